@@ -0,0 +1,275 @@
+/*
+ * core-arena.c - chunked allocation of objects with same size
+ *
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "weechat.h"
+#include "core-arena.h"
+#include "core-log.h"
+
+
+/* alignment of chunk header, slots and objects */
+#define ARENA_ALIGN 16
+#define ARENA_ALIGN_SIZE(__size)                                        \
+    (((__size) + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1))
+
+#define ARENA_CHUNK_HEADER_SIZE                                         \
+    ARENA_ALIGN_SIZE(sizeof (struct t_arena_chunk))
+#define ARENA_SLOT_HEADER_SIZE                                          \
+    ARENA_ALIGN_SIZE(sizeof (struct t_arena_chunk *))
+
+
+/*
+ * Creates a new arena for objects of size "object_size", allocated by
+ * chunks of "objects_per_chunk" objects.
+ *
+ * Returns pointer to arena, NULL if error.
+ */
+
+struct t_arena *
+arena_new (size_t object_size, int objects_per_chunk)
+{
+    struct t_arena *new_arena;
+
+    if ((object_size == 0) || (objects_per_chunk <= 0))
+        return NULL;
+
+    new_arena = malloc (sizeof (*new_arena));
+    if (!new_arena)
+        return NULL;
+
+    /* a released slot must be able to store a pointer (list of free slots) */
+    if (object_size < sizeof (void *))
+        object_size = sizeof (void *);
+
+    new_arena->object_size = object_size;
+    new_arena->slot_size = ARENA_SLOT_HEADER_SIZE
+        + ARENA_ALIGN_SIZE(object_size);
+    new_arena->objects_per_chunk = objects_per_chunk;
+    new_arena->chunks_count = 0;
+    new_arena->objects_count = 0;
+    new_arena->closed = 0;
+    new_arena->chunks = NULL;
+    new_arena->full_chunks = NULL;
+
+    return new_arena;
+}
+
+/*
+ * Adds a chunk at the beginning of a list of chunks.
+ */
+
+void
+arena_chunk_list_add (struct t_arena_chunk **list,
+                      struct t_arena_chunk *chunk)
+{
+    chunk->prev_chunk = NULL;
+    chunk->next_chunk = *list;
+    if (*list)
+        (*list)->prev_chunk = chunk;
+    *list = chunk;
+}
+
+/*
+ * Removes a chunk from a list of chunks.
+ */
+
+void
+arena_chunk_list_remove (struct t_arena_chunk **list,
+                         struct t_arena_chunk *chunk)
+{
+    if (chunk->prev_chunk)
+        (chunk->prev_chunk)->next_chunk = chunk->next_chunk;
+    if (chunk->next_chunk)
+        (chunk->next_chunk)->prev_chunk = chunk->prev_chunk;
+    if (*list == chunk)
+        *list = chunk->next_chunk;
+    chunk->prev_chunk = NULL;
+    chunk->next_chunk = NULL;
+}
+
+/*
+ * Allocates an object in arena.
+ *
+ * Note: content of object is not initialized.
+ *
+ * Returns pointer to object, NULL if error.
+ */
+
+void *
+arena_alloc (struct t_arena *arena)
+{
+    struct t_arena_chunk *ptr_chunk;
+    char *slot;
+
+    if (!arena || arena->closed)
+        return NULL;
+
+    ptr_chunk = arena->chunks;
+    if (!ptr_chunk)
+    {
+        ptr_chunk = malloc (ARENA_CHUNK_HEADER_SIZE
+                            + (arena->slot_size * arena->objects_per_chunk));
+        if (!ptr_chunk)
+            return NULL;
+        ptr_chunk->arena = arena;
+        ptr_chunk->used = 0;
+        ptr_chunk->next_unused = 0;
+        ptr_chunk->free_slots = NULL;
+        arena_chunk_list_add (&arena->chunks, ptr_chunk);
+        arena->chunks_count++;
+    }
+
+    if (ptr_chunk->free_slots)
+    {
+        /* reuse a released slot */
+        slot = (char *)ptr_chunk->free_slots - ARENA_SLOT_HEADER_SIZE;
+        ptr_chunk->free_slots = *((void **)ptr_chunk->free_slots);
+    }
+    else
+    {
+        /* use a slot never used in chunk */
+        slot = (char *)ptr_chunk + ARENA_CHUNK_HEADER_SIZE
+            + (arena->slot_size * ptr_chunk->next_unused);
+        ptr_chunk->next_unused++;
+    }
+    *((struct t_arena_chunk **)slot) = ptr_chunk;
+
+    ptr_chunk->used++;
+    arena->objects_count++;
+
+    /* move chunk in full chunks if there's no more free slot */
+    if (ptr_chunk->used == arena->objects_per_chunk)
+    {
+        arena_chunk_list_remove (&arena->chunks, ptr_chunk);
+        arena_chunk_list_add (&arena->full_chunks, ptr_chunk);
+    }
+
+    return slot + ARENA_SLOT_HEADER_SIZE;
+}
+
+/*
+ * Releases an object allocated in an arena.
+ *
+ * The chunk of object is freed if there are no more objects used in the
+ * chunk, and the arena is freed if it has been closed and that was the last
+ * object used.
+ */
+
+void
+arena_release (void *object)
+{
+    struct t_arena_chunk *ptr_chunk;
+    struct t_arena *ptr_arena;
+
+    if (!object)
+        return;
+
+    ptr_chunk = *((struct t_arena_chunk **)((char *)object
+                                            - ARENA_SLOT_HEADER_SIZE));
+    ptr_arena = ptr_chunk->arena;
+
+    if (ptr_chunk->used == ptr_arena->objects_per_chunk)
+    {
+        arena_chunk_list_remove (&ptr_arena->full_chunks, ptr_chunk);
+        arena_chunk_list_add (&ptr_arena->chunks, ptr_chunk);
+    }
+
+    ptr_chunk->used--;
+    ptr_arena->objects_count--;
+
+    if (ptr_chunk->used == 0)
+    {
+        /* chunk is now empty: give memory back */
+        arena_chunk_list_remove (&ptr_arena->chunks, ptr_chunk);
+        free (ptr_chunk);
+        ptr_arena->chunks_count--;
+        if (ptr_arena->closed && (ptr_arena->chunks_count == 0))
+            free (ptr_arena);
+    }
+    else
+    {
+        *((void **)object) = ptr_chunk->free_slots;
+        ptr_chunk->free_slots = object;
+    }
+}
+
+/*
+ * Returns number of bytes allocated by arena for chunks.
+ */
+
+size_t
+arena_size (struct t_arena *arena)
+{
+    if (!arena)
+        return 0;
+
+    return (size_t)arena->chunks_count
+        * (ARENA_CHUNK_HEADER_SIZE
+           + (arena->slot_size * arena->objects_per_chunk));
+}
+
+/*
+ * Frees an arena.
+ *
+ * If objects are still used in arena, it is marked as closed (no more
+ * allocation is possible) and it is freed when the last object is released.
+ */
+
+void
+arena_free (struct t_arena *arena)
+{
+    if (!arena)
+        return;
+
+    if (arena->objects_count > 0)
+    {
+        arena->closed = 1;
+        return;
+    }
+
+    free (arena);
+}
+
+/*
+ * Prints arena in WeeChat log file (usually for crash dump).
+ */
+
+void
+arena_print_log (struct t_arena *arena, const char *name)
+{
+    log_printf ("[arena %s (addr:%p)]", name, arena);
+    if (!arena)
+        return;
+    log_printf ("  object_size. . . . . . : %zu", arena->object_size);
+    log_printf ("  slot_size. . . . . . . : %zu", arena->slot_size);
+    log_printf ("  objects_per_chunk. . . : %d", arena->objects_per_chunk);
+    log_printf ("  chunks_count . . . . . : %d", arena->chunks_count);
+    log_printf ("  objects_count. . . . . : %d", arena->objects_count);
+    log_printf ("  closed . . . . . . . . : %d", arena->closed);
+    log_printf ("  chunks . . . . . . . . : %p", arena->chunks);
+    log_printf ("  full_chunks. . . . . . : %p", arena->full_chunks);
+}
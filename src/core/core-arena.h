@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_ARENA_H
+#define WEECHAT_ARENA_H
+
+#include <stddef.h>
+
+struct t_arena;
+
+/*
+ * an arena allocates objects of same size in chunks of memory; each object
+ * is preceded by a pointer to its chunk, so that an object can be released
+ * without knowing its arena; a chunk is freed as soon as all its objects
+ * are released
+ */
+
+struct t_arena_chunk
+{
+    struct t_arena *arena;             /* arena                             */
+    int used;                          /* number of objects used            */
+    int next_unused;                   /* index of first never used slot    */
+    void *free_slots;                  /* list of released slots            */
+    struct t_arena_chunk *prev_chunk;  /* link to previous chunk            */
+    struct t_arena_chunk *next_chunk;  /* link to next chunk                */
+};
+
+struct t_arena
+{
+    size_t object_size;                /* size of an object                 */
+    size_t slot_size;                  /* size of a slot (header + object)  */
+    int objects_per_chunk;             /* number of objects in a chunk      */
+    int chunks_count;                  /* number of chunks allocated        */
+    int objects_count;                 /* number of objects used            */
+    int closed;                        /* 1 if arena has been freed while   */
+                                       /* objects were still used           */
+    struct t_arena_chunk *chunks;      /* chunks with at least a free slot  */
+    struct t_arena_chunk *full_chunks; /* chunks without free slot          */
+};
+
+extern struct t_arena *arena_new (size_t object_size, int objects_per_chunk);
+extern void *arena_alloc (struct t_arena *arena);
+extern void arena_release (void *object);
+extern size_t arena_size (struct t_arena *arena);
+extern void arena_free (struct t_arena *arena);
+extern void arena_print_log (struct t_arena *arena, const char *name);
+
+#endif /* WEECHAT_ARENA_H */
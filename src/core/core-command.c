@@ -59,6 +59,7 @@
 #include "core-list.h"
 #include "core-log.h"
 #include "core-network.h"
+#include "core-profile.h"
 #include "core-proxy.h"
 #include "core-secure.h"
 #include "core-secure-buffer.h"
@@ -2037,7 +2038,7 @@ COMMAND_CALLBACK(debug)
     struct t_config_option *ptr_option;
     struct t_weechat_plugin *ptr_plugin;
     struct timeval time_start, time_end;
-    char *result, *str_threshold;
+    char *result, *str_threshold, *path;
     long long threshold;
     int debug;
 
@@ -2201,6 +2202,57 @@ COMMAND_CALLBACK(debug)
         return WEECHAT_RC_OK;
     }
 
+    if (string_strcmp (argv[1], "profile") == 0)
+    {
+        COMMAND_MIN_ARGS(3, argv[1]);
+        if (string_strcmp (argv[2], "start") == 0)
+        {
+            if (profile_start ((argc > 3)
+                               && (string_strcmp (argv[3], "memory") == 0)))
+            {
+                gui_chat_printf (NULL,
+                                 (profile_memory) ?
+                                 _("Profiler started (with memory)") :
+                                 _("Profiler started"));
+            }
+            else
+            {
+                gui_chat_printf (NULL, _("Profiler is already running"));
+            }
+            return WEECHAT_RC_OK;
+        }
+        if (string_strcmp (argv[2], "stop") == 0)
+        {
+            if (profile_stop ())
+                gui_chat_printf (NULL, _("Profiler stopped"));
+            else
+                gui_chat_printf (NULL, _("Profiler is not running"));
+            return WEECHAT_RC_OK;
+        }
+        if (string_strcmp (argv[2], "dump") == 0)
+        {
+            profile_display ();
+            path = profile_write_folded ((argc > 3) ? argv_eol[3] : NULL);
+            if (path)
+            {
+                gui_chat_printf (NULL,
+                                 _("Stacks of calls written in file \"%s\""),
+                                 path);
+                free (path);
+            }
+            else
+            {
+                gui_chat_printf (NULL,
+                                 _("%sUnable to write stacks of calls in "
+                                   "file \"%s\""),
+                                 gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                                 (argc > 3) ? argv_eol[3] : PROFILE_DEFAULT_FILE);
+            }
+            return WEECHAT_RC_OK;
+        }
+        COMMAND_ERROR;
+    }
+
     if (string_strcmp (argv[1], "set") == 0)
     {
         COMMAND_MIN_ARGS(4, argv[1]);
@@ -7368,6 +7420,7 @@ COMMAND_CALLBACK(upgrade)
         (void) config_weechat_write ();
     gui_main_end (1);
     log_close ();
+    hook_end ();
 
     if (quit)
     {
@@ -8335,6 +8388,7 @@ command_init ()
            " || callbacks <duration>[<unit>]"
            " || mouse|cursor [verbose]"
            " || hdata [free]"
+           " || profile start [memory]|stop|dump [<file>]"
            " || time <command>"
            " || unicode <string>"),
         CMD_ARGS_DESC(
@@ -8368,6 +8422,17 @@ command_init ()
             N_("raw[libs]: display infos about external libraries used"),
             N_("raw[memory]: display infos about memory usage"),
             N_("raw[mouse]: toggle debug for mouse"),
+            N_("raw[profile]: profile callbacks of hooks and phases of main "
+               "loop (number of calls, total and max time, and with "
+               "\"memory\", which is slower: memory delta, ie memory "
+               "allocated minus memory freed, in bytes, can be negative):"),
+            N_("> raw[start]: start profiler (previous data is removed)"),
+            N_("> raw[stop]: stop profiler (data is kept)"),
+            N_("> raw[dump]: display data in core buffer and write stacks of "
+               "calls in a file (format \"folded stacks\" used to build a "
+               "flame graph), default file is "
+               "\"${weechat_state_dir}/profile.folded\" (file is evaluated, "
+               "see /help eval)"),
             N_("raw[tags]: display tags for lines"),
             N_("raw[term]: display infos about terminal"),
             N_("raw[url]: toggle debug for calls to hook_url (display output hashtable)"),
@@ -8381,6 +8446,8 @@ command_init ()
             AI("  /debug set irc 1"),
             AI("  /debug mouse verbose"),
             AI("  /debug time /filter toggle"),
+            AI("  /debug profile start"),
+            AI("  /debug profile dump"),
             AI("  /debug unicode ${chars:${\\u26C0}-${\\u26CF}}")),
         "list"
         " || set %(plugins_names)|" PLUGIN_CORE
@@ -8398,6 +8465,9 @@ command_init ()
         " || libs"
         " || memory"
         " || mouse verbose"
+        " || profile start memory"
+        " || profile stop"
+        " || profile dump"
         " || tags"
         " || term"
         " || url"
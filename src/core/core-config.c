@@ -358,6 +358,7 @@ regex_t *config_highlight_disable_regex = NULL;
 regex_t *config_highlight_regex = NULL;
 char ***config_highlight_tags = NULL;
 int config_num_highlight_tags = 0;
+struct t_gui_line_tags_cond *config_highlight_tags_cond = NULL;
 char **config_plugin_extensions = NULL;
 int config_num_plugin_extensions = 0;
 char config_tab_spaces[TAB_MAX_WIDTH + 1];
@@ -642,6 +643,7 @@ config_change_buffers (const void *pointer, void *data,
     (void) data;
     (void) option;
 
+    gui_window_line_heights_invalidate_all ();
     gui_window_ask_refresh (1);
 }
 
@@ -658,6 +660,8 @@ config_change_buffer_content (const void *pointer, void *data,
     (void) data;
     (void) option;
 
+    gui_window_line_heights_invalidate_all ();
+
     if (gui_init_ok)
         gui_current_window->refresh_needed = 1;
 }
@@ -732,6 +736,7 @@ config_change_buffer_time_format (const void *pointer, void *data,
 
     gui_chat_time_length = gui_chat_get_time_length ();
     gui_chat_change_time_format ();
+    gui_window_line_heights_invalidate_all ();
     if (gui_init_ok)
         gui_window_ask_refresh (1);
 }
@@ -753,6 +758,7 @@ config_change_buffer_time_same (const void *pointer, void *data,
     config_buffer_time_same_evaluated = eval_expression (
         CONFIG_STRING(config_look_buffer_time_same), NULL, NULL, NULL);
 
+    gui_window_line_heights_invalidate_all ();
     gui_window_ask_refresh (1);
 }
 
@@ -897,6 +903,7 @@ config_change_nick_prefix_suffix (const void *pointer, void *data,
         + gui_chat_strlen_screen (CONFIG_STRING(config_look_nick_suffix));
 
     config_compute_prefix_max_length_all_buffers ();
+    gui_window_line_heights_invalidate_all ();
     gui_window_ask_refresh (1);
 }
 
@@ -917,6 +924,7 @@ config_change_prefix_same_nick (const void *pointer, void *data,
         gui_chat_strlen_screen (CONFIG_STRING(config_look_prefix_same_nick));
 
     config_compute_prefix_max_length_all_buffers ();
+    gui_window_line_heights_invalidate_all ();
     gui_window_ask_refresh (1);
 }
 
@@ -937,6 +945,7 @@ config_change_prefix_same_nick_middle (const void *pointer, void *data,
         gui_chat_strlen_screen (CONFIG_STRING(config_look_prefix_same_nick_middle));
 
     config_compute_prefix_max_length_all_buffers ();
+    gui_window_line_heights_invalidate_all ();
     gui_window_ask_refresh (1);
 }
 
@@ -1090,6 +1099,8 @@ config_change_highlight_tags (const void *pointer, void *data,
         config_highlight_tags = NULL;
     }
     config_num_highlight_tags = 0;
+    gui_line_tags_cond_free (config_highlight_tags_cond);
+    config_highlight_tags_cond = NULL;
 
     if (CONFIG_STRING(config_look_highlight_tags)
         && CONFIG_STRING(config_look_highlight_tags)[0])
@@ -1097,6 +1108,9 @@ config_change_highlight_tags (const void *pointer, void *data,
         config_highlight_tags = string_split_tags (
             CONFIG_STRING(config_look_highlight_tags),
             &config_num_highlight_tags);
+        config_highlight_tags_cond = gui_line_tags_cond_new (
+            config_num_highlight_tags,
+            config_highlight_tags);
     }
 }
 
@@ -1223,6 +1237,7 @@ config_change_read_marker (const void *pointer, void *data,
     (void) data;
     (void) option;
 
+    gui_window_line_heights_invalidate_all ();
     gui_window_ask_refresh (1);
 }
 
@@ -1256,6 +1271,7 @@ config_change_prefix_align_min (const void *pointer, void *data,
     (void) option;
 
     config_compute_prefix_max_length_all_buffers ();
+    gui_window_line_heights_invalidate_all ();
     gui_window_ask_refresh (1);
 }
 
@@ -1326,6 +1342,7 @@ config_change_tab_width (const void *pointer, void *data,
     memset (config_tab_spaces, ' ', CONFIG_INTEGER(config_look_tab_width));
     config_tab_spaces[CONFIG_INTEGER(config_look_tab_width)] = '\0';
 
+    gui_window_line_heights_invalidate_all ();
     gui_window_ask_refresh (1);
 }
 
@@ -5586,6 +5603,8 @@ config_weechat_free ()
         config_highlight_tags = NULL;
     }
     config_num_highlight_tags = 0;
+    gui_line_tags_cond_free (config_highlight_tags_cond);
+    config_highlight_tags_cond = NULL;
 
     if (config_plugin_extensions)
     {
@@ -27,6 +27,7 @@
 #include "core-config-file.h"
 
 struct t_gui_buffer;
+struct t_gui_line_tags_cond;
 
 #define WEECHAT_CONFIG_NAME "weechat"
 #define WEECHAT_CONFIG_PRIO_NAME "110000|weechat"
@@ -394,6 +395,7 @@ extern regex_t *config_highlight_disable_regex;
 extern regex_t *config_highlight_regex;
 extern char ***config_highlight_tags;
 extern int config_num_highlight_tags;
+extern struct t_gui_line_tags_cond *config_highlight_tags_cond;
 extern char **config_plugin_extensions;
 extern int config_num_plugin_extensions;
 extern char config_tab_spaces[];
@@ -66,6 +66,7 @@
 #include "../gui/gui-hotlist.h"
 #include "../gui/gui-key.h"
 #include "../gui/gui-layout.h"
+#include "../gui/gui-line.h"
 #include "../gui/gui-main.h"
 #include "../gui/gui-window.h"
 #include "../plugins/plugin.h"
@@ -343,6 +344,45 @@ debug_windows_tree ()
     debug_windows_tree_display (gui_windows_tree, 1);
 }
 
+/*
+ * Displays memory used by lines in each buffer.
+ */
+
+void
+debug_memory_buffers ()
+{
+    struct t_gui_buffer *ptr_buffer;
+    size_t size_structs, size_strings, total_structs, total_strings;
+    int total_lines;
+
+    total_lines = 0;
+    total_structs = 0;
+    total_strings = 0;
+
+    gui_chat_printf (NULL, "");
+    gui_chat_printf (NULL, _("Memory used by lines in buffers:"));
+    for (ptr_buffer = gui_buffers; ptr_buffer;
+         ptr_buffer = ptr_buffer->next_buffer)
+    {
+        gui_line_lines_memory (ptr_buffer, &size_structs, &size_strings);
+        gui_chat_printf (NULL,
+                         "  %s: %d lines - structs: %zu, strings: %zu "
+                         "(total: %zu bytes)",
+                         ptr_buffer->full_name,
+                         ptr_buffer->own_lines->lines_count,
+                         size_structs, size_strings,
+                         size_structs + size_strings);
+        total_lines += ptr_buffer->own_lines->lines_count;
+        total_structs += size_structs;
+        total_strings += size_strings;
+    }
+    gui_chat_printf (NULL,
+                     "  Total: %d lines - structs: %zu, strings: %zu "
+                     "(total: %zu bytes)",
+                     total_lines, total_structs, total_strings,
+                     total_structs + total_strings);
+}
+
 /*
  * Displays information about dynamic memory allocation.
  */
@@ -391,6 +431,8 @@ debug_memory ()
                        "found)"));
 #endif /* HAVE_MALLINFO */
 #endif /* HAVE_MALLINFO2 */
+
+    debug_memory_buffers ();
 }
 
 /*
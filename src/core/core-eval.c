@@ -24,6 +24,7 @@
 #endif
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
 #include <regex.h>
@@ -87,6 +88,11 @@ char *eval_range_chars[][2] =
     { NULL,     NULL },
 };
 
+struct t_hashtable *eval_cache_conditions = NULL; /* compiled conditions */
+int eval_cache_conditions_running = 0; /* > 0 if compiled conditions are    */
+                                       /* being evaluated                   */
+struct t_hashtable *eval_cache_regex = NULL; /* compiled regex (=~ and !~)  */
+
 char *eval_replace_vars (const char *expr,
                          struct t_eval_context *eval_context);
 char *eval_expression_condition (const char *expr,
@@ -2116,6 +2122,80 @@ eval_replace_vars (const char *expr, struct t_eval_context *eval_context)
     return result;
 }
 
+/*
+ * Frees a compiled regex in cache.
+ */
+
+void
+eval_regex_free_cb (struct t_hashtable *hashtable,
+                    const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    if (value)
+    {
+        regfree ((regex_t *)value);
+        free (value);
+    }
+}
+
+/*
+ * Gets a compiled regex (used for comparisons "=~" and "!~") from cache;
+ * the regex is compiled and added in cache if not found.
+ *
+ * The cache is cleared when it has EVAL_CACHE_REGEX_MAX regex.
+ *
+ * Returns pointer to compiled regex, NULL if error (invalid regex).
+ */
+
+regex_t *
+eval_regex_get (const char *regex)
+{
+    regex_t *ptr_regex;
+
+    if (!regex)
+        return NULL;
+
+    if (!eval_cache_regex)
+    {
+        eval_cache_regex = hashtable_new (64,
+                                          WEECHAT_HASHTABLE_STRING,
+                                          WEECHAT_HASHTABLE_POINTER,
+                                          NULL, NULL);
+        if (!eval_cache_regex)
+            return NULL;
+        eval_cache_regex->callback_free_value = &eval_regex_free_cb;
+    }
+
+    ptr_regex = hashtable_get (eval_cache_regex, regex);
+    if (ptr_regex)
+        return ptr_regex;
+
+    ptr_regex = malloc (sizeof (*ptr_regex));
+    if (!ptr_regex)
+        return NULL;
+    if (string_regcomp (ptr_regex, regex,
+                        REG_EXTENDED | REG_ICASE | REG_NOSUB) != 0)
+    {
+        free (ptr_regex);
+        return NULL;
+    }
+
+    if (eval_cache_regex->items_count >= EVAL_CACHE_REGEX_MAX)
+        hashtable_remove_all (eval_cache_regex);
+
+    if (!hashtable_set (eval_cache_regex, regex, ptr_regex))
+    {
+        regfree (ptr_regex);
+        free (ptr_regex);
+        return NULL;
+    }
+
+    return ptr_regex;
+}
+
 /*
  * Compares two expressions.
  *
@@ -2135,7 +2215,7 @@ eval_compare (const char *expr1, int comparison, const char *expr2,
               struct t_eval_context *eval_context)
 {
     int rc, string_compare, length1, length2, debug_id;
-    regex_t regex;
+    regex_t *ptr_regex;
     double value1, value2;
     char *error, *value;
 
@@ -2151,13 +2231,10 @@ eval_compare (const char *expr1, int comparison, const char *expr2,
     if ((comparison == EVAL_COMPARE_REGEX_MATCHING)
         || (comparison == EVAL_COMPARE_REGEX_NOT_MATCHING))
     {
-        if (string_regcomp (&regex, expr2,
-                            REG_EXTENDED | REG_ICASE | REG_NOSUB) != 0)
-        {
+        ptr_regex = eval_regex_get (expr2);
+        if (!ptr_regex)
             goto end;
-        }
-        rc = (regexec (&regex, expr1, 0, NULL, 0) == 0) ? 1 : 0;
-        regfree (&regex);
+        rc = (regexec (ptr_regex, expr1, 0, NULL, 0) == 0) ? 1 : 0;
         if (comparison == EVAL_COMPARE_REGEX_NOT_MATCHING)
             rc ^= 1;
         goto end;
@@ -2261,7 +2338,8 @@ end:
 }
 
 /*
- * Evaluates a condition (this function must not be called directly).
+ * Evaluates a condition without compiling it (this function must not be
+ * called directly).
  *
  * For return value, see function eval_expression().
  *
@@ -2269,8 +2347,8 @@ end:
  */
 
 char *
-eval_expression_condition (const char *expr,
-                           struct t_eval_context *eval_context)
+eval_expression_condition_uncompiled (const char *expr,
+                                      struct t_eval_context *eval_context)
 {
     int logic, comp, length, level, rc, debug_id;
     const char *pos, *pos_end;
@@ -2483,6 +2561,443 @@ end:
     return value;
 }
 
+/*
+ * Creates a new node of compiled condition.
+ *
+ * Returns pointer to new node, NULL if error.
+ */
+
+struct t_eval_node *
+eval_node_new (enum t_eval_node_type type, int op, const char *text,
+               struct t_eval_context *eval_context)
+{
+    struct t_eval_node *new_node;
+
+    new_node = malloc (sizeof (*new_node));
+    if (!new_node)
+        return NULL;
+
+    new_node->type = type;
+    new_node->op = op;
+    new_node->text = NULL;
+    new_node->constant = 0;
+    new_node->left = NULL;
+    new_node->right = NULL;
+
+    if (text)
+    {
+        new_node->text = strdup (text);
+        if (!new_node->text)
+        {
+            free (new_node);
+            return NULL;
+        }
+        /* no variable neither escaped prefix: value is the text itself */
+        new_node->constant = (strchr (text, eval_context->prefix[0])) ? 0 : 1;
+    }
+
+    return new_node;
+}
+
+/*
+ * Frees a node of compiled condition (and its children).
+ */
+
+void
+eval_node_free (struct t_eval_node *node)
+{
+    if (!node)
+        return;
+
+    free (node->text);
+    eval_node_free (node->left);
+    eval_node_free (node->right);
+    free (node);
+}
+
+/*
+ * Creates a node with two children; children are freed if the node can not
+ * be created.
+ *
+ * Returns pointer to new node, NULL if error.
+ */
+
+struct t_eval_node *
+eval_node_new_children (enum t_eval_node_type type, int op,
+                        struct t_eval_node *left, struct t_eval_node *right,
+                        struct t_eval_context *eval_context)
+{
+    struct t_eval_node *new_node;
+
+    new_node = (left && (right || (type == EVAL_NODE_PARENTHESES))) ?
+        eval_node_new (type, op, NULL, eval_context) : NULL;
+    if (!new_node)
+    {
+        eval_node_free (left);
+        eval_node_free (right);
+        return NULL;
+    }
+
+    new_node->left = left;
+    new_node->right = right;
+
+    return new_node;
+}
+
+/*
+ * Compiles a condition: the expression is split on logical operators,
+ * comparisons and parentheses exactly like function
+ * eval_expression_condition_uncompiled does, but only once; the result is a
+ * tree which is evaluated by function eval_node_evaluate.
+ *
+ * Returns pointer to root node, NULL if error.
+ */
+
+struct t_eval_node *
+eval_compile_condition (const char *expr, struct t_eval_context *eval_context)
+{
+    int logic, comp, level;
+    const char *pos, *pos_end;
+    char *expr2, *sub_expr;
+    struct t_eval_node *node, *left;
+
+    if (!expr)
+        return NULL;
+
+    /* skip spaces at beginning and end of string */
+    while (expr[0] == ' ')
+    {
+        expr++;
+    }
+    if (!expr[0])
+        return eval_node_new (EVAL_NODE_VALUE, 0, "", eval_context);
+    pos_end = expr + strlen (expr) - 1;
+    while ((pos_end > expr) && (pos_end[0] == ' '))
+    {
+        pos_end--;
+    }
+
+    expr2 = string_strndup (expr, pos_end + 1 - expr);
+    if (!expr2)
+        return NULL;
+
+    node = NULL;
+
+    /* logical operator */
+    for (logic = 0; logic < EVAL_NUM_LOGICAL_OPS; logic++)
+    {
+        pos = eval_strstr_level (expr2, eval_logical_ops[logic], eval_context,
+                                 "(", ")", 0);
+        if (pos > expr2)
+        {
+            pos_end = pos - 1;
+            while ((pos_end > expr2) && (pos_end[0] == ' '))
+            {
+                pos_end--;
+            }
+            sub_expr = string_strndup (expr2, pos_end + 1 - expr2);
+            if (!sub_expr)
+                goto end;
+            left = eval_compile_condition (sub_expr, eval_context);
+            free (sub_expr);
+            pos += strlen (eval_logical_ops[logic]);
+            node = eval_node_new_children (
+                EVAL_NODE_LOGICAL, logic,
+                left,
+                eval_compile_condition (pos, eval_context),
+                eval_context);
+            goto end;
+        }
+    }
+
+    /* comparison */
+    for (comp = 0; comp < EVAL_NUM_COMPARISONS; comp++)
+    {
+        pos = eval_strstr_level (expr2, eval_comparisons[comp], eval_context,
+                                 "(", ")", 0);
+        if (pos >= expr2)
+        {
+            if (pos > expr2)
+            {
+                pos_end = pos - 1;
+                while ((pos_end > expr2) && (pos_end[0] == ' '))
+                {
+                    pos_end--;
+                }
+                sub_expr = string_strndup (expr2, pos_end + 1 - expr2);
+            }
+            else
+            {
+                sub_expr = strdup ("");
+            }
+            if (!sub_expr)
+                goto end;
+            pos += strlen (eval_comparisons[comp]);
+            while (pos[0] == ' ')
+            {
+                pos++;
+            }
+            if ((comp == EVAL_COMPARE_REGEX_MATCHING)
+                || (comp == EVAL_COMPARE_REGEX_NOT_MATCHING))
+            {
+                /* for regex: just replace vars in both expressions */
+                left = eval_node_new (EVAL_NODE_VALUE, 0, sub_expr,
+                                      eval_context);
+                node = eval_node_new_children (
+                    EVAL_NODE_COMPARE, comp,
+                    left,
+                    eval_node_new (EVAL_NODE_VALUE, 0, pos, eval_context),
+                    eval_context);
+            }
+            else
+            {
+                /* other comparison: fully evaluate both expressions */
+                left = eval_compile_condition (sub_expr, eval_context);
+                node = eval_node_new_children (
+                    EVAL_NODE_COMPARE, comp,
+                    left,
+                    eval_compile_condition (pos, eval_context),
+                    eval_context);
+            }
+            free (sub_expr);
+            goto end;
+        }
+    }
+
+    /* sub-expression between parentheses */
+    if (expr2[0] == '(')
+    {
+        level = 0;
+        pos = expr2 + 1;
+        while (pos[0])
+        {
+            if (pos[0] == '(')
+                level++;
+            else if (pos[0] == ')')
+            {
+                if (level == 0)
+                    break;
+                level--;
+            }
+            pos++;
+        }
+        if ((pos[0] == ')') && !pos[1])
+        {
+            /* nothing around parentheses: value of sub-expression as-is */
+            sub_expr = string_strndup (expr2 + 1, pos - expr2 - 1);
+            if (!sub_expr)
+                goto end;
+            node = eval_node_new_children (
+                EVAL_NODE_PARENTHESES, 0,
+                eval_compile_condition (sub_expr, eval_context),
+                NULL,
+                eval_context);
+            free (sub_expr);
+        }
+        else
+        {
+            /*
+             * the value of sub-expression is inserted in the expression
+             * which is then parsed again: it can not be compiled
+             */
+            node = eval_node_new (EVAL_NODE_UNCOMPILED, 0, expr2,
+                                  eval_context);
+        }
+        goto end;
+    }
+
+    /* no logical operator neither comparison: just replace variables */
+    node = eval_node_new (EVAL_NODE_VALUE, 0, expr2, eval_context);
+
+end:
+    free (expr2);
+    return node;
+}
+
+/*
+ * Evaluates a node of compiled condition.
+ *
+ * Note: result must be freed after use (if not NULL).
+ */
+
+char *
+eval_node_evaluate (struct t_eval_node *node,
+                    struct t_eval_context *eval_context)
+{
+    char *value, *value2, *result;
+    int rc;
+
+    switch (node->type)
+    {
+        case EVAL_NODE_VALUE:
+            if (node->constant
+                && (eval_context->recursion_count + 1 < EVAL_RECURSION_MAX))
+            {
+                return strdup (node->text);
+            }
+            return eval_replace_vars (node->text, eval_context);
+        case EVAL_NODE_LOGICAL:
+            value = eval_node_evaluate (node->left, eval_context);
+            rc = eval_is_true (value);
+            free (value);
+            /*
+             * if rc == 0 with "&&" or rc == 1 with "||", no need to
+             * evaluate second sub-expression
+             */
+            if ((rc && (node->op == EVAL_LOGICAL_OP_AND))
+                || (!rc && (node->op == EVAL_LOGICAL_OP_OR)))
+            {
+                value = eval_node_evaluate (node->right, eval_context);
+                rc = eval_is_true (value);
+                free (value);
+            }
+            return strdup ((rc) ? EVAL_STR_TRUE : EVAL_STR_FALSE);
+        case EVAL_NODE_COMPARE:
+            value = eval_node_evaluate (node->left, eval_context);
+            value2 = eval_node_evaluate (node->right, eval_context);
+            result = eval_compare (value, node->op, value2,
+                                   eval_context);
+            free (value);
+            free (value2);
+            return result;
+        case EVAL_NODE_PARENTHESES:
+            return eval_node_evaluate (node->left, eval_context);
+        case EVAL_NODE_UNCOMPILED:
+            return eval_expression_condition_uncompiled (node->text,
+                                                         eval_context);
+        case EVAL_NUM_NODE_TYPES:
+            break;
+    }
+
+    return NULL;
+}
+
+/*
+ * Frees a compiled condition in cache.
+ */
+
+void
+eval_cache_conditions_free_cb (struct t_hashtable *hashtable,
+                               const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    eval_node_free ((struct t_eval_node *)value);
+}
+
+/*
+ * Gets a compiled condition from cache; the condition is compiled and added
+ * in cache if not found.
+ *
+ * The key in cache is built with the prefix, suffix and the expression
+ * (the compiled condition depends on prefix/suffix).
+ *
+ * If the cache is full and compiled conditions are being evaluated (so the
+ * cache can not be cleared), the compiled condition is not added in cache
+ * and "temporary" is set to 1: the caller must free it after use.
+ *
+ * Returns pointer to compiled condition, NULL if error.
+ */
+
+struct t_eval_node *
+eval_cache_conditions_get (const char *expr,
+                           struct t_eval_context *eval_context,
+                           int *temporary)
+{
+    struct t_eval_node *node;
+    char *key;
+    int length;
+
+    *temporary = 0;
+
+    if (!eval_cache_conditions)
+    {
+        eval_cache_conditions = hashtable_new (256,
+                                               WEECHAT_HASHTABLE_STRING,
+                                               WEECHAT_HASHTABLE_POINTER,
+                                               NULL, NULL);
+        if (!eval_cache_conditions)
+            return NULL;
+        eval_cache_conditions->callback_free_value = &eval_cache_conditions_free_cb;
+    }
+
+    length = 32 + eval_context->length_prefix + eval_context->length_suffix
+        + strlen (expr) + 1;
+    key = malloc (length);
+    if (!key)
+        return NULL;
+    snprintf (key, length, "%d,%d:%s%s%s",
+              eval_context->length_prefix,
+              eval_context->length_suffix,
+              eval_context->prefix,
+              eval_context->suffix,
+              expr);
+
+    node = hashtable_get (eval_cache_conditions, key);
+    if (node)
+        goto end;
+
+    node = eval_compile_condition (expr, eval_context);
+    if (!node)
+        goto end;
+
+    if (eval_cache_conditions->items_count >= EVAL_CACHE_CONDITIONS_MAX)
+    {
+        if (eval_cache_conditions_running > 0)
+        {
+            *temporary = 1;
+            goto end;
+        }
+        hashtable_remove_all (eval_cache_conditions);
+    }
+
+    if (!hashtable_set (eval_cache_conditions, key, node))
+        *temporary = 1;
+
+end:
+    free (key);
+    return node;
+}
+
+/*
+ * Evaluates a condition (this function must not be called directly).
+ *
+ * The condition is compiled once and kept in cache, then evaluated with
+ * the compiled version; with debug, the condition is not compiled, so that
+ * the debug output shows all steps of evaluation.
+ *
+ * For return value, see function eval_expression().
+ *
+ * Note: result must be freed after use (if not NULL).
+ */
+
+char *
+eval_expression_condition (const char *expr,
+                           struct t_eval_context *eval_context)
+{
+    struct t_eval_node *node;
+    char *value;
+    int temporary;
+
+    if (!expr || (eval_context->debug_level > 0))
+        return eval_expression_condition_uncompiled (expr, eval_context);
+
+    node = eval_cache_conditions_get (expr, eval_context, &temporary);
+    if (!node)
+        return eval_expression_condition_uncompiled (expr, eval_context);
+
+    eval_cache_conditions_running++;
+    value = eval_node_evaluate (node, eval_context);
+    eval_cache_conditions_running--;
+
+    if (temporary)
+        eval_node_free (node);
+
+    return value;
+}
+
 /*
  * Replaces text in a string using a regular expression and replacement text.
  *
@@ -2877,3 +3392,22 @@ eval_expression (const char *expr, struct t_hashtable *pointers,
 
     return value;
 }
+
+/*
+ * Frees all allocated data.
+ */
+
+void
+eval_end ()
+{
+    if (eval_cache_conditions)
+    {
+        hashtable_free (eval_cache_conditions);
+        eval_cache_conditions = NULL;
+    }
+    if (eval_cache_regex)
+    {
+        hashtable_free (eval_cache_regex);
+        eval_cache_regex = NULL;
+    }
+}
@@ -30,6 +30,9 @@
 
 #define EVAL_RECURSION_MAX  32
 
+#define EVAL_CACHE_CONDITIONS_MAX 1024
+#define EVAL_CACHE_REGEX_MAX      256
+
 #define EVAL_RANGE_DIGIT    "0123456789"
 #define EVAL_RANGE_XDIGIT   EVAL_RANGE_DIGIT "abcdefABCDEF"
 #define EVAL_RANGE_LOWER    "abcdefghijklmnopqrstuvwxyz"
@@ -73,6 +76,30 @@ enum t_eval_comparison
     EVAL_NUM_COMPARISONS,
 };
 
+enum t_eval_node_type
+{
+    EVAL_NODE_VALUE = 0,               /* replace variables in text         */
+    EVAL_NODE_LOGICAL,                 /* logical operator (left, right)    */
+    EVAL_NODE_COMPARE,                 /* comparison (left, right)          */
+    EVAL_NODE_PARENTHESES,             /* sub-expression (left)             */
+    EVAL_NODE_UNCOMPILED,              /* condition evaluated without       */
+                                       /* compilation                       */
+    /* number of node types */
+    EVAL_NUM_NODE_TYPES,
+};
+
+/* node of a compiled condition */
+
+struct t_eval_node
+{
+    enum t_eval_node_type type;        /* type of node                      */
+    int op;                            /* logical operator or comparison    */
+    char *text;                        /* text (value or uncompiled)        */
+    int constant;                      /* 1 if text has no variable         */
+    struct t_eval_node *left;          /* left sub-expression               */
+    struct t_eval_node *right;         /* right sub-expression              */
+};
+
 struct t_eval_regex
 {
     const char *result;
@@ -101,10 +128,18 @@ struct t_eval_context
     char **debug_output;               /* string with debug output          */
 };
 
+extern struct t_hashtable *eval_cache_conditions;
+extern struct t_hashtable *eval_cache_regex;
+
 extern int eval_is_true (const char *value);
+extern regex_t *eval_regex_get (const char *regex);
+extern struct t_eval_node *eval_compile_condition (const char *expr,
+                                                   struct t_eval_context *eval_context);
+extern void eval_node_free (struct t_eval_node *node);
 extern char *eval_expression (const char *expr,
                               struct t_hashtable *pointers,
                               struct t_hashtable *extra_vars,
                               struct t_hashtable *options);
+extern void eval_end ();
 
 #endif /* WEECHAT_EVAL_H */
@@ -37,6 +37,7 @@
 #include "core-hashtable.h"
 #include "core-infolist.h"
 #include "core-log.h"
+#include "core-profile.h"
 #include "core-signal.h"
 #include "core-string.h"
 #include "core-util.h"
@@ -59,11 +60,12 @@ int hook_socketpair_ok = 0;            /* 1 if socketpair() is OK           */
 
 /* hook callbacks */
 t_callback_hook *hook_callback_add[HOOK_NUM_TYPES] =
-{ NULL, NULL, NULL, &hook_fd_add_cb, NULL, NULL, NULL, NULL, NULL, NULL,
-  NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+{ NULL, NULL, NULL, &hook_fd_add_cb, NULL, NULL, NULL, NULL,
+  &hook_signal_add_cb, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+  NULL };
 t_callback_hook *hook_callback_remove[HOOK_NUM_TYPES] =
-{ NULL, NULL, NULL, &hook_fd_remove_cb, NULL, NULL, NULL, NULL, NULL, NULL,
-  NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+{ NULL, NULL, &hook_timer_remove_cb, &hook_fd_remove_cb, NULL, NULL, NULL,
+  NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
 t_callback_hook *hook_callback_free_data[HOOK_NUM_TYPES] =
 {
     &hook_command_free_data,
@@ -498,6 +500,9 @@ hook_callback_start (struct t_hook *hook, struct t_hook_exec_cb *hook_exec_cb)
         hook_exec_cb->start_time.tv_sec = 0;
         hook_exec_cb->start_time.tv_usec = 0;
     }
+
+    hook_exec_cb->profile_id = (profile_enabled) ?
+        profile_frame_start_hook (hook) : 0;
 }
 
 /*
@@ -516,6 +521,9 @@ hook_callback_end (struct t_hook *hook, struct t_hook_exec_cb *hook_exec_cb)
     else
         hook->running = 0;
 
+    if (hook_exec_cb->profile_id)
+        profile_frame_end (hook_exec_cb->profile_id);
+
     if ((debug_long_callbacks > 0)
         && (hook_exec_cb->start_time.tv_sec > 0))
     {
@@ -596,6 +604,21 @@ hook_set (struct t_hook *hook, const char *property, const char *value)
             HOOK_PROCESS(hook, child_write[HOOK_PROCESS_STDIN]) = -1;
         }
     }
+    else if ((strcmp (property, "read") == 0)
+             || (strcmp (property, "write") == 0)
+             || (strcmp (property, "exception") == 0))
+    {
+        if (!hook->deleted && (hook->type == HOOK_TYPE_FD) && value)
+        {
+            hook_fd_set_flag (
+                hook,
+                (strcmp (property, "read") == 0) ?
+                HOOK_FD_FLAG_READ :
+                ((strcmp (property, "write") == 0) ?
+                 HOOK_FD_FLAG_WRITE : HOOK_FD_FLAG_EXCEPTION),
+                (strcmp (value, "1") == 0) ? 1 : 0);
+        }
+    }
     else if (strcmp (property, "signal") == 0)
     {
         if (!hook->deleted
@@ -767,6 +790,18 @@ unhook_all ()
     }
 }
 
+/*
+ * Ends hooks: frees data shared by hooks of a type (called on exit after
+ * all hooks have been removed, and on upgrade).
+ */
+
+void
+hook_end ()
+{
+    hook_fd_end ();
+    hook_signal_index_free ();
+}
+
 /*
  * Adds a hook in an infolist.
  *
@@ -116,6 +116,7 @@ struct t_hook_exec_cb
 {
     struct timeval start_time;         /* callback exec star time (to trace */
                                        /* long running callbacks)           */
+    int profile_id;                    /* id of profile (0 = not profiled)  */
 };
 
 /* hook variables */
@@ -151,6 +152,7 @@ extern void unhook (struct t_hook *hook);
 extern void unhook_all_plugin (struct t_weechat_plugin *plugin,
                                const char *subplugin);
 extern void unhook_all ();
+extern void hook_end ();
 extern int hook_add_to_infolist (struct t_infolist *infolist,
                                  struct t_hook *hook,
                                  const char *arguments);
@@ -0,0 +1,826 @@
+/*
+ * core-profile.c - profiler for callbacks of hooks and main loop
+ *
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#if defined(HAVE_MALLINFO) || defined(HAVE_MALLINFO2)
+#include <malloc.h>
+#endif
+
+#include "weechat.h"
+#include "core-profile.h"
+#include "core-arraylist.h"
+#include "core-hashtable.h"
+#include "core-hook.h"
+#include "core-infolist.h"
+#include "core-string.h"
+#include "core-util.h"
+#include "../gui/gui-chat.h"
+#include "../plugins/plugin.h"
+
+
+char *profile_phase_string[PROFILE_NUM_PHASES] =
+{ "timers", "refreshes", "fd", "wait", "process", "signals" };
+
+int profile_enabled = 0;               /* 1 if profiler is running          */
+int profile_memory = 0;                /* 1 if memory is measured           */
+int profile_id = 0;                    /* id of profile, incremented on     */
+                                       /* each reset (calls started with    */
+                                       /* another id are ignored)           */
+struct timeval profile_start_time;     /* start of profile                  */
+struct timeval profile_stop_time;      /* stop of profile                   */
+
+struct t_hashtable *profile_stats = NULL;   /* stats by hook (frame name)   */
+struct t_profile_node *profile_root = NULL; /* root of tree of calls        */
+
+struct t_profile_frame profile_stack[PROFILE_STACK_MAX]; /* calls running   */
+int profile_stack_depth = 0;
+
+void profile_write_node (FILE *file, const char *path,
+                         struct t_profile_node *node);
+
+
+/*
+ * Returns memory currently allocated (in bytes), 0 if not available.
+ */
+
+long long
+profile_memory_used ()
+{
+#ifdef HAVE_MALLINFO2
+    struct mallinfo2 info;
+
+    info = mallinfo2 ();
+    return (long long)info.uordblks + (long long)info.hblkhd;
+#else
+#ifdef HAVE_MALLINFO
+    struct mallinfo info;
+
+    info = mallinfo ();
+    return (long long)info.uordblks + (long long)info.hblkhd;
+#else
+    return 0;
+#endif /* HAVE_MALLINFO */
+#endif /* HAVE_MALLINFO2 */
+}
+
+/*
+ * Frees a node of tree of calls (with all its children).
+ */
+
+void
+profile_node_free (struct t_profile_node *node)
+{
+    if (!node)
+        return;
+
+    hashtable_free (node->children);
+    free (node);
+}
+
+/*
+ * Callback used to free a child node in hashtable.
+ */
+
+void
+profile_node_free_value_cb (struct t_hashtable *hashtable,
+                            const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    profile_node_free ((struct t_profile_node *)value);
+}
+
+/*
+ * Creates a new node in tree of calls.
+ *
+ * Returns pointer to new node, NULL if error.
+ */
+
+struct t_profile_node *
+profile_node_new ()
+{
+    struct t_profile_node *new_node;
+
+    new_node = malloc (sizeof (*new_node));
+    if (!new_node)
+        return NULL;
+
+    new_node->children = NULL;
+    new_node->count = 0;
+    new_node->time_self = 0;
+
+    return new_node;
+}
+
+/*
+ * Searches a child node by frame name, creates it if not found.
+ *
+ * Returns pointer to child node, NULL if error.
+ */
+
+struct t_profile_node *
+profile_node_get_child (struct t_profile_node *node, const char *name)
+{
+    struct t_profile_node *ptr_child;
+
+    if (!node->children)
+    {
+        node->children = hashtable_new (8,
+                                        WEECHAT_HASHTABLE_STRING,
+                                        WEECHAT_HASHTABLE_POINTER,
+                                        NULL, NULL);
+        if (!node->children)
+            return NULL;
+        node->children->callback_free_value = &profile_node_free_value_cb;
+    }
+
+    ptr_child = hashtable_get (node->children, name);
+    if (ptr_child)
+        return ptr_child;
+
+    ptr_child = profile_node_new ();
+    if (!ptr_child)
+        return NULL;
+    if (!hashtable_set (node->children, name, ptr_child))
+    {
+        profile_node_free (ptr_child);
+        return NULL;
+    }
+
+    return ptr_child;
+}
+
+/*
+ * Callback used to free statistics of a hook in hashtable.
+ */
+
+void
+profile_stat_free_value_cb (struct t_hashtable *hashtable,
+                            const void *key, void *value)
+{
+    struct t_profile_stat *stat;
+
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    stat = (struct t_profile_stat *)value;
+    if (!stat)
+        return;
+
+    free (stat->type);
+    free (stat->plugin);
+    free (stat->subplugin);
+    free (stat->description);
+    free (stat);
+}
+
+/*
+ * Creates statistics for a hook (or a main loop phase).
+ *
+ * Returns pointer to new statistics, NULL if error.
+ */
+
+struct t_profile_stat *
+profile_stat_new (const char *type, const char *plugin, const char *subplugin,
+                  const char *description)
+{
+    struct t_profile_stat *new_stat;
+
+    new_stat = malloc (sizeof (*new_stat));
+    if (!new_stat)
+        return NULL;
+
+    new_stat->type = strdup (type);
+    new_stat->plugin = strdup (plugin);
+    new_stat->subplugin = (subplugin) ? strdup (subplugin) : NULL;
+    new_stat->description = strdup ((description) ? description : "");
+    new_stat->count = 0;
+    new_stat->time_total = 0;
+    new_stat->time_max = 0;
+    new_stat->memory_delta = 0;
+
+    return new_stat;
+}
+
+/*
+ * Initializes data of profile (statistics and tree of calls).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+profile_init_data ()
+{
+    if (!profile_stats)
+    {
+        profile_stats = hashtable_new (64,
+                                       WEECHAT_HASHTABLE_STRING,
+                                       WEECHAT_HASHTABLE_POINTER,
+                                       NULL, NULL);
+        if (!profile_stats)
+            return 0;
+        profile_stats->callback_free_value = &profile_stat_free_value_cb;
+    }
+
+    if (!profile_root)
+    {
+        profile_root = profile_node_new ();
+        if (!profile_root)
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Removes all data of profile; calls in progress are ignored.
+ */
+
+void
+profile_reset ()
+{
+    hashtable_free (profile_stats);
+    profile_stats = NULL;
+    profile_node_free (profile_root);
+    profile_root = NULL;
+    profile_stack_depth = 0;
+    profile_id++;
+
+    if (profile_enabled)
+    {
+        gettimeofday (&profile_start_time, NULL);
+    }
+    else
+    {
+        profile_start_time.tv_sec = 0;
+        profile_start_time.tv_usec = 0;
+    }
+    profile_stop_time.tv_sec = 0;
+    profile_stop_time.tv_usec = 0;
+}
+
+/*
+ * Starts profiler (previous data is removed).
+ *
+ * If memory == 1, the net memory allocated during each call is measured too
+ * (memory allocated minus memory freed, can be negative); this is slower.
+ *
+ * Returns:
+ *   1: profiler started
+ *   0: profiler already running
+ */
+
+int
+profile_start (int memory)
+{
+    if (profile_enabled)
+        return 0;
+
+    profile_enabled = 1;
+    profile_memory = (memory) ? 1 : 0;
+    profile_reset ();
+
+    return 1;
+}
+
+/*
+ * Stops profiler (data is kept).
+ *
+ * Returns:
+ *   1: profiler stopped
+ *   0: profiler not running
+ */
+
+int
+profile_stop ()
+{
+    if (!profile_enabled)
+        return 0;
+
+    profile_enabled = 0;
+    gettimeofday (&profile_stop_time, NULL);
+
+    return 1;
+}
+
+/*
+ * Starts a call (hook callback or main loop phase), with frame name "name"
+ * (used in stack of calls).
+ *
+ * Returns id of profile, to give to function profile_frame_end,
+ * 0 if the call is not profiled.
+ */
+
+int
+profile_frame_start (char *name, const char *type, const char *plugin,
+                     const char *subplugin, const char *description)
+{
+    struct t_profile_stat *ptr_stat;
+    struct t_profile_node *ptr_parent, *ptr_node;
+    struct t_profile_frame *ptr_frame;
+    char *ptr_name;
+
+    if (!profile_init_data ())
+        return 0;
+
+    /* ";" is the separator of frames in folded stacks */
+    for (ptr_name = name; ptr_name[0]; ptr_name++)
+    {
+        if ((ptr_name[0] == ';') || (ptr_name[0] == '\n'))
+            ptr_name[0] = ',';
+    }
+
+    ptr_stat = hashtable_get (profile_stats, name);
+    if (!ptr_stat)
+    {
+        ptr_stat = profile_stat_new (type, plugin, subplugin, description);
+        if (!ptr_stat)
+            return 0;
+        if (!hashtable_set (profile_stats, name, ptr_stat))
+        {
+            profile_stat_free_value_cb (NULL, NULL, ptr_stat);
+            return 0;
+        }
+    }
+
+    ptr_parent = (profile_stack_depth > 0) ?
+        profile_stack[profile_stack_depth - 1].node : profile_root;
+    ptr_node = profile_node_get_child (ptr_parent, name);
+    if (!ptr_node)
+        return 0;
+
+    ptr_frame = &profile_stack[profile_stack_depth];
+    ptr_frame->stat = ptr_stat;
+    ptr_frame->node = ptr_node;
+    ptr_frame->time_children = 0;
+    ptr_frame->memory_start = (profile_memory) ? profile_memory_used () : 0;
+    profile_stack_depth++;
+
+    gettimeofday (&ptr_frame->start_time, NULL);
+
+    return profile_id;
+}
+
+/*
+ * Starts a call of hook callback.
+ *
+ * Returns id of profile, to give to function profile_frame_end,
+ * 0 if the call is not profiled.
+ */
+
+int
+profile_frame_start_hook (struct t_hook *hook)
+{
+    const char *plugin_name;
+    char *description, *name;
+    int id;
+
+    if (!profile_enabled || !hook
+        || (profile_stack_depth >= PROFILE_STACK_MAX))
+    {
+        return 0;
+    }
+
+    plugin_name = plugin_get_name (hook->plugin);
+    description = hook_get_description (hook);
+
+    id = 0;
+    if (string_asprintf (&name, "%s%s%s:%s:%s",
+                         plugin_name,
+                         (hook->subplugin) ? "/" : "",
+                         (hook->subplugin) ? hook->subplugin : "",
+                         hook_type_string[hook->type],
+                         (description) ? description : "") >= 0)
+    {
+        id = profile_frame_start (name, hook_type_string[hook->type],
+                                  plugin_name, hook->subplugin, description);
+        free (name);
+    }
+
+    free (description);
+
+    return id;
+}
+
+/*
+ * Starts a phase of main loop.
+ *
+ * Returns id of profile, to give to function profile_frame_end,
+ * 0 if the phase is not profiled.
+ */
+
+int
+profile_frame_start_phase (enum t_profile_phase phase)
+{
+    char *name;
+    int id;
+
+    if (!profile_enabled
+        || (phase < 0) || (phase >= PROFILE_NUM_PHASES)
+        || (profile_stack_depth >= PROFILE_STACK_MAX))
+    {
+        return 0;
+    }
+
+    id = 0;
+    if (string_asprintf (&name, "%s:main_loop:%s",
+                         PLUGIN_CORE, profile_phase_string[phase]) >= 0)
+    {
+        id = profile_frame_start (name, "main_loop", PLUGIN_CORE, NULL,
+                                  profile_phase_string[phase]);
+        free (name);
+    }
+
+    return id;
+}
+
+/*
+ * Ends a call started with profile_frame_start_hook or
+ * profile_frame_start_phase.
+ *
+ * The call is still recorded if the profiler has been stopped during the
+ * call, but ignored if the profile has been reset.
+ */
+
+void
+profile_frame_end (int id)
+{
+    struct t_profile_frame *ptr_frame;
+    struct timeval end_time;
+    long long time_call;
+
+    if ((id == 0) || (id != profile_id) || (profile_stack_depth <= 0))
+        return;
+
+    gettimeofday (&end_time, NULL);
+
+    profile_stack_depth--;
+    ptr_frame = &profile_stack[profile_stack_depth];
+
+    time_call = util_timeval_diff (&ptr_frame->start_time, &end_time);
+    if (time_call < 0)
+        time_call = 0;
+
+    ptr_frame->stat->count++;
+    ptr_frame->stat->time_total += time_call;
+    if (time_call > ptr_frame->stat->time_max)
+        ptr_frame->stat->time_max = time_call;
+    if (profile_memory)
+    {
+        ptr_frame->stat->memory_delta += profile_memory_used ()
+            - ptr_frame->memory_start;
+    }
+
+    ptr_frame->node->count++;
+    if (time_call > ptr_frame->time_children)
+        ptr_frame->node->time_self += time_call - ptr_frame->time_children;
+
+    if (profile_stack_depth > 0)
+        profile_stack[profile_stack_depth - 1].time_children += time_call;
+}
+
+/*
+ * Returns duration of profile (in microseconds).
+ */
+
+long long
+profile_get_duration ()
+{
+    struct timeval now;
+
+    if (profile_start_time.tv_sec == 0)
+        return 0;
+
+    if (profile_enabled || (profile_stop_time.tv_sec == 0))
+    {
+        gettimeofday (&now, NULL);
+        return util_timeval_diff (&profile_start_time, &now);
+    }
+
+    return util_timeval_diff (&profile_start_time, &profile_stop_time);
+}
+
+/*
+ * Compares two statistics on total time (descending order).
+ */
+
+int
+profile_stat_cmp_cb (void *data, struct t_arraylist *arraylist,
+                     void *pointer1, void *pointer2)
+{
+    struct t_profile_stat *stat1, *stat2;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) arraylist;
+
+    stat1 = (struct t_profile_stat *)pointer1;
+    stat2 = (struct t_profile_stat *)pointer2;
+
+    if (stat1->time_total > stat2->time_total)
+        return -1;
+    if (stat1->time_total < stat2->time_total)
+        return 1;
+    return (stat1->count > stat2->count) ?
+        -1 : ((stat1->count < stat2->count) ? 1 : 0);
+}
+
+/*
+ * Adds statistics in arraylist (callback of hashtable_map).
+ */
+
+void
+profile_stat_add_to_list_cb (void *data, struct t_hashtable *hashtable,
+                             const void *key, const void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    arraylist_add ((struct t_arraylist *)data, (void *)value);
+}
+
+/*
+ * Returns statistics sorted by total time (descending order).
+ *
+ * Note: result must be freed after use with function arraylist_free.
+ */
+
+struct t_arraylist *
+profile_get_sorted_stats ()
+{
+    struct t_arraylist *list;
+
+    list = arraylist_new (
+        (profile_stats) ? profile_stats->items_count : 0,
+        1, 1,
+        &profile_stat_cmp_cb, NULL,
+        NULL, NULL);
+    if (!list)
+        return NULL;
+
+    if (profile_stats)
+        hashtable_map (profile_stats, &profile_stat_add_to_list_cb, list);
+
+    return list;
+}
+
+/*
+ * Displays statistics of profile in core buffer.
+ */
+
+void
+profile_display ()
+{
+    struct t_arraylist *list;
+    struct t_profile_stat *ptr_stat;
+    char str_memory[64];
+    int i, size;
+
+    gui_chat_printf (NULL, "");
+
+    if (!profile_stats || (profile_stats->items_count == 0))
+    {
+        gui_chat_printf (NULL,
+                         (profile_enabled) ?
+                         _("Profile: running, no data") :
+                         _("Profile: no data"));
+        return;
+    }
+
+    gui_chat_printf (NULL,
+                     _("Profile (%s, duration: %.3fs, memory: %s):"),
+                     (profile_enabled) ? _("running") : _("stopped"),
+                     (double)profile_get_duration () / 1000000,
+                     (profile_memory) ? _("on") : _("off"));
+    gui_chat_printf (NULL,
+                     "  %10s %12s %10s %10s %12s  %s",
+                     _("calls"), _("total (ms)"), _("max (ms)"),
+                     _("avg (ms)"), _("mem. delta"), _("callback"));
+
+    list = profile_get_sorted_stats ();
+    if (!list)
+        return;
+
+    size = arraylist_size (list);
+    for (i = 0; i < size; i++)
+    {
+        ptr_stat = (struct t_profile_stat *)arraylist_get (list, i);
+        if (profile_memory)
+        {
+            snprintf (str_memory, sizeof (str_memory),
+                      "%lld", ptr_stat->memory_delta);
+        }
+        else
+        {
+            snprintf (str_memory, sizeof (str_memory), "-");
+        }
+        gui_chat_printf (
+            NULL,
+            "  %10lld %12.3f %10.3f %10.3f %12s  %s %s%s%s: %s",
+            ptr_stat->count,
+            (double)ptr_stat->time_total / 1000,
+            (double)ptr_stat->time_max / 1000,
+            (ptr_stat->count > 0) ?
+            (double)ptr_stat->time_total / 1000 / ptr_stat->count : 0,
+            str_memory,
+            ptr_stat->type,
+            ptr_stat->plugin,
+            (ptr_stat->subplugin) ? "/" : "",
+            (ptr_stat->subplugin) ? ptr_stat->subplugin : "",
+            ptr_stat->description);
+    }
+
+    arraylist_free (list);
+}
+
+/*
+ * Writes a child node (callback of hashtable_map).
+ */
+
+void
+profile_write_node_cb (void *data, struct t_hashtable *hashtable,
+                       const void *key, const void *value)
+{
+    void **args;
+    const char *path;
+    char *new_path;
+
+    /* make C compiler happy */
+    (void) hashtable;
+
+    args = (void **)data;
+    path = (const char *)args[1];
+
+    if (string_asprintf (&new_path, "%s%s%s",
+                         (path) ? path : "",
+                         (path) ? ";" : "",
+                         (const char *)key) >= 0)
+    {
+        profile_write_node ((FILE *)args[0], new_path,
+                            (struct t_profile_node *)value);
+        free (new_path);
+    }
+}
+
+/*
+ * Writes a node of tree of calls (and its children) in a file.
+ */
+
+void
+profile_write_node (FILE *file, const char *path,
+                    struct t_profile_node *node)
+{
+    void *args[2];
+
+    if (path && (node->time_self > 0))
+        fprintf (file, "%s %lld\n", path, node->time_self);
+
+    if (node->children)
+    {
+        args[0] = file;
+        args[1] = (void *)path;
+        hashtable_map (node->children, &profile_write_node_cb, args);
+    }
+}
+
+/*
+ * Writes stacks of calls in a file, using the "folded stacks" format
+ * (one line per stack: frames separated by ";" and time in microseconds
+ * spent in the last frame), which can be used to build a flame graph.
+ *
+ * If filename is NULL, the default file is used (it is evaluated).
+ *
+ * Returns path to file written, NULL if error.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+profile_write_folded (const char *filename)
+{
+    FILE *file;
+    char *path;
+
+    path = string_eval_path_home (
+        (filename && filename[0]) ? filename : PROFILE_DEFAULT_FILE,
+        NULL, NULL, NULL);
+    if (!path)
+        return NULL;
+
+    file = fopen (path, "w");
+    if (!file)
+    {
+        free (path);
+        return NULL;
+    }
+
+    if (profile_root)
+        profile_write_node (file, NULL, profile_root);
+
+    fclose (file);
+
+    return path;
+}
+
+/*
+ * Adds statistics of profile in an infolist.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+profile_add_to_infolist (struct t_infolist *infolist)
+{
+    struct t_arraylist *list;
+    struct t_profile_stat *ptr_stat;
+    struct t_infolist_item *ptr_item;
+    char value[64];
+    int i, size, rc;
+
+    if (!infolist)
+        return 0;
+
+    list = profile_get_sorted_stats ();
+    if (!list)
+        return 0;
+
+    rc = 0;
+    size = arraylist_size (list);
+    for (i = 0; i < size; i++)
+    {
+        ptr_stat = (struct t_profile_stat *)arraylist_get (list, i);
+        ptr_item = infolist_new_item (infolist);
+        if (!ptr_item)
+            goto end;
+        if (!infolist_new_var_string (ptr_item, "type", ptr_stat->type))
+            goto end;
+        if (!infolist_new_var_string (ptr_item, "plugin", ptr_stat->plugin))
+            goto end;
+        if (!infolist_new_var_string (ptr_item, "subplugin", ptr_stat->subplugin))
+            goto end;
+        if (!infolist_new_var_string (ptr_item, "description", ptr_stat->description))
+            goto end;
+        snprintf (value, sizeof (value), "%lld", ptr_stat->count);
+        if (!infolist_new_var_string (ptr_item, "count", value))
+            goto end;
+        snprintf (value, sizeof (value), "%lld", ptr_stat->time_total);
+        if (!infolist_new_var_string (ptr_item, "time_total", value))
+            goto end;
+        snprintf (value, sizeof (value), "%lld", ptr_stat->time_max);
+        if (!infolist_new_var_string (ptr_item, "time_max", value))
+            goto end;
+        snprintf (value, sizeof (value), "%lld", ptr_stat->memory_delta);
+        if (!infolist_new_var_string (ptr_item, "memory_delta", value))
+            goto end;
+    }
+    rc = 1;
+
+end:
+    arraylist_free (list);
+    return rc;
+}
+
+/*
+ * Ends profiler: stops it and frees all data.
+ */
+
+void
+profile_end ()
+{
+    profile_enabled = 0;
+    profile_memory = 0;
+    profile_reset ();
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_PROFILE_H
+#define WEECHAT_PROFILE_H
+
+#include <sys/time.h>
+
+#define PROFILE_STACK_MAX 64
+
+#define PROFILE_DEFAULT_FILE "${weechat_state_dir}/profile.folded"
+
+struct t_hook;
+struct t_infolist;
+
+enum t_profile_phase
+{
+    PROFILE_PHASE_TIMERS = 0,          /* execution of timer hooks          */
+    PROFILE_PHASE_REFRESHES,           /* refreshes of screen               */
+    PROFILE_PHASE_FD,                  /* execution of fd hooks             */
+    PROFILE_PHASE_WAIT,                /* wait for activity on fds (in fd)  */
+    PROFILE_PHASE_PROCESS,             /* run of processes (with fork)      */
+    PROFILE_PHASE_SIGNALS,             /* handle of signals received        */
+    /* number of phases */
+    PROFILE_NUM_PHASES,
+};
+
+/* statistics for a hook (or a main loop phase) */
+
+struct t_profile_stat
+{
+    char *type;                        /* hook type or "main_loop"          */
+    char *plugin;                      /* plugin name ("core" for core)     */
+    char *subplugin;                   /* subplugin (script), NULL if none  */
+    char *description;                 /* hook description or phase name    */
+    long long count;                   /* number of calls                   */
+    long long time_total;              /* total time (microseconds)         */
+    long long time_max;                /* max time of a call (microseconds) */
+    long long memory_delta;            /* memory allocated - freed (bytes)  */
+};
+
+/* node in tree of calls (one node per distinct stack of calls) */
+
+struct t_profile_node
+{
+    struct t_hashtable *children;      /* child nodes (key: frame name)     */
+    long long count;                   /* number of calls                   */
+    long long time_self;               /* time without children (usec)      */
+};
+
+/* call in progress */
+
+struct t_profile_frame
+{
+    struct t_profile_stat *stat;       /* statistics of hook/phase          */
+    struct t_profile_node *node;       /* node in tree of calls             */
+    struct timeval start_time;         /* start of call                     */
+    long long time_children;           /* time spent in nested calls        */
+    long long memory_start;            /* memory used at start of call      */
+};
+
+extern char *profile_phase_string[];
+extern int profile_enabled;
+extern int profile_memory;
+extern int profile_id;
+extern struct t_hashtable *profile_stats;
+extern struct t_profile_node *profile_root;
+extern int profile_stack_depth;
+
+extern int profile_start (int memory);
+extern int profile_stop ();
+extern void profile_reset ();
+extern int profile_frame_start_hook (struct t_hook *hook);
+extern int profile_frame_start_phase (enum t_profile_phase phase);
+extern void profile_frame_end (int id);
+extern long long profile_get_duration ();
+extern void profile_display ();
+extern char *profile_write_folded (const char *filename);
+extern int profile_add_to_infolist (struct t_infolist *infolist);
+extern void profile_end ();
+
+#endif /* WEECHAT_PROFILE_H */
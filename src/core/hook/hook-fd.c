@@ -24,20 +24,50 @@
 #endif
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
+#include <unistd.h>
 #include <poll.h>
-#include <fcntl.h>
 #include <errno.h>
+#include <fcntl.h>
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
 
 #include "../weechat.h"
 #include "../core-hook.h"
 #include "../core-infolist.h"
 #include "../core-log.h"
+#include "../core-profile.h"
 #include "../../gui/gui-chat.h"
 
 
+/*
+ * fd hooks are registered once (when the hook is added) in a backend:
+ * - epoll (Linux): fds are registered in an epoll instance, readiness
+ *   maps directly to the fd (with the id of registration, to detect stale
+ *   registrations of fds closed before the hook is removed),
+ * - poll: a "struct pollfd" array built only when hooks are added/removed
+ *   or when flags are changed; it is also used for fds refused by epoll
+ *   (for example regular files), along with the epoll fd itself.
+ */
+
+struct t_hook **hook_fd_table = NULL;  /* fd hooks, indexed by fd           */
+int hook_fd_table_size = 0;            /* size of fd hooks table            */
+
 struct pollfd *hook_fd_pollfd = NULL;  /* file descriptors for poll()       */
 int hook_fd_pollfd_count = 0;          /* number of file descriptors        */
+int hook_fd_pollfd_size = 0;           /* allocated size of pollfd array    */
+int hook_fd_pollfd_rebuild = 1;        /* 1 if pollfd array must be rebuilt */
+
+#ifdef HAVE_EPOLL
+int hook_fd_epoll_fd = -1;             /* epoll instance (-1 if not used)   */
+int hook_fd_epoll_init = 0;            /* 1 if epoll_create1 was called     */
+int hook_fd_epoll_count = 0;           /* number of fds registered in epoll */
+int hook_fd_epoll_last_id = 0;         /* id of last registration in epoll  */
+struct epoll_event *hook_fd_epoll_events = NULL; /* events from epoll_wait  */
+int hook_fd_epoll_events_size = 0;     /* size of epoll events array        */
+#endif /* HAVE_EPOLL */
 
 
 /*
@@ -63,60 +93,299 @@ hook_fd_get_description (struct t_hook *hook)
 }
 
 /*
- * Searches for a fd hook in list.
+ * Searches for a fd hook.
  *
  * Returns pointer to hook found, NULL if not found.
  */
 
 struct t_hook *
 hook_fd_search (int fd)
+{
+    if ((fd < 0) || (fd >= hook_fd_table_size))
+        return NULL;
+
+    return hook_fd_table[fd];
+}
+
+/*
+ * Sets hook in the table of fd hooks (grows the table if needed).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (memory allocation failure)
+ */
+
+int
+hook_fd_table_set (int fd, struct t_hook *hook)
+{
+    struct t_hook **new_table;
+    int new_size, i;
+
+    if (fd < 0)
+        return 0;
+
+    if (fd >= hook_fd_table_size)
+    {
+        if (!hook)
+            return 1;
+        new_size = (hook_fd_table_size > 0) ? hook_fd_table_size : 64;
+        while (new_size <= fd)
+            new_size *= 2;
+        new_table = realloc (hook_fd_table,
+                             new_size * sizeof (*new_table));
+        if (!new_table)
+            return 0;
+        for (i = hook_fd_table_size; i < new_size; i++)
+        {
+            new_table[i] = NULL;
+        }
+        hook_fd_table = new_table;
+        hook_fd_table_size = new_size;
+    }
+
+    hook_fd_table[fd] = hook;
+
+    return 1;
+}
+
+/*
+ * Returns events to watch for a fd hook, using poll() constants.
+ */
+
+int
+hook_fd_get_poll_events (struct t_hook *hook)
+{
+    int events;
+
+    events = 0;
+    if (HOOK_FD(hook, flags) & HOOK_FD_FLAG_READ)
+        events |= POLLIN;
+    if (HOOK_FD(hook, flags) & HOOK_FD_FLAG_WRITE)
+        events |= POLLOUT;
+
+    return events;
+}
+
+/*
+ * Displays an error for a bad file descriptor used in a fd hook
+ * (only once per hook).
+ */
+
+void
+hook_fd_set_error (struct t_hook *hook, int error)
+{
+    if (HOOK_FD(hook, error) != 0)
+        return;
+
+    HOOK_FD(hook, error) = error;
+    gui_chat_printf (NULL,
+                     _("%sBad file descriptor (%d) used in hook_fd"),
+                     gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                     HOOK_FD(hook, fd));
+}
+
+#ifdef HAVE_EPOLL
+/*
+ * Registers (or updates registration of) a fd hook in epoll instance.
+ *
+ * If epoll is not available or if the fd is not supported by epoll (for
+ * example a regular file), the fd will be watched with poll().
+ */
+
+void
+hook_fd_epoll_register (struct t_hook *hook, int op)
+{
+    struct epoll_event event;
+    int events, id;
+
+    if (!hook_fd_epoll_init)
+    {
+        hook_fd_epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+        hook_fd_epoll_init = 1;
+    }
+
+    if (hook_fd_epoll_fd < 0)
+        return;
+
+    if (op == EPOLL_CTL_ADD)
+    {
+        hook_fd_epoll_last_id = (hook_fd_epoll_last_id < INT32_MAX) ?
+            hook_fd_epoll_last_id + 1 : 1;
+        id = hook_fd_epoll_last_id;
+    }
+    else
+    {
+        id = HOOK_FD(hook, registered);
+    }
+
+    events = hook_fd_get_poll_events (hook);
+
+    memset (&event, 0, sizeof (event));
+    event.events = ((events & POLLIN) ? EPOLLIN : 0)
+        | ((events & POLLOUT) ? EPOLLOUT : 0);
+    event.data.u64 = ((uint64_t)id << 32) | (uint32_t)HOOK_FD(hook, fd);
+
+    if (epoll_ctl (hook_fd_epoll_fd, op, HOOK_FD(hook, fd), &event) == 0)
+    {
+        if (op == EPOLL_CTL_ADD)
+        {
+            HOOK_FD(hook, registered) = id;
+            hook_fd_epoll_count++;
+        }
+        return;
+    }
+
+    if (errno == EBADF)
+        hook_fd_set_error (hook, errno);
+
+    /* fallback to poll() for this fd */
+    if (op == EPOLL_CTL_MOD)
+    {
+        HOOK_FD(hook, registered) = 0;
+        hook_fd_epoll_count--;
+    }
+}
+
+/*
+ * Unregisters a fd hook from epoll instance.
+ */
+
+void
+hook_fd_epoll_unregister (struct t_hook *hook)
+{
+    struct epoll_event event;
+
+    if ((hook_fd_epoll_fd < 0) || !HOOK_FD(hook, registered))
+        return;
+
+    /*
+     * never remove the registration of another hook on the same fd number
+     * (if the fd has been closed and reused, the stale registration of this
+     * hook is dropped in function hook_fd_exec_epoll)
+     */
+    if (hook_fd_search (HOOK_FD(hook, fd)) == hook)
+    {
+        /* event is ignored but must be non-NULL with kernel < 2.6.9 */
+        memset (&event, 0, sizeof (event));
+
+        /* the fd may be already closed: ignore errors */
+        (void) epoll_ctl (hook_fd_epoll_fd, EPOLL_CTL_DEL, HOOK_FD(hook, fd),
+                          &event);
+    }
+
+    HOOK_FD(hook, registered) = 0;
+    hook_fd_epoll_count--;
+}
+
+/*
+ * Creates a new epoll instance and registers again all fds registered in
+ * epoll.
+ *
+ * This is used to drop stale registrations: a fd closed before its hook is
+ * removed stays in the epoll instance as long as the file is open elsewhere
+ * (for example in a child process), and it can not be removed by its fd
+ * number, which may have been reused.
+ */
+
+void
+hook_fd_epoll_rebuild ()
 {
     struct t_hook *ptr_hook;
 
+    if (hook_fd_epoll_fd >= 0)
+        close (hook_fd_epoll_fd);
+    hook_fd_epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+    hook_fd_epoll_init = 1;
+    hook_fd_epoll_count = 0;
+
     for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
          ptr_hook = ptr_hook->next_hook)
     {
-        if (!ptr_hook->deleted && (HOOK_FD(ptr_hook, fd) == fd))
-            return ptr_hook;
+        if (!ptr_hook->hook_data || !HOOK_FD(ptr_hook, registered))
+            continue;
+        HOOK_FD(ptr_hook, registered) = 0;
+        if (!ptr_hook->deleted)
+            hook_fd_epoll_register (ptr_hook, EPOLL_CTL_ADD);
     }
 
-    /* fd hook not found */
-    return NULL;
+    hook_fd_pollfd_rebuild = 1;
 }
+#endif /* HAVE_EPOLL */
 
 /*
- * Reallocates the "struct pollfd" array for poll().
+ * Builds the "struct pollfd" array for poll(), with all fds not registered
+ * in epoll (and the epoll fd itself if some fds are watched with poll()).
+ *
+ * The array is rebuilt only when fd hooks are added/removed or when their
+ * flags are changed.
  */
 
 void
-hook_fd_realloc_pollfd ()
+hook_fd_build_pollfd ()
 {
-    struct pollfd *ptr_pollfd;
+    struct t_hook *ptr_hook;
+    struct pollfd *new_pollfd;
     int count;
 
-    if (hooks_count[HOOK_TYPE_FD] == hook_fd_pollfd_count)
-        return;
+    hook_fd_pollfd_rebuild = 0;
 
-    count = hooks_count[HOOK_TYPE_FD];
+    /* count fds to watch with poll() */
+    count = 0;
+    for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
+         ptr_hook = ptr_hook->next_hook)
+    {
+        if (!ptr_hook->deleted && !HOOK_FD(ptr_hook, registered))
+            count++;
+    }
+#ifdef HAVE_EPOLL
+    if ((count > 0) && (hook_fd_epoll_fd >= 0) && (hook_fd_epoll_count > 0))
+        count++;
+#endif /* HAVE_EPOLL */
 
     if (count == 0)
     {
-        if (hook_fd_pollfd)
-        {
-            free (hook_fd_pollfd);
-            hook_fd_pollfd = NULL;
-        }
+        free (hook_fd_pollfd);
+        hook_fd_pollfd = NULL;
+        hook_fd_pollfd_size = 0;
+        hook_fd_pollfd_count = 0;
+        return;
     }
-    else
+
+    if (count > hook_fd_pollfd_size)
     {
-        ptr_pollfd = realloc (hook_fd_pollfd,
-                              count * sizeof (struct pollfd));
-        if (!ptr_pollfd)
+        new_pollfd = realloc (hook_fd_pollfd, count * sizeof (*new_pollfd));
+        if (!new_pollfd)
+        {
+            hook_fd_pollfd_count = 0;
+            hook_fd_pollfd_rebuild = 1;
             return;
-        hook_fd_pollfd = ptr_pollfd;
+        }
+        hook_fd_pollfd = new_pollfd;
+        hook_fd_pollfd_size = count;
     }
 
-    hook_fd_pollfd_count = count;
+    hook_fd_pollfd_count = 0;
+#ifdef HAVE_EPOLL
+    if ((hook_fd_epoll_fd >= 0) && (hook_fd_epoll_count > 0))
+    {
+        hook_fd_pollfd[0].fd = hook_fd_epoll_fd;
+        hook_fd_pollfd[0].events = POLLIN;
+        hook_fd_pollfd[0].revents = 0;
+        hook_fd_pollfd_count++;
+    }
+#endif /* HAVE_EPOLL */
+    for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
+         ptr_hook = ptr_hook->next_hook)
+    {
+        if (!ptr_hook->deleted && !HOOK_FD(ptr_hook, registered))
+        {
+            hook_fd_pollfd[hook_fd_pollfd_count].fd = HOOK_FD(ptr_hook, fd);
+            hook_fd_pollfd[hook_fd_pollfd_count].events =
+                hook_fd_get_poll_events (ptr_hook);
+            hook_fd_pollfd[hook_fd_pollfd_count].revents = 0;
+            hook_fd_pollfd_count++;
+        }
+    }
 }
 
 /*
@@ -126,14 +395,24 @@ hook_fd_realloc_pollfd ()
 void
 hook_fd_add_cb (struct t_hook *hook)
 {
-    /* make C compiler happy */
-    (void) hook;
+    hook_fd_table_set (HOOK_FD(hook, fd), hook);
 
-    hook_fd_realloc_pollfd ();
+#ifdef HAVE_EPOLL
+    hook_fd_epoll_register (hook, EPOLL_CTL_ADD);
+    /* first fd in epoll: the epoll fd may have to be added in pollfd */
+    if (hook_fd_epoll_count == 1)
+        hook_fd_pollfd_rebuild = 1;
+#endif /* HAVE_EPOLL */
+
+    if (!HOOK_FD(hook, registered))
+        hook_fd_pollfd_rebuild = 1;
 }
 
 /*
  * Callback called when a fd hook is removed from the list of hooks.
+ *
+ * Note: hook data has already been freed when this function is called
+ * (the fd is unregistered in function hook_fd_free_data).
  */
 
 void
@@ -142,7 +421,13 @@ hook_fd_remove_cb (struct t_hook *hook)
     /* make C compiler happy */
     (void) hook;
 
-    hook_fd_realloc_pollfd ();
+    if (hooks_count[HOOK_TYPE_FD] == 0)
+    {
+        free (hook_fd_table);
+        hook_fd_table = NULL;
+        hook_fd_table_size = 0;
+        hook_fd_pollfd_rebuild = 1;
+    }
 }
 
 /*
@@ -182,6 +467,7 @@ hook_fd (struct t_weechat_plugin *plugin, int fd, int flag_read,
     new_hook_fd->fd = fd;
     new_hook_fd->flags = 0;
     new_hook_fd->error = 0;
+    new_hook_fd->registered = 0;
     if (flag_read)
         new_hook_fd->flags |= HOOK_FD_FLAG_READ;
     if (flag_write)
@@ -195,101 +481,209 @@ hook_fd (struct t_weechat_plugin *plugin, int fd, int flag_read,
 }
 
 /*
- * Executes fd hooks:
- * - poll() on fie descriptors
- * - call of hook fd callbacks if needed.
+ * Sets a flag (read, write, exception) in a fd hook and updates the
+ * registration of fd in the backend.
  */
 
 void
-hook_fd_exec ()
+hook_fd_set_flag (struct t_hook *hook, int flag, int enable)
+{
+    int old_flags;
+
+    if (!hook || hook->deleted || (hook->type != HOOK_TYPE_FD))
+        return;
+
+    old_flags = HOOK_FD(hook, flags);
+
+    if (enable)
+        HOOK_FD(hook, flags) |= flag;
+    else
+        HOOK_FD(hook, flags) &= ~flag;
+
+    if (HOOK_FD(hook, flags) == old_flags)
+        return;
+
+#ifdef HAVE_EPOLL
+    if (HOOK_FD(hook, registered))
+        hook_fd_epoll_register (hook, EPOLL_CTL_MOD);
+#endif /* HAVE_EPOLL */
+
+    if (!HOOK_FD(hook, registered))
+        hook_fd_pollfd_rebuild = 1;
+}
+
+/*
+ * Runs callback of the fd hook watching this fd (if any).
+ */
+
+void
+hook_fd_exec_fd (int fd)
 {
-    struct t_hook *ptr_hook, *next_hook;
+    struct t_hook *ptr_hook;
     struct t_hook_exec_cb hook_exec_cb;
-    int i, num_fd, timeout, ready, found;
 
-    if (!weechat_hooks[HOOK_TYPE_FD])
+    /*
+     * the hook is searched by fd (and not kept from the poll/epoll call)
+     * because a previous callback may have removed it
+     */
+    ptr_hook = hook_fd_search (fd);
+    if (!ptr_hook || ptr_hook->deleted || ptr_hook->running)
         return;
 
-    /* build an array of "struct pollfd" for poll() */
-    num_fd = 0;
-    for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
-         ptr_hook = ptr_hook->next_hook)
+    hook_callback_start (ptr_hook, &hook_exec_cb);
+    (void) (HOOK_FD(ptr_hook, callback)) (
+        ptr_hook->callback_pointer,
+        ptr_hook->callback_data,
+        HOOK_FD(ptr_hook, fd));
+    hook_callback_end (ptr_hook, &hook_exec_cb);
+}
+
+#ifdef HAVE_EPOLL
+/*
+ * Waits for events on fds registered in epoll instance and runs callbacks
+ * for file descriptors with activity.
+ *
+ * On error or hang up (EPOLLERR/EPOLLHUP), if the fd has been closed (while
+ * the file is still open elsewhere, so it is still in epoll instance), an
+ * error is displayed (like POLLNVAL with poll()) and the fd is removed from
+ * epoll; otherwise the callback is called, like poll() does with POLLERR and
+ * POLLHUP (so that the end of file can be read).
+ */
+
+void
+hook_fd_exec_epoll (int timeout)
+{
+    struct t_hook *ptr_hook;
+    struct epoll_event *new_events;
+    int i, size, ready, fd, id, profile, stale;
+
+    size = (hook_fd_epoll_count < 16) ? 16 : hook_fd_epoll_count;
+    if (size > hook_fd_epoll_events_size)
     {
-        if (!ptr_hook->deleted)
+        new_events = realloc (hook_fd_epoll_events,
+                              size * sizeof (*new_events));
+        if (new_events)
         {
-            /* skip invalid file descriptors */
-            if ((fcntl (HOOK_FD(ptr_hook,fd), F_GETFD) == -1)
-                && (errno == EBADF))
-            {
-                if (HOOK_FD(ptr_hook, error) == 0)
-                {
-                    HOOK_FD(ptr_hook, error) = errno;
-                    gui_chat_printf (NULL,
-                                     _("%sBad file descriptor (%d) used in "
-                                       "hook_fd"),
-                                     gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
-                                     HOOK_FD(ptr_hook, fd));
-                }
-            }
-            else
-            {
-                if (num_fd > hook_fd_pollfd_count)
-                    break;
-
-                hook_fd_pollfd[num_fd].fd = HOOK_FD(ptr_hook, fd);
-                hook_fd_pollfd[num_fd].events = 0;
-                hook_fd_pollfd[num_fd].revents = 0;
-                if (HOOK_FD(ptr_hook, flags) & HOOK_FD_FLAG_READ)
-                    hook_fd_pollfd[num_fd].events |= POLLIN;
-                if (HOOK_FD(ptr_hook, flags) & HOOK_FD_FLAG_WRITE)
-                    hook_fd_pollfd[num_fd].events |= POLLOUT;
-
-                num_fd++;
-            }
+            hook_fd_epoll_events = new_events;
+            hook_fd_epoll_events_size = size;
         }
     }
+    if (!hook_fd_epoll_events)
+        return;
+
+    profile = (profile_enabled) ?
+        profile_frame_start_phase (PROFILE_PHASE_WAIT) : 0;
+    ready = epoll_wait (hook_fd_epoll_fd, hook_fd_epoll_events,
+                        hook_fd_epoll_events_size, timeout);
+    profile_frame_end (profile);
+    if (ready <= 0)
+        return;
+
+    stale = 0;
+
+    hook_exec_start ();
+    for (i = 0; i < ready; i++)
+    {
+        fd = (int)(hook_fd_epoll_events[i].data.u64 & 0xFFFFFFFF);
+        id = (int)(hook_fd_epoll_events[i].data.u64 >> 32);
+        ptr_hook = hook_fd_search (fd);
+        if (!ptr_hook || (HOOK_FD(ptr_hook, registered) != id))
+        {
+            /*
+             * no more hook on this fd, or the fd has been reused by another
+             * hook (stale registration): it is dropped after the loop
+             */
+            stale = 1;
+            continue;
+        }
+        if ((hook_fd_epoll_events[i].events & (EPOLLERR | EPOLLHUP))
+            && (fcntl (fd, F_GETFD) < 0) && (errno == EBADF))
+        {
+            /* invalid file descriptor: watch it with poll() (POLLNVAL) */
+            if (!ptr_hook->deleted)
+                hook_fd_set_error (ptr_hook, EBADF);
+            HOOK_FD(ptr_hook, registered) = 0;
+            hook_fd_epoll_count--;
+            hook_fd_pollfd_rebuild = 1;
+            stale = 1;
+            continue;
+        }
+        hook_fd_exec_fd (fd);
+    }
+    if (stale)
+        hook_fd_epoll_rebuild ();
+    hook_exec_end ();
+}
+#endif /* HAVE_EPOLL */
+
+/*
+ * Executes fd hooks:
+ * - wait for activity on file descriptors (epoll or poll),
+ * - call of hook fd callbacks if needed.
+ */
+
+void
+hook_fd_exec ()
+{
+    struct t_hook *ptr_hook;
+    int i, timeout, ready, profile;
+
+    if (!weechat_hooks[HOOK_TYPE_FD])
+        return;
+
+    if (hook_fd_pollfd_rebuild)
+        hook_fd_build_pollfd ();
 
-    /* perform the poll() */
     timeout = hook_timer_get_time_to_next ();
     if (hook_process_pending)
         timeout = 0;
-    ready = poll (hook_fd_pollfd, num_fd, timeout);
+
+#ifdef HAVE_EPOLL
+    /* all fds are registered in epoll: wait directly on epoll instance */
+    if ((hook_fd_epoll_fd >= 0) && (hook_fd_epoll_count > 0)
+        && (hook_fd_pollfd_count == 0))
+    {
+        hook_fd_exec_epoll (timeout);
+        return;
+    }
+#endif /* HAVE_EPOLL */
+
+    /* perform the poll() */
+    profile = (profile_enabled) ?
+        profile_frame_start_phase (PROFILE_PHASE_WAIT) : 0;
+    ready = poll (hook_fd_pollfd, hook_fd_pollfd_count, timeout);
+    profile_frame_end (profile);
     if (ready <= 0)
         return;
 
     /* execute callbacks for file descriptors with activity */
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_FD];
-    while (ptr_hook)
+    for (i = 0; i < hook_fd_pollfd_count; i++)
     {
-        next_hook = ptr_hook->next_hook;
-
-        if (!ptr_hook->deleted
-            && !ptr_hook->running)
+        if (!hook_fd_pollfd[i].revents)
+            continue;
+#ifdef HAVE_EPOLL
+        if ((hook_fd_epoll_fd >= 0)
+            && (hook_fd_pollfd[i].fd == hook_fd_epoll_fd))
         {
-            found = 0;
-            for (i = 0; i < num_fd; i++)
-            {
-                if (hook_fd_pollfd[i].fd == HOOK_FD(ptr_hook, fd)
-                    && hook_fd_pollfd[i].revents)
-                {
-                    found = 1;
-                    break;
-                }
-            }
-            if (found)
-            {
-                hook_callback_start (ptr_hook, &hook_exec_cb);
-                (void) (HOOK_FD(ptr_hook, callback)) (
-                    ptr_hook->callback_pointer,
-                    ptr_hook->callback_data,
-                    HOOK_FD(ptr_hook, fd));
-                hook_callback_end (ptr_hook, &hook_exec_cb);
-            }
+            hook_fd_exec_epoll (0);
+            continue;
         }
-
-        ptr_hook = next_hook;
+#endif /* HAVE_EPOLL */
+        if (hook_fd_pollfd[i].revents & POLLNVAL)
+        {
+            /* skip invalid file descriptor until next rebuild of array */
+            ptr_hook = hook_fd_search (hook_fd_pollfd[i].fd);
+            if (ptr_hook && !ptr_hook->deleted)
+                hook_fd_set_error (ptr_hook, EBADF);
+            hook_fd_pollfd[i].fd = -1;
+            continue;
+        }
+        hook_fd_exec_fd (hook_fd_pollfd[i].fd);
+        /* the array may have been rebuilt/freed by a callback */
+        if (hook_fd_pollfd_rebuild || !hook_fd_pollfd)
+            break;
     }
 
     hook_exec_end ();
@@ -305,10 +699,59 @@ hook_fd_free_data (struct t_hook *hook)
     if (!hook || !hook->hook_data)
         return;
 
+    if (!HOOK_FD(hook, registered))
+        hook_fd_pollfd_rebuild = 1;
+#ifdef HAVE_EPOLL
+    hook_fd_epoll_unregister (hook);
+    if (hook_fd_epoll_count == 0)
+        hook_fd_pollfd_rebuild = 1;
+#endif /* HAVE_EPOLL */
+    if (hook_fd_search (HOOK_FD(hook, fd)) == hook)
+        hook_fd_table_set (HOOK_FD(hook, fd), NULL);
+
     free (hook->hook_data);
     hook->hook_data = NULL;
 }
 
+/*
+ * Ends fd hooks: closes the epoll instance and frees the arrays used to
+ * watch fds.
+ *
+ * Fd hooks which are still registered in epoll are then watched with
+ * poll().
+ */
+
+void
+hook_fd_end ()
+{
+#ifdef HAVE_EPOLL
+    struct t_hook *ptr_hook;
+
+    for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
+         ptr_hook = ptr_hook->next_hook)
+    {
+        if (ptr_hook->hook_data)
+            HOOK_FD(ptr_hook, registered) = 0;
+    }
+    if (hook_fd_epoll_fd >= 0)
+    {
+        close (hook_fd_epoll_fd);
+        hook_fd_epoll_fd = -1;
+    }
+    hook_fd_epoll_init = 0;
+    hook_fd_epoll_count = 0;
+    free (hook_fd_epoll_events);
+    hook_fd_epoll_events = NULL;
+    hook_fd_epoll_events_size = 0;
+#endif /* HAVE_EPOLL */
+
+    free (hook_fd_pollfd);
+    hook_fd_pollfd = NULL;
+    hook_fd_pollfd_count = 0;
+    hook_fd_pollfd_size = 0;
+    hook_fd_pollfd_rebuild = 1;
+}
+
 /*
  * Adds fd hook data in the infolist item.
  *
@@ -351,4 +794,5 @@ hook_fd_print_log (struct t_hook *hook)
     log_printf ("    fd. . . . . . . . . . : %d", HOOK_FD(hook, fd));
     log_printf ("    flags . . . . . . . . : %d", HOOK_FD(hook, flags));
     log_printf ("    error . . . . . . . . : %d", HOOK_FD(hook, error));
+    log_printf ("    registered. . . . . . : %d", HOOK_FD(hook, registered));
 }
@@ -39,6 +39,8 @@ struct t_hook_fd
     int flags;                         /* fd flags (read,write,..)          */
     int error;                         /* contains errno if error occurred  */
                                        /* with fd                           */
+    int registered;                    /* id of registration in epoll (> 0) */
+                                       /* (0 if fd is watched with poll())  */
 };
 
 extern char *hook_fd_get_description (struct t_hook *hook);
@@ -50,8 +52,10 @@ extern struct t_hook *hook_fd (struct t_weechat_plugin *plugin, int fd,
                                t_hook_callback_fd *callback,
                                const void *callback_pointer,
                                void *callback_data);
+extern void hook_fd_set_flag (struct t_hook *hook, int flag, int enable);
 extern void hook_fd_exec ();
 extern void hook_fd_free_data (struct t_hook *hook);
+extern void hook_fd_end ();
 extern int hook_fd_add_to_infolist (struct t_infolist_item *item,
                                     struct t_hook *hook);
 extern void hook_fd_print_log (struct t_hook *hook);
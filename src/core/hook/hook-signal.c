@@ -27,6 +27,8 @@
 #include <string.h>
 
 #include "../weechat.h"
+#include "../core-arraylist.h"
+#include "../core-hashtable.h"
 #include "../core-hook.h"
 #include "../core-infolist.h"
 #include "../core-log.h"
@@ -34,6 +36,25 @@
 #include "../../plugins/plugin.h"
 
 
+/*
+ * Index of signal hooks, used to find hooks matching a signal without
+ * checking all masks of all signal hooks (masks are lower case):
+ * - exact: hashtable "signal" -> arraylist of hooks
+ * - prefix: trie with masks "xxx*"
+ * - suffix: trie with masks "*xxx" (reversed)
+ * - generic: arraylist of other masks (for example "*,irc_in2_*"), checked
+ *   with string_match
+ */
+
+struct t_hashtable *hook_signal_index_exact = NULL;
+struct t_hook_signal_trie *hook_signal_index_prefix = NULL;
+struct t_hook_signal_trie *hook_signal_index_suffix = NULL;
+struct t_arraylist *hook_signal_index_generic = NULL;
+
+unsigned long long hook_signal_seq = 0; /* creation order of signal hooks   */
+unsigned long long hook_signal_index_updates = 0; /* hooks added in index   */
+
+
 /*
  * Returns description of hook.
  *
@@ -47,6 +68,596 @@ hook_signal_get_description (struct t_hook *hook)
         (const char **)(HOOK_SIGNAL(hook, signals)), ";", 0, -1);
 }
 
+/*
+ * Returns the type of a mask (lower case) for the index of signal hooks,
+ * and sets the word to index (without wildcards) in "word" and "length".
+ */
+
+enum t_hook_signal_mask_type
+hook_signal_mask_type (const char *mask, const char **word, int *length)
+{
+    const char *ptr_start, *ptr_end;
+
+    ptr_start = mask;
+    while (ptr_start[0] == '*')
+    {
+        ptr_start++;
+    }
+    ptr_end = ptr_start;
+    while (ptr_end[0] && (ptr_end[0] != '*'))
+    {
+        ptr_end++;
+    }
+
+    *word = ptr_start;
+    *length = ptr_end - ptr_start;
+
+    /* no wildcard at all */
+    if ((ptr_start == mask) && !ptr_end[0])
+        return HOOK_SIGNAL_MASK_EXACT;
+
+    /* mask is only wildcards: matches any signal */
+    if (*length == 0)
+        return HOOK_SIGNAL_MASK_PREFIX;
+
+    /* only wildcards at the end */
+    if (ptr_start == mask)
+    {
+        while (ptr_end[0] == '*')
+        {
+            ptr_end++;
+        }
+        return (ptr_end[0]) ? HOOK_SIGNAL_MASK_GENERIC : HOOK_SIGNAL_MASK_PREFIX;
+    }
+
+    /* only wildcards at the beginning */
+    if (!ptr_end[0])
+        return HOOK_SIGNAL_MASK_SUFFIX;
+
+    return HOOK_SIGNAL_MASK_GENERIC;
+}
+
+/*
+ * Removes first occurrence of a hook in an arraylist.
+ */
+
+void
+hook_signal_arraylist_remove (struct t_arraylist *list, struct t_hook *hook)
+{
+    int i;
+
+    for (i = 0; i < list->size; i++)
+    {
+        if (list->data[i] == hook)
+        {
+            arraylist_remove (list, i);
+            return;
+        }
+    }
+}
+
+/*
+ * Searches a child node with a given char in a trie node.
+ */
+
+struct t_hook_signal_trie *
+hook_signal_trie_search_child (struct t_hook_signal_trie *node, char c)
+{
+    struct t_hook_signal_trie *ptr_child;
+
+    for (ptr_child = node->children; ptr_child;
+         ptr_child = ptr_child->next_sibling)
+    {
+        if (ptr_child->c == c)
+            return ptr_child;
+    }
+
+    return NULL;
+}
+
+/*
+ * Allocates a new trie node.
+ *
+ * Returns pointer to new node, NULL if error.
+ */
+
+struct t_hook_signal_trie *
+hook_signal_trie_new (char c)
+{
+    struct t_hook_signal_trie *new_node;
+
+    new_node = malloc (sizeof (*new_node));
+    if (!new_node)
+        return NULL;
+
+    new_node->c = c;
+    new_node->hooks = NULL;
+    new_node->children = NULL;
+    new_node->next_sibling = NULL;
+
+    return new_node;
+}
+
+/*
+ * Adds a hook in a trie, for a word (read backwards if reverse == 1).
+ */
+
+void
+hook_signal_trie_add (struct t_hook_signal_trie **trie,
+                      const char *word, int length, int reverse,
+                      struct t_hook *hook)
+{
+    struct t_hook_signal_trie *ptr_node, *ptr_child;
+    int i;
+    char c;
+
+    if (!*trie)
+    {
+        *trie = hook_signal_trie_new ('\0');
+        if (!*trie)
+            return;
+    }
+
+    ptr_node = *trie;
+    for (i = 0; i < length; i++)
+    {
+        c = (reverse) ? word[length - 1 - i] : word[i];
+        ptr_child = hook_signal_trie_search_child (ptr_node, c);
+        if (!ptr_child)
+        {
+            ptr_child = hook_signal_trie_new (c);
+            if (!ptr_child)
+                return;
+            ptr_child->next_sibling = ptr_node->children;
+            ptr_node->children = ptr_child;
+        }
+        ptr_node = ptr_child;
+    }
+
+    if (!ptr_node->hooks)
+    {
+        ptr_node->hooks = arraylist_new (4, 0, 1, NULL, NULL, NULL, NULL);
+        if (!ptr_node->hooks)
+            return;
+    }
+    arraylist_add (ptr_node->hooks, hook);
+}
+
+/*
+ * Removes a hook from a trie, for a word (read backwards if reverse == 1),
+ * and frees nodes which are not used any more.
+ *
+ * Returns:
+ *   1: node is empty and has been freed
+ *   0: node is still used
+ */
+
+int
+hook_signal_trie_remove (struct t_hook_signal_trie *node,
+                         const char *word, int length, int reverse,
+                         int depth, struct t_hook *hook)
+{
+    struct t_hook_signal_trie *ptr_child, *prev_child;
+    char c;
+
+    if (depth < length)
+    {
+        c = (reverse) ? word[length - 1 - depth] : word[depth];
+        prev_child = NULL;
+        for (ptr_child = node->children; ptr_child;
+             ptr_child = ptr_child->next_sibling)
+        {
+            if (ptr_child->c == c)
+                break;
+            prev_child = ptr_child;
+        }
+        if (ptr_child
+            && hook_signal_trie_remove (ptr_child, word, length, reverse,
+                                        depth + 1, hook))
+        {
+            if (prev_child)
+                prev_child->next_sibling = ptr_child->next_sibling;
+            else
+                node->children = ptr_child->next_sibling;
+        }
+    }
+    else if (node->hooks)
+    {
+        hook_signal_arraylist_remove (node->hooks, hook);
+        if (node->hooks->size == 0)
+        {
+            arraylist_free (node->hooks);
+            node->hooks = NULL;
+        }
+    }
+
+    if ((depth > 0) && !node->hooks && !node->children)
+    {
+        free (node);
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Frees a trie (node, its children and its siblings).
+ */
+
+void
+hook_signal_trie_free (struct t_hook_signal_trie *node)
+{
+    struct t_hook_signal_trie *ptr_next;
+
+    while (node)
+    {
+        ptr_next = node->next_sibling;
+        hook_signal_trie_free (node->children);
+        arraylist_free (node->hooks);
+        free (node);
+        node = ptr_next;
+    }
+}
+
+/*
+ * Frees a list of hooks for an exact signal in index.
+ */
+
+void
+hook_signal_index_exact_free_value_cb (struct t_hashtable *hashtable,
+                                       const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    arraylist_free ((struct t_arraylist *)value);
+}
+
+/*
+ * Frees a generic mask in index.
+ */
+
+void
+hook_signal_index_generic_free_cb (void *data, struct t_arraylist *arraylist,
+                                   void *pointer)
+{
+    struct t_hook_signal_mask *ptr_mask;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) arraylist;
+
+    ptr_mask = (struct t_hook_signal_mask *)pointer;
+    free (ptr_mask->mask);
+    free (ptr_mask->word);
+    free (ptr_mask);
+}
+
+/*
+ * Adds a mask of a signal hook in index.
+ */
+
+void
+hook_signal_index_add_mask (struct t_hook *hook, const char *mask)
+{
+    struct t_arraylist *ptr_list;
+    struct t_hook_signal_mask *new_mask;
+    const char *word;
+    int length;
+
+    switch (hook_signal_mask_type (mask, &word, &length))
+    {
+        case HOOK_SIGNAL_MASK_EXACT:
+            if (!hook_signal_index_exact)
+            {
+                hook_signal_index_exact = hashtable_new (
+                    32,
+                    WEECHAT_HASHTABLE_STRING,
+                    WEECHAT_HASHTABLE_POINTER,
+                    NULL, NULL);
+                if (!hook_signal_index_exact)
+                    return;
+                hook_signal_index_exact->callback_free_value =
+                    &hook_signal_index_exact_free_value_cb;
+            }
+            ptr_list = hashtable_get (hook_signal_index_exact, mask);
+            if (!ptr_list)
+            {
+                ptr_list = arraylist_new (4, 0, 1, NULL, NULL, NULL, NULL);
+                if (!ptr_list)
+                    return;
+                hashtable_set (hook_signal_index_exact, mask, ptr_list);
+            }
+            arraylist_add (ptr_list, hook);
+            break;
+        case HOOK_SIGNAL_MASK_PREFIX:
+            hook_signal_trie_add (&hook_signal_index_prefix, word, length, 0,
+                                  hook);
+            break;
+        case HOOK_SIGNAL_MASK_SUFFIX:
+            hook_signal_trie_add (&hook_signal_index_suffix, word, length, 1,
+                                  hook);
+            break;
+        case HOOK_SIGNAL_MASK_GENERIC:
+            if (!hook_signal_index_generic)
+            {
+                hook_signal_index_generic = arraylist_new (
+                    16, 0, 1,
+                    NULL, NULL,
+                    &hook_signal_index_generic_free_cb, NULL);
+                if (!hook_signal_index_generic)
+                    return;
+            }
+            new_mask = malloc (sizeof (*new_mask));
+            if (!new_mask)
+                return;
+            new_mask->hook = hook;
+            new_mask->mask = strdup (mask);
+            new_mask->word = string_strndup (word, length);
+            arraylist_add (hook_signal_index_generic, new_mask);
+            break;
+    }
+}
+
+/*
+ * Removes a mask of a signal hook from index.
+ */
+
+void
+hook_signal_index_remove_mask (struct t_hook *hook, const char *mask)
+{
+    struct t_arraylist *ptr_list;
+    struct t_hook_signal_mask *ptr_mask;
+    const char *word;
+    int i, length;
+
+    switch (hook_signal_mask_type (mask, &word, &length))
+    {
+        case HOOK_SIGNAL_MASK_EXACT:
+            if (!hook_signal_index_exact)
+                return;
+            ptr_list = hashtable_get (hook_signal_index_exact, mask);
+            if (!ptr_list)
+                return;
+            hook_signal_arraylist_remove (ptr_list, hook);
+            if (ptr_list->size == 0)
+                hashtable_remove (hook_signal_index_exact, mask);
+            break;
+        case HOOK_SIGNAL_MASK_PREFIX:
+            if (hook_signal_index_prefix)
+            {
+                hook_signal_trie_remove (hook_signal_index_prefix,
+                                         word, length, 0, 0, hook);
+            }
+            break;
+        case HOOK_SIGNAL_MASK_SUFFIX:
+            if (hook_signal_index_suffix)
+            {
+                hook_signal_trie_remove (hook_signal_index_suffix,
+                                         word, length, 1, 0, hook);
+            }
+            break;
+        case HOOK_SIGNAL_MASK_GENERIC:
+            if (!hook_signal_index_generic)
+                return;
+            for (i = 0; i < hook_signal_index_generic->size; i++)
+            {
+                ptr_mask = (struct t_hook_signal_mask *)hook_signal_index_generic->data[i];
+                if ((ptr_mask->hook == hook)
+                    && (strcmp (ptr_mask->mask, mask) == 0))
+                {
+                    arraylist_remove (hook_signal_index_generic, i);
+                    break;
+                }
+            }
+            break;
+    }
+}
+
+/*
+ * Adds or removes all masks of a signal hook in index.
+ */
+
+void
+hook_signal_index_update (struct t_hook *hook, int add)
+{
+    char *mask;
+    int i;
+
+    for (i = 0; i < HOOK_SIGNAL(hook, num_signals); i++)
+    {
+        mask = string_tolower (HOOK_SIGNAL(hook, signals)[i]);
+        if (!mask)
+            continue;
+        if (add)
+            hook_signal_index_add_mask (hook, mask);
+        else
+            hook_signal_index_remove_mask (hook, mask);
+        free (mask);
+    }
+
+    if (add)
+        hook_signal_index_updates++;
+}
+
+/*
+ * Frees index of signal hooks (called on exit after all hooks have been
+ * removed, and on upgrade).
+ */
+
+void
+hook_signal_index_free ()
+{
+    hashtable_free (hook_signal_index_exact);
+    hook_signal_index_exact = NULL;
+    hook_signal_trie_free (hook_signal_index_prefix);
+    hook_signal_index_prefix = NULL;
+    hook_signal_trie_free (hook_signal_index_suffix);
+    hook_signal_index_suffix = NULL;
+    arraylist_free (hook_signal_index_generic);
+    hook_signal_index_generic = NULL;
+}
+
+/*
+ * Adds a hook in candidates.
+ */
+
+void
+hook_signal_candidates_add (struct t_hook_signal_candidates *candidates,
+                            struct t_hook *hook)
+{
+    struct t_hook **new_hooks;
+    int new_size;
+
+    if (candidates->count >= candidates->size)
+    {
+        new_size = (candidates->size > 0) ? candidates->size * 2 : 16;
+        new_hooks = realloc (candidates->hooks,
+                             new_size * sizeof (*new_hooks));
+        if (!new_hooks)
+            return;
+        candidates->hooks = new_hooks;
+        candidates->size = new_size;
+    }
+
+    candidates->hooks[candidates->count++] = hook;
+}
+
+/*
+ * Adds hooks of an arraylist in candidates.
+ */
+
+void
+hook_signal_candidates_add_list (struct t_hook_signal_candidates *candidates,
+                                 struct t_arraylist *list)
+{
+    int i;
+
+    if (!list)
+        return;
+
+    for (i = 0; i < list->size; i++)
+    {
+        hook_signal_candidates_add (candidates,
+                                    (struct t_hook *)list->data[i]);
+    }
+}
+
+/*
+ * Compares two signal hooks, to sort them in the same order as the list of
+ * signal hooks: by priority (descending), then by creation order.
+ */
+
+int
+hook_signal_candidates_cmp_cb (const void *hook1, const void *hook2)
+{
+    struct t_hook *ptr_hook1, *ptr_hook2;
+
+    ptr_hook1 = *((struct t_hook **)hook1);
+    ptr_hook2 = *((struct t_hook **)hook2);
+
+    if (ptr_hook1->priority != ptr_hook2->priority)
+        return (ptr_hook1->priority > ptr_hook2->priority) ? -1 : 1;
+
+    if (HOOK_SIGNAL(ptr_hook1, seq) != HOOK_SIGNAL(ptr_hook2, seq))
+        return (HOOK_SIGNAL(ptr_hook1, seq) < HOOK_SIGNAL(ptr_hook2, seq)) ? -1 : 1;
+
+    return 0;
+}
+
+/*
+ * Builds the list of signal hooks matching a signal (using index), sorted
+ * like the list of signal hooks, without duplicates and without deleted
+ * hooks.
+ */
+
+void
+hook_signal_get_candidates (const char *signal, const char *signal_lower,
+                            struct t_hook_signal_candidates *candidates)
+{
+    struct t_hook_signal_trie *ptr_node;
+    struct t_hook_signal_mask *ptr_mask;
+    int i, j, length;
+
+    candidates->count = 0;
+
+    /* exact signal name */
+    if (hook_signal_index_exact)
+    {
+        hook_signal_candidates_add_list (
+            candidates,
+            hashtable_get (hook_signal_index_exact, signal_lower));
+    }
+
+    length = strlen (signal_lower);
+
+    /* masks "xxx*": all nodes in path of signal in trie */
+    ptr_node = hook_signal_index_prefix;
+    for (i = 0; ptr_node; i++)
+    {
+        hook_signal_candidates_add_list (candidates, ptr_node->hooks);
+        if (i >= length)
+            break;
+        ptr_node = hook_signal_trie_search_child (ptr_node, signal_lower[i]);
+    }
+
+    /* masks "*xxx": all nodes in path of reversed signal in trie */
+    ptr_node = hook_signal_index_suffix;
+    for (i = 0; ptr_node; i++)
+    {
+        hook_signal_candidates_add_list (candidates, ptr_node->hooks);
+        if (i >= length)
+            break;
+        ptr_node = hook_signal_trie_search_child (ptr_node,
+                                                  signal_lower[length - 1 - i]);
+    }
+
+    /* other masks: check the word first, then the whole mask */
+    if (hook_signal_index_generic)
+    {
+        for (i = 0; i < hook_signal_index_generic->size; i++)
+        {
+            ptr_mask = (struct t_hook_signal_mask *)hook_signal_index_generic->data[i];
+            if (ptr_mask->word && ptr_mask->word[0]
+                && !strstr (signal_lower, ptr_mask->word))
+            {
+                continue;
+            }
+            if (string_match (signal, ptr_mask->mask, 0))
+                hook_signal_candidates_add (candidates, ptr_mask->hook);
+        }
+    }
+
+    if (candidates->count > 1)
+    {
+        qsort (candidates->hooks, candidates->count,
+               sizeof (*candidates->hooks),
+               &hook_signal_candidates_cmp_cb);
+    }
+
+    /* remove duplicates (hook with multiple masks matching) */
+    j = 0;
+    for (i = 0; i < candidates->count; i++)
+    {
+        if ((j > 0) && (candidates->hooks[j - 1] == candidates->hooks[i]))
+            continue;
+        candidates->hooks[j++] = candidates->hooks[i];
+    }
+    candidates->count = j;
+}
+
+/*
+ * Callback called when a signal hook is added in the list of hooks.
+ */
+
+void
+hook_signal_add_cb (struct t_hook *hook)
+{
+    HOOK_SIGNAL(hook, seq) = hook_signal_seq++;
+    hook_signal_index_update (hook, 1);
+}
+
 /*
  * Hooks a signal.
  *
@@ -92,6 +703,7 @@ hook_signal (struct t_weechat_plugin *plugin, const char *signal,
         | WEECHAT_STRING_SPLIT_STRIP_RIGHT
         | WEECHAT_STRING_SPLIT_COLLAPSE_SEPS,
         0, &new_hook_signal->num_signals);
+    new_hook_signal->seq = 0;
 
     hook_add_to_list (new_hook);
 
@@ -123,46 +735,94 @@ hook_signal_match (const char *signal, struct t_hook *hook)
 
 /*
  * Sends a signal.
+ *
+ * Hooks are found with the index of signal hooks, and they are called in the
+ * same order as the list of signal hooks.
  */
 
 int
 hook_signal_send (const char *signal, const char *type_data, void *signal_data)
 {
-    struct t_hook *ptr_hook, *next_hook;
+    struct t_hook *ptr_hook;
     struct t_hook_exec_cb hook_exec_cb;
-    int rc;
+    struct t_hook_signal_candidates candidates;
+    unsigned long long index_updates, seq;
+    char *signal_lower;
+    int i, rc, priority;
 
     rc = WEECHAT_RC_OK;
 
+    if (!signal || !weechat_hooks[HOOK_TYPE_SIGNAL])
+        return rc;
+
+    signal_lower = string_tolower (signal);
+    if (!signal_lower)
+        return rc;
+
+    candidates.hooks = NULL;
+    candidates.count = 0;
+    candidates.size = 0;
+
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_SIGNAL];
-    while (ptr_hook)
+    hook_signal_get_candidates (signal, signal_lower, &candidates);
+    index_updates = hook_signal_index_updates;
+
+    i = 0;
+    while (i < candidates.count)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = candidates.hooks[i];
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && hook_signal_match (signal, ptr_hook))
+        if (ptr_hook->deleted || ptr_hook->running)
         {
-            hook_callback_start (ptr_hook, &hook_exec_cb);
-            rc = (HOOK_SIGNAL(ptr_hook, callback))
-                (ptr_hook->callback_pointer,
-                 ptr_hook->callback_data,
-                 signal,
-                 type_data,
-                 signal_data);
-            hook_callback_end (ptr_hook, &hook_exec_cb);
-
-            if (rc == WEECHAT_RC_OK_EAT)
-                break;
+            i++;
+            continue;
         }
 
-        ptr_hook = next_hook;
+        priority = ptr_hook->priority;
+        seq = HOOK_SIGNAL(ptr_hook, seq);
+
+        hook_callback_start (ptr_hook, &hook_exec_cb);
+        rc = (HOOK_SIGNAL(ptr_hook, callback))
+            (ptr_hook->callback_pointer,
+             ptr_hook->callback_data,
+             signal,
+             type_data,
+             signal_data);
+        hook_callback_end (ptr_hook, &hook_exec_cb);
+
+        if (rc == WEECHAT_RC_OK_EAT)
+            break;
+
+        if (hook_signal_index_updates != index_updates)
+        {
+            /*
+             * new signal hooks have been added by the callback: build the
+             * list again and continue after the hook that has just been
+             * called (like a scan of the list of hooks would do)
+             */
+            hook_signal_get_candidates (signal, signal_lower, &candidates);
+            index_updates = hook_signal_index_updates;
+            i = 0;
+            while ((i < candidates.count)
+                   && ((candidates.hooks[i]->priority > priority)
+                       || ((candidates.hooks[i]->priority == priority)
+                           && (candidates.hooks[i]->deleted
+                               || (HOOK_SIGNAL(candidates.hooks[i], seq) <= seq)))))
+            {
+                i++;
+            }
+            continue;
+        }
+
+        i++;
     }
 
     hook_exec_end ();
 
+    free (candidates.hooks);
+    free (signal_lower);
+
     return rc;
 }
 
@@ -176,6 +836,8 @@ hook_signal_free_data (struct t_hook *hook)
     if (!hook || !hook->hook_data)
         return;
 
+    hook_signal_index_update (hook, 0);
+
     if (HOOK_SIGNAL(hook, signals))
     {
         string_free_split (HOOK_SIGNAL(hook, signals));
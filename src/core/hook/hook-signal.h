@@ -22,6 +22,7 @@
 
 struct t_weechat_plugin;
 struct t_infolist_item;
+struct t_arraylist;
 
 #define HOOK_SIGNAL(hook, var) (((struct t_hook_signal *)hook->hook_data)->var)
 
@@ -36,14 +37,57 @@ struct t_hook_signal
                                        /* begin or end with "*",            */
                                        /* "*" == any signal                 */
     int num_signals;                   /* number of signals                 */
+    unsigned long long seq;            /* creation order (to sort hooks     */
+                                       /* found with index like the list)   */
+};
+
+/* type of mask in index of signal hooks */
+
+enum t_hook_signal_mask_type
+{
+    HOOK_SIGNAL_MASK_EXACT = 0,        /* no wildcard: "signal"             */
+    HOOK_SIGNAL_MASK_PREFIX,           /* wildcards at end: "signal*"       */
+    HOOK_SIGNAL_MASK_SUFFIX,           /* wildcards at beginning: "*signal" */
+    HOOK_SIGNAL_MASK_GENERIC,          /* any other mask: "*sig*nal*"       */
+};
+
+/* trie node, used for masks "xxx*" and "*xxx" in index */
+
+struct t_hook_signal_trie
+{
+    char c;                            /* char (in mask, lower case)        */
+    struct t_arraylist *hooks;         /* hooks with mask ending here       */
+    struct t_hook_signal_trie *children;     /* first child node            */
+    struct t_hook_signal_trie *next_sibling; /* next node with same parent  */
+};
+
+/* generic mask in index (not exact name, not prefix, not suffix) */
+
+struct t_hook_signal_mask
+{
+    struct t_hook *hook;               /* signal hook                       */
+    char *mask;                        /* mask (lower case)                 */
+    char *word;                        /* first word of mask (without "*"), */
+                                       /* must be in signal to match        */
+};
+
+/* signal hooks matching a signal */
+
+struct t_hook_signal_candidates
+{
+    struct t_hook **hooks;             /* hooks (sorted like the list)      */
+    int count;                         /* number of hooks                   */
+    int size;                          /* allocated size of hooks           */
 };
 
 extern char *hook_signal_get_description (struct t_hook *hook);
+extern void hook_signal_add_cb (struct t_hook *hook);
 extern struct t_hook *hook_signal (struct t_weechat_plugin *plugin,
                                    const char *signal,
                                    t_hook_callback_signal *callback,
                                    const void *callback_pointer,
                                    void *callback_data);
+extern void hook_signal_index_free ();
 extern int hook_signal_send (const char *signal, const char *type_data,
                              void *signal_data);
 extern void hook_signal_free_data (struct t_hook *hook);
@@ -37,6 +37,14 @@
 
 time_t hook_last_system_time = 0;      /* used to detect system clock skew  */
 
+/*
+ * timers are kept in a binary min-heap sorted on next execution date
+ * (hook_timer_heap[0] is the next timer to run)
+ */
+struct t_hook **hook_timer_heap = NULL; /* heap of timers                   */
+int hook_timer_heap_count = 0;         /* number of timers in heap          */
+int hook_timer_heap_size = 0;          /* allocated size of heap            */
+
 
 /*
  * Returns description of hook.
@@ -75,6 +83,167 @@ hook_timer_get_description (struct t_hook *hook)
     return strdup (str_desc);
 }
 
+/*
+ * Compares next execution date of two timers in heap.
+ *
+ * Returns:
+ *   < 0: timer at index1 must run before timer at index2
+ *     0: same date
+ *   > 0: timer at index1 must run after timer at index2
+ */
+
+int
+hook_timer_heap_cmp (int index1, int index2)
+{
+    return util_timeval_cmp (&HOOK_TIMER(hook_timer_heap[index1], next_exec),
+                             &HOOK_TIMER(hook_timer_heap[index2], next_exec));
+}
+
+/*
+ * Swaps two timers in heap.
+ */
+
+void
+hook_timer_heap_swap (int index1, int index2)
+{
+    struct t_hook *ptr_hook;
+
+    ptr_hook = hook_timer_heap[index1];
+    hook_timer_heap[index1] = hook_timer_heap[index2];
+    hook_timer_heap[index2] = ptr_hook;
+
+    HOOK_TIMER(hook_timer_heap[index1], heap_index) = index1;
+    HOOK_TIMER(hook_timer_heap[index2], heap_index) = index2;
+}
+
+/*
+ * Moves a timer up in heap (to the root), until heap order is respected.
+ */
+
+void
+hook_timer_heap_up (int index)
+{
+    int parent;
+
+    while (index > 0)
+    {
+        parent = (index - 1) / 2;
+        if (hook_timer_heap_cmp (index, parent) >= 0)
+            break;
+        hook_timer_heap_swap (index, parent);
+        index = parent;
+    }
+}
+
+/*
+ * Moves a timer down in heap (to the leaves), until heap order is respected.
+ */
+
+void
+hook_timer_heap_down (int index)
+{
+    int child, smallest;
+
+    while (1)
+    {
+        smallest = index;
+        child = (2 * index) + 1;
+        if ((child < hook_timer_heap_count)
+            && (hook_timer_heap_cmp (child, smallest) < 0))
+        {
+            smallest = child;
+        }
+        child++;
+        if ((child < hook_timer_heap_count)
+            && (hook_timer_heap_cmp (child, smallest) < 0))
+        {
+            smallest = child;
+        }
+        if (smallest == index)
+            break;
+        hook_timer_heap_swap (index, smallest);
+        index = smallest;
+    }
+}
+
+/*
+ * Adds a timer in heap.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (memory allocation failure)
+ */
+
+int
+hook_timer_heap_add (struct t_hook *hook)
+{
+    struct t_hook **new_heap;
+    int new_size;
+
+    if (HOOK_TIMER(hook, heap_index) >= 0)
+        return 1;
+
+    if (hook_timer_heap_count >= hook_timer_heap_size)
+    {
+        new_size = (hook_timer_heap_size > 0) ? hook_timer_heap_size * 2 : 64;
+        new_heap = realloc (hook_timer_heap, new_size * sizeof (*new_heap));
+        if (!new_heap)
+            return 0;
+        hook_timer_heap = new_heap;
+        hook_timer_heap_size = new_size;
+    }
+
+    hook_timer_heap[hook_timer_heap_count] = hook;
+    HOOK_TIMER(hook, heap_index) = hook_timer_heap_count;
+    hook_timer_heap_count++;
+
+    hook_timer_heap_up (hook_timer_heap_count - 1);
+
+    return 1;
+}
+
+/*
+ * Removes a timer from heap.
+ */
+
+void
+hook_timer_heap_remove (struct t_hook *hook)
+{
+    int index, last;
+
+    index = HOOK_TIMER(hook, heap_index);
+    if ((index < 0) || (index >= hook_timer_heap_count))
+        return;
+
+    last = hook_timer_heap_count - 1;
+    if (index != last)
+        hook_timer_heap_swap (index, last);
+
+    hook_timer_heap_count--;
+    HOOK_TIMER(hook, heap_index) = -1;
+
+    if (index < hook_timer_heap_count)
+    {
+        hook_timer_heap_up (index);
+        hook_timer_heap_down (index);
+    }
+}
+
+/*
+ * Rebuilds the heap (after change of next execution date in many timers).
+ */
+
+void
+hook_timer_heap_rebuild ()
+{
+    int i;
+
+    for (i = (hook_timer_heap_count / 2) - 1; i >= 0; i--)
+    {
+        hook_timer_heap_down (i);
+    }
+}
+
 /*
  * Initializes a timer hook.
  */
@@ -167,9 +336,22 @@ hook_timer (struct t_weechat_plugin *plugin, long interval, int align_second,
     new_hook_timer->interval = interval;
     new_hook_timer->align_second = align_second;
     new_hook_timer->remaining_calls = max_calls;
+    new_hook_timer->heap_index = -1;
 
     hook_timer_init (new_hook);
 
+    /*
+     * the heap is allocated for all timers here (and never shrinks while
+     * there are timers), so that a timer can always be put back in heap
+     * after its execution
+     */
+    if (!hook_timer_heap_add (new_hook))
+    {
+        free (new_hook_timer);
+        free (new_hook);
+        return NULL;
+    }
+
     hook_add_to_list (new_hook);
 
     return new_hook;
@@ -212,6 +394,7 @@ hook_timer_check_system_clock ()
             if (!ptr_hook->deleted)
                 hook_timer_init (ptr_hook);
         }
+        hook_timer_heap_rebuild ();
     }
 
     hook_last_system_time = now;
@@ -224,7 +407,6 @@ hook_timer_check_system_clock ()
 int
 hook_timer_get_time_to_next ()
 {
-    struct t_hook *ptr_hook;
     int found, timeout;
     struct timeval tv_now, tv_timeout;
     long diff_usec;
@@ -235,18 +417,12 @@ hook_timer_get_time_to_next ()
     tv_timeout.tv_sec = 0;
     tv_timeout.tv_usec = 0;
 
-    for (ptr_hook = weechat_hooks[HOOK_TYPE_TIMER]; ptr_hook;
-         ptr_hook = ptr_hook->next_hook)
+    /* next timer to run is on top of heap */
+    if (hook_timer_heap_count > 0)
     {
-        if (!ptr_hook->deleted
-            && (!found
-                || (util_timeval_cmp (&HOOK_TIMER(ptr_hook, next_exec),
-                                      &tv_timeout) < 0)))
-        {
-            found = 1;
-            tv_timeout.tv_sec = HOOK_TIMER(ptr_hook, next_exec).tv_sec;
-            tv_timeout.tv_usec = HOOK_TIMER(ptr_hook, next_exec).tv_usec;
-        }
+        found = 1;
+        tv_timeout.tv_sec = HOOK_TIMER(hook_timer_heap[0], next_exec).tv_sec;
+        tv_timeout.tv_usec = HOOK_TIMER(hook_timer_heap[0], next_exec).tv_usec;
     }
 
     /* no timeout found, return 2 seconds by default */
@@ -302,9 +478,10 @@ end:
 void
 hook_timer_exec ()
 {
-    struct t_hook *ptr_hook, *next_hook;
+    struct t_hook **timers, *ptr_hook;
     struct t_hook_exec_cb hook_exec_cb;
     struct timeval tv_time;
+    int i, count;
 
     if (!weechat_hooks[HOOK_TYPE_TIMER])
         return;
@@ -313,17 +490,41 @@ hook_timer_exec ()
 
     gettimeofday (&tv_time, NULL);
 
+    if ((hook_timer_heap_count == 0)
+        || (util_timeval_cmp (&HOOK_TIMER(hook_timer_heap[0], next_exec),
+                              &tv_time) > 0))
+    {
+        return;
+    }
+
+    /*
+     * extract all timers to run from heap (sorted by next execution date),
+     * so that each timer is called at most once by this function, even if
+     * its next execution date is still in the past after the call
+     */
+    timers = malloc (hook_timer_heap_count * sizeof (*timers));
+    if (!timers)
+        return;
+    count = 0;
+    while ((hook_timer_heap_count > 0)
+           && (util_timeval_cmp (&HOOK_TIMER(hook_timer_heap[0], next_exec),
+                                 &tv_time) <= 0))
+    {
+        timers[count++] = hook_timer_heap[0];
+        hook_timer_heap_remove (hook_timer_heap[0]);
+    }
+
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_TIMER];
-    while (ptr_hook)
+    for (i = 0; i < count; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = timers[i];
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (util_timeval_cmp (&HOOK_TIMER(ptr_hook, next_exec),
-                                  &tv_time) <= 0))
+        /* timer removed by a previous callback? */
+        if (ptr_hook->deleted)
+            continue;
+
+        if (!ptr_hook->running)
         {
             hook_callback_start (ptr_hook, &hook_exec_cb);
             (void) (HOOK_TIMER(ptr_hook, callback))
@@ -332,27 +533,40 @@ hook_timer_exec ()
                  (HOOK_TIMER(ptr_hook, remaining_calls) > 0) ?
                   HOOK_TIMER(ptr_hook, remaining_calls) - 1 : -1);
             hook_callback_end (ptr_hook, &hook_exec_cb);
-            if (!ptr_hook->deleted)
-            {
-                HOOK_TIMER(ptr_hook, last_exec).tv_sec = tv_time.tv_sec;
-                HOOK_TIMER(ptr_hook, last_exec).tv_usec = tv_time.tv_usec;
+            if (ptr_hook->deleted)
+                continue;
+
+            HOOK_TIMER(ptr_hook, last_exec).tv_sec = tv_time.tv_sec;
+            HOOK_TIMER(ptr_hook, last_exec).tv_usec = tv_time.tv_usec;
 
-                util_timeval_add (
-                    &HOOK_TIMER(ptr_hook, next_exec),
-                    ((long long)HOOK_TIMER(ptr_hook, interval)) * 1000);
+            util_timeval_add (
+                &HOOK_TIMER(ptr_hook, next_exec),
+                ((long long)HOOK_TIMER(ptr_hook, interval)) * 1000);
 
-                if (HOOK_TIMER(ptr_hook, remaining_calls) > 0)
+            if (HOOK_TIMER(ptr_hook, remaining_calls) > 0)
+            {
+                HOOK_TIMER(ptr_hook, remaining_calls)--;
+                if (HOOK_TIMER(ptr_hook, remaining_calls) == 0)
                 {
-                    HOOK_TIMER(ptr_hook, remaining_calls)--;
-                    if (HOOK_TIMER(ptr_hook, remaining_calls) == 0)
-                        unhook (ptr_hook);
+                    unhook (ptr_hook);
+                    continue;
                 }
             }
         }
 
-        ptr_hook = next_hook;
+        /* put timer back in heap, with its new execution date */
+        if (!hook_timer_heap_add (ptr_hook))
+        {
+            gui_chat_printf (NULL,
+                             _("%sError: not enough memory to schedule "
+                               "timer %p, it will not be called any more"),
+                             gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                             ptr_hook);
+        }
     }
 
+    free (timers);
+
     hook_exec_end ();
 }
 
@@ -366,10 +580,32 @@ hook_timer_free_data (struct t_hook *hook)
     if (!hook || !hook->hook_data)
         return;
 
+    hook_timer_heap_remove (hook);
+
     free (hook->hook_data);
     hook->hook_data = NULL;
 }
 
+/*
+ * Callback called when a timer hook is removed from the list of hooks:
+ * the heap is freed when there are no more timers.
+ */
+
+void
+hook_timer_remove_cb (struct t_hook *hook)
+{
+    /* make C compiler happy */
+    (void) hook;
+
+    if (hooks_count[HOOK_TYPE_TIMER] == 0)
+    {
+        free (hook_timer_heap);
+        hook_timer_heap = NULL;
+        hook_timer_heap_count = 0;
+        hook_timer_heap_size = 0;
+    }
+}
+
 /*
  * Adds timer hook data in the infolist item.
  *
@@ -425,6 +661,7 @@ hook_timer_print_log (struct t_hook *hook)
     log_printf ("    interval. . . . . . . : %ld", HOOK_TIMER(hook, interval));
     log_printf ("    align_second. . . . . : %d", HOOK_TIMER(hook, align_second));
     log_printf ("    remaining_calls . . . : %d", HOOK_TIMER(hook, remaining_calls));
+    log_printf ("    heap_index. . . . . . : %d", HOOK_TIMER(hook, heap_index));
     util_strftimeval (text_time, sizeof (text_time),
                       "%Y-%m-%dT%H:%M:%S.%f", &(HOOK_TIMER(hook, last_exec)));
     log_printf ("    last_exec . . . . . . : %s", text_time);
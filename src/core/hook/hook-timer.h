@@ -40,9 +40,13 @@ struct t_hook_timer
     int remaining_calls;               /* calls remaining (0 = unlimited)   */
     struct timeval last_exec;          /* last time hook was executed       */
     struct timeval next_exec;          /* next scheduled execution          */
+    int heap_index;                    /* index in heap of timers           */
+                                       /* (-1 if not in heap)               */
 };
 
 extern time_t hook_last_system_time;
+extern struct t_hook **hook_timer_heap;
+extern int hook_timer_heap_count;
 
 extern char *hook_timer_get_description (struct t_hook *hook);
 extern struct t_hook *hook_timer (struct t_weechat_plugin *plugin,
@@ -54,6 +58,7 @@ extern struct t_hook *hook_timer (struct t_weechat_plugin *plugin,
 extern int hook_timer_get_time_to_next ();
 extern void hook_timer_exec ();
 extern void hook_timer_free_data (struct t_hook *hook);
+extern void hook_timer_remove_cb (struct t_hook *hook);
 extern int hook_timer_add_to_infolist (struct t_infolist_item *item,
                                        struct t_hook *hook);
 extern void hook_timer_print_log (struct t_hook *hook);
@@ -68,6 +68,7 @@
 #include "core-list.h"
 #include "core-log.h"
 #include "core-network.h"
+#include "core-profile.h"
 #include "core-proxy.h"
 #include "core-secure.h"
 #include "core-secure-config.h"
@@ -715,6 +716,9 @@ weechat_end (void (*gui_end_cb)(int clean_exit))
     config_file_free_all ();            /* free all configuration files     */
     gui_key_end ();                     /* remove all keys                  */
     unhook_all ();                      /* remove all hooks                 */
+    hook_end ();                        /* end hooks                        */
+    eval_end ();                        /* end eval                         */
+    profile_end ();                     /* end profiler                     */
     hdata_end ();                       /* end hdata                        */
     secure_end ();                      /* end secured data                 */
     string_end ();                      /* end string                       */
@@ -45,6 +45,7 @@
 #include "../gui-main.h"
 #include "../gui-window.h"
 #include "gui-curses.h"
+#include "gui-curses-chat.h"
 #include "gui-curses-main.h"
 #include "gui-curses-window.h"
 
@@ -1370,6 +1371,116 @@ gui_chat_display_time_to_prefix (struct t_gui_window *window,
     free (ptr_prefix);
 }
 
+/*
+ * Checks if the day change message must be displayed before a line (first
+ * line displayed of buffer, with a date which is not today).
+ *
+ * If "date_line" is not NULL, it is set with the local date of line.
+ *
+ * Returns:
+ *   1: day change message must be displayed before line
+ *   0: no day change message before line
+ */
+
+int
+gui_chat_day_changed_before_line (struct t_gui_window *window,
+                                  struct t_gui_line *line,
+                                  struct tm *date_line)
+{
+    struct t_gui_line *ptr_prev_line;
+    struct tm local_time, local_time2;
+    struct timeval tv_time;
+    time_t seconds;
+
+    if ((line->data->date == 0)
+        || !CONFIG_BOOLEAN(config_look_day_change)
+        || !window->buffer->day_change)
+    {
+        return 0;
+    }
+
+    ptr_prev_line = gui_line_get_prev_displayed (line);
+    while (ptr_prev_line && (ptr_prev_line->data->date == 0))
+    {
+        ptr_prev_line = gui_line_get_prev_displayed (ptr_prev_line);
+    }
+    if (ptr_prev_line)
+        return 0;
+
+    gettimeofday (&tv_time, NULL);
+    seconds = tv_time.tv_sec;
+    localtime_r (&seconds, &local_time);
+    localtime_r (&line->data->date, &local_time2);
+    if (date_line)
+        memcpy (date_line, &local_time2, sizeof (*date_line));
+
+    return ((local_time.tm_mday != local_time2.tm_mday)
+            || (local_time.tm_mon != local_time2.tm_mon)
+            || (local_time.tm_year != local_time2.tm_year)) ? 1 : 0;
+}
+
+/*
+ * Checks if the day change message must be displayed after a line (date of
+ * next line displayed, or current date for last line, is not the same day).
+ *
+ * If "date_line" and "date_next" are not NULL, they are set with the local
+ * date of line and the local date of next line (or current date).
+ *
+ * Returns:
+ *   1: day change message must be displayed after line
+ *   0: no day change message after line
+ */
+
+int
+gui_chat_day_changed_after_line (struct t_gui_window *window,
+                                 struct t_gui_line *line,
+                                 struct tm *date_line,
+                                 struct tm *date_next)
+{
+    struct t_gui_line *ptr_next_line;
+    struct tm local_time, local_time2;
+    struct timeval tv_time;
+    time_t seconds, *ptr_time;
+
+    if ((line->data->date == 0)
+        || !CONFIG_BOOLEAN(config_look_day_change)
+        || !window->buffer->day_change)
+    {
+        return 0;
+    }
+
+    ptr_next_line = gui_line_get_next_displayed (line);
+    while (ptr_next_line && (ptr_next_line->data->date == 0))
+    {
+        ptr_next_line = gui_line_get_next_displayed (ptr_next_line);
+    }
+    if (ptr_next_line)
+    {
+        /* get time of next line */
+        ptr_time = &ptr_next_line->data->date;
+    }
+    else
+    {
+        /* it was the last line => compare with current system time */
+        gettimeofday (&tv_time, NULL);
+        seconds = tv_time.tv_sec;
+        ptr_time = &seconds;
+    }
+    if (*ptr_time == 0)
+        return 0;
+
+    localtime_r (&line->data->date, &local_time);
+    localtime_r (ptr_time, &local_time2);
+    if (date_line)
+        memcpy (date_line, &local_time, sizeof (*date_line));
+    if (date_next)
+        memcpy (date_next, &local_time2, sizeof (*date_next));
+
+    return ((local_time.tm_mday != local_time2.tm_mday)
+            || (local_time.tm_mon != local_time2.tm_mon)
+            || (local_time.tm_year != local_time2.tm_year)) ? 1 : 0;
+}
+
 /*
  * Displays a line in the chat window.
  *
@@ -1392,10 +1503,7 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
     int nick_offline, nick_offline_action, nick_offline_prefix;
     char *message_nick_offline, *message_with_tags, *message_with_search;
     const char *ptr_data, *ptr_end_offset, *ptr_style, *next_char;
-    struct t_gui_line *ptr_prev_line, *ptr_next_line;
     struct tm local_time, local_time2;
-    struct timeval tv_time;
-    time_t seconds, *ptr_time;
 
     if (!line)
         return 0;
@@ -1414,7 +1522,7 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
             return 0;
         x = window->win_chat_cursor_x;
         y = window->win_chat_cursor_y;
-        num_lines = gui_chat_display_line (window, line, 0, 1);
+        num_lines = gui_chat_line_height (window, line);
         window->win_chat_cursor_x = x;
         window->win_chat_cursor_y = y;
         gui_window_current_emphasis = 0;
@@ -1430,36 +1538,12 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
     lines_displayed = 0;
 
     /* display message before first line of buffer if date is not today */
-    if ((line->data->date != 0)
-        && CONFIG_BOOLEAN(config_look_day_change)
-        && window->buffer->day_change)
+    if (gui_chat_day_changed_before_line (window, line, &local_time2))
     {
-        ptr_time = NULL;
-        ptr_prev_line = gui_line_get_prev_displayed (line);
-        if (ptr_prev_line)
-        {
-            while (ptr_prev_line && (ptr_prev_line->data->date == 0))
-            {
-                ptr_prev_line = gui_line_get_prev_displayed (ptr_prev_line);
-            }
-        }
-        if (!ptr_prev_line)
-        {
-            gettimeofday (&tv_time, NULL);
-            seconds = tv_time.tv_sec;
-            localtime_r (&seconds, &local_time);
-            localtime_r (&line->data->date, &local_time2);
-            if ((local_time.tm_mday != local_time2.tm_mday)
-                || (local_time.tm_mon != local_time2.tm_mon)
-                || (local_time.tm_year != local_time2.tm_year))
-            {
-                gui_chat_display_day_changed (window, NULL, &local_time2,
-                                              simulate);
-                gui_chat_display_new_line (window, num_lines, count,
-                                           &lines_displayed, simulate);
-                pre_lines_displayed++;
-            }
-        }
+        gui_chat_display_day_changed (window, NULL, &local_time2, simulate);
+        gui_chat_display_new_line (window, num_lines, count,
+                                   &lines_displayed, simulate);
+        pre_lines_displayed++;
     }
 
     /* calculate marker position (maybe not used for this line!) */
@@ -1652,45 +1736,13 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
     free (message_with_search);
 
     /* display message if day has changed after this line */
-    if ((line->data->date != 0)
-        && CONFIG_BOOLEAN(config_look_day_change)
-        && window->buffer->day_change)
+    if (gui_chat_day_changed_after_line (window, line,
+                                         &local_time, &local_time2))
     {
-        ptr_time = NULL;
-        ptr_next_line = gui_line_get_next_displayed (line);
-        if (ptr_next_line)
-        {
-            while (ptr_next_line && (ptr_next_line->data->date == 0))
-            {
-                ptr_next_line = gui_line_get_next_displayed (ptr_next_line);
-            }
-        }
-        if (ptr_next_line)
-        {
-            /* get time of next line */
-            ptr_time = &ptr_next_line->data->date;
-        }
-        else
-        {
-            /* it was the last line => compare with current system time */
-            gettimeofday (&tv_time, NULL);
-            seconds = tv_time.tv_sec;
-            ptr_time = &seconds;
-        }
-        if (ptr_time && (*ptr_time != 0))
-        {
-            localtime_r (&line->data->date, &local_time);
-            localtime_r (ptr_time, &local_time2);
-            if ((local_time.tm_mday != local_time2.tm_mday)
-                || (local_time.tm_mon != local_time2.tm_mon)
-                || (local_time.tm_year != local_time2.tm_year))
-            {
-                gui_chat_display_day_changed (window, &local_time, &local_time2,
-                                              simulate);
-                gui_chat_display_new_line (window, num_lines, count,
-                                           &lines_displayed, simulate);
-            }
-        }
+        gui_chat_display_day_changed (window, &local_time, &local_time2,
+                                      simulate);
+        gui_chat_display_new_line (window, num_lines, count,
+                                   &lines_displayed, simulate);
     }
 
     /* display read marker (after line) */
@@ -1739,6 +1791,48 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
     return lines_displayed;
 }
 
+/*
+ * Returns number of lines on screen used to display a line (including day
+ * change messages and read marker).
+ *
+ * The height is read from the cache of lines heights in window if possible,
+ * otherwise it is computed by simulating the display of line, then stored
+ * in cache.
+ */
+
+int
+gui_chat_line_height (struct t_gui_window *window, struct t_gui_line *line)
+{
+    int height, flags;
+
+    if (!line)
+        return 0;
+
+    /* no cache when text is emphasized (search) or tags are displayed */
+    if ((window->buffer->text_search != GUI_BUFFER_SEARCH_DISABLED)
+        || gui_chat_display_tags)
+    {
+        return gui_chat_display_line (window, line, 0, 1);
+    }
+
+    flags = 0;
+    if (gui_chat_day_changed_before_line (window, line, NULL))
+        flags |= GUI_CHAT_LINE_HEIGHT_DAY_BEFORE;
+    if (gui_chat_day_changed_after_line (window, line, NULL, NULL))
+        flags |= GUI_CHAT_LINE_HEIGHT_DAY_AFTER;
+    if (gui_chat_marker_for_line (window->buffer, line))
+        flags |= GUI_CHAT_LINE_HEIGHT_READ_MARKER;
+
+    height = gui_window_line_heights_get (window, line, flags);
+    if (height < 0)
+    {
+        height = gui_chat_display_line (window, line, 0, 1);
+        gui_window_line_heights_set (window, line, height, flags);
+    }
+
+    return height;
+}
+
 /*
  * Displays a line in the chat window (for a buffer with free content).
  */
@@ -1814,12 +1908,14 @@ gui_chat_calculate_line_diff (struct t_gui_window *window,
                               struct t_gui_line **line, int *line_pos,
                               int difference)
 {
-    int backward, current_size;
+    int backward, current_size, available;
 
     if (!line || !line_pos)
         return;
 
     backward = (difference < 0);
+    if (backward)
+        difference = -difference;
 
     if (*line && (*line_pos < 0))
     {
@@ -1835,7 +1931,7 @@ gui_chat_calculate_line_diff (struct t_gui_window *window,
             *line = gui_line_get_last_displayed (window->buffer);
             if (!(*line))
                 return;
-            current_size = gui_chat_display_line (window, *line, 0, 1);
+            current_size = gui_chat_line_height (window, *line);
             if (current_size == 0)
                 current_size = 1;
             *line_pos = current_size - 1;
@@ -1847,49 +1943,59 @@ gui_chat_calculate_line_diff (struct t_gui_window *window,
             if (!(*line))
                 return;
             *line_pos = 0;
-            current_size = gui_chat_display_line (window, *line, 0, 1);
+            current_size = gui_chat_line_height (window, *line);
         }
     }
     else
-        current_size = gui_chat_display_line (window, *line, 0, 1);
+        current_size = gui_chat_line_height (window, *line);
 
-    while ((*line) && (difference != 0))
+    /* move by whole lines as long as possible */
+    while ((*line) && (difference > 0))
     {
         /* looking backward */
         if (backward)
         {
-            if (*line_pos > 0)
-                (*line_pos)--;
+            if (*line_pos >= difference)
+            {
+                *line_pos -= difference;
+                difference = 0;
+            }
             else
             {
+                difference -= *line_pos + 1;
                 *line = gui_line_get_prev_displayed (*line);
                 if (*line)
                 {
-                    current_size = gui_chat_display_line (window, *line, 0, 1);
+                    current_size = gui_chat_line_height (window, *line);
                     if (current_size == 0)
                         current_size = 1;
                     *line_pos = current_size - 1;
                 }
             }
-            difference++;
         }
         /* looking forward */
         else
         {
-            if (*line_pos < current_size - 1)
-                (*line_pos)++;
+            available = current_size - 1 - *line_pos;
+            if (available < 0)
+                available = 0;
+            if (available >= difference)
+            {
+                *line_pos += difference;
+                difference = 0;
+            }
             else
             {
+                difference -= available + 1;
                 *line = gui_line_get_next_displayed (*line);
                 if (*line)
                 {
-                    current_size = gui_chat_display_line (window, *line, 0, 1);
+                    current_size = gui_chat_line_height (window, *line);
                     if (current_size == 0)
                         current_size = 1;
                     *line_pos = 0;
                 }
             }
-            difference--;
         }
     }
 
@@ -1981,9 +2087,8 @@ gui_chat_draw_formatted_buffer (struct t_gui_window *window)
     {
         /* display end of first line at top of screen */
         count = gui_chat_display_line (window, ptr_line,
-                                       gui_chat_display_line (window,
-                                                              ptr_line,
-                                                              0, 1) -
+                                       gui_chat_line_height (window,
+                                                             ptr_line) -
                                        line_pos, 0);
         ptr_line = gui_line_get_next_displayed (ptr_line);
         window->scroll->first_line_displayed = 0;
@@ -2008,7 +2113,7 @@ gui_chat_draw_formatted_buffer (struct t_gui_window *window)
     /* if so, disable scroll indicator */
     if (!ptr_line && window->scroll->scrolling)
     {
-        if ((count == gui_chat_display_line (window, gui_line_get_last_displayed (window->buffer), 0, 1))
+        if ((count == gui_chat_line_height (window, gui_line_get_last_displayed (window->buffer)))
             || (count == window->win_chat_height))
             window->scroll->scrolling = 0;
     }
@@ -20,6 +20,25 @@
 #ifndef WEECHAT_GUI_CURSES_CHAT_H
 #define WEECHAT_GUI_CURSES_CHAT_H
 
+#include <time.h>
+
+struct t_gui_window;
+struct t_gui_line;
+
+/* flags stored with heights of lines in cache */
+#define GUI_CHAT_LINE_HEIGHT_DAY_BEFORE   (1 << 0)
+#define GUI_CHAT_LINE_HEIGHT_DAY_AFTER    (1 << 1)
+#define GUI_CHAT_LINE_HEIGHT_READ_MARKER  (1 << 2)
+
+extern int gui_chat_day_changed_before_line (struct t_gui_window *window,
+                                             struct t_gui_line *line,
+                                             struct tm *date_line);
+extern int gui_chat_day_changed_after_line (struct t_gui_window *window,
+                                            struct t_gui_line *line,
+                                            struct tm *date_line,
+                                            struct tm *date_next);
+extern int gui_chat_line_height (struct t_gui_window *window,
+                                 struct t_gui_line *line);
 extern void gui_chat_calculate_line_diff (struct t_gui_window *window,
                                           struct t_gui_line **line,
                                           int *line_pos, int difference);
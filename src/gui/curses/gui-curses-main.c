@@ -35,6 +35,7 @@
 #include "../../core/core-config.h"
 #include "../../core/core-hook.h"
 #include "../../core/core-log.h"
+#include "../../core/core-profile.h"
 #include "../../core/core-signal.h"
 #include "../../core/core-string.h"
 #include "../../core/core-utf8.h"
@@ -388,7 +389,7 @@ void
 gui_main_loop ()
 {
     struct t_hook *hook_fd_keyboard;
-    int send_signal_sigwinch;
+    int send_signal_sigwinch, profile;
 
     send_signal_sigwinch = 0;
 
@@ -415,7 +416,13 @@ gui_main_loop ()
     while (!weechat_quit)
     {
         /* execute timer hooks */
+        profile = (profile_enabled) ?
+            profile_frame_start_phase (PROFILE_PHASE_TIMERS) : 0;
         hook_timer_exec ();
+        profile_frame_end (profile);
+
+        profile = (profile_enabled) ?
+            profile_frame_start_phase (PROFILE_PHASE_REFRESHES) : 0;
 
         /* auto reset of color pairs */
         if (gui_color_pairs_auto_reset)
@@ -446,14 +453,25 @@ gui_main_loop ()
 
         gui_color_pairs_auto_reset_pending = 0;
 
+        profile_frame_end (profile);
+
         /* execute fd hooks */
+        profile = (profile_enabled) ?
+            profile_frame_start_phase (PROFILE_PHASE_FD) : 0;
         hook_fd_exec ();
+        profile_frame_end (profile);
 
         /* run process (with fork) */
+        profile = (profile_enabled) ?
+            profile_frame_start_phase (PROFILE_PHASE_PROCESS) : 0;
         hook_process_exec ();
+        profile_frame_end (profile);
 
         /* handle signals received */
+        profile = (profile_enabled) ?
+            profile_frame_start_phase (PROFILE_PHASE_SIGNALS) : 0;
         signal_handle ();
+        profile_frame_end (profile);
     }
 
     /* remove keyboard hook */
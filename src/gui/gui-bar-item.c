@@ -2162,7 +2162,7 @@ gui_bar_item_focus_buffer_nicklist_cb (const void *pointer,
 {
     struct t_gui_nick_group *ptr_group;
     struct t_gui_nick *ptr_nick;
-    int i, rc, bar_item_line;
+    int rc, bar_item_line;
     const char *str_window, *str_buffer, *str_bar_item_line;
     struct t_gui_window *window;
     struct t_gui_buffer *buffer;
@@ -2209,25 +2209,9 @@ gui_bar_item_focus_buffer_nicklist_cb (const void *pointer,
     if (!error || error[0])
         return NULL;
 
-    i = 0;
-    ptr_group = NULL;
-    ptr_nick = NULL;
-    gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
-    while (ptr_group || ptr_nick)
-    {
-        if ((ptr_nick && ptr_nick->visible)
-            || (ptr_group && !ptr_nick
-                && buffer->nicklist_display_groups
-                && ptr_group->visible))
-        {
-            if (i == bar_item_line)
-                break;
-            i++;
-        }
-        gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
-    }
-
-    if (i != bar_item_line)
+    gui_nicklist_get_visible_item (buffer, bar_item_line,
+                                   &ptr_group, &ptr_nick);
+    if (!ptr_group && !ptr_nick)
         return NULL;
 
     if (ptr_nick)
@@ -2300,6 +2284,12 @@ gui_bar_item_signal_cb (const void *pointer, void *data,
         {
             gui_hotlist_resort ();
         }
+        /* nicklist changed in a batch: item is updated at the end of batch */
+        if (gui_nicklist_batch_signal
+            && (strncmp (signal, "nicklist_", 9) == 0))
+        {
+            return WEECHAT_RC_OK;
+        }
         gui_bar_item_update (item);
     }
 
@@ -36,6 +36,7 @@
 #include <ctype.h>
 
 #include "../core/weechat.h"
+#include "../core/core-arena.h"
 #include "../core/core-arraylist.h"
 #include "../core/core-config.h"
 #include "../core/core-eval.h"
@@ -133,6 +134,7 @@ char *gui_buffer_properties_set[] =
   "hotlist_max_level_nicks_add", "hotlist_max_level_nicks_del",
   "input_prompt", "input", "input_pos", "input_get_any_user_data",
   "input_get_unknown_commands", "input_get_empty", "input_multiline",
+  "print_batch",
   NULL
 };
 
@@ -881,6 +883,10 @@ gui_buffer_new_props_with_id (long long id,
     new_buffer->mixed_lines = NULL;
     new_buffer->lines = new_buffer->own_lines;
     new_buffer->next_line_id = 0;
+    new_buffer->own_lines_by_id = NULL;
+    new_buffer->lines_arena = NULL;
+    new_buffer->lines_data_arena = NULL;
+    new_buffer->lines_batch = NULL;
     new_buffer->time_for_each_line = 1;
     new_buffer->chat_refresh_needed = 2;
 
@@ -888,6 +894,7 @@ gui_buffer_new_props_with_id (long long id,
     new_buffer->nicklist = 0;
     new_buffer->nicklist_case_sensitive = 0;
     new_buffer->nicklist_root = NULL;
+    new_buffer->nicklist_nicks_index = NULL;
     new_buffer->nicklist_max_length = 0;
     new_buffer->nicklist_display_groups = 1;
     new_buffer->nicklist_count = 0;
@@ -955,9 +962,11 @@ gui_buffer_new_props_with_id (long long id,
     new_buffer->highlight_tags_restrict = NULL;
     new_buffer->highlight_tags_restrict_count = 0;
     new_buffer->highlight_tags_restrict_array = NULL;
+    new_buffer->highlight_tags_restrict_cond = NULL;
     new_buffer->highlight_tags = NULL;
     new_buffer->highlight_tags_count = 0;
     new_buffer->highlight_tags_array = NULL;
+    new_buffer->highlight_tags_cond = NULL;
 
     /* hotlist */
     new_buffer->hotlist = NULL;
@@ -2164,6 +2173,8 @@ gui_buffer_set_highlight_tags_restrict (struct t_gui_buffer *buffer,
         string_free_split_tags (buffer->highlight_tags_restrict_array);
         buffer->highlight_tags_restrict_array = NULL;
     }
+    gui_line_tags_cond_free (buffer->highlight_tags_restrict_cond);
+    buffer->highlight_tags_restrict_cond = NULL;
     buffer->highlight_tags_restrict_count = 0;
 
     if (!new_tags)
@@ -2176,6 +2187,9 @@ gui_buffer_set_highlight_tags_restrict (struct t_gui_buffer *buffer,
     buffer->highlight_tags_restrict_array = string_split_tags (
         buffer->highlight_tags_restrict,
         &buffer->highlight_tags_restrict_count);
+    buffer->highlight_tags_restrict_cond = gui_line_tags_cond_new (
+        buffer->highlight_tags_restrict_count,
+        buffer->highlight_tags_restrict_array);
 }
 
 /*
@@ -2199,6 +2213,8 @@ gui_buffer_set_highlight_tags (struct t_gui_buffer *buffer,
         string_free_split_tags (buffer->highlight_tags_array);
         buffer->highlight_tags_array = NULL;
     }
+    gui_line_tags_cond_free (buffer->highlight_tags_cond);
+    buffer->highlight_tags_cond = NULL;
     buffer->highlight_tags_count = 0;
 
     if (!new_tags)
@@ -2211,6 +2227,9 @@ gui_buffer_set_highlight_tags (struct t_gui_buffer *buffer,
     buffer->highlight_tags_array = string_split_tags (
         buffer->highlight_tags,
         &buffer->highlight_tags_count);
+    buffer->highlight_tags_cond = gui_line_tags_cond_new (
+        buffer->highlight_tags_count,
+        buffer->highlight_tags_array);
 }
 
 /*
@@ -2642,6 +2661,25 @@ gui_buffer_set (struct t_gui_buffer *buffer, const char *property,
         if (error && !error[0])
             gui_buffer_set_day_change (buffer, number);
     }
+    else if (strcmp (property, "print_batch") == 0)
+    {
+        if (strcmp (value, "sorted") == 0)
+        {
+            gui_line_batch_start (buffer, 1);
+        }
+        else
+        {
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+            {
+                if (number)
+                    gui_line_batch_start (buffer, 0);
+                else
+                    gui_line_batch_end (buffer);
+            }
+        }
+    }
     else if (strcmp (property, "clear") == 0)
     {
         error = NULL;
@@ -3792,6 +3830,10 @@ gui_buffer_close (struct t_gui_buffer *buffer)
     gui_line_free_all (buffer);
     free (buffer->own_lines);
     free (buffer->mixed_lines);
+    hashtable_free (buffer->own_lines_by_id);
+    arena_free (buffer->lines_arena);
+    arena_free (buffer->lines_data_arena);
+    free (buffer->lines_batch);
 
     /* free some data */
     gui_buffer_undo_free_all (buffer);
@@ -3799,6 +3841,7 @@ gui_buffer_close (struct t_gui_buffer *buffer)
     gui_completion_free (buffer->completion);
     gui_nicklist_remove_all (buffer);
     gui_nicklist_remove_group (buffer, buffer->nicklist_root);
+    hashtable_free (buffer->nicklist_nicks_index);
     hashtable_free (buffer->hotlist_max_level_nicks);
     gui_key_free_all (-1, &buffer->keys, &buffer->last_key,
                       &buffer->keys_count, 0);
@@ -3835,8 +3878,10 @@ gui_buffer_close (struct t_gui_buffer *buffer)
     }
     free (buffer->highlight_tags_restrict);
     string_free_split_tags (buffer->highlight_tags_restrict_array);
+    gui_line_tags_cond_free (buffer->highlight_tags_restrict_cond);
     free (buffer->highlight_tags);
     string_free_split_tags (buffer->highlight_tags_array);
+    gui_line_tags_cond_free (buffer->highlight_tags_cond);
     free (buffer->input_callback_data);
     free (buffer->close_callback_data);
     free (buffer->nickcmp_callback_data);
@@ -5329,9 +5374,11 @@ gui_buffer_hdata_buffer_cb (const void *pointer, void *data,
         HDATA_VAR(struct t_gui_buffer, highlight_tags_restrict, STRING, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, highlight_tags_restrict_count, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, highlight_tags_restrict_array, POINTER, 0, "*,highlight_tags_restrict_count", NULL);
+        HDATA_VAR(struct t_gui_buffer, highlight_tags_restrict_cond, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, highlight_tags, STRING, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, highlight_tags_count, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, highlight_tags_array, POINTER, 0, "*,highlight_tags_count", NULL);
+        HDATA_VAR(struct t_gui_buffer, highlight_tags_cond, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, hotlist, POINTER, 0, NULL, "hotlist");
         HDATA_VAR(struct t_gui_buffer, hotlist_max_level_nicks, HASHTABLE, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, keys, POINTER, 0, NULL, "key");
@@ -5731,11 +5778,16 @@ gui_buffer_print_log ()
         gui_lines_print_log (ptr_buffer->mixed_lines);
         log_printf ("  lines . . . . . . . . . : %p", ptr_buffer->lines);
         log_printf ("  next_line_id. . . . . . : %d", ptr_buffer->next_line_id);
+        log_printf ("  own_lines_by_id . . . . : %p", ptr_buffer->own_lines_by_id);
+        log_printf ("  lines_arena . . . . . . : %p", ptr_buffer->lines_arena);
+        log_printf ("  lines_data_arena. . . . : %p", ptr_buffer->lines_data_arena);
+        log_printf ("  lines_batch . . . . . . : %p", ptr_buffer->lines_batch);
         log_printf ("  time_for_each_line. . . : %d", ptr_buffer->time_for_each_line);
         log_printf ("  chat_refresh_needed . . : %d", ptr_buffer->chat_refresh_needed);
         log_printf ("  nicklist. . . . . . . . : %d", ptr_buffer->nicklist);
         log_printf ("  nicklist_case_sensitive : %d", ptr_buffer->nicklist_case_sensitive);
         log_printf ("  nicklist_root . . . . . : %p", ptr_buffer->nicklist_root);
+        log_printf ("  nicklist_nicks_index. . : %p", ptr_buffer->nicklist_nicks_index);
         log_printf ("  nicklist_max_length . . : %d", ptr_buffer->nicklist_max_length);
         log_printf ("  nicklist_display_groups : %d", ptr_buffer->nicklist_display_groups);
         log_printf ("  nicklist_count. . . . . : %d", ptr_buffer->nicklist_count);
@@ -5800,9 +5852,11 @@ gui_buffer_print_log ()
         log_printf ("  highlight_tags_restrict . . . . : '%s'", ptr_buffer->highlight_tags_restrict);
         log_printf ("  highlight_tags_restrict_count . : %d", ptr_buffer->highlight_tags_restrict_count);
         log_printf ("  highlight_tags_restrict_array . : %p", ptr_buffer->highlight_tags_restrict_array);
+        log_printf ("  highlight_tags_restrict_cond. . : %p", ptr_buffer->highlight_tags_restrict_cond);
         log_printf ("  highlight_tags. . . . . . . . . : '%s'", ptr_buffer->highlight_tags);
         log_printf ("  highlight_tags_count. . . . . . : %d", ptr_buffer->highlight_tags_count);
         log_printf ("  highlight_tags_array. . . . . . : %p", ptr_buffer->highlight_tags_array);
+        log_printf ("  highlight_tags_cond . . . . . . : %p", ptr_buffer->highlight_tags_cond);
         log_printf ("  hotlist . . . . . . . . . . . . : %p", ptr_buffer->hotlist);
         log_printf ("  hotlist_removed . . . . . . . . : %p", ptr_buffer->hotlist_removed);
         log_printf ("  keys. . . . . . . . . . . . . . : %p", ptr_buffer->keys);
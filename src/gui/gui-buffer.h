@@ -23,7 +23,10 @@
 #include <limits.h>
 #include <regex.h>
 
+struct t_arena;
 struct t_config_option;
+struct t_gui_line_batch;
+struct t_gui_line_tags_cond;
 struct t_gui_window;
 struct t_hashtable;
 struct t_infolist;
@@ -156,6 +159,11 @@ struct t_gui_buffer
                                        /* "mixed_lines"                     */
     int next_line_id;                  /* next line id                      */
                                        /* (used with formatted type only)   */
+    struct t_hashtable *own_lines_by_id; /* own lines indexed by line id    */
+    struct t_arena *lines_arena;       /* arena for lines (own and mixed)   */
+    struct t_arena *lines_data_arena;  /* arena for data of own lines       */
+    struct t_gui_line_batch *lines_batch; /* batch of lines in progress     */
+                                       /* (NULL if no batch)                */
     int time_for_each_line;            /* time is displayed for each line?  */
     int chat_refresh_needed;           /* refresh for chat is needed ?      */
                                        /* (1=refresh, 2=erase+refresh)      */
@@ -164,6 +172,7 @@ struct t_gui_buffer
     int nicklist;                      /* = 1 if nicklist is enabled        */
     int nicklist_case_sensitive;       /* nicks are case sensitive ?        */
     struct t_gui_nick_group *nicklist_root; /* pointer to groups root       */
+    struct t_hashtable *nicklist_nicks_index; /* nicks by name (lower case) */
     int nicklist_max_length;           /* max length for a nick             */
     int nicklist_display_groups;       /* display groups ?                  */
     int nicklist_count;                /* number of nicks/groups            */
@@ -243,9 +252,11 @@ struct t_gui_buffer
     char *highlight_tags_restrict;     /* restrict highlight to these tags  */
     int highlight_tags_restrict_count; /* number of restricted tags         */
     char ***highlight_tags_restrict_array; /* array with restricted tags    */
+    struct t_gui_line_tags_cond *highlight_tags_restrict_cond; /* compiled  */
     char *highlight_tags;              /* force highlight on these tags     */
     int highlight_tags_count;          /* number of highlight tags          */
     char ***highlight_tags_array;      /* array with highlight tags         */
+    struct t_gui_line_tags_cond *highlight_tags_cond; /* compiled tags      */
 
     /* hotlist */
     struct t_gui_hotlist *hotlist;     /* hotlist entry for buffer          */
@@ -772,13 +772,14 @@ gui_chat_printf_datetime_tags_internal (struct t_gui_buffer *buffer,
     }
 
     /* add line in the buffer */
-    gui_line_add (new_line);
-
-    /* run hook_print for the new line */
-    if (new_line->data->buffer && new_line->data->buffer->print_hooks_enabled)
-        hook_print_exec (new_line->data->buffer, new_line);
+    if (gui_line_add (new_line))
+    {
+        /* run hook_print for the new line */
+        if (new_line->data->buffer && new_line->data->buffer->print_hooks_enabled)
+            hook_print_exec (new_line->data->buffer, new_line);
 
-    gui_buffer_ask_chat_refresh (new_line->data->buffer, 1);
+        gui_buffer_ask_chat_refresh (new_line->data->buffer, 1);
+    }
 
     free (string);
     free (modifier_data);
@@ -790,7 +791,7 @@ no_print:
     if (new_line)
     {
         gui_line_free_data (new_line);
-        free (new_line);
+        gui_line_release (new_line);
     }
     free (string);
     free (modifier_data);
@@ -1002,7 +1003,7 @@ gui_chat_printf_y_datetime_tags (struct t_gui_buffer *buffer, int y,
     if (!new_line->data->buffer)
     {
         gui_line_free_data (new_line);
-        free (new_line);
+        gui_line_release (new_line);
         goto end;
     }
 
@@ -1042,7 +1043,7 @@ gui_chat_printf_y_datetime_tags (struct t_gui_buffer *buffer, int y,
         {
             string_fprintf (stdout, "%s\n", new_line->data->message);
             gui_line_free_data (new_line);
-            free (new_line);
+            gui_line_release (new_line);
         }
     }
     else
@@ -1071,7 +1072,7 @@ gui_chat_printf_y_datetime_tags (struct t_gui_buffer *buffer, int y,
             }
         }
         gui_line_free_data (new_line);
-        free (new_line);
+        gui_line_release (new_line);
     }
 
 end:
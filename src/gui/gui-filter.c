@@ -80,9 +80,8 @@ gui_filter_check_line (struct t_gui_line_data *line_data)
                                    0))
             {
                 if ((strcmp (ptr_filter->tags, "*") == 0)
-                    || (gui_line_match_tags (line_data,
-                                             ptr_filter->tags_count,
-                                             ptr_filter->tags_array)))
+                    || (gui_line_match_tags_cond (line_data,
+                                                  ptr_filter->tags_cond)))
                 {
                     /* check line with regex */
                     rc = 1;
@@ -162,6 +161,9 @@ gui_filter_buffer (struct t_gui_buffer *buffer,
 
     if (lines_changed)
     {
+        /* heights of lines (hidden lines) are not valid any more */
+        gui_window_line_heights_invalidate_all ();
+
         /* force a full refresh of buffer */
         gui_buffer_ask_chat_refresh (buffer, 2);
 
@@ -480,6 +482,8 @@ gui_filter_new (int enabled, const char *name, const char *buffer_name,
         new_filter->tags = (tags) ? strdup (tags) : NULL;
         new_filter->tags_array = string_split_tags (new_filter->tags,
                                                     &new_filter->tags_count);
+        new_filter->tags_cond = gui_line_tags_cond_new (new_filter->tags_count,
+                                                        new_filter->tags_array);
         new_filter->regex = strdup (regex);
         new_filter->regex_prefix = regex1;
         new_filter->regex_message = regex2;
@@ -543,6 +547,7 @@ gui_filter_free (struct t_gui_filter *filter)
     string_free_split (filter->buffers);
     free (filter->tags);
     string_free_split_tags (filter->tags_array);
+    gui_line_tags_cond_free (filter->tags_cond);
     free (filter->regex);
     if (filter->regex_prefix)
     {
@@ -601,6 +606,7 @@ gui_filter_hdata_filter_cb (const void *pointer, void *data,
         HDATA_VAR(struct t_gui_filter, tags, STRING, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_filter, tags_count, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_filter, tags_array, POINTER, 0, "*,tags_count", NULL);
+        HDATA_VAR(struct t_gui_filter, tags_cond, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_filter, regex, STRING, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_filter, regex_prefix, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_filter, regex_message, POINTER, 0, NULL, NULL);
@@ -695,6 +701,7 @@ gui_filter_print_log ()
             log_printf ("  buffers[%03d] . . . . . : '%s'", i, ptr_filter->buffers[i]);
         }
         log_printf ("  tags . . . . . . . . . : '%s'", ptr_filter->tags);
+        log_printf ("  tags_cond. . . . . . . : %p", ptr_filter->tags_cond);
         log_printf ("  regex. . . . . . . . . : '%s'", ptr_filter->regex);
         log_printf ("  regex_prefix . . . . . : %p", ptr_filter->regex_prefix);
         log_printf ("  regex_message. . . . . : %p", ptr_filter->regex_message);
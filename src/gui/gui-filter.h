@@ -27,6 +27,7 @@
 /* filter structures */
 
 struct t_gui_line_data;
+struct t_gui_line_tags_cond;
 
 struct t_gui_filter
 {
@@ -38,6 +39,7 @@ struct t_gui_filter
     char *tags;                        /* tags                              */
     int tags_count;                    /* number of tags                    */
     char ***tags_array;                /* array of tags                     */
+    struct t_gui_line_tags_cond *tags_cond; /* compiled tags                */
     char *regex;                       /* regex                             */
     regex_t *regex_prefix;             /* regex for line prefix             */
     regex_t *regex_message;            /* regex for line message            */
@@ -58,6 +58,7 @@ extern int gui_add_hotlist;
 
 /* hotlist functions */
 
+extern void gui_hotlist_changed_signal (struct t_gui_buffer *buffer);
 extern int gui_hotlist_search_priority (const char *priority);
 extern struct t_gui_hotlist *gui_hotlist_add (struct t_gui_buffer *buffer,
                                               enum t_gui_hotlist_priority priority,
@@ -30,6 +30,7 @@
 #include <regex.h>
 
 #include "../core/weechat.h"
+#include "../core/core-arena.h"
 #include "../core/core-config.h"
 #include "../core/core-hashtable.h"
 #include "../core/core-hdata.h"
@@ -39,6 +40,7 @@
 #include "../core/core-string.h"
 #include "../plugins/plugin.h"
 #include "gui-line.h"
+#include "gui-bar-item.h"
 #include "gui-buffer.h"
 #include "gui-chat.h"
 #include "gui-color.h"
@@ -48,6 +50,13 @@
 #include "gui-window.h"
 
 
+struct t_hashtable *gui_line_tags_ids = NULL;  /* tag (lower) -> tag id     */
+struct t_gui_line_tag_id *gui_line_tags_ids_array = NULL; /* tags by id     */
+int gui_line_tags_ids_size = 0;        /* size of gui_line_tags_ids_array   */
+int gui_line_tags_ids_count = 0;       /* number of ids used                */
+int gui_line_tags_ids_first_free = -1; /* first unused id (-1 if none)      */
+
+
 /*
  * Allocates structure "t_gui_lines" and initializes it.
  *
@@ -90,25 +99,226 @@ gui_line_lines_free (struct t_gui_lines *lines)
     free (lines);
 }
 
+/*
+ * Computes memory used by own lines of a buffer:
+ *   - size_structs: lines and data of lines (arena of buffer),
+ *   - size_strings: strings and arrays owned by lines (time, tags array
+ *     and message); shared strings (prefix and tags) are not counted.
+ */
+
+void
+gui_line_lines_memory (struct t_gui_buffer *buffer,
+                       size_t *size_structs, size_t *size_strings)
+{
+    struct t_gui_line *ptr_line;
+
+    *size_structs = 0;
+    *size_strings = 0;
+
+    if (!buffer || !buffer->own_lines)
+        return;
+
+    *size_structs = sizeof (*(buffer->own_lines))
+        + arena_size (buffer->lines_arena)
+        + arena_size (buffer->lines_data_arena);
+
+    for (ptr_line = buffer->own_lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        if (ptr_line->data->str_time)
+            *size_strings += strlen (ptr_line->data->str_time) + 1;
+        if (ptr_line->data->tags_array)
+        {
+            *size_strings += ((ptr_line->data->tags_count + 1) * sizeof (char *))
+                + (ptr_line->data->tags_count * sizeof (int));
+        }
+        if (ptr_line->data->message)
+            *size_strings += strlen (ptr_line->data->message) + 1;
+    }
+}
+
+/*
+ * Searches id of a tag (case insensitive).
+ *
+ * Returns tag id, -1 if tag has no id.
+ */
+
+int
+gui_line_tag_id_search (const char *tag)
+{
+    char *tag_lower;
+    int *ptr_id;
+
+    if (!tag || !gui_line_tags_ids)
+        return -1;
+
+    tag_lower = string_tolower (tag);
+    if (!tag_lower)
+        return -1;
+    ptr_id = hashtable_get (gui_line_tags_ids, tag_lower);
+    free (tag_lower);
+
+    return (ptr_id) ? *ptr_id : -1;
+}
+
+/*
+ * Gets id of a tag (case insensitive) and adds a reference on it: tags that
+ * are equal when converted to lower case have the same id.
+ *
+ * Returns tag id, -1 if error.
+ */
+
+int
+gui_line_tag_id_ref (const char *tag)
+{
+    struct t_gui_line_tag_id *new_array;
+    struct t_hashtable_item *ptr_item;
+    char *tag_lower;
+    int *ptr_id, id, i, new_size;
+
+    if (!tag)
+        return -1;
+
+    if (!gui_line_tags_ids)
+    {
+        gui_line_tags_ids = hashtable_new (256,
+                                           WEECHAT_HASHTABLE_STRING,
+                                           WEECHAT_HASHTABLE_INTEGER,
+                                           NULL, NULL);
+        if (!gui_line_tags_ids)
+            return -1;
+    }
+
+    tag_lower = string_tolower (tag);
+    if (!tag_lower)
+        return -1;
+
+    ptr_id = hashtable_get (gui_line_tags_ids, tag_lower);
+    if (ptr_id)
+    {
+        free (tag_lower);
+        gui_line_tags_ids_array[*ptr_id].refcount++;
+        return *ptr_id;
+    }
+
+    /* new tag: use first unused id, or extend array */
+    if (gui_line_tags_ids_first_free < 0)
+    {
+        new_size = (gui_line_tags_ids_size == 0) ?
+            256 : gui_line_tags_ids_size * 2;
+        new_array = realloc (gui_line_tags_ids_array,
+                             new_size * sizeof (*new_array));
+        if (!new_array)
+        {
+            free (tag_lower);
+            return -1;
+        }
+        for (i = gui_line_tags_ids_size; i < new_size; i++)
+        {
+            new_array[i].tag = NULL;
+            new_array[i].refcount = 0;
+            new_array[i].next_free = (i < new_size - 1) ? i + 1 : -1;
+        }
+        gui_line_tags_ids_first_free = gui_line_tags_ids_size;
+        gui_line_tags_ids_array = new_array;
+        gui_line_tags_ids_size = new_size;
+    }
+    id = gui_line_tags_ids_first_free;
+
+    ptr_item = hashtable_set (gui_line_tags_ids, tag_lower, &id);
+    free (tag_lower);
+    if (!ptr_item)
+        return -1;
+
+    gui_line_tags_ids_first_free = gui_line_tags_ids_array[id].next_free;
+    gui_line_tags_ids_array[id].tag = ptr_item->key;
+    gui_line_tags_ids_array[id].refcount = 1;
+    gui_line_tags_ids_array[id].next_free = -1;
+    gui_line_tags_ids_count++;
+
+    return id;
+}
+
+/*
+ * Removes a reference on a tag id: the id is released when there are no
+ * more references on it (then it can be used for another tag).
+ *
+ * When no more ids are used, all tags ids are freed.
+ */
+
+void
+gui_line_tag_id_unref (int id)
+{
+    if ((id < 0) || (id >= gui_line_tags_ids_size)
+        || (gui_line_tags_ids_array[id].refcount <= 0))
+    {
+        return;
+    }
+
+    gui_line_tags_ids_array[id].refcount--;
+    if (gui_line_tags_ids_array[id].refcount > 0)
+        return;
+
+    hashtable_remove (gui_line_tags_ids, gui_line_tags_ids_array[id].tag);
+    gui_line_tags_ids_array[id].tag = NULL;
+    gui_line_tags_ids_array[id].next_free = gui_line_tags_ids_first_free;
+    gui_line_tags_ids_first_free = id;
+    gui_line_tags_ids_count--;
+
+    if (gui_line_tags_ids_count == 0)
+    {
+        hashtable_free (gui_line_tags_ids);
+        gui_line_tags_ids = NULL;
+        free (gui_line_tags_ids_array);
+        gui_line_tags_ids_array = NULL;
+        gui_line_tags_ids_size = 0;
+        gui_line_tags_ids_first_free = -1;
+    }
+}
+
 /*
  * Allocates array with tags in a line_data.
+ *
+ * The tags are shared strings, and the ids of tags are stored in the same
+ * allocation, after the NULL pointer ending the tags
+ * (see macro GUI_LINE_TAGS_IDS).
  */
 
 void
 gui_line_tags_alloc (struct t_gui_line_data *line_data, const char *tags)
 {
+    char **tags_array, **new_tags_array;
+    int i, tags_count, *ptr_ids;
+
     if (!line_data)
         return;
 
-    if (tags)
+    line_data->tags_count = 0;
+    line_data->tags_array = NULL;
+
+    if (!tags)
+        return;
+
+    tags_array = string_split_shared (tags, ",", NULL, 0, 0, &tags_count);
+    if (!tags_array)
+        return;
+
+    new_tags_array = realloc (tags_array,
+                              ((tags_count + 1) * sizeof (*tags_array))
+                              + (tags_count * sizeof (int)));
+    if (!new_tags_array)
     {
-        line_data->tags_array = string_split_shared (tags, ",", NULL, 0, 0,
-                                                     &line_data->tags_count);
+        string_free_split_shared (tags_array);
+        return;
     }
-    else
+
+    line_data->tags_count = tags_count;
+    line_data->tags_array = new_tags_array;
+
+    ptr_ids = GUI_LINE_TAGS_IDS(line_data);
+    for (i = 0; i < tags_count; i++)
     {
-        line_data->tags_count = 0;
-        line_data->tags_array = NULL;
+        ptr_ids[i] = gui_line_tag_id_ref (new_tags_array[i]);
     }
 }
 
@@ -119,17 +329,129 @@ gui_line_tags_alloc (struct t_gui_line_data *line_data, const char *tags)
 void
 gui_line_tags_free (struct t_gui_line_data *line_data)
 {
+    int i, *ptr_ids;
+
     if (!line_data)
         return;
 
     if (line_data->tags_array)
     {
+        ptr_ids = GUI_LINE_TAGS_IDS(line_data);
+        for (i = 0; i < line_data->tags_count; i++)
+        {
+            gui_line_tag_id_unref (ptr_ids[i]);
+        }
         string_free_split_shared (line_data->tags_array);
         line_data->tags_count = 0;
         line_data->tags_array = NULL;
     }
 }
 
+/*
+ * Compiles tags (as returned by function string_split_tags) for a fast
+ * match on lines with function gui_line_match_tags_cond: tags without
+ * wildcard are converted to tag ids.
+ *
+ * Note: result must be freed with gui_line_tags_cond_free after use.
+ *
+ * Returns pointer to compiled tags, NULL if error.
+ */
+
+struct t_gui_line_tags_cond *
+gui_line_tags_cond_new (int tags_count, char ***tags_array)
+{
+    struct t_gui_line_tags_cond *new_tags_cond;
+    struct t_gui_line_tag_cond *ptr_cond;
+    const char *ptr_tag;
+    int i, j, count;
+
+    if ((tags_count < 0) || ((tags_count > 0) && !tags_array))
+        return NULL;
+
+    new_tags_cond = malloc (sizeof (*new_tags_cond));
+    if (!new_tags_cond)
+        return NULL;
+
+    new_tags_cond->count = tags_count;
+    new_tags_cond->tags_count = calloc ((tags_count > 0) ? tags_count : 1,
+                                        sizeof (*new_tags_cond->tags_count));
+    new_tags_cond->tags = calloc ((tags_count > 0) ? tags_count : 1,
+                                  sizeof (*new_tags_cond->tags));
+    if (!new_tags_cond->tags_count || !new_tags_cond->tags)
+    {
+        new_tags_cond->count = 0;
+        gui_line_tags_cond_free (new_tags_cond);
+        return NULL;
+    }
+
+    for (i = 0; i < tags_count; i++)
+    {
+        count = 0;
+        while (tags_array[i][count])
+        {
+            count++;
+        }
+        new_tags_cond->tags[i] = calloc ((count > 0) ? count : 1,
+                                         sizeof (*new_tags_cond->tags[i]));
+        if (!new_tags_cond->tags[i])
+        {
+            new_tags_cond->count = i;
+            gui_line_tags_cond_free (new_tags_cond);
+            return NULL;
+        }
+        new_tags_cond->tags_count[i] = count;
+        for (j = 0; j < count; j++)
+        {
+            ptr_cond = &(new_tags_cond->tags[i][j]);
+            ptr_tag = tags_array[i][j];
+            ptr_cond->negated = 0;
+            ptr_cond->id = -1;
+            ptr_cond->mask = NULL;
+            /* check if tag is negated (prefixed with a '!') */
+            if ((ptr_tag[0] == '!') && ptr_tag[1])
+            {
+                ptr_tag++;
+                ptr_cond->negated = 1;
+            }
+            if (strcmp (ptr_tag, "*") == 0)
+                continue;
+            if (!strchr (ptr_tag, '*'))
+                ptr_cond->id = gui_line_tag_id_ref (ptr_tag);
+            if (ptr_cond->id < 0)
+                ptr_cond->mask = strdup (ptr_tag);
+        }
+    }
+
+    return new_tags_cond;
+}
+
+/*
+ * Frees compiled tags.
+ */
+
+void
+gui_line_tags_cond_free (struct t_gui_line_tags_cond *tags_cond)
+{
+    int i, j;
+
+    if (!tags_cond)
+        return;
+
+    for (i = 0; i < tags_cond->count; i++)
+    {
+        for (j = 0; j < tags_cond->tags_count[i]; j++)
+        {
+            gui_line_tag_id_unref (tags_cond->tags[i][j].id);
+            free (tags_cond->tags[i][j].mask);
+        }
+        free (tags_cond->tags[i]);
+    }
+    free (tags_cond->tags_count);
+    free (tags_cond->tags);
+
+    free (tags_cond);
+}
+
 /*
  * Checks if prefix on line is a nick and is the same as nick on previous/next
  * line (according to direction: if < 0, check if it's the same nick as
@@ -602,6 +924,48 @@ gui_line_get_next_displayed (struct t_gui_line *line)
     return line;
 }
 
+/*
+ * Adds a line in index of own lines by id.
+ *
+ * If another line has the same id (after overflow of ids), the new line
+ * replaces it in index.
+ */
+
+void
+gui_line_index_add (struct t_gui_line *line)
+{
+    struct t_gui_buffer *ptr_buffer;
+
+    ptr_buffer = line->data->buffer;
+
+    if (!ptr_buffer->own_lines_by_id)
+    {
+        ptr_buffer->own_lines_by_id = hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_INTEGER,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+        if (!ptr_buffer->own_lines_by_id)
+            return;
+    }
+
+    hashtable_set (ptr_buffer->own_lines_by_id, &(line->data->id), line);
+}
+
+/*
+ * Removes a line from index of own lines by id.
+ */
+
+void
+gui_line_index_remove (struct t_gui_buffer *buffer, struct t_gui_line *line)
+{
+    if (!buffer->own_lines_by_id || !line->data)
+        return;
+
+    if (hashtable_get (buffer->own_lines_by_id, &(line->data->id)) == line)
+        hashtable_remove (buffer->own_lines_by_id, &(line->data->id));
+}
+
 /*
  * Searches a line by id.
  *
@@ -611,20 +975,10 @@ gui_line_get_next_displayed (struct t_gui_line *line)
 struct t_gui_line *
 gui_line_search_by_id (struct t_gui_buffer *buffer, int id)
 {
-    struct t_gui_line *ptr_line;
-
-    if (!buffer || !buffer->own_lines)
+    if (!buffer || !buffer->own_lines_by_id)
         return NULL;
 
-    for (ptr_line = buffer->own_lines->last_line; ptr_line;
-         ptr_line = ptr_line->prev_line)
-    {
-        if (ptr_line->data && (ptr_line->data->id == id))
-            return ptr_line;
-    }
-
-    /* line not found */
-    return NULL;
+    return (struct t_gui_line *)hashtable_get (buffer->own_lines_by_id, &id);
 }
 
 /*
@@ -866,6 +1220,80 @@ gui_line_match_tags (struct t_gui_line_data *line_data,
     return 0;
 }
 
+/*
+ * Checks if line matches compiled tags (see function gui_line_tags_cond_new).
+ *
+ * The result is the same as function gui_line_match_tags with the tags
+ * used to compile "tags_cond", but tags without wildcard are compared with
+ * tag ids instead of strings.
+ *
+ * Returns:
+ *   1: line matches tags
+ *   0: line does not match tags
+ */
+
+int
+gui_line_match_tags_cond (struct t_gui_line_data *line_data,
+                          struct t_gui_line_tags_cond *tags_cond)
+{
+    struct t_gui_line_tag_cond *ptr_cond;
+    int i, j, k, match, tag_found, *ptr_ids;
+
+    if (!line_data || !tags_cond)
+        return 0;
+
+    ptr_ids = (line_data->tags_array) ? GUI_LINE_TAGS_IDS(line_data) : NULL;
+
+    for (i = 0; i < tags_cond->count; i++)
+    {
+        match = 1;
+        for (j = 0; j < tags_cond->tags_count[i]; j++)
+        {
+            ptr_cond = &(tags_cond->tags[i][j]);
+            tag_found = 0;
+            if (ptr_cond->mask)
+            {
+                for (k = 0; k < line_data->tags_count; k++)
+                {
+                    if (string_match (line_data->tags_array[k],
+                                      ptr_cond->mask, 0))
+                    {
+                        tag_found = 1;
+                        break;
+                    }
+                }
+            }
+            else if (ptr_cond->id >= 0)
+            {
+                for (k = 0; k < line_data->tags_count; k++)
+                {
+                    if (ptr_ids[k] == ptr_cond->id)
+                    {
+                        tag_found = 1;
+                        break;
+                    }
+                }
+            }
+            else
+            {
+                /* tag "*" */
+                tag_found = 1;
+            }
+            if (tag_found && ptr_cond->negated)
+                return 0;
+            if (!tag_found && !ptr_cond->negated)
+            {
+                match = 0;
+                break;
+            }
+        }
+        if (match)
+            return 1;
+    }
+
+    return 0;
+}
+
 /*
  * Returns pointer on tag starting with "tag", NULL if such tag is not found.
  */
@@ -1031,10 +1459,9 @@ gui_line_has_highlight (struct t_gui_line *line)
      * check if highlight is forced by a tag
      * (with global option "weechat.look.highlight_tags")
      */
-    if (config_highlight_tags
-        && gui_line_match_tags (line->data,
-                                config_num_highlight_tags,
-                                config_highlight_tags))
+    if (config_highlight_tags_cond
+        && gui_line_match_tags_cond (line->data,
+                                     config_highlight_tags_cond))
     {
         rc = 1;
         goto end;
@@ -1044,10 +1471,9 @@ gui_line_has_highlight (struct t_gui_line *line)
      * check if highlight is forced by a tag
      * (with buffer property "highlight_tags")
      */
-    if (line->data->buffer->highlight_tags
-        && gui_line_match_tags (line->data,
-                                line->data->buffer->highlight_tags_count,
-                                line->data->buffer->highlight_tags_array))
+    if (line->data->buffer->highlight_tags_cond
+        && gui_line_match_tags_cond (line->data,
+                                     line->data->buffer->highlight_tags_cond))
     {
         rc = 1;
         goto end;
@@ -1059,9 +1485,8 @@ gui_line_has_highlight (struct t_gui_line *line)
      */
     if (line->data->buffer->highlight_tags_restrict_count > 0)
     {
-        if (!gui_line_match_tags (line->data,
-                                  line->data->buffer->highlight_tags_restrict_count,
-                                  line->data->buffer->highlight_tags_restrict_array))
+        if (!gui_line_match_tags_cond (line->data,
+                                       line->data->buffer->highlight_tags_restrict_cond))
         {
             rc = 0;
             goto end;
@@ -1221,36 +1646,96 @@ gui_line_compute_prefix_max_length (struct t_gui_lines *lines)
     lines->prefix_max_length_refresh = 0;
 }
 
+/*
+ * Compares dates of two lines.
+ *
+ * Returns:
+ *   < 0: date of line1 < date of line2
+ *     0: date of line1 == date of line2
+ *   > 0: date of line1 > date of line2
+ */
+
+int
+gui_line_date_cmp (struct t_gui_line_data *line_data1,
+                   struct t_gui_line_data *line_data2)
+{
+    if (line_data1->date != line_data2->date)
+        return (line_data1->date < line_data2->date) ? -1 : 1;
+
+    if (line_data1->date_usec != line_data2->date_usec)
+        return (line_data1->date_usec < line_data2->date_usec) ? -1 : 1;
+
+    return 0;
+}
+
 /*
  * Adds a line to a "t_gui_lines" structure.
+ *
+ * The line is added at the end of list, except during a sorted batch of
+ * lines in the buffer: then the line is inserted after the last line with a
+ * date lower than or equal to the line date.
  */
 
 void
 gui_line_add_to_list (struct t_gui_lines *lines,
                       struct t_gui_line *line)
 {
+    struct t_gui_line_batch *ptr_batch;
+    struct t_gui_line *ptr_prev_line;
     int prefix_length, prefix_is_nick;
 
-    if (lines->last_line)
-        (lines->last_line)->next_line = line;
+    ptr_batch = line->data->buffer->lines_batch;
+
+    /* search line after which the line is added (from the end of list) */
+    ptr_prev_line = lines->last_line;
+    if (ptr_batch && ptr_batch->sorted)
+    {
+        while (ptr_prev_line
+               && (gui_line_date_cmp (ptr_prev_line->data, line->data) > 0))
+        {
+            ptr_prev_line = ptr_prev_line->prev_line;
+        }
+    }
+
+    /*
+     * display of previous line can depend on next line (for example with
+     * option weechat.look.prefix_same_nick_middle), so its height is
+     * removed from cache
+     */
+    gui_window_line_heights_remove_line (line);
+    gui_window_line_heights_remove_line (ptr_prev_line);
+
+    line->prev_line = ptr_prev_line;
+    line->next_line = (ptr_prev_line) ?
+        ptr_prev_line->next_line : lines->first_line;
+    if (line->next_line)
+    {
+        (line->next_line)->prev_line = line;
+        gui_window_line_heights_remove_line (line->next_line);
+    }
+    else
+        lines->last_line = line;
+    if (ptr_prev_line)
+        ptr_prev_line->next_line = line;
     else
         lines->first_line = line;
-    line->prev_line = lines->last_line;
-    line->next_line = NULL;
-    lines->last_line = line;
 
     /*
      * adjust "prefix_max_length" if this prefix length is > max
-     * (only if the line is displayed
+     * (only if the line is displayed); during a batch, the max length is
+     * computed once at the end of batch
      */
     if (line->data->displayed)
     {
-        gui_line_get_prefix_for_display (line, NULL, &prefix_length, NULL,
-                                         &prefix_is_nick);
-        if (prefix_is_nick)
-            prefix_length += config_length_nick_prefix_suffix;
-        if (prefix_length > lines->prefix_max_length)
-            lines->prefix_max_length = prefix_length;
+        if (!ptr_batch)
+        {
+            gui_line_get_prefix_for_display (line, NULL, &prefix_length, NULL,
+                                             &prefix_is_nick);
+            if (prefix_is_nick)
+                prefix_length += config_length_nick_prefix_suffix;
+            if (prefix_length > lines->prefix_max_length)
+                lines->prefix_max_length = prefix_length;
+        }
     }
     else
     {
@@ -1261,6 +1746,34 @@ gui_line_add_to_list (struct t_gui_lines *lines,
     lines->lines_count++;
 }
 
+/*
+ * Allocates a line (structure only) in arena of buffer.
+ *
+ * Returns pointer to new line, NULL if error.
+ */
+
+struct t_gui_line *
+gui_line_alloc (struct t_gui_buffer *buffer)
+{
+    if (!buffer->lines_arena)
+    {
+        buffer->lines_arena = arena_new (sizeof (struct t_gui_line),
+                                         GUI_LINE_ARENA_CHUNK);
+    }
+    return arena_alloc (buffer->lines_arena);
+}
+
+/*
+ * Releases a line (structure only, data of line must have been freed or
+ * given to another line before).
+ */
+
+void
+gui_line_release (struct t_gui_line *line)
+{
+    arena_release (line);
+}
+
 /*
  * Frees data in a line.
  */
@@ -1272,7 +1785,7 @@ gui_line_free_data (struct t_gui_line *line)
     gui_line_tags_free (line->data);
     string_shared_free (line->data->prefix);
     free (line->data->message);
-    free (line->data);
+    arena_release (line->data);
 
     line->data = NULL;
 }
@@ -1322,6 +1835,11 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
         gui_window_coords_remove_line (ptr_win, line);
     }
 
+    /* remove line and its neighbours from cache of lines heights */
+    gui_window_line_heights_remove_line (line->prev_line);
+    gui_window_line_heights_remove_line (line);
+    gui_window_line_heights_remove_line (line->next_line);
+
     gui_line_get_prefix_for_display (line, NULL, &prefix_length, NULL,
                                      &prefix_is_nick);
     if (prefix_is_nick)
@@ -1357,7 +1875,7 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
 
     lines->lines_count--;
 
-    free (line);
+    gui_line_release (line);
 }
 
 /*
@@ -1370,7 +1888,7 @@ gui_line_mixed_add (struct t_gui_lines *lines,
 {
     struct t_gui_line *new_line;
 
-    new_line = malloc (sizeof (*new_line));
+    new_line = gui_line_alloc (line_data->buffer);
     if (new_line)
     {
         new_line->data = line_data;
@@ -1456,6 +1974,7 @@ gui_line_free (struct t_gui_buffer *buffer, struct t_gui_line *line)
     }
 
     /* remove line from lines list */
+    gui_line_index_remove (buffer, line);
     gui_line_remove_from_list (buffer, buffer->own_lines, line, 1);
 }
 
@@ -1585,16 +2104,21 @@ gui_line_new (struct t_gui_buffer *buffer, int y,
     if (!buffer)
         return NULL;
 
-    /* create new line */
-    new_line = malloc (sizeof (*new_line));
+    /* create new line (in arena of buffer) */
+    new_line = gui_line_alloc (buffer);
     if (!new_line)
         return NULL;
 
-    /* create data for line */
-    new_line_data = malloc (sizeof (*new_line_data));
+    /* create data for line (in arena of buffer) */
+    if (!buffer->lines_data_arena)
+    {
+        buffer->lines_data_arena = arena_new (sizeof (*new_line_data),
+                                              GUI_LINE_DATA_ARENA_CHUNK);
+    }
+    new_line_data = arena_alloc (buffer->lines_data_arena);
     if (!new_line_data)
     {
-        free (new_line);
+        gui_line_release (new_line);
         return NULL;
     }
     new_line->data = new_line_data;
@@ -1880,51 +2404,194 @@ gui_line_hook_update (struct t_gui_line *line,
 }
 
 /*
- * Adds a new line in a buffer with formatted content.
+ * Starts a batch of lines in a buffer: until the end of batch, the hotlist,
+ * the signal "buffer_lines_hidden", the max length of prefix, the refresh
+ * of buffer and the bar items with the nicklist are updated only once, at the
+ * end of batch.
+ *
+ * If sorted == 1, lines added are inserted in order of date (this is useful
+ * to add older lines in a buffer, for example a backlog).
+ *
+ * Batches can be nested: only the end of outermost batch applies the updates.
  */
 
 void
+gui_line_batch_start (struct t_gui_buffer *buffer, int sorted)
+{
+    if (!buffer)
+        return;
+
+    if (!buffer->lines_batch)
+    {
+        buffer->lines_batch = calloc (1, sizeof (*buffer->lines_batch));
+        if (!buffer->lines_batch)
+            return;
+    }
+
+    (buffer->lines_batch->count)++;
+    if (sorted)
+        buffer->lines_batch->sorted = 1;
+}
+
+/*
+ * Ends a batch of lines in a buffer (started with gui_line_batch_start).
+ */
+
+void
+gui_line_batch_end (struct t_gui_buffer *buffer)
+{
+    struct t_gui_line_batch *ptr_batch;
+    struct t_gui_hotlist *ptr_hotlist;
+    int priority;
+
+    if (!buffer || !buffer->lines_batch)
+        return;
+
+    ptr_batch = buffer->lines_batch;
+
+    (ptr_batch->count)--;
+    if (ptr_batch->count > 0)
+        return;
+
+    buffer->lines_batch = NULL;
+
+    if (ptr_batch->lines_added > 0)
+    {
+        buffer->own_lines->prefix_max_length_refresh = 1;
+        if (buffer->mixed_lines)
+            buffer->mixed_lines->prefix_max_length_refresh = 1;
+
+        /*
+         * add buffer in hotlist with each priority (conditions are
+         * evaluated once per priority), then adjust the counts
+         */
+        for (priority = GUI_HOTLIST_MAX; priority >= GUI_HOTLIST_MIN;
+             priority--)
+        {
+            if (ptr_batch->hotlist[priority] <= 0)
+                continue;
+            ptr_hotlist = gui_hotlist_add (buffer, priority,
+                                           NULL,  /* creation_time */
+                                           1);  /* check_conditions */
+            if (ptr_hotlist && (ptr_batch->hotlist[priority] > 1))
+            {
+                ptr_hotlist->count[priority] += ptr_batch->hotlist[priority] - 1;
+                gui_hotlist_changed_signal (buffer);
+            }
+        }
+
+        if (ptr_batch->lines_hidden > 0)
+        {
+            (void) gui_buffer_send_signal (buffer,
+                                           "buffer_lines_hidden",
+                                           WEECHAT_HOOK_SIGNAL_POINTER,
+                                           buffer);
+        }
+
+        gui_buffer_ask_chat_refresh (buffer, (ptr_batch->sorted) ? 2 : 1);
+    }
+
+    if (ptr_batch->nicklist_changed)
+    {
+        gui_bar_item_update (
+            gui_bar_item_names[GUI_BAR_ITEM_BUFFER_NICKLIST]);
+        gui_bar_item_update (
+            gui_bar_item_names[GUI_BAR_ITEM_BUFFER_NICKLIST_COUNT]);
+        gui_bar_item_update (
+            gui_bar_item_names[GUI_BAR_ITEM_BUFFER_NICKLIST_COUNT_GROUPS]);
+        gui_bar_item_update (
+            gui_bar_item_names[GUI_BAR_ITEM_BUFFER_NICKLIST_COUNT_ALL]);
+    }
+
+    free (ptr_batch);
+}
+
+/*
+ * Adds a new line in a buffer with formatted content.
+ *
+ * Returns:
+ *   1: line added
+ *   0: line not added (it is freed and must not be used any more): in a
+ *      sorted batch, the buffer is full and the line is older than all lines
+ *      in buffer
+ */
+
+int
 gui_line_add (struct t_gui_line *line)
 {
     struct t_gui_window *ptr_win;
+    struct t_gui_line_batch *ptr_batch;
+    struct t_gui_lines *ptr_lines;
     char *message_for_signal;
-    int lines_removed;
+    int lines_removed, priority;
     time_t current_time;
 
+    ptr_lines = line->data->buffer->own_lines;
+
     /*
-     * remove line(s) if necessary, according to history options:
-     *   max_lines:   if > 0, keep only N lines in buffer
-     *   max_minutes: if > 0, keep only lines from last N minutes
+     * remove line(s) if necessary, according to history option max_minutes:
+     * if > 0, keep only lines from last N minutes
      */
     lines_removed = 0;
     current_time = time (NULL);
-    while (line->data->buffer->own_lines->first_line
-           && (((CONFIG_INTEGER(config_history_max_buffer_lines_number) > 0)
-                && (line->data->buffer->own_lines->lines_count + 1 >
-                    CONFIG_INTEGER(config_history_max_buffer_lines_number)))
-               || ((CONFIG_INTEGER(config_history_max_buffer_lines_minutes) > 0)
-                   && (current_time - line->data->buffer->own_lines->first_line->data->date_printed >
-                       CONFIG_INTEGER(config_history_max_buffer_lines_minutes) * 60))))
-    {
-        gui_line_free (line->data->buffer,
-                       line->data->buffer->own_lines->first_line);
+    while (ptr_lines->first_line
+           && (CONFIG_INTEGER(config_history_max_buffer_lines_minutes) > 0)
+           && (current_time - ptr_lines->first_line->data->date_printed >
+               CONFIG_INTEGER(config_history_max_buffer_lines_minutes) * 60))
+    {
+        gui_line_free (line->data->buffer, ptr_lines->first_line);
         lines_removed++;
     }
 
     /* add line to lines list */
-    gui_line_add_to_list (line->data->buffer->own_lines, line);
+    gui_line_add_to_list (ptr_lines, line);
+    gui_line_index_add (line);
 
-    /* update hotlist and/or send signals for line */
+    /*
+     * remove line(s) if necessary, according to history option max_lines:
+     * if > 0, keep only N lines in buffer; this is done after the line is
+     * added, because in a sorted batch the line can be inserted before
+     * other lines (and then it is removed itself if it is the oldest one)
+     */
+    while (ptr_lines->first_line
+           && (CONFIG_INTEGER(config_history_max_buffer_lines_number) > 0)
+           && (ptr_lines->lines_count >
+               CONFIG_INTEGER(config_history_max_buffer_lines_number)))
+    {
+        if (ptr_lines->first_line == line)
+        {
+            gui_line_free (line->data->buffer, line);
+            return 0;
+        }
+        gui_line_free (line->data->buffer, ptr_lines->first_line);
+        lines_removed++;
+    }
+
+    ptr_batch = line->data->buffer->lines_batch;
+    if (ptr_batch)
+        (ptr_batch->lines_added)++;
+
+    /*
+     * update hotlist and/or send signals for line
+     * (during a batch, hotlist is updated at the end of batch)
+     */
     if (line->data->displayed)
     {
         if ((line->data->notify_level >= GUI_HOTLIST_MIN)
             && line->data->highlight)
         {
-            (void) gui_hotlist_add (
-                line->data->buffer,
-                GUI_HOTLIST_HIGHLIGHT,
-                NULL,  /* creation_time */
-                1);  /* check_conditions */
+            if (ptr_batch)
+            {
+                (ptr_batch->hotlist[GUI_HOTLIST_HIGHLIGHT])++;
+            }
+            else
+            {
+                (void) gui_hotlist_add (
+                    line->data->buffer,
+                    GUI_HOTLIST_HIGHLIGHT,
+                    NULL,  /* creation_time */
+                    1);  /* check_conditions */
+            }
             if (!weechat_upgrading)
             {
                 message_for_signal = gui_line_build_string_prefix_message (
@@ -1955,20 +2622,36 @@ gui_line_add (struct t_gui_line *line)
             }
             if (line->data->notify_level >= GUI_HOTLIST_MIN)
             {
-                (void) gui_hotlist_add (
-                    line->data->buffer,
-                    line->data->notify_level,
-                    NULL,  /* creation_time */
-                    1);  /* check_conditions */
+                if (ptr_batch)
+                {
+                    priority = (line->data->notify_level > GUI_HOTLIST_MAX) ?
+                        GUI_HOTLIST_MAX : line->data->notify_level;
+                    (ptr_batch->hotlist[priority])++;
+                }
+                else
+                {
+                    (void) gui_hotlist_add (
+                        line->data->buffer,
+                        line->data->notify_level,
+                        NULL,  /* creation_time */
+                        1);  /* check_conditions */
+                }
             }
         }
     }
     else
     {
-        (void) gui_buffer_send_signal (line->data->buffer,
-                                       "buffer_lines_hidden",
-                                       WEECHAT_HOOK_SIGNAL_POINTER,
-                                       line->data->buffer);
+        if (ptr_batch)
+        {
+            (ptr_batch->lines_hidden)++;
+        }
+        else
+        {
+            (void) gui_buffer_send_signal (line->data->buffer,
+                                           "buffer_lines_hidden",
+                                           WEECHAT_HOOK_SIGNAL_POINTER,
+                                           line->data->buffer);
+        }
     }
 
     /* add mixed line, if buffer is attached to at least one other buffer */
@@ -1998,6 +2681,8 @@ gui_line_add (struct t_gui_line *line)
     (void) gui_buffer_send_signal (line->data->buffer,
                                    "buffer_line_added",
                                    WEECHAT_HOOK_SIGNAL_POINTER, line);
+
+    return 1;
 }
 
 /*
@@ -2015,12 +2700,26 @@ gui_line_add_y (struct t_gui_line *line)
     struct t_gui_window *ptr_win;
     int old_line_displayed;
 
-    /* search if line exists for "y" */
-    for (ptr_line = line->data->buffer->own_lines->first_line; ptr_line;
-         ptr_line = ptr_line->next_line)
-    {
-        if (ptr_line->data->y >= line->data->y)
-            break;
+    /*
+     * search if line exists for "y" (in a buffer with free content, the line
+     * id is "y"): first in index, then if the line is not found, it is added
+     * at the end if "y" is greater than the last line, otherwise the line
+     * with this "y" (or the position) is searched in the list (lines are
+     * sorted by "y")
+     */
+    ptr_line = gui_line_search_by_id (line->data->buffer, line->data->y);
+    if (ptr_line && (ptr_line->data->y != line->data->y))
+        ptr_line = NULL;
+    if (!ptr_line
+        && line->data->buffer->own_lines->last_line
+        && (line->data->buffer->own_lines->last_line->data->y >= line->data->y))
+    {
+        for (ptr_line = line->data->buffer->own_lines->first_line; ptr_line;
+             ptr_line = ptr_line->next_line)
+        {
+            if (ptr_line->data->y >= line->data->y)
+                break;
+        }
     }
 
     if (ptr_line && (ptr_line->data->y == line->data->y))
@@ -2039,7 +2738,10 @@ gui_line_add_y (struct t_gui_line *line)
         /* replace ptr_line by line in list */
         gui_line_free_data (ptr_line);
         ptr_line->data = line->data;
-        free (line);
+        gui_line_release (line);
+
+        /* line may have been found in list (not in index) */
+        gui_line_index_add (ptr_line);
     }
     else
     {
@@ -2068,6 +2770,7 @@ gui_line_add_y (struct t_gui_line *line)
             line->next_line = NULL;
         }
         ptr_line = line;
+        gui_line_index_add (line);
 
         line->data->buffer->own_lines->lines_count++;
     }
@@ -2395,6 +3098,7 @@ gui_line_hdata_line_data_update_cb (void *data,
                 gui_window_coords_remove_line_data (ptr_win, line_data);
             }
         }
+        gui_window_line_heights_invalidate_all ();
         gui_filter_buffer (line_data->buffer, line_data);
         gui_buffer_ask_chat_refresh (line_data->buffer, 1);
         (void) gui_buffer_send_signal (line_data->buffer,
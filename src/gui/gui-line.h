@@ -23,8 +23,22 @@
 #include <time.h>
 #include <regex.h>
 
+#include "gui-hotlist.h"
+
+struct t_hashtable;
 struct t_infolist;
 
+/* number of lines/line data allocated in each chunk of arenas (in buffer) */
+#define GUI_LINE_ARENA_CHUNK      64
+#define GUI_LINE_DATA_ARENA_CHUNK 64
+
+/*
+ * ids of tags are stored after the tags in the array "tags_array"
+ * (same allocation, see function gui_line_tags_alloc)
+ */
+#define GUI_LINE_TAGS_IDS(__line_data)                                  \
+    ((int *)((__line_data)->tags_array + (__line_data)->tags_count + 1))
+
 /* line structures */
 
 struct t_gui_line_data
@@ -57,6 +71,33 @@ struct t_gui_line
     struct t_gui_line *next_line;      /* link to next line                 */
 };
 
+/* tag id: a small integer for each distinct tag (case insensitive) */
+
+struct t_gui_line_tag_id
+{
+    const char *tag;                   /* tag (lower case, NULL if unused)  */
+    int refcount;                      /* number of references to this id  */
+    int next_free;                     /* next unused id (if refcount == 0) */
+};
+
+/* tags compiled (for filters and highlight), see gui_line_tags_cond_new */
+
+struct t_gui_line_tag_cond
+{
+    int negated;                       /* 1 if tag is negated ("!tag")      */
+    int id;                            /* tag id (tag without wildcard)     */
+                                       /* or -1 (tag with wildcard or "*")  */
+    char *mask;                        /* tag with wildcard (NULL if tag    */
+                                       /* has no wildcard or is "*")        */
+};
+
+struct t_gui_line_tags_cond
+{
+    int count;                         /* number of groups of tags (OR)     */
+    int *tags_count;                   /* number of tags in groups (AND)    */
+    struct t_gui_line_tag_cond **tags; /* tags in each group                */
+};
+
 struct t_gui_lines
 {
     struct t_gui_line *first_line;     /* pointer to first line             */
@@ -72,13 +113,46 @@ struct t_gui_lines
     int prefix_max_length_refresh;     /* refresh asked for prefix max len. */
 };
 
+/*
+ * batch of lines added in a buffer: some updates done for each line added
+ * are deferred to the end of batch (hotlist, signal "buffer_lines_hidden",
+ * max length of prefix, refresh of buffer)
+ */
+
+struct t_gui_line_batch
+{
+    int count;                         /* number of nested batches          */
+    int sorted;                        /* 1 if lines are inserted in order  */
+                                       /* of date (older lines before)      */
+    int lines_added;                   /* number of lines added             */
+    int lines_hidden;                  /* number of hidden lines added      */
+    int hotlist[GUI_HOTLIST_NUM_PRIORITIES]; /* lines to add in hotlist     */
+    int nicklist_changed;              /* 1 if nicklist has changed         */
+};
+
+/* line variables */
+
+extern struct t_hashtable *gui_line_tags_ids;
+extern struct t_gui_line_tag_id *gui_line_tags_ids_array;
+extern int gui_line_tags_ids_size;
+extern int gui_line_tags_ids_count;
+
 /* line functions */
 
 extern struct t_gui_lines *gui_line_lines_alloc ();
 extern void gui_line_lines_free (struct t_gui_lines *lines);
+extern void gui_line_lines_memory (struct t_gui_buffer *buffer,
+                                   size_t *size_structs,
+                                   size_t *size_strings);
+extern int gui_line_tag_id_ref (const char *tag);
+extern void gui_line_tag_id_unref (int id);
+extern int gui_line_tag_id_search (const char *tag);
 extern void gui_line_tags_alloc (struct t_gui_line_data *line_data,
                                  const char *tags);
 extern void gui_line_tags_free (struct t_gui_line_data *line_data);
+extern struct t_gui_line_tags_cond *gui_line_tags_cond_new (int tags_count,
+                                                            char ***tags_array);
+extern void gui_line_tags_cond_free (struct t_gui_line_tags_cond *tags_cond);
 extern void gui_line_get_prefix_for_display (struct t_gui_line *line,
                                              char **prefix, int *length,
                                              char **color, int *prefix_is_nick);
@@ -107,6 +181,8 @@ extern int gui_line_match_regex (struct t_gui_line_data *line_data,
 extern int gui_line_has_tag_no_filter (struct t_gui_line_data *line_data);
 extern int gui_line_match_tags (struct t_gui_line_data *line_data,
                                 int tags_count, char ***tags_array);
+extern int gui_line_match_tags_cond (struct t_gui_line_data *line_data,
+                                     struct t_gui_line_tags_cond *tags_cond);
 extern const char *gui_line_search_tag_starting_with (struct t_gui_line *line,
                                                       const char *tag);
 extern const char *gui_line_get_nick_tag (struct t_gui_line *line);
@@ -118,6 +194,8 @@ extern void gui_line_compute_buffer_max_length (struct t_gui_buffer *buffer,
 extern void gui_line_compute_prefix_max_length (struct t_gui_lines *lines);
 extern void gui_line_mixed_free_buffer (struct t_gui_buffer *buffer);
 extern void gui_line_mixed_free_all (struct t_gui_buffer *buffer);
+extern struct t_gui_line *gui_line_alloc (struct t_gui_buffer *buffer);
+extern void gui_line_release (struct t_gui_line *line);
 extern void gui_line_free_data (struct t_gui_line *line);
 extern void gui_line_free (struct t_gui_buffer *buffer,
                            struct t_gui_line *line);
@@ -139,7 +217,9 @@ extern struct t_gui_line *gui_line_new (struct t_gui_buffer *buffer,
 extern void gui_line_hook_update (struct t_gui_line *line,
                                   struct t_hashtable *hashtable,
                                   struct t_hashtable *hashtable2);
-extern void gui_line_add (struct t_gui_line *line);
+extern void gui_line_batch_start (struct t_gui_buffer *buffer, int sorted);
+extern void gui_line_batch_end (struct t_gui_buffer *buffer);
+extern int gui_line_add (struct t_gui_line *line);
 extern void gui_line_add_y (struct t_gui_line *line);
 extern void gui_line_clear (struct t_gui_line *line);
 extern void gui_line_mix_buffers (struct t_gui_buffer *buffer);
@@ -34,6 +34,7 @@
 #include <ctype.h>
 
 #include "../core/weechat.h"
+#include "../core/core-arraylist.h"
 #include "../core/core-config.h"
 #include "../core/core-hashtable.h"
 #include "../core/core-hdata.h"
@@ -46,9 +47,12 @@
 #include "gui-nicklist.h"
 #include "gui-buffer.h"
 #include "gui-color.h"
+#include "gui-line.h"
 
 
 struct t_hashtable *gui_nicklist_hsignal = NULL;
+int gui_nicklist_batch_signal = 0;     /* 1 if signal is sent for a buffer  */
+                                       /* with a batch of lines             */
 
 
 /*
@@ -60,7 +64,7 @@ gui_nicklist_send_signal (const char *signal, struct t_gui_buffer *buffer,
                           const char *arguments)
 {
     char *str_args;
-    int length;
+    int length, old_batch_signal;
 
     if (buffer)
     {
@@ -72,8 +76,17 @@ gui_nicklist_send_signal (const char *signal, struct t_gui_buffer *buffer,
                       "0x%lx,%s",
                       (unsigned long)buffer,
                       (arguments) ? arguments : "");
+            /*
+             * during a batch of lines in buffer, the bar items with the
+             * nicklist are updated only once, at the end of batch
+             */
+            old_batch_signal = gui_nicklist_batch_signal;
+            gui_nicklist_batch_signal = (buffer->lines_batch) ? 1 : 0;
+            if (buffer->lines_batch)
+                buffer->lines_batch->nicklist_changed = 1;
             (void) hook_signal_send (signal,
                                      WEECHAT_HOOK_SIGNAL_STRING, str_args);
+            gui_nicklist_batch_signal = old_batch_signal;
             free (str_args);
         }
     }
@@ -117,6 +130,174 @@ gui_nicklist_send_hsignal (const char *signal, struct t_gui_buffer *buffer,
     (void) hook_hsignal_send (signal, gui_nicklist_hsignal);
 }
 
+/*
+ * Compares two nicks in arraylist of sorted nicks of a group.
+ */
+
+int
+gui_nicklist_nicks_sorted_cmp_cb (void *data, struct t_arraylist *arraylist,
+                                  void *pointer1, void *pointer2)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) arraylist;
+
+    return string_strcasecmp (((struct t_gui_nick *)pointer1)->name,
+                              ((struct t_gui_nick *)pointer2)->name);
+}
+
+/*
+ * Adds a number of visible groups/nicks to a group and all its parents.
+ */
+
+void
+gui_nicklist_tree_visible_add (struct t_gui_nick_group *group,
+                               int groups, int nicks)
+{
+    struct t_gui_nick_group *ptr_group;
+
+    for (ptr_group = group; ptr_group; ptr_group = ptr_group->parent)
+    {
+        ptr_group->tree_groups_visible_count += groups;
+        ptr_group->tree_nicks_visible_count += nicks;
+    }
+}
+
+/*
+ * Returns the key of a nick name in index of nicks: the name in lower case,
+ * with chars "[\\]^" converted to "{|}~".
+ *
+ * All names considered equal by the function "nickcmp_callback" of buffer
+ * must have the same key (this is the case for nicks compared case
+ * insensitively, including with IRC casemappings).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+gui_nicklist_nick_index_key (const char *name)
+{
+    char *key, *ptr_key;
+    const char *ptr_name;
+    int length;
+
+    key = malloc ((strlen (name) * 2) + 1);
+    if (!key)
+        return NULL;
+
+    ptr_key = key;
+    ptr_name = name;
+    while (ptr_name[0])
+    {
+        if (!((unsigned char)(ptr_name[0]) & 0x80))
+        {
+            if ((ptr_name[0] >= 'A') && (ptr_name[0] <= '^'))
+                ptr_key[0] = ptr_name[0] + ('a' - 'A');
+            else
+                ptr_key[0] = ptr_name[0];
+            ptr_key++;
+            ptr_name++;
+        }
+        else
+        {
+            length = utf8_int_string (towlower (utf8_char_int (ptr_name)),
+                                      ptr_key);
+            if (length <= 0)
+            {
+                /* invalid UTF-8 char: copy it as-is */
+                ptr_key[0] = ptr_name[0];
+                length = 1;
+            }
+            ptr_key += length;
+            ptr_name = utf8_next_char (ptr_name);
+        }
+    }
+    ptr_key[0] = '\0';
+
+    return key;
+}
+
+/*
+ * Adds a nick in index of nicks (hashtable in buffer).
+ */
+
+void
+gui_nicklist_nick_index_add (struct t_gui_buffer *buffer,
+                             struct t_gui_nick *nick)
+{
+    char *key;
+
+    nick->next_nick_index = NULL;
+
+    if (!buffer->nicklist_nicks_index)
+    {
+        buffer->nicklist_nicks_index = hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+        if (!buffer->nicklist_nicks_index)
+            return;
+    }
+
+    key = gui_nicklist_nick_index_key (nick->name);
+    if (!key)
+        return;
+
+    nick->next_nick_index = hashtable_get (buffer->nicklist_nicks_index, key);
+    hashtable_set (buffer->nicklist_nicks_index, key, nick);
+
+    free (key);
+}
+
+/*
+ * Removes a nick from index of nicks (hashtable in buffer).
+ */
+
+void
+gui_nicklist_nick_index_remove (struct t_gui_buffer *buffer,
+                                struct t_gui_nick *nick)
+{
+    struct t_gui_nick *ptr_nick;
+    char *key;
+
+    if (!buffer->nicklist_nicks_index)
+        return;
+
+    key = gui_nicklist_nick_index_key (nick->name);
+    if (!key)
+        return;
+
+    ptr_nick = hashtable_get (buffer->nicklist_nicks_index, key);
+    if (ptr_nick == nick)
+    {
+        if (nick->next_nick_index)
+        {
+            hashtable_set (buffer->nicklist_nicks_index, key,
+                           nick->next_nick_index);
+        }
+        else
+        {
+            hashtable_remove (buffer->nicklist_nicks_index, key);
+        }
+    }
+    else
+    {
+        while (ptr_nick)
+        {
+            if (ptr_nick->next_nick_index == nick)
+            {
+                ptr_nick->next_nick_index = nick->next_nick_index;
+                break;
+            }
+            ptr_nick = ptr_nick->next_nick_index;
+        }
+    }
+    nick->next_nick_index = NULL;
+
+    free (key);
+}
+
 /*
  * Searches for position of a group (to keep nicklist sorted).
  */
@@ -361,6 +542,20 @@ gui_nicklist_add_group_with_id (struct t_gui_buffer *buffer, long long id,
     new_group->last_child = NULL;
     new_group->nicks = NULL;
     new_group->last_nick = NULL;
+    new_group->nicks_sorted = arraylist_new (
+        32, 1, 1,
+        &gui_nicklist_nicks_sorted_cmp_cb, NULL,
+        NULL, NULL);
+    if (!new_group->nicks_sorted)
+    {
+        string_shared_free (new_group->name);
+        string_shared_free (new_group->color);
+        free (new_group);
+        return NULL;
+    }
+    new_group->nicks_visible_count = 0;
+    new_group->tree_groups_visible_count = 0;
+    new_group->tree_nicks_visible_count = 0;
     new_group->prev_group = NULL;
     new_group->next_group = NULL;
 
@@ -377,6 +572,9 @@ gui_nicklist_add_group_with_id (struct t_gui_buffer *buffer, long long id,
         buffer->nicklist_root = new_group;
     }
 
+    if (visible)
+        gui_nicklist_tree_visible_add (new_group, 1, 0);
+
     if (buffer->nicklist_display_groups && visible)
     {
         buffer->nicklist_visible_count++;
@@ -413,69 +611,70 @@ gui_nicklist_add_group (struct t_gui_buffer *buffer,
 }
 
 /*
- * Searches for position of a nick (to keep nicklist sorted).
+ * Inserts nick into sorted list.
+ *
+ * The position is found with a binary search in the arraylist of sorted nicks
+ * of the group (a nick is added after nicks with same name).
  */
 
-struct t_gui_nick *
-gui_nicklist_find_pos_nick (struct t_gui_nick_group *group,
-                            struct t_gui_nick *nick)
+void
+gui_nicklist_insert_nick_sorted (struct t_gui_nick_group *group,
+                                 struct t_gui_nick *nick)
 {
-    struct t_gui_nick *ptr_nick;
+    struct t_gui_nick *pos_nick;
+    int index;
 
-    if (!group)
-        return NULL;
+    index = arraylist_add (group->nicks_sorted, nick);
+    pos_nick = ((index >= 0) && (index + 1 < arraylist_size (group->nicks_sorted))) ?
+        (struct t_gui_nick *)arraylist_get (group->nicks_sorted, index + 1) : NULL;
 
-    for (ptr_nick = group->nicks; ptr_nick; ptr_nick = ptr_nick->next_nick)
+    if (pos_nick)
     {
-        if (string_strcasecmp (nick->name, ptr_nick->name) < 0)
-            return ptr_nick;
+        /* insert nick into the list (before nick found) */
+        nick->prev_nick = pos_nick->prev_nick;
+        nick->next_nick = pos_nick;
+        if (pos_nick->prev_nick)
+            (pos_nick->prev_nick)->next_nick = nick;
+        else
+            group->nicks = nick;
+        pos_nick->prev_nick = nick;
+    }
+    else
+    {
+        /* add nick to the end */
+        nick->prev_nick = group->last_nick;
+        nick->next_nick = NULL;
+        if (group->last_nick)
+            group->last_nick->next_nick = nick;
+        else
+            group->nicks = nick;
+        group->last_nick = nick;
     }
-
-    /* nick will be inserted at end of list */
-    return NULL;
 }
 
 /*
- * Inserts nick into sorted list.
+ * Removes nick from arraylist of sorted nicks of its group.
  */
 
 void
-gui_nicklist_insert_nick_sorted (struct t_gui_nick_group *group,
+gui_nicklist_remove_nick_sorted (struct t_gui_nick_group *group,
                                  struct t_gui_nick *nick)
 {
-    struct t_gui_nick *pos_nick;
+    int index, size;
 
-    if (group->nicks)
-    {
-        pos_nick = gui_nicklist_find_pos_nick (group, nick);
+    size = arraylist_size (group->nicks_sorted);
 
-        if (pos_nick)
-        {
-            /* insert nick into the list (before nick found) */
-            nick->prev_nick = pos_nick->prev_nick;
-            nick->next_nick = pos_nick;
-            if (pos_nick->prev_nick)
-                (pos_nick->prev_nick)->next_nick = nick;
-            else
-                group->nicks = nick;
-            pos_nick->prev_nick = nick;
-        }
-        else
-        {
-            /* add nick to the end */
-            nick->prev_nick = group->last_nick;
-            nick->next_nick = NULL;
-            group->last_nick->next_nick = nick;
-            group->last_nick = nick;
-        }
-    }
-    else
+    /* find first nick with same name, then the nick itself */
+    (void) arraylist_search (group->nicks_sorted, nick, &index, NULL);
+    if (index < 0)
+        return;
+    while ((index < size)
+           && (arraylist_get (group->nicks_sorted, index) != nick))
     {
-        nick->prev_nick = NULL;
-        nick->next_nick = NULL;
-        group->nicks = nick;
-        group->last_nick = nick;
+        index++;
     }
+    if (index < size)
+        arraylist_remove (group->nicks_sorted, index);
 }
 
 /*
@@ -517,6 +716,10 @@ gui_nicklist_search_nick_id (struct t_gui_buffer *buffer,
  * Searches for a nick in nicklist by name (this function must not be called
  * directly).
  *
+ * The nick is searched in the index of nicks (hashtable in buffer), then
+ * names are compared with the function "nickcmp_callback" of buffer
+ * (if set) or with a case sensitive comparison.
+ *
  * Returns pointer to nick found, NULL if not found.
  */
 
@@ -527,9 +730,20 @@ gui_nicklist_search_nick_name (struct t_gui_buffer *buffer,
 {
     struct t_gui_nick *ptr_nick;
     struct t_gui_nick_group *ptr_group;
+    char *key;
 
-    for (ptr_nick = (from_group) ? from_group->nicks : buffer->nicklist_root->nicks;
-         ptr_nick; ptr_nick = ptr_nick->next_nick)
+    if (!buffer || !buffer->nicklist_nicks_index)
+        return NULL;
+
+    key = gui_nicklist_nick_index_key (name);
+    if (!key)
+        return NULL;
+
+    ptr_nick = hashtable_get (buffer->nicklist_nicks_index, key);
+
+    free (key);
+
+    for (; ptr_nick; ptr_nick = ptr_nick->next_nick_index)
     {
         if (buffer->nickcmp_callback)
         {
@@ -537,23 +751,24 @@ gui_nicklist_search_nick_name (struct t_gui_buffer *buffer,
                                             buffer->nickcmp_callback_data,
                                             buffer,
                                             ptr_nick->name,
-                                            name) == 0)
-                return ptr_nick;
+                                            name) != 0)
+                continue;
         }
         else
         {
-            if (strcmp (ptr_nick->name, name) == 0)
-                return ptr_nick;
+            if (strcmp (ptr_nick->name, name) != 0)
+                continue;
         }
-    }
 
-    /* search nick in child groups */
-    for (ptr_group = (from_group) ? from_group->children : buffer->nicklist_root->children;
-         ptr_group; ptr_group = ptr_group->next_group)
-    {
-        ptr_nick = gui_nicklist_search_nick_name (buffer, ptr_group, name);
-        if (ptr_nick)
+        /* check that nick is in "from_group" or one of its children */
+        if (!from_group)
             return ptr_nick;
+        for (ptr_group = ptr_nick->group; ptr_group;
+             ptr_group = ptr_group->parent)
+        {
+            if (ptr_group == from_group)
+                return ptr_nick;
+        }
     }
 
     /* nick not found */
@@ -624,6 +839,12 @@ gui_nicklist_add_nick_with_id (struct t_gui_buffer *buffer, long long id,
     new_nick->visible = visible;
 
     gui_nicklist_insert_nick_sorted (new_nick->group, new_nick);
+    gui_nicklist_nick_index_add (buffer, new_nick);
+    if (visible)
+    {
+        new_nick->group->nicks_visible_count++;
+        gui_nicklist_tree_visible_add (new_nick->group, 0, 1);
+    }
 
     buffer->nicklist_count++;
     buffer->nicklist_nicks_count++;
@@ -688,6 +909,16 @@ gui_nicklist_remove_nick (struct t_gui_buffer *buffer,
     gui_nicklist_send_signal ("nicklist_nick_removing", buffer, nick_removed);
     gui_nicklist_send_hsignal ("nicklist_nick_removing", buffer, NULL, nick);
 
+    /* remove nick from index and sorted nicks */
+    gui_nicklist_nick_index_remove (buffer, nick);
+    gui_nicklist_remove_nick_sorted (nick->group, nick);
+    if (nick->visible)
+    {
+        if (nick->group->nicks_visible_count > 0)
+            nick->group->nicks_visible_count--;
+        gui_nicklist_tree_visible_add (nick->group, 0, -1);
+    }
+
     /* remove nick from list */
     if (nick->prev_nick)
         (nick->prev_nick)->next_nick = nick->next_nick;
@@ -755,6 +986,9 @@ gui_nicklist_remove_group (struct t_gui_buffer *buffer,
     gui_nicklist_send_signal ("nicklist_group_removing", buffer, group_removed);
     gui_nicklist_send_hsignal ("nicklist_group_removing", buffer, group, NULL);
 
+    if (group->visible)
+        gui_nicklist_tree_visible_add (group, -1, 0);
+
     if (group->parent)
     {
         /* remove group from list */
@@ -778,6 +1012,7 @@ gui_nicklist_remove_group (struct t_gui_buffer *buffer,
     /* free data */
     string_shared_free (group->name);
     string_shared_free (group->color);
+    arraylist_free (group->nicks_sorted);
 
     if (buffer->nicklist_display_groups && group->visible)
     {
@@ -897,6 +1132,91 @@ gui_nicklist_get_next_item (struct t_gui_buffer *buffer,
     *group = NULL;
 }
 
+/*
+ * Gets visible item (group or nick) by index (first visible item is 0), in
+ * the same order as function gui_nicklist_get_next_item.
+ *
+ * The number of visible groups/nicks in each group (including children) is
+ * used to skip groups, so the nicks are not all visited.
+ *
+ * If not found, *group and *nick are set to NULL.
+ */
+
+void
+gui_nicklist_get_visible_item (struct t_gui_buffer *buffer, int index,
+                               struct t_gui_nick_group **group,
+                               struct t_gui_nick **nick)
+{
+    struct t_gui_nick_group *ptr_group, *ptr_child;
+    struct t_gui_nick *ptr_nick;
+    int count;
+
+    *group = NULL;
+    *nick = NULL;
+
+    if (!buffer || (index < 0))
+        return;
+
+    ptr_group = buffer->nicklist_root;
+    while (ptr_group)
+    {
+        /* the group itself */
+        if (buffer->nicklist_display_groups && ptr_group->visible)
+        {
+            if (index == 0)
+            {
+                *group = ptr_group;
+                return;
+            }
+            index--;
+        }
+
+        /* children of group */
+        for (ptr_child = ptr_group->children; ptr_child;
+             ptr_child = ptr_child->next_group)
+        {
+            count = ptr_child->tree_nicks_visible_count;
+            if (buffer->nicklist_display_groups)
+                count += ptr_child->tree_groups_visible_count;
+            if (index < count)
+                break;
+            index -= count;
+        }
+        if (ptr_child)
+        {
+            ptr_group = ptr_child;
+            continue;
+        }
+
+        /* nicks of group */
+        if (index >= ptr_group->nicks_visible_count)
+            return;
+        if (ptr_group->nicks_visible_count == arraylist_size (ptr_group->nicks_sorted))
+        {
+            /* all nicks are visible: direct access to the nick */
+            *group = ptr_group;
+            *nick = (struct t_gui_nick *)arraylist_get (ptr_group->nicks_sorted,
+                                                        index);
+            return;
+        }
+        for (ptr_nick = ptr_group->nicks; ptr_nick;
+             ptr_nick = ptr_nick->next_nick)
+        {
+            if (ptr_nick->visible)
+            {
+                if (index == 0)
+                {
+                    *group = ptr_group;
+                    *nick = ptr_nick;
+                    return;
+                }
+                index--;
+            }
+        }
+        return;
+    }
+}
+
 /*
  * Returns first char of a group that will be displayed on screen.
  *
@@ -1069,7 +1389,15 @@ gui_nicklist_group_set (struct t_gui_buffer *buffer,
         error = NULL;
         number = strtol (value, &error, 10);
         if (error && !error[0])
-            group->visible = (number) ? 1 : 0;
+        {
+            number = (number) ? 1 : 0;
+            if (number != group->visible)
+            {
+                gui_nicklist_tree_visible_add (group,
+                                               (number) ? 1 : -1, 0);
+            }
+            group->visible = number;
+        }
         group_changed = 1;
     }
 
@@ -1203,7 +1531,16 @@ gui_nicklist_nick_set (struct t_gui_buffer *buffer,
         error = NULL;
         number = strtol (value, &error, 10);
         if (error && !error[0])
-            nick->visible = (number) ? 1 : 0;
+        {
+            number = (number) ? 1 : 0;
+            if (number != nick->visible)
+            {
+                nick->group->nicks_visible_count += (number) ? 1 : -1;
+                gui_nicklist_tree_visible_add (nick->group,
+                                               0, (number) ? 1 : -1);
+            }
+            nick->visible = number;
+        }
         nick_changed = 1;
     }
 
@@ -22,6 +22,7 @@
 
 struct t_gui_buffer;
 struct t_infolist;
+struct t_arraylist;
 
 struct t_gui_nick_group
 {
@@ -35,6 +36,10 @@ struct t_gui_nick_group
     struct t_gui_nick_group *last_child; /* last child                      */
     struct t_gui_nick *nicks;          /* nicks for group                   */
     struct t_gui_nick *last_nick;      /* last nick for group               */
+    struct t_arraylist *nicks_sorted;  /* nicks sorted by name              */
+    int nicks_visible_count;           /* number of visible nicks in group  */
+    int tree_groups_visible_count;     /* visible groups (group + children) */
+    int tree_nicks_visible_count;      /* visible nicks (group + children)  */
     struct t_gui_nick_group *prev_group; /* link to previous group          */
     struct t_gui_nick_group *next_group; /* link to next group              */
 };
@@ -48,10 +53,15 @@ struct t_gui_nick
     char *prefix;                      /* prefix for nick (for admins, ..)  */
     char *prefix_color;                /* color for prefix                  */
     int visible;                       /* 1 if nick is displayed            */
+    struct t_gui_nick *next_nick_index; /* next nick with same key in index */
     struct t_gui_nick *prev_nick;      /* link to previous nick             */
     struct t_gui_nick *next_nick;      /* link to next nick                 */
 };
 
+/* nicklist variables */
+
+extern int gui_nicklist_batch_signal;
+
 /* nicklist functions */
 
 extern struct t_gui_nick_group *gui_nicklist_search_group (struct t_gui_buffer *buffer,
@@ -95,6 +105,10 @@ extern void gui_nicklist_remove_all (struct t_gui_buffer *buffer);
 extern void gui_nicklist_get_next_item (struct t_gui_buffer *buffer,
                                         struct t_gui_nick_group **group,
                                         struct t_gui_nick **nick);
+extern void gui_nicklist_get_visible_item (struct t_gui_buffer *buffer,
+                                           int index,
+                                           struct t_gui_nick_group **group,
+                                           struct t_gui_nick **nick);
 extern const char *gui_nicklist_get_group_start (const char *name);
 extern void gui_nicklist_compute_visible_count (struct t_gui_buffer *buffer,
                                                 struct t_gui_nick_group *group);
@@ -35,6 +35,7 @@
 
 #include "../core/weechat.h"
 #include "../core/core-config.h"
+#include "../core/core-hashtable.h"
 #include "../core/core-hdata.h"
 #include "../core/core-hook.h"
 #include "../core/core-infolist.h"
@@ -71,6 +72,8 @@ int gui_window_cursor_y = 0;           /* cursor pos on screen              */
 int gui_window_bare_display = 0;       /* 1 for bare disp. (disable ncurses)*/
 struct t_hook *gui_window_bare_display_timer = NULL;
                                        /* timer for bare display            */
+int gui_window_line_heights_generation = 0; /* incremented to invalidate    */
+                                       /* cache of lines heights           */
 
 
 /*
@@ -721,6 +724,7 @@ gui_window_new (struct t_gui_window *parent_window, struct t_gui_buffer *buffer,
     /* coordinates */
     new_window->coords_size = 0;
     new_window->coords = NULL;
+    new_window->line_heights = NULL;
 
     /* tree */
     new_window->ptr_tree = ptr_leaf;
@@ -993,6 +997,166 @@ gui_window_coords_remove_line_data (struct t_gui_window *window,
     }
 }
 
+/*
+ * Invalidates cache of lines heights in all windows.
+ *
+ * This must be called on any change that could change the number of lines
+ * displayed for many lines (options, filters, etc.).
+ */
+
+void
+gui_window_line_heights_invalidate_all ()
+{
+    gui_window_line_heights_generation++;
+}
+
+/*
+ * Checks that cache of lines heights in window is still valid for the
+ * current size of window and buffer displayed; if not, the cache is cleared.
+ *
+ * If "create" is 1, the cache is created if it does not exist.
+ *
+ * Returns:
+ *   1: cache is usable
+ *   0: no cache
+ */
+
+int
+gui_window_line_heights_check (struct t_gui_window *window, int create)
+{
+    struct t_gui_window_line_heights *ptr_heights;
+    struct t_gui_lines *ptr_lines;
+
+    if (!window || !window->buffer)
+        return 0;
+
+    if (!window->line_heights)
+    {
+        if (!create)
+            return 0;
+        window->line_heights = malloc (sizeof (*window->line_heights));
+        if (!window->line_heights)
+            return 0;
+        window->line_heights->heights = hashtable_new (
+            256,
+            WEECHAT_HASHTABLE_POINTER,
+            WEECHAT_HASHTABLE_INTEGER,
+            NULL, NULL);
+        if (!window->line_heights->heights)
+        {
+            free (window->line_heights);
+            window->line_heights = NULL;
+            return 0;
+        }
+        window->line_heights->lines = NULL;
+    }
+
+    ptr_heights = window->line_heights;
+    ptr_lines = window->buffer->lines;
+
+    if ((ptr_heights->generation != gui_window_line_heights_generation)
+        || (ptr_heights->chat_width != window->win_chat_width)
+        || (ptr_heights->bare_display != gui_window_bare_display)
+        || (ptr_heights->lines != ptr_lines)
+        || (ptr_heights->prefix_max_length != ptr_lines->prefix_max_length)
+        || (ptr_heights->buffer_max_length != ptr_lines->buffer_max_length)
+        || (ptr_heights->time_for_each_line != window->buffer->time_for_each_line))
+    {
+        hashtable_remove_all (ptr_heights->heights);
+        ptr_heights->generation = gui_window_line_heights_generation;
+        ptr_heights->chat_width = window->win_chat_width;
+        ptr_heights->bare_display = gui_window_bare_display;
+        ptr_heights->lines = ptr_lines;
+        ptr_heights->prefix_max_length = ptr_lines->prefix_max_length;
+        ptr_heights->buffer_max_length = ptr_lines->buffer_max_length;
+        ptr_heights->time_for_each_line = window->buffer->time_for_each_line;
+    }
+
+    return 1;
+}
+
+/*
+ * Gets height of a line (number of lines on screen) from cache.
+ *
+ * The height is returned only if it was stored with the same flags
+ * (flags are the parts of line display that can change without change in
+ * the line itself, like the day change or read marker).
+ *
+ * Returns height of line, -1 if not found in cache.
+ */
+
+int
+gui_window_line_heights_get (struct t_gui_window *window,
+                             struct t_gui_line *line, int flags)
+{
+    int *ptr_value;
+
+    if (!line || !gui_window_line_heights_check (window, 0))
+        return -1;
+
+    ptr_value = hashtable_get (window->line_heights->heights, line);
+    if (!ptr_value
+        || ((*ptr_value & GUI_WINDOW_LINE_HEIGHTS_FLAGS_MASK) != flags))
+    {
+        return -1;
+    }
+
+    return *ptr_value >> GUI_WINDOW_LINE_HEIGHTS_FLAGS_BITS;
+}
+
+/*
+ * Stores height of a line (number of lines on screen) in cache.
+ */
+
+void
+gui_window_line_heights_set (struct t_gui_window *window,
+                             struct t_gui_line *line,
+                             int height, int flags)
+{
+    int value;
+
+    if (!line || (height < 0) || !gui_window_line_heights_check (window, 1))
+        return;
+
+    value = (height << GUI_WINDOW_LINE_HEIGHTS_FLAGS_BITS)
+        | (flags & GUI_WINDOW_LINE_HEIGHTS_FLAGS_MASK);
+    hashtable_set (window->line_heights->heights, line, &value);
+}
+
+/*
+ * Removes a line from cache of lines heights in all windows.
+ */
+
+void
+gui_window_line_heights_remove_line (struct t_gui_line *line)
+{
+    struct t_gui_window *ptr_win;
+
+    if (!line)
+        return;
+
+    for (ptr_win = gui_windows; ptr_win; ptr_win = ptr_win->next_window)
+    {
+        if (ptr_win->line_heights)
+            hashtable_remove (ptr_win->line_heights->heights, line);
+    }
+}
+
+/*
+ * Frees cache of lines heights in a window.
+ */
+
+void
+gui_window_line_heights_free (struct t_gui_window *window)
+{
+    if (!window || !window->line_heights)
+        return;
+
+    hashtable_free (window->line_heights->heights);
+    free (window->line_heights);
+    window->line_heights = NULL;
+}
+
 /*
  * Allocates and initializes coordinates for window.
  */
@@ -1066,6 +1230,9 @@ gui_window_free (struct t_gui_window *window)
     /* free coords */
     free (window->coords);
 
+    /* free cache of lines heights */
+    gui_window_line_heights_free (window);
+
     /* remove window from windows list */
     if (window->prev_window)
         (window->prev_window)->next_window = window->next_window;
@@ -2136,6 +2303,7 @@ gui_window_print_log ()
         log_printf ("  layout_buffer_name. : '%s'", ptr_window->layout_buffer_name);
         log_printf ("  scroll. . . . . . . : %p", ptr_window->scroll);
         log_printf ("  scroll_changed. . . : %d", ptr_window->scroll_changed);
+        log_printf ("  line_heights. . . . : %p", ptr_window->line_heights);
         log_printf ("  coords_size . . . . : %d", ptr_window->coords_size);
         log_printf ("  coords. . . . . . . : %p", ptr_window->coords);
         log_printf ("  ptr_tree. . . . . . : %p", ptr_window->ptr_tree);
@@ -21,8 +21,18 @@
 #define WEECHAT_GUI_WINDOW_H
 
 struct t_infolist;
+struct t_hashtable;
 struct t_gui_bar_window;
 struct t_gui_line_data;
+struct t_gui_lines;
+
+/*
+ * heights of lines are stored in cache with flags (in lower bits), so that
+ * the cached height is used only if flags are the same
+ */
+#define GUI_WINDOW_LINE_HEIGHTS_FLAGS_BITS 3
+#define GUI_WINDOW_LINE_HEIGHTS_FLAGS_MASK                              \
+    ((1 << GUI_WINDOW_LINE_HEIGHTS_FLAGS_BITS) - 1)
 
 /* window structures */
 
@@ -35,6 +45,19 @@ struct t_gui_window_coords
     int prefix_x1, prefix_x2;          /* start/end of prefix on screen     */
 };
 
+struct t_gui_window_line_heights
+{
+    struct t_hashtable *heights;       /* line (pointer) -> height + flags  */
+    int generation;                    /* gui_window_line_heights_generation*/
+                                       /* when cache was built              */
+    int chat_width;                    /* width of chat area                */
+    int bare_display;                  /* 1 if bare display is enabled      */
+    struct t_gui_lines *lines;         /* lines displayed in window         */
+    int prefix_max_length;             /* max length of prefix in lines     */
+    int buffer_max_length;             /* max length of buffer name in lines*/
+    int time_for_each_line;            /* time is displayed for each line   */
+};
+
 struct t_gui_window
 {
     int number;                        /* window number (first is 1)        */
@@ -73,6 +96,8 @@ struct t_gui_window
     struct t_gui_window_scroll *scroll; /* scroll infos for each buffer     */
                                         /* scrolled in this window          */
     int scroll_changed;                 /* scrolled changed?                */
+    struct t_gui_window_line_heights *line_heights; /* cache of heights of  */
+                                        /* lines (used to scroll)           */
 
     /* coordinates (for focus) */
     int coords_size;                   /* size of coords (number of lines)  */
@@ -128,6 +153,7 @@ extern int gui_window_cursor_x;
 extern int gui_window_cursor_y;
 extern int gui_window_bare_display;
 extern struct t_hook *gui_window_bare_display_timer;
+extern int gui_window_line_heights_generation;
 
 /* window functions */
 
@@ -177,6 +203,17 @@ extern void gui_window_coords_remove_line (struct t_gui_window *window,
 extern void gui_window_coords_remove_line_data (struct t_gui_window *window,
                                                 struct t_gui_line_data *line_data);
 extern void gui_window_coords_alloc (struct t_gui_window *window);
+extern void gui_window_line_heights_invalidate_all ();
+extern int gui_window_line_heights_check (struct t_gui_window *window,
+                                          int create);
+extern int gui_window_line_heights_get (struct t_gui_window *window,
+                                        struct t_gui_line *line,
+                                        int flags);
+extern void gui_window_line_heights_set (struct t_gui_window *window,
+                                         struct t_gui_line *line,
+                                         int height, int flags);
+extern void gui_window_line_heights_remove_line (struct t_gui_line *line);
+extern void gui_window_line_heights_free (struct t_gui_window *window);
 extern void gui_window_free (struct t_gui_window *window);
 extern void gui_window_switch_previous (struct t_gui_window *window);
 extern void gui_window_switch_next (struct t_gui_window *window);
@@ -39,6 +39,10 @@ struct t_arraylist *buflist_list_buffers[BUFLIST_BAR_NUM_ITEMS] =
 
 int old_line_number_current_buffer[BUFLIST_BAR_NUM_ITEMS] =
 { -1, -1, -1, -1, -1 };
+struct t_hashtable *buflist_bar_item_cache[BUFLIST_BAR_NUM_ITEMS] =
+{ NULL, NULL, NULL, NULL, NULL };
+int buflist_bar_item_cache_buffer_only[BUFLIST_BAR_NUM_ITEMS] =
+{ 0, 0, 0, 0, 0 };
 
 
 /*
@@ -106,18 +110,68 @@ buflist_bar_item_get_index_with_pointer (struct t_gui_bar_item *item)
 }
 
 /*
- * Updates buflist bar item if buflist is enabled (or if force argument is 1).
+ * Frees a buffer in cache of bar item.
+ */
+
+void
+buflist_bar_item_cache_free_cb (struct t_hashtable *hashtable,
+                                const void *key, void *value)
+{
+    struct t_buflist_bar_item_cache *ptr_cache;
+
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    ptr_cache = (struct t_buflist_bar_item_cache *)value;
+    if (!ptr_cache)
+        return;
+
+    free (ptr_cache->signature);
+    free (ptr_cache->line);
+    free (ptr_cache);
+}
+
+/*
+ * Invalidates cache of bar items: the content for the buffers will be
+ * evaluated again on next refresh.
  *
- * If index == -1, all bar items (or all bar items used) are refreshed,
- * otherwise only this bar item is refreshed.
+ * If index == -1, the cache of all bar items is invalidated, otherwise only
+ * the cache of this bar item.
  *
- * If force == 1, all used items are refreshed (according to option
- * buflist.look.use_items).
- * If force == 2, all items are refreshed.
+ * If buffer is NULL, all buffers are removed from cache, otherwise only this
+ * buffer.
  */
 
 void
-buflist_bar_item_update (int index, int force)
+buflist_bar_item_cache_invalidate (int index, struct t_gui_buffer *buffer)
+{
+    int i;
+
+    for (i = 0; i < BUFLIST_BAR_NUM_ITEMS; i++)
+    {
+        if ((index >= 0) && (i != index))
+            continue;
+        if (!buffer)
+            buflist_bar_item_cache_buffer_only[i] = 0;
+        if (!buflist_bar_item_cache[i])
+            continue;
+        if (buffer)
+            weechat_hashtable_remove (buflist_bar_item_cache[i], buffer);
+        else
+            weechat_hashtable_remove_all (buflist_bar_item_cache[i]);
+    }
+}
+
+/*
+ * Refreshes buflist bar item if buflist is enabled (or if force argument is
+ * 1), using the content of buffers in cache when it is still valid.
+ *
+ * For arguments, see function buflist_bar_item_update.
+ */
+
+void
+buflist_bar_item_refresh (int index, int force)
 {
     int i, num_items;
 
@@ -140,6 +194,80 @@ buflist_bar_item_update (int index, int force)
     }
 }
 
+/*
+ * Updates buflist bar item if buflist is enabled (or if force argument is 1):
+ * the content of all buffers is evaluated again.
+ *
+ * If index == -1, all bar items (or all bar items used) are refreshed,
+ * otherwise only this bar item is refreshed.
+ *
+ * If force == 1, all used items are refreshed (according to option
+ * buflist.look.use_items).
+ * If force == 2, all items are refreshed.
+ */
+
+void
+buflist_bar_item_update (int index, int force)
+{
+    buflist_bar_item_cache_invalidate (index, NULL);
+    buflist_bar_item_refresh (index, force);
+}
+
+/*
+ * Updates buflist bar items after a change on a buffer: only the content of
+ * this buffer is evaluated again (other buffers are taken from cache if
+ * their variables did not change).
+ *
+ * If buffer is NULL, the content of all buffers is evaluated again.
+ */
+
+void
+buflist_bar_item_update_buffer (struct t_gui_buffer *buffer)
+{
+    int i;
+
+    buflist_bar_item_cache_invalidate (-1, buffer);
+    if (buffer)
+    {
+        for (i = 0; i < BUFLIST_BAR_NUM_ITEMS; i++)
+        {
+            buflist_bar_item_cache_buffer_only[i] = 1;
+        }
+    }
+    buflist_bar_item_refresh (-1, 0);
+}
+
+/*
+ * Builds the signature of a buffer in bar item: the extra variables and
+ * pointers used to evaluate the conditions and format of buffer.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+buflist_bar_item_cache_signature ()
+{
+    char **signature;
+
+    signature = weechat_string_dyn_alloc (512);
+    if (!signature)
+        return NULL;
+
+    weechat_string_dyn_concat (
+        signature,
+        weechat_hashtable_get_string (buflist_hashtable_extra_vars,
+                                      "keys_values"),
+        -1);
+    weechat_string_dyn_concat (signature, "\n", -1);
+    weechat_string_dyn_concat (
+        signature,
+        weechat_hashtable_get_string (buflist_hashtable_pointers,
+                                      "keys_values"),
+        -1);
+
+    return weechat_string_dyn_free (signature, 0);
+}
+
 /*
  * Checks if the bar can be scrolled, the bar must have:
  * - a position "left" or "right"
@@ -297,6 +425,72 @@ buflist_bar_item_auto_scroll (const char *item_name, int line_number)
     }
 }
 
+/*
+ * Evaluates the conditions and format of a buffer (the extra variables and
+ * pointers must be set) and stores the result in cache of bar item.
+ *
+ * Returns pointer to buffer in cache, NULL if error.
+ */
+
+struct t_buflist_bar_item_cache *
+buflist_bar_item_cache_eval (int item_index, struct t_gui_buffer *buffer,
+                             const char *signature, const char *format)
+{
+    struct t_buflist_bar_item_cache *new_cache;
+    char *condition;
+
+    if (!buflist_bar_item_cache[item_index])
+    {
+        buflist_bar_item_cache[item_index] = weechat_hashtable_new (
+            128,
+            WEECHAT_HASHTABLE_POINTER,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+        if (!buflist_bar_item_cache[item_index])
+            return NULL;
+        weechat_hashtable_set_pointer (buflist_bar_item_cache[item_index],
+                                       "callback_free_value",
+                                       &buflist_bar_item_cache_free_cb);
+    }
+
+    new_cache = malloc (sizeof (*new_cache));
+    if (!new_cache)
+        return NULL;
+
+    new_cache->signature = (signature) ? strdup (signature) : NULL;
+
+    /* check condition: if false, the buffer is not displayed */
+    condition = weechat_string_eval_expression (
+        weechat_config_string (buflist_config_look_display_conditions),
+        buflist_hashtable_pointers,
+        buflist_hashtable_extra_vars,
+        buflist_hashtable_options_conditions);
+    new_cache->displayed = (condition && (strcmp (condition, "1") == 0)) ?
+        1 : 0;
+    free (condition);
+
+    /* build string */
+    new_cache->line = (new_cache->displayed) ?
+        weechat_string_eval_expression (format,
+                                        buflist_hashtable_pointers,
+                                        buflist_hashtable_extra_vars,
+                                        NULL) : NULL;
+    if (new_cache->displayed && !new_cache->line)
+    {
+        buflist_bar_item_cache_free_cb (NULL, NULL, new_cache);
+        return NULL;
+    }
+
+    if (!weechat_hashtable_set (buflist_bar_item_cache[item_index],
+                                buffer, new_cache))
+    {
+        buflist_bar_item_cache_free_cb (NULL, NULL, new_cache);
+        return NULL;
+    }
+
+    return new_cache;
+}
+
 /*
  * Returns the content of the bar item.
  */
@@ -314,10 +508,11 @@ buflist_bar_item_buflist_cb (const void *pointer, void *data,
     struct t_gui_nick *ptr_gui_nick;
     struct t_gui_hotlist *ptr_hotlist;
     void *ptr_server, *ptr_channel;
-    char **buflist, *str_buflist, *condition;
+    struct t_buflist_bar_item_cache *ptr_cache;
+    char **buflist, *str_buflist, *signature;
     char str_format_number[32], str_format_number_empty[32];
     char str_nick_prefix[32], str_color_nick_prefix[32];
-    char str_number[32], str_number2[32], *line, **hotlist, *str_hotlist;
+    char str_number[32], str_number2[32], **hotlist, *str_hotlist;
     char str_hotlist_count[32];
     const char *ptr_format, *ptr_format_current, *ptr_format_indent;
     const char *ptr_name, *ptr_type, *ptr_nick, *ptr_nick_prefix;
@@ -329,7 +524,7 @@ buflist_bar_item_buflist_cb (const void *pointer, void *data,
     const char *ptr_lag, *ptr_item_name, *ptr_tls_version;
     int item_index, num_buffers, is_channel, is_private, is_list;
     int i, j, length_max_number, current_buffer, number, prev_number, priority;
-    int rc, count, line_number, line_number_current_buffer;
+    int count, line_number, line_number_current_buffer;
     int hotlist_priority_number;
 
     /* make C compiler happy */
@@ -345,6 +540,15 @@ buflist_bar_item_buflist_cb (const void *pointer, void *data,
     if (item_index + 1 > weechat_config_integer (buflist_config_look_use_items))
         return NULL;
 
+    /*
+     * the cache is used only if the refresh was asked for a single buffer:
+     * on any other refresh, all buffers are evaluated again because the
+     * formats can use any data (hdata, infos, dates, ...)
+     */
+    if (!buflist_bar_item_cache_buffer_only[item_index])
+        buflist_bar_item_cache_invalidate (item_index, NULL);
+    buflist_bar_item_cache_buffer_only[item_index] = 0;
+
     prev_number = -1;
     line_number = 0;
     line_number_current_buffer = 0;
@@ -623,15 +827,28 @@ buflist_bar_item_buflist_cb (const void *pointer, void *data,
             (ptr_tls_version && ptr_tls_version[0]) ?
             weechat_config_string (buflist_config_format_tls_version) : "");
 
-        /* check condition: if false, the buffer is not displayed */
-        condition = weechat_string_eval_expression (
-            weechat_config_string (buflist_config_look_display_conditions),
-            buflist_hashtable_pointers,
-            buflist_hashtable_extra_vars,
-            buflist_hashtable_options_conditions);
-        rc = (condition && (strcmp (condition, "1") == 0));
-        free (condition);
-        if (!rc)
+        /*
+         * get buffer from cache: it is evaluated again only if it is not in
+         * cache (always the case if the refresh is not for a single buffer)
+         * or if the variables have changed
+         */
+        signature = buflist_bar_item_cache_signature ();
+        ptr_cache = (buflist_bar_item_cache[item_index]) ?
+            weechat_hashtable_get (buflist_bar_item_cache[item_index],
+                                   ptr_buffer) : NULL;
+        if (!ptr_cache || !signature || !ptr_cache->signature
+            || (strcmp (ptr_cache->signature, signature) != 0))
+        {
+            ptr_cache = buflist_bar_item_cache_eval (item_index, ptr_buffer,
+                                                     signature,
+                                                     (current_buffer) ?
+                                                     ptr_format_current :
+                                                     ptr_format);
+        }
+        free (signature);
+
+        /* condition is false: the buffer is not displayed */
+        if (!ptr_cache || !ptr_cache->displayed)
             continue;
 
         /* add buffer in list */
@@ -650,17 +867,8 @@ buflist_bar_item_buflist_cb (const void *pointer, void *data,
                 goto error;
         }
 
-        /* build string */
-        line = weechat_string_eval_expression (
-            (current_buffer) ? ptr_format_current : ptr_format,
-            buflist_hashtable_pointers,
-            buflist_hashtable_extra_vars,
-            NULL);
-
         /* concatenate string */
-        rc = weechat_string_dyn_concat (buflist, line, -1);
-        free (line);
-        if (!rc)
+        if (!weechat_string_dyn_concat (buflist, ptr_cache->line, -1))
             goto error;
 
         line_number++;
@@ -784,5 +992,10 @@ buflist_bar_item_end ()
             weechat_arraylist_free (buflist_list_buffers[i]);
             buflist_list_buffers[i] = NULL;
         }
+        if (buflist_bar_item_cache[i])
+        {
+            weechat_hashtable_free (buflist_bar_item_cache[i]);
+            buflist_bar_item_cache[i] = NULL;
+        }
     }
 }
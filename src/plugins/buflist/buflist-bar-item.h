@@ -25,14 +25,30 @@
 #define BUFLIST_BAR_NUM_ITEMS 5
 
 struct t_gui_bar_item;
+struct t_gui_buffer;
+
+/* buffer in cache of bar item */
+
+struct t_buflist_bar_item_cache
+{
+    char *signature;                   /* variables used to evaluate buffer */
+    int displayed;                     /* result of display conditions      */
+    char *line;                        /* evaluated format (if displayed)   */
+};
 
 extern struct t_gui_bar_item *buflist_bar_item_buflist[BUFLIST_BAR_NUM_ITEMS];
 extern struct t_arraylist *buflist_list_buffers[BUFLIST_BAR_NUM_ITEMS];
+extern struct t_hashtable *buflist_bar_item_cache[BUFLIST_BAR_NUM_ITEMS];
+extern int buflist_bar_item_cache_buffer_only[BUFLIST_BAR_NUM_ITEMS];
 
 extern const char *buflist_bar_item_get_name (int index);
 extern int buflist_bar_item_get_index (const char *item_name);
 extern int buflist_bar_item_get_index_with_pointer (struct t_gui_bar_item *item);
+extern void buflist_bar_item_cache_invalidate (int index,
+                                               struct t_gui_buffer *buffer);
+extern void buflist_bar_item_refresh (int index, int force);
 extern void buflist_bar_item_update (int index, int force);
+extern void buflist_bar_item_update_buffer (struct t_gui_buffer *buffer);
 extern int buflist_bar_item_init ();
 extern void buflist_bar_item_end ();
 
@@ -70,6 +70,7 @@ struct t_config_option *buflist_config_format_tls_version = NULL;
 
 struct t_hook **buflist_config_signals_refresh = NULL;
 int buflist_config_num_signals_refresh = 0;
+char **buflist_config_signals_refresh_buffer = NULL;
 char **buflist_config_sort_fields[BUFLIST_BAR_NUM_ITEMS] =
 { NULL, NULL, NULL, NULL, NULL };
 int buflist_config_sort_fields_count[BUFLIST_BAR_NUM_ITEMS] =
@@ -145,6 +146,10 @@ buflist_config_compare_signals (void *data, struct t_arraylist *arraylist,
 
 /*
  * Callback for a signal on a buffer.
+ *
+ * For signals which are about a single buffer (see
+ * BUFLIST_CONFIG_SIGNALS_REFRESH_BUFFER), only this buffer is evaluated
+ * again, otherwise all buffers are evaluated again.
  */
 
 int
@@ -152,14 +157,35 @@ buflist_config_signal_buffer_cb (const void *pointer, void *data,
                                  const char *signal, const char *type_data,
                                  void *signal_data)
 {
+    struct t_gui_buffer *ptr_buffer;
+    int rc;
+
     /* make C compiler happy */
     (void) pointer;
     (void) data;
-    (void) signal;
-    (void) type_data;
-    (void) signal_data;
 
-    buflist_bar_item_update (-1, 0);
+    ptr_buffer = NULL;
+
+    if (signal_data
+        && weechat_string_match_list (
+            signal,
+            (const char **)buflist_config_signals_refresh_buffer,
+            1))
+    {
+        if (strcmp (type_data, WEECHAT_HOOK_SIGNAL_POINTER) == 0)
+        {
+            ptr_buffer = (struct t_gui_buffer *)signal_data;
+        }
+        else if (strcmp (type_data, WEECHAT_HOOK_SIGNAL_STRING) == 0)
+        {
+            /* nicklist signals: "0x123abc,nick" */
+            rc = sscanf ((const char *)signal_data, "%p", &ptr_buffer);
+            if ((rc == EOF) || (rc < 1))
+                ptr_buffer = NULL;
+        }
+    }
+
+    buflist_bar_item_update_buffer (ptr_buffer);
 
     return WEECHAT_RC_OK;
 }
@@ -471,6 +497,16 @@ buflist_config_change_format (const void *pointer, void *data,
 int
 buflist_config_init ()
 {
+    buflist_config_signals_refresh_buffer = weechat_string_split (
+        BUFLIST_CONFIG_SIGNALS_REFRESH_BUFFER,
+        ",",
+        NULL,
+        WEECHAT_STRING_SPLIT_STRIP_LEFT
+        | WEECHAT_STRING_SPLIT_STRIP_RIGHT
+        | WEECHAT_STRING_SPLIT_COLLAPSE_SEPS,
+        0,
+        NULL);
+
     buflist_config_file = weechat_config_new (
         BUFLIST_CONFIG_PRIO_NAME,
         &buflist_config_reload, NULL, NULL);
@@ -863,4 +899,10 @@ buflist_config_free ()
 
     free (buflist_config_format_hotlist_eval);
     buflist_config_format_hotlist_eval = NULL;
+
+    if (buflist_config_signals_refresh_buffer)
+    {
+        weechat_string_free_split (buflist_config_signals_refresh_buffer);
+        buflist_config_signals_refresh_buffer = NULL;
+    }
 }
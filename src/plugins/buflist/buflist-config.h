@@ -32,6 +32,11 @@
     "window_switch,hotlist_changed"
 #define BUFLIST_CONFIG_SIGNALS_REFRESH_NICK_PREFIX                      \
     "nicklist_nick_*"
+/* signals about a single buffer: only this buffer is evaluated again */
+#define BUFLIST_CONFIG_SIGNALS_REFRESH_BUFFER                           \
+    "buffer_renamed,buffer_hidden,buffer_unhidden,"                     \
+    "buffer_localvar_added,buffer_localvar_changed,hotlist_changed,"    \
+    "nicklist_nick_*"
 
 extern struct t_config_file *buflist_config_file;
 
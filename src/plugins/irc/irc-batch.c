@@ -224,7 +224,7 @@ irc_batch_process_messages (struct t_irc_server *server,
 {
     char **list_messages, *command, *channel, modifier_data[1024], *new_messages;
     char *message, *message2;
-    int i, count_messages;
+    int i, count_messages, print_batch;
 
     if (!batch || !batch->messages)
         return;
@@ -252,6 +252,18 @@ irc_batch_process_messages (struct t_irc_server *server,
             "\n", NULL, 0, 0, &count_messages);
         if (list_messages)
         {
+            /*
+             * netsplit/netjoin: update buffers only once, at the end;
+             * nicks are still added/removed one by one by the JOIN/QUIT
+             * callbacks: the nicklist signals are sent for each nick
+             * (used by relay, buflist and scripts) and the nick lookups
+             * in channel and nicklist are indexed, so a bulk removal
+             * would not save anything but the signals
+             */
+            print_batch = (batch->type
+                           && ((strcmp (batch->type, "netsplit") == 0)
+                               || (strcmp (batch->type, "netjoin") == 0))) ?
+                irc_server_print_batch_start (server) : 0;
             for (i = 0; i < count_messages; i++)
             {
                 message = weechat_string_replace (list_messages[i], "\r", "\n");
@@ -292,6 +304,8 @@ irc_batch_process_messages (struct t_irc_server *server,
                 free (command);
                 free (channel);
             }
+            if (print_batch)
+                irc_server_print_batch_end (server);
             weechat_string_free_split (list_messages);
         }
     }
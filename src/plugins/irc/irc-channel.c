@@ -466,11 +466,14 @@ irc_channel_new (struct t_irc_server *server, int channel_type,
     new_channel->cycle = 0;
     new_channel->part = 0;
     new_channel->nick_completion_reset = 0;
+    new_channel->print_batch = 0;
     new_channel->pv_remote_nick_color = NULL;
     new_channel->hook_autorejoin = NULL;
     new_channel->nicks_count = 0;
     new_channel->nicks = NULL;
     new_channel->last_nick = NULL;
+    new_channel->nicks_index = NULL;
+    new_channel->nicks_index_collisions = 0;
     new_channel->nicks_speaking[0] = NULL;
     new_channel->nicks_speaking[1] = NULL;
     new_channel->nicks_speaking_time = NULL;
@@ -1648,6 +1651,7 @@ irc_channel_free (struct t_irc_server *server, struct t_irc_channel *channel)
 
     /* free linked lists */
     irc_nick_free_all (server, channel);
+    weechat_hashtable_free (channel->nicks_index);
     irc_modelist_free_all (channel);
 
     /* free channel data */
@@ -1714,11 +1718,14 @@ irc_channel_hdata_channel_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_channel, cycle, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, part, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, nick_completion_reset, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_channel, print_batch, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, pv_remote_nick_color, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, hook_autorejoin, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_count, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, nicks, POINTER, 0, NULL, "irc_nick");
         WEECHAT_HDATA_VAR(struct t_irc_channel, last_nick, POINTER, 0, NULL, "irc_nick");
+        WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_index, HASHTABLE, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_index_collisions, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_speaking, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_speaking_time, POINTER, 0, NULL, "irc_channel_speaking");
         WEECHAT_HDATA_VAR(struct t_irc_channel, last_nick_speaking_time, POINTER, 0, NULL, "irc_channel_speaking");
@@ -1902,11 +1909,14 @@ irc_channel_print_log (struct t_irc_channel *channel)
     weechat_log_printf ("       cycle. . . . . . . . . . : %d", channel->cycle);
     weechat_log_printf ("       part . . . . . . . . . . : %d", channel->part);
     weechat_log_printf ("       nick_completion_reset. . : %d", channel->nick_completion_reset);
+    weechat_log_printf ("       print_batch. . . . . . . : %d", channel->print_batch);
     weechat_log_printf ("       pv_remote_nick_color . . : '%s'", channel->pv_remote_nick_color);
     weechat_log_printf ("       hook_autorejoin. . . . . : %p", channel->hook_autorejoin);
     weechat_log_printf ("       nicks_count. . . . . . . : %d", channel->nicks_count);
     weechat_log_printf ("       nicks. . . . . . . . . . : %p", channel->nicks);
     weechat_log_printf ("       last_nick. . . . . . . . : %p", channel->last_nick);
+    weechat_log_printf ("       nicks_index. . . . . . . : %p", channel->nicks_index);
+    weechat_log_printf ("       nicks_index_collisions . : %d", channel->nicks_index_collisions);
     weechat_log_printf ("       nicks_speaking[0]. . . . : %p", channel->nicks_speaking[0]);
     weechat_log_printf ("       nicks_speaking[1]. . . . : %p", channel->nicks_speaking[1]);
     weechat_log_printf ("       nicks_speaking_time. . . : %p", channel->nicks_speaking_time);
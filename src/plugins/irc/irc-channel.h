@@ -69,11 +69,16 @@ struct t_irc_channel
     int part;                          /* /part done on channel?            */
     int nick_completion_reset;         /* 1 for resetting nick completion   */
                                        /* there was some join/part on chan  */
+    int print_batch;                   /* 1 if batch of lines started by    */
+                                       /* server in channel buffer          */
     char *pv_remote_nick_color;        /* color for remote nick in pv       */
     struct t_hook *hook_autorejoin;    /* this time+delay = autorejoin time */
     int nicks_count;                   /* # nicks on channel (0 if pv)      */
     struct t_irc_nick *nicks;          /* nicks on the channel              */
     struct t_irc_nick *last_nick;      /* last nick on the channel          */
+    struct t_hashtable *nicks_index;   /* nicks by name (casemapped)        */
+    int nicks_index_collisions;        /* nicks not indexed because another */
+                                       /* nick has same casemapped name     */
     struct t_weelist *nicks_speaking[2]; /* for smart completion: first     */
                                        /* list is nick speaking, second is  */
                                        /* speaking to me (highlight)        */
@@ -1152,6 +1152,7 @@ irc_config_server_default_change_cb (const void *pointer, void *data,
                                               weechat_config_string (option));
                         break;
                     case IRC_SERVER_OPTION_ANTI_FLOOD:
+                    case IRC_SERVER_OPTION_ANTI_FLOOD_BURST:
                         if (ptr_server->hook_timer_anti_flood)
                         {
                             irc_server_outqueue_timer_remove (ptr_server);
@@ -1454,6 +1455,7 @@ irc_config_server_change_cb (const void *pointer, void *data,
                                                  IRC_SERVER_OPTION_NICKS));
                     break;
                 case IRC_SERVER_OPTION_ANTI_FLOOD:
+                case IRC_SERVER_OPTION_ANTI_FLOOD_BURST:
                     if (ptr_server->hook_timer_anti_flood)
                     {
                         irc_server_outqueue_timer_remove (ptr_server);
@@ -2598,6 +2600,27 @@ irc_config_server_new_option (struct t_config_file *config_file,
                 callback_change_data,
                 NULL, NULL, NULL);
             break;
+        case IRC_SERVER_OPTION_ANTI_FLOOD_BURST:
+            new_option = weechat_config_new_option (
+                config_file, section,
+                option_name, "integer",
+                N_("max number of messages that can be sent at once to the "
+                   "server before the anti-flood delay applies (token bucket: "
+                   "one message is allowed again every \"anti_flood\" "
+                   "milliseconds, up to this number); consecutive MODE or "
+                   "KICK messages for the same channel waiting in queues are "
+                   "merged into a single message when possible"),
+                NULL, 1, 100,
+                default_value, value,
+                null_value_allowed,
+                callback_check_value,
+                callback_check_value_pointer,
+                callback_check_value_data,
+                callback_change,
+                callback_change_pointer,
+                callback_change_data,
+                NULL, NULL, NULL);
+            break;
         case IRC_SERVER_OPTION_AWAY_CHECK:
             new_option = weechat_config_new_option (
                 config_file, section,
@@ -21,6 +21,7 @@
 
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "../weechat-plugin.h"
@@ -33,6 +34,17 @@
 struct t_irc_ignore *irc_ignore_list = NULL; /* list of ignore              */
 struct t_irc_ignore *last_irc_ignore = NULL; /* last ignore in list         */
 
+/*
+ * matcher built with the list of ignores: ignores matching only one text are
+ * stored by text, other ignores by server (these ones are checked with the
+ * regex, after a check of the prefix); the result of last checks is kept in
+ * a cache, cleared when an ignore is added or removed
+ */
+struct t_hashtable *irc_ignore_exact = NULL;     /* text -> ignores         */
+struct t_hashtable *irc_ignore_by_server = NULL; /* server -> ignores       */
+struct t_hashtable *irc_ignore_cache = NULL;     /* message -> result       */
+int irc_ignore_matcher_ok = 0;                   /* 0 if must be rebuilt    */
+
 
 /*
  * Checks if an ignore pointer is valid.
@@ -118,6 +130,249 @@ irc_ignore_search_by_number (int number)
     return NULL;
 }
 
+/*
+ * Converts upper case ASCII chars of a string to lower case (other chars are
+ * unchanged).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_ignore_lower (const char *string)
+{
+    char *result, *ptr_result;
+
+    if (!string)
+        return NULL;
+
+    result = strdup (string);
+    if (!result)
+        return NULL;
+
+    for (ptr_result = result; ptr_result[0]; ptr_result++)
+    {
+        if ((ptr_result[0] >= 'A') && (ptr_result[0] <= 'Z'))
+            ptr_result[0] += 'a' - 'A';
+    }
+
+    return result;
+}
+
+/*
+ * Extracts from an ignore regex the text at the beginning of all strings
+ * that can match, and the whole text if the regex matches only this text
+ * (for example "^nick$"), ignoring case.
+ *
+ * Only ASCII chars are extracted; the regex must begin with "^" and must not
+ * contain "|".
+ *
+ * If the regex matches only one text, "exact" is set to this text (in lower
+ * case) and "prefix" is set to NULL, otherwise "exact" is set to NULL and
+ * "prefix" to the text at the beginning (or NULL if there is no such text).
+ *
+ * Note: exact and prefix must be freed after use.
+ */
+
+void
+irc_ignore_parse_mask (const char *mask, char **exact, char **prefix)
+{
+    const char *ptr_mask, *ptr_next;
+    char *text, *regex_special_char = ".[]{}()?+*|^$\\";
+    int length;
+
+    if (exact)
+        *exact = NULL;
+    if (prefix)
+        *prefix = NULL;
+
+    if (!mask || (mask[0] != '^') || !exact || !prefix)
+        return;
+
+    /* alternative with "|": matching strings can begin with anything */
+    for (ptr_mask = mask; ptr_mask[0]; ptr_mask++)
+    {
+        if (ptr_mask[0] == '\\')
+        {
+            if (!ptr_mask[1])
+                break;
+            ptr_mask++;
+        }
+        else if (ptr_mask[0] == '|')
+        {
+            return;
+        }
+    }
+
+    text = malloc (strlen (mask) + 1);
+    if (!text)
+        return;
+
+    length = 0;
+    ptr_mask = mask + 1;
+    while (ptr_mask[0] && ((ptr_mask[0] != '$') || ptr_mask[1]))
+    {
+        if (ptr_mask[0] == '\\')
+        {
+            /* escaped special char (but not a class like "\w") */
+            if (!ptr_mask[1] || !strchr (regex_special_char, ptr_mask[1]))
+                break;
+            text[length] = ptr_mask[1];
+            ptr_next = ptr_mask + 2;
+        }
+        else
+        {
+            if (((unsigned char)ptr_mask[0] >= 128)
+                || strchr (regex_special_char, ptr_mask[0]))
+            {
+                break;
+            }
+            text[length] = ptr_mask[0];
+            ptr_next = ptr_mask + 1;
+        }
+        /* char followed by a quantifier is optional or repeated */
+        if (ptr_next[0] && strchr ("?*+{", ptr_next[0]))
+            break;
+        if ((text[length] >= 'A') && (text[length] <= 'Z'))
+            text[length] += 'a' - 'A';
+        length++;
+        ptr_mask = ptr_next;
+    }
+    text[length] = '\0';
+
+    if ((ptr_mask[0] == '$') && !ptr_mask[1])
+        *exact = text;
+    else if (length > 0)
+        *prefix = text;
+    else
+        free (text);
+}
+
+/*
+ * Marks the matcher as invalid (it is built again on next check) and clears
+ * the cache of results.
+ */
+
+void
+irc_ignore_matcher_invalidate ()
+{
+    irc_ignore_matcher_ok = 0;
+
+    if (irc_ignore_cache)
+        weechat_hashtable_remove_all (irc_ignore_cache);
+}
+
+/*
+ * Frees an arraylist of ignores in a hashtable of matcher.
+ */
+
+void
+irc_ignore_matcher_free_value_cb (struct t_hashtable *hashtable,
+                                  const void *key, const void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    weechat_arraylist_free ((struct t_arraylist *)value);
+}
+
+/*
+ * Creates a hashtable for matcher (keys are strings, values are arraylists
+ * of ignores).
+ */
+
+struct t_hashtable *
+irc_ignore_matcher_hashtable_new ()
+{
+    struct t_hashtable *hashtable;
+
+    hashtable = weechat_hashtable_new (32,
+                                       WEECHAT_HASHTABLE_STRING,
+                                       WEECHAT_HASHTABLE_POINTER,
+                                       NULL, NULL);
+    if (hashtable)
+    {
+        weechat_hashtable_set_pointer (hashtable,
+                                       "callback_free_value",
+                                       &irc_ignore_matcher_free_value_cb);
+    }
+
+    return hashtable;
+}
+
+/*
+ * Builds the matcher with the list of ignores: ignores with an exact text
+ * are stored by text, other ignores are stored by server name ("*" for any
+ * server).
+ *
+ * If an error occurs, the matcher stays invalid and irc_ignore_check uses
+ * the list of ignores.
+ */
+
+void
+irc_ignore_matcher_build ()
+{
+    struct t_irc_ignore *ptr_ignore;
+    struct t_hashtable *ptr_hashtable;
+    struct t_arraylist *ptr_list;
+    const char *key;
+
+    irc_ignore_matcher_invalidate ();
+
+    if (!irc_ignore_exact)
+        irc_ignore_exact = irc_ignore_matcher_hashtable_new ();
+    if (!irc_ignore_by_server)
+        irc_ignore_by_server = irc_ignore_matcher_hashtable_new ();
+    if (!irc_ignore_cache)
+    {
+        irc_ignore_cache = weechat_hashtable_new (256,
+                                                  WEECHAT_HASHTABLE_STRING,
+                                                  WEECHAT_HASHTABLE_INTEGER,
+                                                  NULL, NULL);
+    }
+    if (!irc_ignore_exact || !irc_ignore_by_server || !irc_ignore_cache)
+        return;
+
+    weechat_hashtable_remove_all (irc_ignore_exact);
+    weechat_hashtable_remove_all (irc_ignore_by_server);
+
+    for (ptr_ignore = irc_ignore_list; ptr_ignore;
+         ptr_ignore = ptr_ignore->next_ignore)
+    {
+        ptr_hashtable = (ptr_ignore->exact) ?
+            irc_ignore_exact : irc_ignore_by_server;
+        key = (ptr_ignore->exact) ? ptr_ignore->exact : ptr_ignore->server;
+        ptr_list = weechat_hashtable_get (ptr_hashtable, key);
+        if (!ptr_list)
+        {
+            ptr_list = weechat_arraylist_new (4, 0, 1,
+                                              NULL, NULL, NULL, NULL);
+            if (!ptr_list)
+                return;
+            weechat_hashtable_set (ptr_hashtable, key, ptr_list);
+        }
+        weechat_arraylist_add (ptr_list, ptr_ignore);
+    }
+
+    irc_ignore_matcher_ok = 1;
+}
+
+/*
+ * Frees the matcher.
+ */
+
+void
+irc_ignore_matcher_free ()
+{
+    weechat_hashtable_free (irc_ignore_exact);
+    irc_ignore_exact = NULL;
+    weechat_hashtable_free (irc_ignore_by_server);
+    irc_ignore_by_server = NULL;
+    weechat_hashtable_free (irc_ignore_cache);
+    irc_ignore_cache = NULL;
+    irc_ignore_matcher_ok = 0;
+}
+
 /*
  * Adds a new ignore.
  *
@@ -150,6 +405,9 @@ irc_ignore_new (const char *mask, const char *server, const char *channel)
         new_ignore->number = (last_irc_ignore) ? last_irc_ignore->number + 1 : 1;
         new_ignore->mask = strdup (mask);
         new_ignore->regex_mask = regex;
+        irc_ignore_parse_mask (mask, &new_ignore->exact, &new_ignore->prefix);
+        new_ignore->prefix_length = (new_ignore->prefix) ?
+            strlen (new_ignore->prefix) : 0;
         new_ignore->server = (server) ? strdup (server) : strdup ("*");
         new_ignore->channel = (channel) ? strdup (channel) : strdup ("*");
 
@@ -161,6 +419,8 @@ irc_ignore_new (const char *mask, const char *server, const char *channel)
             irc_ignore_list = new_ignore;
         last_irc_ignore = new_ignore;
         new_ignore->next_ignore = NULL;
+
+        irc_ignore_matcher_invalidate ();
     }
 
     return new_ignore;
@@ -209,6 +469,28 @@ irc_ignore_check_channel (struct t_irc_ignore *ignore,
     return 0;
 }
 
+/*
+ * Checks if a string matches the regex of an ignore (the prefix of ignore is
+ * checked first, to skip the regex if the string can not match).
+ *
+ * Returns:
+ *   1: ignore matches the string
+ *   0: ignore does not match the string
+ */
+
+int
+irc_ignore_check_regex (struct t_irc_ignore *ignore, const char *string)
+{
+    if (ignore->prefix
+        && (weechat_strncasecmp (string, ignore->prefix,
+                                 ignore->prefix_length) != 0))
+    {
+        return 0;
+    }
+
+    return (regexec (ignore->regex_mask, string, 0, NULL, 0) == 0) ? 1 : 0;
+}
+
 /*
  * Checks if an ignore matches a host.
  *
@@ -223,22 +505,98 @@ irc_ignore_check_host (struct t_irc_ignore *ignore,
 {
     const char *pos;
 
-    if (nick && (regexec (ignore->regex_mask, nick, 0, NULL, 0) == 0))
+    if (nick && irc_ignore_check_regex (ignore, nick))
         return 1;
 
     if (host)
     {
-        if (regexec (ignore->regex_mask, host, 0, NULL, 0) == 0)
+        if (irc_ignore_check_regex (ignore, host))
             return 1;
 
         if (!strchr (ignore->mask, '!'))
         {
             pos = strchr (host, '!');
-            if (pos && (regexec (ignore->regex_mask, pos + 1,
-                                 0, NULL, 0) == 0))
-            {
+            if (pos && irc_ignore_check_regex (ignore, pos + 1))
                 return 1;
-            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Checks if ignores with an exact text match a nick, a host or a
+ * "user@host" (if user_host == 1).
+ *
+ * Returns:
+ *   1: an ignore matches the text
+ *   0: no ignore matches the text
+ */
+
+int
+irc_ignore_check_exact (struct t_irc_server *server, const char *channel,
+                        const char *nick, const char *text, int user_host)
+{
+    struct t_arraylist *ptr_list;
+    struct t_irc_ignore *ptr_ignore;
+    char *text_lower;
+    int i, size;
+
+    if (!text)
+        return 0;
+
+    text_lower = irc_ignore_lower (text);
+    if (!text_lower)
+        return 0;
+    ptr_list = weechat_hashtable_get (irc_ignore_exact, text_lower);
+    free (text_lower);
+    if (!ptr_list)
+        return 0;
+
+    size = weechat_arraylist_size (ptr_list);
+    for (i = 0; i < size; i++)
+    {
+        ptr_ignore = (struct t_irc_ignore *)weechat_arraylist_get (ptr_list, i);
+        if (user_host && strchr (ptr_ignore->mask, '!'))
+            continue;
+        if (irc_ignore_check_server (ptr_ignore, server->name)
+            && irc_ignore_check_channel (ptr_ignore, server, channel, nick))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Checks if ignores of an arraylist match a nick or host.
+ *
+ * Returns:
+ *   1: an ignore matches
+ *   0: no ignore matches
+ */
+
+int
+irc_ignore_check_list (struct t_arraylist *list, struct t_irc_server *server,
+                       const char *channel, const char *nick,
+                       const char *host)
+{
+    struct t_irc_ignore *ptr_ignore;
+    int i, size;
+
+    if (!list)
+        return 0;
+
+    size = weechat_arraylist_size (list);
+    for (i = 0; i < size; i++)
+    {
+        ptr_ignore = (struct t_irc_ignore *)weechat_arraylist_get (list, i);
+        if (irc_ignore_check_server (ptr_ignore, server->name)
+            && irc_ignore_check_channel (ptr_ignore, server, channel, nick)
+            && irc_ignore_check_host (ptr_ignore, nick, host))
+        {
+            return 1;
         }
     }
 
@@ -258,8 +616,11 @@ irc_ignore_check (struct t_irc_server *server, const char *channel,
                   const char *nick, const char *host)
 {
     struct t_irc_ignore *ptr_ignore;
+    char str_key[1024];
+    const char *pos;
+    int *ptr_rc, rc, length;
 
-    if (!server)
+    if (!server || !irc_ignore_list)
         return 0;
 
     /*
@@ -272,18 +633,66 @@ irc_ignore_check (struct t_irc_server *server, const char *channel,
         return 0;
     }
 
-    for (ptr_ignore = irc_ignore_list; ptr_ignore;
-         ptr_ignore = ptr_ignore->next_ignore)
+    if (!irc_ignore_matcher_ok)
+        irc_ignore_matcher_build ();
+
+    if (!irc_ignore_matcher_ok)
     {
-        if (irc_ignore_check_server (ptr_ignore, server->name)
-            && irc_ignore_check_channel (ptr_ignore, server, channel, nick))
+        for (ptr_ignore = irc_ignore_list; ptr_ignore;
+             ptr_ignore = ptr_ignore->next_ignore)
         {
-            if (irc_ignore_check_host (ptr_ignore, nick, host))
-                return 1;
+            if (irc_ignore_check_server (ptr_ignore, server->name)
+                && irc_ignore_check_channel (ptr_ignore, server, channel, nick))
+            {
+                if (irc_ignore_check_host (ptr_ignore, nick, host))
+                    return 1;
+            }
         }
+        return 0;
     }
 
-    return 0;
+    /* search result in cache ("c"/"n" before channel: channel or nick) */
+    length = snprintf (str_key, sizeof (str_key), "%s\t%s%s\t%s%s\t%s%s",
+                       server->name,
+                       (!channel) ? "" :
+                       (irc_channel_is_channel (server, channel)) ? "c" : "n",
+                       (channel) ? channel : "",
+                       (nick) ? "+" : "",
+                       (nick) ? nick : "",
+                       (host) ? "+" : "",
+                       (host) ? host : "");
+    if ((length < 0) || (length >= (int)sizeof (str_key)))
+        str_key[0] = '\0';
+    if (str_key[0])
+    {
+        ptr_rc = weechat_hashtable_get (irc_ignore_cache, str_key);
+        if (ptr_rc)
+            return *ptr_rc;
+    }
+
+    pos = (host) ? strchr (host, '!') : NULL;
+    rc = (irc_ignore_check_exact (server, channel, nick, nick, 0)
+          || irc_ignore_check_exact (server, channel, nick, host, 0)
+          || (pos && irc_ignore_check_exact (server, channel, nick, pos + 1, 1))
+          || irc_ignore_check_list (
+              weechat_hashtable_get (irc_ignore_by_server, "*"),
+              server, channel, nick, host)
+          || ((strcmp (server->name, "*") != 0)
+              && irc_ignore_check_list (
+                  weechat_hashtable_get (irc_ignore_by_server, server->name),
+                  server, channel, nick, host))) ? 1 : 0;
+
+    if (str_key[0])
+    {
+        if (weechat_hashtable_get_integer (
+                irc_ignore_cache, "items_count") >= IRC_IGNORE_CACHE_SIZE)
+        {
+            weechat_hashtable_remove_all (irc_ignore_cache);
+        }
+        weechat_hashtable_set (irc_ignore_cache, str_key, &rc);
+    }
+
+    return rc;
 }
 
 /*
@@ -315,6 +724,8 @@ irc_ignore_free (struct t_irc_ignore *ignore)
         regfree (ignore->regex_mask);
         free (ignore->regex_mask);
     }
+    free (ignore->exact);
+    free (ignore->prefix);
     free (ignore->server);
     free (ignore->channel);
 
@@ -330,6 +741,8 @@ irc_ignore_free (struct t_irc_ignore *ignore)
 
     free (ignore);
 
+    irc_ignore_matcher_invalidate ();
+
     (void) weechat_hook_signal_send ("irc_ignore_removed",
                                      WEECHAT_HOOK_SIGNAL_STRING, NULL);
 }
@@ -345,6 +758,8 @@ irc_ignore_free_all ()
     {
         irc_ignore_free (irc_ignore_list);
     }
+
+    irc_ignore_matcher_free ();
 }
 
 /*
@@ -368,6 +783,9 @@ irc_ignore_hdata_ignore_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_ignore, number, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_ignore, mask, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_ignore, regex_mask, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_ignore, exact, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_ignore, prefix, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_ignore, prefix_length, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_ignore, server, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_ignore, channel, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_ignore, prev_ignore, POINTER, 0, NULL, hdata_name);
@@ -426,6 +844,9 @@ irc_ignore_print_log ()
         weechat_log_printf ("  number . . . . . . . : %d", ptr_ignore->number);
         weechat_log_printf ("  mask . . . . . . . . : '%s'", ptr_ignore->mask);
         weechat_log_printf ("  regex_mask . . . . . : %p", ptr_ignore->regex_mask);
+        weechat_log_printf ("  exact. . . . . . . . : '%s'", ptr_ignore->exact);
+        weechat_log_printf ("  prefix . . . . . . . : '%s'", ptr_ignore->prefix);
+        weechat_log_printf ("  prefix_length. . . . : %d", ptr_ignore->prefix_length);
         weechat_log_printf ("  server . . . . . . . : '%s'", ptr_ignore->server);
         weechat_log_printf ("  channel. . . . . . . : '%s'", ptr_ignore->channel);
         weechat_log_printf ("  prev_ignore. . . . . : %p", ptr_ignore->prev_ignore);
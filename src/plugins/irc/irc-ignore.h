@@ -22,6 +22,9 @@
 
 #include <regex.h>
 
+/* max number of results kept in cache of irc_ignore_check */
+#define IRC_IGNORE_CACHE_SIZE 4096
+
 struct t_irc_server;
 struct t_irc_channel;
 
@@ -30,6 +33,11 @@ struct t_irc_ignore
     int number;                        /* ignore number                     */
     char *mask;                        /* nick / host mask                  */
     regex_t *regex_mask;               /* regex for mask                    */
+    char *exact;                       /* lower case text if mask matches   */
+                                       /* only this text ("^text$")         */
+    char *prefix;                      /* lower case text at beginning of   */
+                                       /* all strings matching the mask     */
+    int prefix_length;                 /* length of prefix                  */
     char *server;                      /* server name ("*" == any server)   */
     char *channel;                     /* channel name ("*" == any channel) */
     struct t_irc_ignore *prev_ignore;  /* link to previous ignore           */
@@ -44,6 +52,8 @@ extern struct t_irc_ignore *irc_ignore_search (const char *mask,
                                                const char *server,
                                                const char *channel);
 extern struct t_irc_ignore *irc_ignore_search_by_number (int number);
+extern void irc_ignore_parse_mask (const char *mask, char **exact,
+                                   char **prefix);
 extern struct t_irc_ignore *irc_ignore_new (const char *mask,
                                             const char *server,
                                             const char *channel);
@@ -55,6 +65,9 @@ extern int irc_ignore_check_channel (struct t_irc_ignore *ignore,
                                      const char *nick);
 extern int irc_ignore_check_host (struct t_irc_ignore *ignore,
                                   const char *nick, const char *host);
+extern void irc_ignore_matcher_invalidate ();
+extern void irc_ignore_matcher_build ();
+extern void irc_ignore_matcher_free ();
 extern int irc_ignore_check (struct t_irc_server *server,
                              const char *channel, const char *nick,
                              const char *host);
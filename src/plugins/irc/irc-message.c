@@ -133,88 +133,72 @@ irc_message_parse_params (const char *parameters,
 }
 
 /*
- * Parses an IRC message and returns:
- *   - tags (string)
- *   - message without tags (string)
- *   - nick (string)
- *   - user (string)
- *   - host (string)
- *   - command (string)
- *   - channel (string)
- *   - arguments (string)
- *   - text (string)
- *   - params (array of strings)
- *   - num_params (integer)
- *   - pos_command (integer: command index in message)
- *   - pos_arguments (integer: arguments index in message)
- *   - pos_channel (integer: channel index in message)
- *   - pos_text (integer: text index in message)
+ * Sets position and length of a part of IRC message.
+ */
+
+void
+irc_message_span_set (struct t_irc_message_span *span,
+                      const char *message, const char *start, const char *end)
+{
+    span->pos = start - message;
+    span->length = end - start;
+}
+
+/*
+ * Parses an IRC message and returns position and length of each part of
+ * message (no copy of the message is done):
+ *   - tags
+ *   - message without tags
+ *   - nick
+ *   - user
+ *   - host
+ *   - command
+ *   - channel
+ *   - arguments
+ *   - text
+ *
+ * A part not found in message has position -1 (and length 0).
  *
  * Example:
  *   @time=2015-06-27T16:40:35.000Z :nick!user@host PRIVMSG #weechat :Hello world!
  *
- * Result:
- *               tags: "time=2015-06-27T16:40:35.000Z"
- *   msg_without_tags: ":nick!user@host PRIVMSG #weechat :Hello world!"
- *               nick: "nick"
- *               user: "user"
- *               host: "nick!user@host"
- *            command: "PRIVMSG"
- *            channel: "#weechat"
- *          arguments: "#weechat :Hello world!"
- *               text: "Hello world!"
- *        pos_command: 47
- *      pos_arguments: 55
- *        pos_channel: 55
- *           pos_text: 65
+ * Result (position, length):
+ *               tags: 1, 29   "time=2015-06-27T16:40:35.000Z"
+ *   msg_without_tags: 31, 46  ":nick!user@host PRIVMSG #weechat :Hello world!"
+ *               nick: 32, 4   "nick"
+ *               user: 37, 4   "user"
+ *               host: 32, 14  "nick!user@host"
+ *            command: 47, 7   "PRIVMSG"
+ *            channel: 55, 8   "#weechat"
+ *          arguments: 55, 22  "#weechat :Hello world!"
+ *               text: 65, 12  "Hello world!"
  */
 
 void
-irc_message_parse (struct t_irc_server *server, const char *message,
-                   char **tags, char **message_without_tags, char **nick,
-                   char **user, char **host, char **command, char **channel,
-                   char **arguments, char **text,
-                   char ***params, int *num_params,
-                   int *pos_command, int *pos_arguments, int *pos_channel,
-                   int *pos_text)
+irc_message_parse_spans (struct t_irc_server *server, const char *message,
+                         struct t_irc_message_spans *spans)
 {
-    const char *ptr_message, *pos, *pos2, *pos3, *pos4;
+    const char *ptr_message, *ptr_end, *pos, *pos2, *pos3, *pos4;
 
-    if (tags)
-        *tags = NULL;
-    if (message_without_tags)
-        *message_without_tags = NULL;
-    if (nick)
-        *nick = NULL;
-    if (user)
-        *user = NULL;
-    if (host)
-        *host = NULL;
-    if (command)
-        *command = NULL;
-    if (channel)
-        *channel = NULL;
-    if (arguments)
-        *arguments = NULL;
-    if (text)
-        *text = NULL;
-    if (params)
-        *params = NULL;
-    if (num_params)
-        *num_params = 0;
-    if (pos_command)
-        *pos_command = -1;
-    if (pos_arguments)
-        *pos_arguments = -1;
-    if (pos_channel)
-        *pos_channel = -1;
-    if (pos_text)
-        *pos_text = -1;
+    if (!spans)
+        return;
+
+    spans->tags.pos = -1;
+    spans->tags.length = 0;
+    spans->message_without_tags = spans->tags;
+    spans->nick = spans->tags;
+    spans->user = spans->tags;
+    spans->host = spans->tags;
+    spans->command = spans->tags;
+    spans->channel = spans->tags;
+    spans->arguments = spans->tags;
+    spans->text = spans->tags;
 
     if (!message)
         return;
 
     ptr_message = message;
+    ptr_end = message + strlen (message);
 
     /*
      * we will use this message as example:
@@ -232,11 +216,7 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         pos = strchr (ptr_message, ' ');
         if (pos)
         {
-            if (tags)
-            {
-                *tags = weechat_strndup (ptr_message + 1,
-                                         pos - (ptr_message + 1));
-            }
+            irc_message_span_set (&spans->tags, message, ptr_message + 1, pos);
             ptr_message = pos + 1;
             while (ptr_message[0] == ' ')
             {
@@ -245,8 +225,8 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         }
     }
 
-    if (message_without_tags)
-        *message_without_tags = strdup (ptr_message);
+    irc_message_span_set (&spans->message_without_tags, message,
+                          ptr_message, ptr_end);
 
     /* now we have: ptr_message --> ":nick!user@host PRIVMSG #weechat :Hello world!" */
     if (ptr_message[0] == ':')
@@ -259,24 +239,14 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         if (!pos2 || (pos && pos2 > pos))
             pos2 = pos3;
         if (pos2 && pos3 && (pos3 > pos2))
-        {
-            if (user)
-                *user = weechat_strndup (pos2 + 1, pos3 - pos2 - 1);
-        }
+            irc_message_span_set (&spans->user, message, pos2 + 1, pos3);
         if (pos2 && (!pos || pos > pos2))
-        {
-            if (nick)
-                *nick = weechat_strndup (ptr_message + 1, pos2 - (ptr_message + 1));
-        }
+            irc_message_span_set (&spans->nick, message, ptr_message + 1, pos2);
         else if (pos)
-        {
-            if (nick)
-                *nick = weechat_strndup (ptr_message + 1, pos - (ptr_message + 1));
-        }
+            irc_message_span_set (&spans->nick, message, ptr_message + 1, pos);
         if (pos)
         {
-            if (host)
-                *host = weechat_strndup (ptr_message + 1, pos - (ptr_message + 1));
+            irc_message_span_set (&spans->host, message, ptr_message + 1, pos);
             ptr_message = pos + 1;
             while (ptr_message[0] == ' ')
             {
@@ -285,151 +255,197 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         }
         else
         {
-            if (host)
-                *host = strdup (ptr_message + 1);
-            ptr_message += strlen (ptr_message);
+            irc_message_span_set (&spans->host, message,
+                                  ptr_message + 1, ptr_end);
+            ptr_message = ptr_end;
         }
     }
 
     /* now we have: ptr_message --> "PRIVMSG #weechat :Hello world!" */
-    if (ptr_message[0])
+    if (!ptr_message[0])
+        return;
+
+    pos = strchr (ptr_message, ' ');
+    if (!pos)
     {
-        pos = strchr (ptr_message, ' ');
-        if (pos)
+        irc_message_span_set (&spans->command, message, ptr_message, ptr_end);
+        return;
+    }
+
+    irc_message_span_set (&spans->command, message, ptr_message, pos);
+    pos++;
+    while (pos[0] == ' ')
+    {
+        pos++;
+    }
+    /* now we have: pos --> "#weechat :Hello world!" */
+    irc_message_span_set (&spans->arguments, message, pos, ptr_end);
+    if ((pos[0] == ':')
+        && ((strncmp (ptr_message, "JOIN ", 5) == 0)
+            || (strncmp (ptr_message, "PART ", 5) == 0)))
+    {
+        pos++;
+    }
+    if (pos[0] == ':')
+    {
+        irc_message_span_set (&spans->text, message, pos + 1, ptr_end);
+        return;
+    }
+    if (irc_channel_is_channel (server, pos))
+    {
+        pos2 = strchr (pos, ' ');
+        irc_message_span_set (&spans->channel, message,
+                              pos, (pos2) ? pos2 : ptr_end);
+        if (pos2)
         {
-            if (command)
-                *command = weechat_strndup (ptr_message, pos - ptr_message);
-            if (pos_command)
-                *pos_command = ptr_message - message;
-            pos++;
-            while (pos[0] == ' ')
-            {
-                pos++;
-            }
-            /* now we have: pos --> "#weechat :Hello world!" */
-            if (arguments)
-                *arguments = strdup (pos);
-            if (pos_arguments)
-                *pos_arguments = pos - message;
-            irc_message_parse_params (pos, params, num_params);
-            if ((pos[0] == ':')
-                && ((strncmp (ptr_message, "JOIN ", 5) == 0)
-                    || (strncmp (ptr_message, "PART ", 5) == 0)))
+            while (pos2[0] == ' ')
             {
-                pos++;
-            }
-            if (pos[0] == ':')
-            {
-                if (text)
-                    *text = strdup (pos + 1);
-                if (pos_text)
-                    *pos_text = pos - message + 1;
-            }
-            else
-            {
-                if (irc_channel_is_channel (server, pos))
-                {
-                    pos2 = strchr (pos, ' ');
-                    if (channel)
-                    {
-                        if (pos2)
-                            *channel = weechat_strndup (pos, pos2 - pos);
-                        else
-                            *channel = strdup (pos);
-                    }
-                    if (pos_channel)
-                        *pos_channel = pos - message;
-                    if (pos2)
-                    {
-                        while (pos2[0] == ' ')
-                        {
-                            pos2++;
-                        }
-                        if (pos2[0] == ':')
-                            pos2++;
-                        if (text)
-                            *text = strdup (pos2);
-                        if (pos_text)
-                            *pos_text = pos2 - message;
-                    }
-                }
-                else
-                {
-                    pos2 = strchr (pos, ' ');
-                    if (nick && !*nick)
-                    {
-                        if (pos2)
-                            *nick = weechat_strndup (pos, pos2 - pos);
-                        else
-                            *nick = strdup (pos);
-                    }
-                    if (pos2)
-                    {
-                        pos3 = pos2;
-                        pos2++;
-                        while (pos2[0] == ' ')
-                        {
-                            pos2++;
-                        }
-                        if (irc_channel_is_channel (server, pos2))
-                        {
-                            pos4 = strchr (pos2, ' ');
-                            if (channel)
-                            {
-                                if (pos4)
-                                    *channel = weechat_strndup (pos2, pos4 - pos2);
-                                else
-                                    *channel = strdup (pos2);
-                            }
-                            if (pos_channel)
-                                *pos_channel = pos2 - message;
-                            if (pos4)
-                            {
-                                while (pos4[0] == ' ')
-                                {
-                                    pos4++;
-                                }
-                                if (pos4[0] == ':')
-                                    pos4++;
-                                if (text)
-                                    *text = strdup (pos4);
-                                if (pos_text)
-                                    *pos_text = pos4 - message;
-                            }
-                        }
-                        else
-                        {
-                            if (channel)
-                                *channel = weechat_strndup (pos, pos3 - pos);
-                            if (pos_channel)
-                                *pos_channel = pos - message;
-                            pos4 = strchr (pos3, ' ');
-                            if (pos4)
-                            {
-                                while (pos4[0] == ' ')
-                                {
-                                    pos4++;
-                                }
-                                if (pos4[0] == ':')
-                                    pos4++;
-                                if (text)
-                                    *text = strdup (pos4);
-                                if (pos_text)
-                                    *pos_text = pos4 - message;
-                            }
-                        }
-                    }
-                }
+                pos2++;
             }
+            if (pos2[0] == ':')
+                pos2++;
+            irc_message_span_set (&spans->text, message, pos2, ptr_end);
         }
-        else
+        return;
+    }
+    pos2 = strchr (pos, ' ');
+    if (spans->nick.pos < 0)
+    {
+        irc_message_span_set (&spans->nick, message,
+                              pos, (pos2) ? pos2 : ptr_end);
+    }
+    if (!pos2)
+        return;
+    pos3 = pos2;
+    pos2++;
+    while (pos2[0] == ' ')
+    {
+        pos2++;
+    }
+    if (irc_channel_is_channel (server, pos2))
+    {
+        pos4 = strchr (pos2, ' ');
+        irc_message_span_set (&spans->channel, message,
+                              pos2, (pos4) ? pos4 : ptr_end);
+    }
+    else
+    {
+        irc_message_span_set (&spans->channel, message, pos, pos3);
+        pos4 = strchr (pos3, ' ');
+    }
+    if (pos4)
+    {
+        while (pos4[0] == ' ')
         {
-            if (command)
-                *command = strdup (ptr_message);
-            if (pos_command)
-                *pos_command = ptr_message - message;
+            pos4++;
         }
+        if (pos4[0] == ':')
+            pos4++;
+        irc_message_span_set (&spans->text, message, pos4, ptr_end);
+    }
+}
+
+/*
+ * Returns a copy of a part of IRC message, NULL if the part was not found
+ * in message.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_message_span_dup (const char *message, struct t_irc_message_span *span)
+{
+    if (!message || !span || (span->pos < 0))
+        return NULL;
+
+    return weechat_strndup (message + span->pos, span->length);
+}
+
+/*
+ * Parses an IRC message and returns:
+ *   - tags (string)
+ *   - message without tags (string)
+ *   - nick (string)
+ *   - user (string)
+ *   - host (string)
+ *   - command (string)
+ *   - channel (string)
+ *   - arguments (string)
+ *   - text (string)
+ *   - params (array of strings)
+ *   - num_params (integer)
+ *   - pos_command (integer: command index in message)
+ *   - pos_arguments (integer: arguments index in message)
+ *   - pos_channel (integer: channel index in message)
+ *   - pos_text (integer: text index in message)
+ *
+ * Example:
+ *   @time=2015-06-27T16:40:35.000Z :nick!user@host PRIVMSG #weechat :Hello world!
+ *
+ * Result:
+ *               tags: "time=2015-06-27T16:40:35.000Z"
+ *   msg_without_tags: ":nick!user@host PRIVMSG #weechat :Hello world!"
+ *               nick: "nick"
+ *               user: "user"
+ *               host: "nick!user@host"
+ *            command: "PRIVMSG"
+ *            channel: "#weechat"
+ *          arguments: "#weechat :Hello world!"
+ *               text: "Hello world!"
+ *        pos_command: 47
+ *      pos_arguments: 55
+ *        pos_channel: 55
+ *           pos_text: 65
+ */
+
+void
+irc_message_parse (struct t_irc_server *server, const char *message,
+                   char **tags, char **message_without_tags, char **nick,
+                   char **user, char **host, char **command, char **channel,
+                   char **arguments, char **text,
+                   char ***params, int *num_params,
+                   int *pos_command, int *pos_arguments, int *pos_channel,
+                   int *pos_text)
+{
+    struct t_irc_message_spans spans;
+
+    irc_message_parse_spans (server, message, &spans);
+
+    if (tags)
+        *tags = irc_message_span_dup (message, &spans.tags);
+    if (message_without_tags)
+    {
+        *message_without_tags = irc_message_span_dup (
+            message, &spans.message_without_tags);
     }
+    if (nick)
+        *nick = irc_message_span_dup (message, &spans.nick);
+    if (user)
+        *user = irc_message_span_dup (message, &spans.user);
+    if (host)
+        *host = irc_message_span_dup (message, &spans.host);
+    if (command)
+        *command = irc_message_span_dup (message, &spans.command);
+    if (channel)
+        *channel = irc_message_span_dup (message, &spans.channel);
+    if (arguments)
+        *arguments = irc_message_span_dup (message, &spans.arguments);
+    if (text)
+        *text = irc_message_span_dup (message, &spans.text);
+    if (params || num_params)
+    {
+        irc_message_parse_params (
+            (spans.arguments.pos >= 0) ? message + spans.arguments.pos : NULL,
+            params, num_params);
+    }
+    if (pos_command)
+        *pos_command = spans.command.pos;
+    if (pos_arguments)
+        *pos_arguments = spans.arguments.pos;
+    if (pos_channel)
+        *pos_channel = spans.channel.pos;
+    if (pos_text)
+        *pos_text = spans.text.pos;
 }
 
 /*
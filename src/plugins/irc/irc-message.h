@@ -28,11 +28,39 @@ struct t_irc_message_split_context
                                        /* (+ 1 byte between each message)   */
 };
 
+/* part of an IRC message: position and length in message */
+
+struct t_irc_message_span
+{
+    int pos;                           /* position (-1 if not found)        */
+    int length;                        /* length in bytes                   */
+};
+
+/* parts of an IRC message, without any copy of the message */
+
+struct t_irc_message_spans
+{
+    struct t_irc_message_span tags;    /* tags (without "@")                */
+    struct t_irc_message_span message_without_tags; /* msg without tags     */
+    struct t_irc_message_span nick;    /* nick                              */
+    struct t_irc_message_span user;    /* user                              */
+    struct t_irc_message_span host;    /* host (nick!user@host)             */
+    struct t_irc_message_span command; /* command                           */
+    struct t_irc_message_span channel; /* channel                           */
+    struct t_irc_message_span arguments; /* arguments (up to end of msg)    */
+    struct t_irc_message_span text;    /* text (up to end of message)       */
+};
+
 struct t_irc_server;
 struct t_irc_channel;
 
 extern void irc_message_parse_params (const char *parameters,
                                       char ***params, int *num_params);
+extern void irc_message_parse_spans (struct t_irc_server *server,
+                                     const char *message,
+                                     struct t_irc_message_spans *spans);
+extern char *irc_message_span_dup (const char *message,
+                                   struct t_irc_message_span *span);
 extern void irc_message_parse (struct t_irc_server *server, const char *message,
                                char **tags, char **message_without_tags,
                                char **nick, char **user, char **host,
@@ -517,6 +517,122 @@ irc_nick_nicklist_set_color_all ()
     }
 }
 
+/*
+ * Adds a nick in index of nicks of channel (hashtable with casemapped nick
+ * as key).
+ *
+ * If another nick with same casemapped name is already in index, the index
+ * is not changed (the first nick in list is kept).
+ */
+
+void
+irc_nick_index_add (struct t_irc_server *server,
+                    struct t_irc_channel *channel,
+                    struct t_irc_nick *nick)
+{
+    char *key;
+
+    if (!channel || !nick || !nick->name)
+        return;
+
+    if (!channel->nicks_index)
+    {
+        channel->nicks_index = weechat_hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+        if (!channel->nicks_index)
+            return;
+    }
+
+    key = irc_server_string_casemap (server, nick->name);
+    if (!key)
+        return;
+
+    if (weechat_hashtable_has_key (channel->nicks_index, key))
+        channel->nicks_index_collisions++;
+    else
+        weechat_hashtable_set (channel->nicks_index, key, nick);
+
+    free (key);
+}
+
+/*
+ * Removes a nick from index of nicks of channel.
+ *
+ * If another nick of channel has the same casemapped name (not indexed),
+ * it is indexed instead of the nick removed.
+ */
+
+void
+irc_nick_index_remove (struct t_irc_server *server,
+                       struct t_irc_channel *channel,
+                       struct t_irc_nick *nick)
+{
+    struct t_irc_nick *ptr_nick, *ptr_nick_indexed;
+    char *key;
+
+    if (!channel || !channel->nicks_index || !nick || !nick->name)
+        return;
+
+    key = irc_server_string_casemap (server, nick->name);
+    if (!key)
+        return;
+
+    ptr_nick_indexed = weechat_hashtable_get (channel->nicks_index, key);
+    if (ptr_nick_indexed == nick)
+    {
+        weechat_hashtable_remove (channel->nicks_index, key);
+        if (channel->nicks_index_collisions > 0)
+        {
+            for (ptr_nick = channel->nicks; ptr_nick;
+                 ptr_nick = ptr_nick->next_nick)
+            {
+                if ((ptr_nick != nick)
+                    && (irc_server_strcasecmp (server, ptr_nick->name,
+                                               nick->name) == 0))
+                {
+                    weechat_hashtable_set (channel->nicks_index, key,
+                                           ptr_nick);
+                    channel->nicks_index_collisions--;
+                    break;
+                }
+            }
+        }
+    }
+    else if (ptr_nick_indexed && (channel->nicks_index_collisions > 0))
+    {
+        /* nick was not indexed because of another nick with same key */
+        channel->nicks_index_collisions--;
+    }
+
+    free (key);
+}
+
+/*
+ * Rebuilds index of nicks of channel (called when the casemapping of server
+ * has changed).
+ */
+
+void
+irc_nick_index_rebuild (struct t_irc_server *server,
+                        struct t_irc_channel *channel)
+{
+    struct t_irc_nick *ptr_nick;
+
+    if (!channel || !channel->nicks_index)
+        return;
+
+    weechat_hashtable_remove_all (channel->nicks_index);
+    channel->nicks_index_collisions = 0;
+
+    for (ptr_nick = channel->nicks; ptr_nick; ptr_nick = ptr_nick->next_nick)
+    {
+        irc_nick_index_add (server, channel, ptr_nick);
+    }
+}
+
 /*
  * Adds a new nick in channel, but do not update the buffer nicklist.
  * This function is only called by the function `irc_nick_new` (below) and
@@ -580,6 +696,8 @@ irc_nick_new_in_channel (struct t_irc_server *server,
     channel->last_nick = new_nick;
     new_nick->next_nick = NULL;
 
+    irc_nick_index_add (server, channel, new_nick);
+
     channel->nicks_count++;
 
     channel->nick_completion_reset = 1;
@@ -653,8 +771,10 @@ irc_nick_change (struct t_irc_server *server, struct t_irc_channel *channel,
         irc_channel_nick_speaking_rename (channel, nick->name, new_nick);
 
     /* change nickname */
+    irc_nick_index_remove (server, channel, nick);
     free (nick->name);
     nick->name = strdup (new_nick);
+    irc_nick_index_add (server, channel, nick);
     free (nick->color);
     if (nick_is_me)
         nick->color = strdup (IRC_COLOR_CHAT_NICK_SELF);
@@ -762,6 +882,7 @@ irc_nick_free (struct t_irc_server *server, struct t_irc_channel *channel,
     irc_nick_nicklist_remove (server, channel, nick);
 
     /* remove nick */
+    irc_nick_index_remove (server, channel, nick);
     if (channel->last_nick == nick)
         channel->last_nick = nick->prev_nick;
     if (nick->prev_nick)
@@ -829,19 +950,20 @@ irc_nick_search (struct t_irc_server *server, struct t_irc_channel *channel,
                  const char *nickname)
 {
     struct t_irc_nick *ptr_nick;
+    char *key;
 
-    if (!channel || !nickname)
+    if (!channel || !nickname || !channel->nicks_index)
         return NULL;
 
-    for (ptr_nick = channel->nicks; ptr_nick;
-         ptr_nick = ptr_nick->next_nick)
-    {
-        if (irc_server_strcasecmp (server, ptr_nick->name, nickname) == 0)
-            return ptr_nick;
-    }
+    key = irc_server_string_casemap (server, nickname);
+    if (!key)
+        return NULL;
 
-    /* nick not found */
-    return NULL;
+    ptr_nick = weechat_hashtable_get (channel->nicks_index, key);
+
+    free (key);
+
+    return ptr_nick;
 }
 
 /*
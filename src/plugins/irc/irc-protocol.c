@@ -4097,7 +4097,7 @@ IRC_PROTOCOL_CALLBACK(005)
             /* save casemapping */
             casemapping = irc_server_search_casemapping (ctxt->params[i] + 12);
             if (casemapping >= 0)
-                ctxt->server->casemapping = casemapping;
+                irc_server_set_casemapping (ctxt->server, casemapping);
         }
         else if (strncmp (ctxt->params[i], "UTF8MAPPING=", 12) == 0)
         {
@@ -7896,6 +7896,330 @@ IRC_PROTOCOL_CALLBACK(sasl_end_fail)
     return WEECHAT_RC_OK;
 }
 
+/*
+ * IRC messages received, with callback.
+ */
+
+struct t_irc_protocol_msg irc_protocol_messages[] =
+{
+    /* format: "command", decode_color, keep_trailing_spaces, func_cb   */
+    IRCB(account, 1, 0, account),    /* account (cap "account-notify")  */
+    IRCB(authenticate, 1, 0, authenticate), /* authenticate             */
+    IRCB(away, 1, 0, away),          /* away (cap "away-notify")        */
+    IRCB(batch, 1, 0, batch),        /* batch (cap "batch")             */
+    IRCB(cap, 1, 0, cap),            /* client capability               */
+    IRCB(chghost, 1, 0, chghost),    /* user/host change (cap "chghost")*/
+    IRCB(error, 1, 0, error),        /* error received from server      */
+    IRCB(fail, 1, 0, fail),          /* error received from server      */
+    IRCB(invite, 1, 0, invite),      /* invite a nick on a channel      */
+    IRCB(join, 1, 0, join),          /* join a channel                  */
+    IRCB(kick, 1, 1, kick),          /* kick a user                     */
+    IRCB(kill, 1, 1, kill),          /* close client-server connection  */
+    IRCB(mode, 1, 0, mode),          /* change channel or user mode     */
+    IRCB(nick, 1, 0, nick),          /* change current nickname         */
+    IRCB(note, 1, 0, note),          /* note received from server       */
+    IRCB(notice, 1, 1, notice),      /* send notice message to user     */
+    IRCB(part, 1, 1, part),          /* leave a channel                 */
+    IRCB(ping, 1, 0, ping),          /* ping server                     */
+    IRCB(pong, 1, 0, pong),          /* answer to a ping message        */
+    IRCB(privmsg, 1, 1, privmsg),    /* message received                */
+    IRCB(quit, 1, 1, quit),          /* close all connections and quit  */
+    IRCB(setname, 0, 1, setname),    /* set realname                    */
+    IRCB(tagmsg, 0, 0, tagmsg),      /* tag message                     */
+    IRCB(topic, 0, 1, topic),        /* get/set channel topic           */
+    IRCB(wallops, 1, 1, wallops),    /* wallops                         */
+    IRCB(warn, 1, 0, warn),          /* warning received from server    */
+    IRCB(001, 1, 0, 001),            /* a server message                */
+    IRCB(005, 1, 0, 005),            /* a server message                */
+    IRCB(008, 1, 0, 008),            /* server notice mask              */
+    IRCB(221, 1, 0, 221),            /* user mode string                */
+    IRCB(223, 1, 0, whois_nick_msg), /* whois (charset is)              */
+    IRCB(264, 1, 0, whois_nick_msg), /* whois (encrypted connection)    */
+    IRCB(275, 1, 0, whois_nick_msg), /* whois (secure connection)       */
+    IRCB(276, 1, 0, whois_nick_msg), /* whois (client cert. fingerprint)*/
+    IRCB(301, 1, 1, 301),            /* away message                    */
+    IRCB(303, 1, 0, 303),            /* ison                            */
+    IRCB(305, 1, 0, 305),            /* unaway                          */
+    IRCB(306, 1, 0, 306),            /* now away                        */
+    IRCB(307, 1, 0, whois_nick_msg), /* whois (registered nick)         */
+    IRCB(310, 1, 0, whois_nick_msg), /* whois (help mode)               */
+    IRCB(311, 1, 0, 311),            /* whois (user)                    */
+    IRCB(312, 1, 0, 312),            /* whois (server)                  */
+    IRCB(313, 1, 0, whois_nick_msg), /* whois (operator)                */
+    IRCB(314, 1, 0, 314),            /* whowas                          */
+    IRCB(315, 1, 0, 315),            /* end of /who list                */
+    IRCB(317, 1, 0, 317),            /* whois (idle)                    */
+    IRCB(318, 1, 0, whois_nick_msg), /* whois (end)                     */
+    IRCB(319, 1, 0, whois_nick_msg), /* whois (channels)                */
+    IRCB(320, 1, 0, whois_nick_msg), /* whois (identified user)         */
+    IRCB(321, 1, 0, 321),            /* /list start                     */
+    IRCB(322, 1, 1, 322),            /* channel (for /list)             */
+    IRCB(323, 1, 0, 323),            /* end of /list                    */
+    IRCB(324, 1, 0, 324),            /* channel mode                    */
+    IRCB(326, 1, 0, whois_nick_msg), /* whois (has oper privs)          */
+    IRCB(327, 1, 0, 327),            /* whois (host)                    */
+    IRCB(328, 1, 0, 328),            /* channel URL                     */
+    IRCB(329, 1, 0, 329),            /* channel creation date           */
+    IRCB(330, 1, 0, 330_343),        /* is logged in as                 */
+    IRCB(331, 1, 0, 331),            /* no topic for channel            */
+    IRCB(332, 0, 1, 332),            /* topic of channel                */
+    IRCB(333, 1, 0, 333),            /* topic info (nick/date)          */
+    IRCB(335, 1, 0, whois_nick_msg), /* whois (is a bot on)             */
+    IRCB(337, 1, 0, whois_nick_msg), /* whois (is hiding idle time)     */
+    IRCB(338, 1, 0, 338),            /* whois (host)                    */
+    IRCB(341, 1, 0, 341),            /* inviting                        */
+    IRCB(343, 1, 0, 330_343),        /* is opered as                    */
+    IRCB(344, 1, 0, 344),            /* channel reop / whois (geo info) */
+    IRCB(345, 1, 0, 345),            /* end of channel reop list        */
+    IRCB(346, 1, 0, 346),            /* invite list                     */
+    IRCB(347, 1, 0, 347),            /* end of invite list              */
+    IRCB(348, 1, 0, 348),            /* channel exception list          */
+    IRCB(349, 1, 0, 349),            /* end of channel exception list   */
+    IRCB(350, 1, 0, 350),            /* whois (gateway)                 */
+    IRCB(351, 1, 0, 351),            /* server version                  */
+    IRCB(352, 1, 0, 352),            /* who                             */
+    IRCB(353, 1, 0, 353),            /* list of nicks on channel        */
+    IRCB(354, 1, 0, 354),            /* whox                            */
+    IRCB(366, 1, 0, 366),            /* end of /names list              */
+    IRCB(367, 1, 0, 367),            /* banlist                         */
+    IRCB(368, 1, 0, 368),            /* end of banlist                  */
+    IRCB(369, 1, 0, whowas_nick_msg), /* whowas (end)                   */
+    IRCB(378, 1, 0, whois_nick_msg), /* whois (connecting from)         */
+    IRCB(379, 1, 0, whois_nick_msg), /* whois (using modes)             */
+    IRCB(401, 1, 0, generic_error),  /* no such nick/channel            */
+    IRCB(402, 1, 0, generic_error),  /* no such server                  */
+    IRCB(403, 1, 0, generic_error),  /* no such channel                 */
+    IRCB(404, 1, 0, generic_error),  /* cannot send to channel          */
+    IRCB(405, 1, 0, generic_error),  /* too many channels               */
+    IRCB(406, 1, 0, generic_error),  /* was no such nick                */
+    IRCB(407, 1, 0, generic_error),  /* was no such nick                */
+    IRCB(409, 1, 0, generic_error),  /* no origin                       */
+    IRCB(410, 1, 0, generic_error),  /* no services                     */
+    IRCB(411, 1, 0, generic_error),  /* no recipient                    */
+    IRCB(412, 1, 0, generic_error),  /* no text to send                 */
+    IRCB(413, 1, 0, generic_error),  /* no toplevel                     */
+    IRCB(414, 1, 0, generic_error),  /* wilcard in toplevel domain      */
+    IRCB(415, 1, 0, generic_error),  /* cannot send message to channel  */
+    IRCB(421, 1, 0, generic_error),  /* unknown command                 */
+    IRCB(422, 1, 0, generic_error),  /* MOTD is missing                 */
+    IRCB(423, 1, 0, generic_error),  /* no administrative info          */
+    IRCB(424, 1, 0, generic_error),  /* file error                      */
+    IRCB(431, 1, 0, generic_error),  /* no nickname given               */
+    IRCB(432, 1, 0, 432),            /* erroneous nickname              */
+    IRCB(433, 1, 0, 433),            /* nickname already in use         */
+    IRCB(436, 1, 0, generic_error),  /* nickname collision              */
+    IRCB(437, 1, 0, 437),            /* nick/channel unavailable        */
+    IRCB(438, 1, 0, 438),            /* not auth. to change nickname    */
+    IRCB(441, 1, 0, generic_error),  /* user not in channel             */
+    IRCB(442, 1, 0, generic_error),  /* not on channel                  */
+    IRCB(443, 1, 0, generic_error),  /* user already on channel         */
+    IRCB(444, 1, 0, generic_error),  /* user not logged in              */
+    IRCB(445, 1, 0, generic_error),  /* summon has been disabled        */
+    IRCB(446, 1, 0, generic_error),  /* users has been disabled         */
+    IRCB(451, 1, 0, generic_error),  /* you are not registered          */
+    IRCB(461, 1, 0, generic_error),  /* not enough parameters           */
+    IRCB(462, 1, 0, generic_error),  /* you may not register            */
+    IRCB(463, 1, 0, generic_error),  /* host not privileged             */
+    IRCB(464, 1, 0, generic_error),  /* password incorrect              */
+    IRCB(465, 1, 0, generic_error),  /* banned from this server         */
+    IRCB(467, 1, 0, generic_error),  /* channel key already set         */
+    IRCB(470, 1, 0, 470),            /* forwarding to another channel   */
+    IRCB(471, 1, 0, generic_error),  /* channel is already full         */
+    IRCB(472, 1, 0, generic_error),  /* unknown mode char to me         */
+    IRCB(473, 1, 0, generic_error),  /* cannot join (invite only)       */
+    IRCB(474, 1, 0, generic_error),  /* cannot join (banned)            */
+    IRCB(475, 1, 0, generic_error),  /* cannot join (bad key)           */
+    IRCB(476, 1, 0, generic_error),  /* bad channel mask                */
+    IRCB(477, 1, 0, generic_error),  /* channel doesn't support modes   */
+    IRCB(481, 1, 0, generic_error),  /* you're not an IRC operator      */
+    IRCB(482, 1, 0, generic_error),  /* you're not channel operator     */
+    IRCB(483, 1, 0, generic_error),  /* you can't kill a server!        */
+    IRCB(484, 1, 0, generic_error),  /* your connection is restricted!  */
+    IRCB(485, 1, 0, generic_error),  /* user immune from kick/deop      */
+    IRCB(487, 1, 0, generic_error),  /* network split                   */
+    IRCB(491, 1, 0, generic_error),  /* no O-lines for your host        */
+    IRCB(501, 1, 0, generic_error),  /* unknown mode flag               */
+    IRCB(502, 1, 0, generic_error),  /* can't chg mode for other users  */
+    IRCB(524, 1, 0, help),           /* HELP/HELPOP (help not found)    */
+    IRCB(569, 1, 0, whois_nick_msg), /* whois (connecting from)         */
+    IRCB(671, 1, 0, whois_nick_msg), /* whois (secure connection)       */
+    IRCB(704, 1, 0, help),           /* start of HELP/HELPOP            */
+    IRCB(705, 1, 0, help),           /* body of HELP/HELPOP             */
+    IRCB(706, 1, 0, help),           /* end of HELP/HELPOP              */
+    IRCB(710, 1, 0, 710),            /* knock: has asked for an invite  */
+    IRCB(711, 1, 0, knock_reply),    /* knock: has been delivered       */
+    IRCB(712, 1, 0, knock_reply),    /* knock: too many knocks          */
+    IRCB(713, 1, 0, knock_reply),    /* knock: channel is open          */
+    IRCB(714, 1, 0, knock_reply),    /* knock: already on that channel  */
+    IRCB(716, 1, 0, generic_error),  /* nick is in +g mode              */
+    IRCB(717, 1, 0, generic_error),  /* nick has been informed of msg   */
+    IRCB(728, 1, 0, 728),            /* quietlist                       */
+    IRCB(729, 1, 0, 729),            /* end of quietlist                */
+    IRCB(730, 1, 0, 730),            /* monitored nicks online          */
+    IRCB(731, 1, 0, 731),            /* monitored nicks offline         */
+    IRCB(732, 1, 0, 732),            /* list of monitored nicks         */
+    IRCB(733, 1, 0, 733),            /* end of monitor list             */
+    IRCB(734, 1, 0, 734),            /* monitor list is full            */
+    IRCB(742, 1, 0, generic_error),  /* mode cannot be set              */
+    IRCB(900, 1, 0, 900),            /* logged in as (SASL)             */
+    IRCB(901, 1, 0, 901),            /* you are now logged out          */
+    IRCB(902, 1, 0, sasl_end_fail),  /* SASL auth failed (acc. locked)  */
+    IRCB(903, 1, 0, sasl_end_ok),    /* SASL auth successful            */
+    IRCB(904, 1, 0, sasl_end_fail),  /* SASL auth failed                */
+    IRCB(905, 1, 0, sasl_end_fail),  /* SASL message too long           */
+    IRCB(906, 1, 0, sasl_end_fail),  /* SASL authentication aborted     */
+    IRCB(907, 1, 0, sasl_end_ok),    /* already completed SASL auth     */
+    IRCB(936, 1, 0, generic_error),  /* censored word                   */
+    IRCB(973, 1, 0, server_mode_reason), /* whois (secure conn.)        */
+    IRCB(974, 1, 0, server_mode_reason), /* whois (secure conn.)        */
+    IRCB(975, 1, 0, server_mode_reason), /* whois (secure conn.)        */
+    { NULL, 0, 0, NULL },
+};
+
+struct t_hashtable *irc_protocol_messages_index = NULL;
+struct t_irc_protocol_msg *irc_protocol_messages_numeric[1000];
+
+/*
+ * Hashes a command name (case-insensitive, the same way for "PRIVMSG" and
+ * "privmsg").
+ */
+
+unsigned long long
+irc_protocol_messages_hash_key_cb (struct t_hashtable *hashtable,
+                                   const void *key)
+{
+    const char *ptr_key;
+    unsigned long long hash;
+
+    /* make C compiler happy */
+    (void) hashtable;
+
+    /* variant of djb2 hash, on lower case chars */
+    hash = 5381;
+    for (ptr_key = (const char *)key; ptr_key[0]; ptr_key++)
+    {
+        hash ^= (hash << 5) + (hash >> 2)
+            + (unsigned long long)tolower ((unsigned char)ptr_key[0]);
+    }
+
+    return hash;
+}
+
+/*
+ * Compares two command names (case-insensitive).
+ */
+
+int
+irc_protocol_messages_keycmp_cb (struct t_hashtable *hashtable,
+                                 const void *key1, const void *key2)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    return weechat_strcasecmp ((const char *)key1, (const char *)key2);
+}
+
+/*
+ * Builds index of IRC messages received: a case-insensitive hashtable for
+ * commands with name and an array indexed by number for 3-digit numeric
+ * commands.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+irc_protocol_init ()
+{
+    int i, number;
+    const char *name;
+
+    memset (irc_protocol_messages_numeric, 0,
+            sizeof (irc_protocol_messages_numeric));
+
+    if (!irc_protocol_messages_index)
+    {
+        irc_protocol_messages_index = weechat_hashtable_new (
+            256,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_POINTER,
+            &irc_protocol_messages_hash_key_cb,
+            &irc_protocol_messages_keycmp_cb);
+        if (!irc_protocol_messages_index)
+            return 0;
+    }
+    else
+    {
+        weechat_hashtable_remove_all (irc_protocol_messages_index);
+    }
+
+    for (i = 0; irc_protocol_messages[i].name; i++)
+    {
+        name = irc_protocol_messages[i].name;
+        if ((strlen (name) == 3) && irc_protocol_is_numeric_command (name))
+        {
+            number = atoi (name);
+            if (!irc_protocol_messages_numeric[number])
+                irc_protocol_messages_numeric[number] = &irc_protocol_messages[i];
+        }
+        else if (!weechat_hashtable_has_key (irc_protocol_messages_index,
+                                             name))
+        {
+            weechat_hashtable_set (irc_protocol_messages_index,
+                                   name, &irc_protocol_messages[i]);
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Searches an IRC message received (case-insensitive search).
+ *
+ * Returns pointer to message found, NULL if not found.
+ */
+
+struct t_irc_protocol_msg *
+irc_protocol_search_message (const char *command)
+{
+    if (!command || !command[0])
+        return NULL;
+
+    if (!irc_protocol_messages_index && !irc_protocol_init ())
+        return NULL;
+
+    /* 3-digit numeric command: direct access by number */
+    if (isdigit ((unsigned char)command[0])
+        && isdigit ((unsigned char)command[1])
+        && isdigit ((unsigned char)command[2])
+        && !command[3])
+    {
+        return irc_protocol_messages_numeric[((command[0] - '0') * 100)
+                                             + ((command[1] - '0') * 10)
+                                             + (command[2] - '0')];
+    }
+
+    return (struct t_irc_protocol_msg *)weechat_hashtable_get (
+        irc_protocol_messages_index, command);
+}
+
+/*
+ * Frees index of IRC messages received.
+ */
+
+void
+irc_protocol_end ()
+{
+    if (irc_protocol_messages_index)
+    {
+        weechat_hashtable_free (irc_protocol_messages_index);
+        irc_protocol_messages_index = NULL;
+    }
+    memset (irc_protocol_messages_numeric, 0,
+            sizeof (irc_protocol_messages_numeric));
+}
+
 /*
  * Executes action when an IRC command is received.
  *
@@ -7915,9 +8239,10 @@ irc_protocol_recv_command (struct t_irc_server *server,
                            const char *msg_channel,
                            int ignore_batch_tag)
 {
-    int i, cmd_found, return_code, decode_color, keep_trailing_spaces, ignored;
+    int return_code, decode_color, keep_trailing_spaces, ignored;
     char *message_colors_decoded, *pos_space, *tags;
     struct t_irc_channel *ptr_channel;
+    struct t_irc_protocol_msg *ptr_msg;
     t_irc_recv_func *cmd_recv_func;
     const char *ptr_msg_after_tags, *ptr_batch_ref, *ptr_tag_time;
     const char *nick1, *address1, *host1;
@@ -7925,181 +8250,6 @@ irc_protocol_recv_command (struct t_irc_server *server,
     struct t_irc_protocol_ctxt ctxt;
     struct timeval tv;
 
-    struct t_irc_protocol_msg irc_protocol_messages[] = {
-        /* format: "command", decode_color, keep_trailing_spaces, func_cb   */
-        IRCB(account, 1, 0, account),    /* account (cap "account-notify")  */
-        IRCB(authenticate, 1, 0, authenticate), /* authenticate             */
-        IRCB(away, 1, 0, away),          /* away (cap "away-notify")        */
-        IRCB(batch, 1, 0, batch),        /* batch (cap "batch")             */
-        IRCB(cap, 1, 0, cap),            /* client capability               */
-        IRCB(chghost, 1, 0, chghost),    /* user/host change (cap "chghost")*/
-        IRCB(error, 1, 0, error),        /* error received from server      */
-        IRCB(fail, 1, 0, fail),          /* error received from server      */
-        IRCB(invite, 1, 0, invite),      /* invite a nick on a channel      */
-        IRCB(join, 1, 0, join),          /* join a channel                  */
-        IRCB(kick, 1, 1, kick),          /* kick a user                     */
-        IRCB(kill, 1, 1, kill),          /* close client-server connection  */
-        IRCB(mode, 1, 0, mode),          /* change channel or user mode     */
-        IRCB(nick, 1, 0, nick),          /* change current nickname         */
-        IRCB(note, 1, 0, note),          /* note received from server       */
-        IRCB(notice, 1, 1, notice),      /* send notice message to user     */
-        IRCB(part, 1, 1, part),          /* leave a channel                 */
-        IRCB(ping, 1, 0, ping),          /* ping server                     */
-        IRCB(pong, 1, 0, pong),          /* answer to a ping message        */
-        IRCB(privmsg, 1, 1, privmsg),    /* message received                */
-        IRCB(quit, 1, 1, quit),          /* close all connections and quit  */
-        IRCB(setname, 0, 1, setname),    /* set realname                    */
-        IRCB(tagmsg, 0, 0, tagmsg),      /* tag message                     */
-        IRCB(topic, 0, 1, topic),        /* get/set channel topic           */
-        IRCB(wallops, 1, 1, wallops),    /* wallops                         */
-        IRCB(warn, 1, 0, warn),          /* warning received from server    */
-        IRCB(001, 1, 0, 001),            /* a server message                */
-        IRCB(005, 1, 0, 005),            /* a server message                */
-        IRCB(008, 1, 0, 008),            /* server notice mask              */
-        IRCB(221, 1, 0, 221),            /* user mode string                */
-        IRCB(223, 1, 0, whois_nick_msg), /* whois (charset is)              */
-        IRCB(264, 1, 0, whois_nick_msg), /* whois (encrypted connection)    */
-        IRCB(275, 1, 0, whois_nick_msg), /* whois (secure connection)       */
-        IRCB(276, 1, 0, whois_nick_msg), /* whois (client cert. fingerprint)*/
-        IRCB(301, 1, 1, 301),            /* away message                    */
-        IRCB(303, 1, 0, 303),            /* ison                            */
-        IRCB(305, 1, 0, 305),            /* unaway                          */
-        IRCB(306, 1, 0, 306),            /* now away                        */
-        IRCB(307, 1, 0, whois_nick_msg), /* whois (registered nick)         */
-        IRCB(310, 1, 0, whois_nick_msg), /* whois (help mode)               */
-        IRCB(311, 1, 0, 311),            /* whois (user)                    */
-        IRCB(312, 1, 0, 312),            /* whois (server)                  */
-        IRCB(313, 1, 0, whois_nick_msg), /* whois (operator)                */
-        IRCB(314, 1, 0, 314),            /* whowas                          */
-        IRCB(315, 1, 0, 315),            /* end of /who list                */
-        IRCB(317, 1, 0, 317),            /* whois (idle)                    */
-        IRCB(318, 1, 0, whois_nick_msg), /* whois (end)                     */
-        IRCB(319, 1, 0, whois_nick_msg), /* whois (channels)                */
-        IRCB(320, 1, 0, whois_nick_msg), /* whois (identified user)         */
-        IRCB(321, 1, 0, 321),            /* /list start                     */
-        IRCB(322, 1, 1, 322),            /* channel (for /list)             */
-        IRCB(323, 1, 0, 323),            /* end of /list                    */
-        IRCB(324, 1, 0, 324),            /* channel mode                    */
-        IRCB(326, 1, 0, whois_nick_msg), /* whois (has oper privs)          */
-        IRCB(327, 1, 0, 327),            /* whois (host)                    */
-        IRCB(328, 1, 0, 328),            /* channel URL                     */
-        IRCB(329, 1, 0, 329),            /* channel creation date           */
-        IRCB(330, 1, 0, 330_343),        /* is logged in as                 */
-        IRCB(331, 1, 0, 331),            /* no topic for channel            */
-        IRCB(332, 0, 1, 332),            /* topic of channel                */
-        IRCB(333, 1, 0, 333),            /* topic info (nick/date)          */
-        IRCB(335, 1, 0, whois_nick_msg), /* whois (is a bot on)             */
-        IRCB(337, 1, 0, whois_nick_msg), /* whois (is hiding idle time)     */
-        IRCB(338, 1, 0, 338),            /* whois (host)                    */
-        IRCB(341, 1, 0, 341),            /* inviting                        */
-        IRCB(343, 1, 0, 330_343),        /* is opered as                    */
-        IRCB(344, 1, 0, 344),            /* channel reop / whois (geo info) */
-        IRCB(345, 1, 0, 345),            /* end of channel reop list        */
-        IRCB(346, 1, 0, 346),            /* invite list                     */
-        IRCB(347, 1, 0, 347),            /* end of invite list              */
-        IRCB(348, 1, 0, 348),            /* channel exception list          */
-        IRCB(349, 1, 0, 349),            /* end of channel exception list   */
-        IRCB(350, 1, 0, 350),            /* whois (gateway)                 */
-        IRCB(351, 1, 0, 351),            /* server version                  */
-        IRCB(352, 1, 0, 352),            /* who                             */
-        IRCB(353, 1, 0, 353),            /* list of nicks on channel        */
-        IRCB(354, 1, 0, 354),            /* whox                            */
-        IRCB(366, 1, 0, 366),            /* end of /names list              */
-        IRCB(367, 1, 0, 367),            /* banlist                         */
-        IRCB(368, 1, 0, 368),            /* end of banlist                  */
-        IRCB(369, 1, 0, whowas_nick_msg), /* whowas (end)                   */
-        IRCB(378, 1, 0, whois_nick_msg), /* whois (connecting from)         */
-        IRCB(379, 1, 0, whois_nick_msg), /* whois (using modes)             */
-        IRCB(401, 1, 0, generic_error),  /* no such nick/channel            */
-        IRCB(402, 1, 0, generic_error),  /* no such server                  */
-        IRCB(403, 1, 0, generic_error),  /* no such channel                 */
-        IRCB(404, 1, 0, generic_error),  /* cannot send to channel          */
-        IRCB(405, 1, 0, generic_error),  /* too many channels               */
-        IRCB(406, 1, 0, generic_error),  /* was no such nick                */
-        IRCB(407, 1, 0, generic_error),  /* was no such nick                */
-        IRCB(409, 1, 0, generic_error),  /* no origin                       */
-        IRCB(410, 1, 0, generic_error),  /* no services                     */
-        IRCB(411, 1, 0, generic_error),  /* no recipient                    */
-        IRCB(412, 1, 0, generic_error),  /* no text to send                 */
-        IRCB(413, 1, 0, generic_error),  /* no toplevel                     */
-        IRCB(414, 1, 0, generic_error),  /* wilcard in toplevel domain      */
-        IRCB(415, 1, 0, generic_error),  /* cannot send message to channel  */
-        IRCB(421, 1, 0, generic_error),  /* unknown command                 */
-        IRCB(422, 1, 0, generic_error),  /* MOTD is missing                 */
-        IRCB(423, 1, 0, generic_error),  /* no administrative info          */
-        IRCB(424, 1, 0, generic_error),  /* file error                      */
-        IRCB(431, 1, 0, generic_error),  /* no nickname given               */
-        IRCB(432, 1, 0, 432),            /* erroneous nickname              */
-        IRCB(433, 1, 0, 433),            /* nickname already in use         */
-        IRCB(436, 1, 0, generic_error),  /* nickname collision              */
-        IRCB(437, 1, 0, 437),            /* nick/channel unavailable        */
-        IRCB(438, 1, 0, 438),            /* not auth. to change nickname    */
-        IRCB(441, 1, 0, generic_error),  /* user not in channel             */
-        IRCB(442, 1, 0, generic_error),  /* not on channel                  */
-        IRCB(443, 1, 0, generic_error),  /* user already on channel         */
-        IRCB(444, 1, 0, generic_error),  /* user not logged in              */
-        IRCB(445, 1, 0, generic_error),  /* summon has been disabled        */
-        IRCB(446, 1, 0, generic_error),  /* users has been disabled         */
-        IRCB(451, 1, 0, generic_error),  /* you are not registered          */
-        IRCB(461, 1, 0, generic_error),  /* not enough parameters           */
-        IRCB(462, 1, 0, generic_error),  /* you may not register            */
-        IRCB(463, 1, 0, generic_error),  /* host not privileged             */
-        IRCB(464, 1, 0, generic_error),  /* password incorrect              */
-        IRCB(465, 1, 0, generic_error),  /* banned from this server         */
-        IRCB(467, 1, 0, generic_error),  /* channel key already set         */
-        IRCB(470, 1, 0, 470),            /* forwarding to another channel   */
-        IRCB(471, 1, 0, generic_error),  /* channel is already full         */
-        IRCB(472, 1, 0, generic_error),  /* unknown mode char to me         */
-        IRCB(473, 1, 0, generic_error),  /* cannot join (invite only)       */
-        IRCB(474, 1, 0, generic_error),  /* cannot join (banned)            */
-        IRCB(475, 1, 0, generic_error),  /* cannot join (bad key)           */
-        IRCB(476, 1, 0, generic_error),  /* bad channel mask                */
-        IRCB(477, 1, 0, generic_error),  /* channel doesn't support modes   */
-        IRCB(481, 1, 0, generic_error),  /* you're not an IRC operator      */
-        IRCB(482, 1, 0, generic_error),  /* you're not channel operator     */
-        IRCB(483, 1, 0, generic_error),  /* you can't kill a server!        */
-        IRCB(484, 1, 0, generic_error),  /* your connection is restricted!  */
-        IRCB(485, 1, 0, generic_error),  /* user immune from kick/deop      */
-        IRCB(487, 1, 0, generic_error),  /* network split                   */
-        IRCB(491, 1, 0, generic_error),  /* no O-lines for your host        */
-        IRCB(501, 1, 0, generic_error),  /* unknown mode flag               */
-        IRCB(502, 1, 0, generic_error),  /* can't chg mode for other users  */
-        IRCB(524, 1, 0, help),           /* HELP/HELPOP (help not found)    */
-        IRCB(569, 1, 0, whois_nick_msg), /* whois (connecting from)         */
-        IRCB(671, 1, 0, whois_nick_msg), /* whois (secure connection)       */
-        IRCB(704, 1, 0, help),           /* start of HELP/HELPOP            */
-        IRCB(705, 1, 0, help),           /* body of HELP/HELPOP             */
-        IRCB(706, 1, 0, help),           /* end of HELP/HELPOP              */
-        IRCB(710, 1, 0, 710),            /* knock: has asked for an invite  */
-        IRCB(711, 1, 0, knock_reply),    /* knock: has been delivered       */
-        IRCB(712, 1, 0, knock_reply),    /* knock: too many knocks          */
-        IRCB(713, 1, 0, knock_reply),    /* knock: channel is open          */
-        IRCB(714, 1, 0, knock_reply),    /* knock: already on that channel  */
-        IRCB(716, 1, 0, generic_error),  /* nick is in +g mode              */
-        IRCB(717, 1, 0, generic_error),  /* nick has been informed of msg   */
-        IRCB(728, 1, 0, 728),            /* quietlist                       */
-        IRCB(729, 1, 0, 729),            /* end of quietlist                */
-        IRCB(730, 1, 0, 730),            /* monitored nicks online          */
-        IRCB(731, 1, 0, 731),            /* monitored nicks offline         */
-        IRCB(732, 1, 0, 732),            /* list of monitored nicks         */
-        IRCB(733, 1, 0, 733),            /* end of monitor list             */
-        IRCB(734, 1, 0, 734),            /* monitor list is full            */
-        IRCB(742, 1, 0, generic_error),  /* mode cannot be set              */
-        IRCB(900, 1, 0, 900),            /* logged in as (SASL)             */
-        IRCB(901, 1, 0, 901),            /* you are now logged out          */
-        IRCB(902, 1, 0, sasl_end_fail),  /* SASL auth failed (acc. locked)  */
-        IRCB(903, 1, 0, sasl_end_ok),    /* SASL auth successful            */
-        IRCB(904, 1, 0, sasl_end_fail),  /* SASL auth failed                */
-        IRCB(905, 1, 0, sasl_end_fail),  /* SASL message too long           */
-        IRCB(906, 1, 0, sasl_end_fail),  /* SASL authentication aborted     */
-        IRCB(907, 1, 0, sasl_end_ok),    /* already completed SASL auth     */
-        IRCB(936, 1, 0, generic_error),  /* censored word                   */
-        IRCB(973, 1, 0, server_mode_reason), /* whois (secure conn.)        */
-        IRCB(974, 1, 0, server_mode_reason), /* whois (secure conn.)        */
-        IRCB(975, 1, 0, server_mode_reason), /* whois (secure conn.)        */
-        { NULL, 0, 0, NULL },
-    };
-
     if (!msg_command)
         return;
 
@@ -8244,19 +8394,10 @@ irc_protocol_recv_command (struct t_irc_server *server,
     }
 
     /* look for IRC command */
-    cmd_found = -1;
-    for (i = 0; irc_protocol_messages[i].name; i++)
-    {
-        if (weechat_strcasecmp (irc_protocol_messages[i].name,
-                                msg_command) == 0)
-        {
-            cmd_found = i;
-            break;
-        }
-    }
+    ptr_msg = irc_protocol_search_message (msg_command);
 
     /* command not found */
-    if (cmd_found < 0)
+    if (!ptr_msg)
     {
         /* for numeric commands, we use default recv function */
         if (irc_protocol_is_numeric_command (msg_command))
@@ -8277,10 +8418,10 @@ irc_protocol_recv_command (struct t_irc_server *server,
     }
     else
     {
-        ctxt.command = strdup (irc_protocol_messages[cmd_found].name);
-        decode_color = irc_protocol_messages[cmd_found].decode_color;
-        keep_trailing_spaces = irc_protocol_messages[cmd_found].keep_trailing_spaces;
-        cmd_recv_func = irc_protocol_messages[cmd_found].recv_function;
+        ctxt.command = strdup (ptr_msg->name);
+        decode_color = ptr_msg->decode_color;
+        keep_trailing_spaces = ptr_msg->keep_trailing_spaces;
+        cmd_recv_func = ptr_msg->recv_function;
     }
 
     if ((cmd_recv_func != NULL) && ptr_msg_after_tags)
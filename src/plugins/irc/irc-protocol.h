@@ -87,6 +87,8 @@ struct t_irc_protocol_msg
     t_irc_recv_func *recv_function; /* function called when msg is received  */
 };
 
+extern struct t_irc_protocol_msg irc_protocol_messages[];
+
 extern const char *irc_protocol_tags (struct t_irc_protocol_ctxt *ctxt,
                                       const char *extra_tags);
 extern void irc_protocol_recv_command (struct t_irc_server *server,
@@ -94,5 +96,8 @@ extern void irc_protocol_recv_command (struct t_irc_server *server,
                                        const char *msg_command,
                                        const char *msg_channel,
                                        int ignore_batch_tag);
+extern int irc_protocol_init ();
+extern struct t_irc_protocol_msg *irc_protocol_search_message (const char *command);
+extern void irc_protocol_end ();
 
 #endif /* WEECHAT_PLUGIN_IRC_PROTOCOL_H */
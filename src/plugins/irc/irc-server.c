@@ -73,9 +73,6 @@
 struct t_irc_server *irc_servers = NULL;
 struct t_irc_server *last_irc_server = NULL;
 
-struct t_irc_message *irc_recv_msgq = NULL;
-struct t_irc_message *irc_msgq_last_msg = NULL;
-
 char *irc_server_ipv6_string[IRC_SERVER_NUM_IPV6] =
 { "disable", "auto", "force" };
 
@@ -121,6 +118,7 @@ char *irc_server_options[IRC_SERVER_NUM_OPTIONS][2] =
   { "autorejoin_delay",     "30"                      },
   { "connection_timeout",   "60"                      },
   { "anti_flood",           "2000"                    },
+  { "anti_flood_burst",     "5"                       },
   { "away_check",           "0"                       },
   { "away_check_max_nicks", "25"                      },
   { "msg_kick",             ""                        },
@@ -337,6 +335,67 @@ irc_server_strncasecmp (struct t_irc_server *server,
     return weechat_strncasecmp_range (string1, string2, max, range);
 }
 
+/*
+ * Converts a string to lower case on server (depends on casemapping), so that
+ * two strings equal with function irc_server_strcasecmp give the same result.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_server_string_casemap (struct t_irc_server *server, const char *string)
+{
+    int casemapping, range;
+    char *result, *ptr_result;
+
+    if (!string)
+        return NULL;
+
+    casemapping = (server) ? server->casemapping : -1;
+    if ((casemapping < 0) || (casemapping >= IRC_SERVER_NUM_CASEMAPPING))
+        casemapping = IRC_SERVER_CASEMAPPING_RFC1459;
+
+    range = irc_server_casemapping_range[casemapping];
+
+    result = strdup (string);
+    if (!result)
+        return NULL;
+
+    for (ptr_result = result; ptr_result[0]; ptr_result++)
+    {
+        if ((ptr_result[0] >= 'A') && (ptr_result[0] < 'A' + range))
+            ptr_result[0] += ('a' - 'A');
+    }
+
+    return result;
+}
+
+/*
+ * Sets casemapping on server and rebuilds the index of nicks in all channels
+ * if casemapping has changed.
+ */
+
+void
+irc_server_set_casemapping (struct t_irc_server *server, int casemapping)
+{
+    struct t_irc_channel *ptr_channel;
+
+    if (!server
+        || (casemapping < 0) || (casemapping >= IRC_SERVER_NUM_CASEMAPPING)
+        || (casemapping == server->casemapping))
+    {
+        return;
+    }
+
+    server->casemapping = casemapping;
+
+    for (ptr_channel = server->channels; ptr_channel;
+         ptr_channel = ptr_channel->next_channel)
+    {
+        irc_nick_index_rebuild (server, ptr_channel);
+    }
+}
+
 /*
  * Evaluates a string using the server as context:
  * ${irc_server.xxx} and ${server} are replaced by a server option and the
@@ -1549,6 +1608,67 @@ irc_server_get_max_modes (struct t_irc_server *server)
     return max_modes;
 }
 
+/*
+ * Gets max number of targets for a command supported by the server
+ * (in isupport value, with the format: "TARGMAX=KICK:4,PRIVMSG:4,NAMES:").
+ *
+ * Returns:
+ *   > 0: max number of targets
+ *   0: no limit
+ *   -1: command not in isupport value (multiple targets not supported)
+ */
+
+int
+irc_server_get_targmax (struct t_irc_server *server, const char *command)
+{
+    const char *support_targmax;
+    char **items, *pos, *error;
+    long number;
+    int i, num_items, targmax;
+
+    if (!server || !command || !command[0])
+        return -1;
+
+    support_targmax = irc_server_get_isupport_value (server, "TARGMAX");
+    if (!support_targmax)
+        return -1;
+
+    targmax = -1;
+
+    items = weechat_string_split (support_targmax, ",", NULL,
+                                  WEECHAT_STRING_SPLIT_STRIP_LEFT
+                                  | WEECHAT_STRING_SPLIT_STRIP_RIGHT
+                                  | WEECHAT_STRING_SPLIT_COLLAPSE_SEPS,
+                                  0, &num_items);
+    if (items)
+    {
+        for (i = 0; i < num_items; i++)
+        {
+            pos = strchr (items[i], ':');
+            if (!pos)
+                continue;
+            pos[0] = '\0';
+            if (weechat_strcasecmp (items[i], command) != 0)
+                continue;
+            if (!pos[1])
+            {
+                targmax = 0;
+            }
+            else
+            {
+                error = NULL;
+                number = strtol (pos + 1, &error, 10);
+                if (error && !error[0] && (number >= 0))
+                    targmax = number;
+            }
+            break;
+        }
+        weechat_string_free_split (items);
+    }
+
+    return targmax;
+}
+
 /*
  * Gets an evaluated default_msg server option: replaces "%v" by WeeChat
  * version if there's no ${...} in string, or just evaluates the string.
@@ -1757,6 +1877,7 @@ irc_server_alloc (const char *name)
     new_server->hook_timer_connection = NULL;
     new_server->hook_timer_sasl = NULL;
     new_server->hook_timer_anti_flood = NULL;
+    new_server->hook_timer_msgq = NULL;
     new_server->sasl_scram_client_first = NULL;
     new_server->sasl_scram_salted_pwd = NULL;
     new_server->sasl_scram_salted_pwd_size = 0;
@@ -1771,7 +1892,13 @@ irc_server_alloc (const char *name)
     new_server->gnutls_sess = NULL;
     new_server->tls_cert = NULL;
     new_server->tls_cert_key = NULL;
-    new_server->unterminated_message = NULL;
+    new_server->recv_buffer = NULL;
+    new_server->recv_buffer_size = 0;
+    new_server->recv_buffer_start = 0;
+    new_server->recv_buffer_parsed = 0;
+    new_server->recv_buffer_length = 0;
+    new_server->recv_buffer_flush = NULL;
+    new_server->print_batch = 0;
     new_server->nicks_count = 0;
     new_server->nicks_array = NULL;
     new_server->nick_first_tried = 0;
@@ -1835,7 +1962,15 @@ irc_server_alloc (const char *name)
     {
         new_server->outqueue[i] = NULL;
         new_server->last_outqueue[i] = NULL;
-    }
+        new_server->outqueue_size[i] = 0;
+    }
+    new_server->anti_flood_credit = 0;
+    new_server->anti_flood_last_refill.tv_sec = 0;
+    new_server->anti_flood_last_refill.tv_usec = 0;
+    new_server->outqueue_sent = 0;
+    new_server->outqueue_merged = 0;
+    new_server->outqueue_latency_total = 0;
+    new_server->outqueue_latency_max = 0;
     new_server->redirects = NULL;
     new_server->last_redirect = NULL;
     new_server->notify_list = NULL;
@@ -2202,8 +2337,275 @@ irc_server_apply_command_line_options (struct t_irc_server *server,
     }
 }
 
+/*
+ * Merges two messages "MODE" with only modes having a nick as argument (like
+ * "MODE #test +o nick"), for the same channel and the same action (+/-),
+ * if the total number of modes is allowed by the server (isupport "MODES").
+ *
+ * Messages must not contain "\r\n".
+ *
+ * Returns merged message, NULL if messages can not be merged.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_server_outqueue_merge_mode (struct t_irc_server *server,
+                                const char *message1, const char *message2)
+{
+    char **argv1, **argv2, **result;
+    const char *prefix_modes, *ptr_modes1, *ptr_modes2;
+    int i, argc1, argc2, num_modes1, num_modes2, merge;
+
+    result = NULL;
+    merge = 0;
+
+    argv1 = weechat_string_split (message1, " ", NULL, 0, 0, &argc1);
+    argv2 = weechat_string_split (message2, " ", NULL, 0, 0, &argc2);
+    if (!argv1 || !argv2 || (argc1 < 4) || (argc2 < 4))
+        goto end;
+
+    if ((irc_server_strcasecmp (server, argv1[1], argv2[1]) != 0)
+        || !irc_channel_is_channel (server, argv1[1])
+        || !argv1[2][0] || !strchr ("+-", argv1[2][0])
+        || (argv1[2][0] != argv2[2][0]))
+    {
+        goto end;
+    }
+
+    prefix_modes = irc_server_get_prefix_modes (server);
+    ptr_modes1 = argv1[2] + 1;
+    ptr_modes2 = argv2[2] + 1;
+    num_modes1 = strlen (ptr_modes1);
+    num_modes2 = strlen (ptr_modes2);
+    if ((num_modes1 != argc1 - 3) || (num_modes2 != argc2 - 3)
+        || (num_modes1 + num_modes2 > irc_server_get_max_modes (server))
+        || (strspn (ptr_modes1, prefix_modes) != (size_t)num_modes1)
+        || (strspn (ptr_modes2, prefix_modes) != (size_t)num_modes2))
+    {
+        goto end;
+    }
+    for (i = 3; i < argc1; i++)
+    {
+        if (!argv1[i][0] || (argv1[i][0] == ':'))
+            goto end;
+    }
+    for (i = 3; i < argc2; i++)
+    {
+        if (!argv2[i][0] || (argv2[i][0] == ':'))
+            goto end;
+    }
+
+    result = weechat_string_dyn_alloc (256);
+    if (!result)
+        goto end;
+    weechat_string_dyn_concat (result, argv1[0], -1);
+    weechat_string_dyn_concat (result, " ", -1);
+    weechat_string_dyn_concat (result, argv1[1], -1);
+    weechat_string_dyn_concat (result, " ", -1);
+    weechat_string_dyn_concat (result, argv1[2], -1);
+    weechat_string_dyn_concat (result, ptr_modes2, -1);
+    for (i = 3; i < argc1; i++)
+    {
+        weechat_string_dyn_concat (result, " ", -1);
+        weechat_string_dyn_concat (result, argv1[i], -1);
+    }
+    for (i = 3; i < argc2; i++)
+    {
+        weechat_string_dyn_concat (result, " ", -1);
+        weechat_string_dyn_concat (result, argv2[i], -1);
+    }
+    merge = 1;
+
+end:
+    weechat_string_free_split (argv1);
+    weechat_string_free_split (argv2);
+    if (result)
+        return weechat_string_dyn_free (result, !merge);
+    return NULL;
+}
+
+/*
+ * Merges two messages "KICK" for the same channel and with the same reason
+ * (like "KICK #test nick1 :reason" and "KICK #test nick2 :reason") into
+ * one message with multiple nicks, if the total number of nicks is allowed
+ * by the server (isupport "TARGMAX").
+ *
+ * Messages must not contain "\r\n".
+ *
+ * Returns merged message, NULL if messages can not be merged.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_server_outqueue_merge_kick (struct t_irc_server *server,
+                                const char *message1, const char *message2)
+{
+    const char *pos_channel1, *pos_channel2, *pos_nicks1, *pos_nicks2;
+    const char *pos_reason1, *pos_reason2;
+    char **result;
+    int targmax, num_nicks;
+
+    targmax = irc_server_get_targmax (server, "KICK");
+    if ((targmax < 0) || (targmax == 1))
+        return NULL;
+
+    pos_channel1 = strchr (message1, ' ');
+    pos_channel2 = strchr (message2, ' ');
+    if (!pos_channel1 || !pos_channel2)
+        return NULL;
+    pos_channel1++;
+    pos_channel2++;
+    pos_nicks1 = strchr (pos_channel1, ' ');
+    pos_nicks2 = strchr (pos_channel2, ' ');
+    if (!pos_nicks1 || !pos_nicks2)
+        return NULL;
+    pos_nicks1++;
+    pos_nicks2++;
+    if (!pos_nicks1[0] || (pos_nicks1[0] == ' ') || (pos_nicks1[0] == ':')
+        || !pos_nicks2[0] || (pos_nicks2[0] == ' ') || (pos_nicks2[0] == ':'))
+    {
+        return NULL;
+    }
+    pos_reason1 = strchr (pos_nicks1, ' ');
+    pos_reason2 = strchr (pos_nicks2, ' ');
+    if (!pos_reason1)
+        pos_reason1 = pos_nicks1 + strlen (pos_nicks1);
+    if (!pos_reason2)
+        pos_reason2 = pos_nicks2 + strlen (pos_nicks2);
+
+    /* same channel and same reason */
+    if ((pos_nicks1 - pos_channel1 != pos_nicks2 - pos_channel2)
+        || (weechat_strncasecmp (pos_channel1, pos_channel2,
+                                 pos_nicks1 - pos_channel1) != 0)
+        || (strcmp (pos_reason1, pos_reason2) != 0))
+    {
+        return NULL;
+    }
+
+    if (targmax > 0)
+    {
+        num_nicks = 2;
+        pos_channel1 = pos_nicks1;
+        while ((pos_channel1 = strchr (pos_channel1, ',')) != NULL
+               && (pos_channel1 < pos_reason1))
+        {
+            num_nicks++;
+            pos_channel1++;
+        }
+        pos_channel2 = pos_nicks2;
+        while ((pos_channel2 = strchr (pos_channel2, ',')) != NULL
+               && (pos_channel2 < pos_reason2))
+        {
+            num_nicks++;
+            pos_channel2++;
+        }
+        if (num_nicks > targmax)
+            return NULL;
+    }
+
+    result = weechat_string_dyn_alloc (256);
+    if (!result)
+        return NULL;
+    weechat_string_dyn_concat (result, message1, pos_reason1 - message1);
+    weechat_string_dyn_concat (result, ",", -1);
+    weechat_string_dyn_concat (result, pos_nicks2, pos_reason2 - pos_nicks2);
+    weechat_string_dyn_concat (result, pos_reason1, -1);
+
+    return weechat_string_dyn_free (result, 0);
+}
+
+/*
+ * Merges a message with the last message of an out queue, for commands
+ * accepting multiple targets or modes: "MODE" and "KICK".
+ *
+ * Messages modified by a modifier, with a redirection or with different tags
+ * are never merged.
+ *
+ * Returns:
+ *   1: message merged with last message of queue
+ *   0: message not merged
+ */
+
+int
+irc_server_outqueue_merge (struct t_irc_server *server, int priority,
+                           const char *command, const char *message,
+                           int modified, const char *tags,
+                           struct t_irc_redirect *redirect)
+{
+    struct t_irc_outqueue *ptr_outqueue;
+    char *message1, *message2, *merged, *new_message;
+    int length1, length2;
+
+    if ((priority == 0) || modified || redirect || !command || !message)
+        return 0;
+
+    ptr_outqueue = server->last_outqueue[priority];
+    if (!ptr_outqueue || ptr_outqueue->modified || ptr_outqueue->redirect
+        || !ptr_outqueue->message_after_mod
+        || (weechat_strcasecmp (ptr_outqueue->command, command) != 0)
+        || (weechat_strcmp (ptr_outqueue->tags, tags) != 0))
+    {
+        return 0;
+    }
+
+    if ((weechat_strcasecmp (command, "mode") != 0)
+        && (weechat_strcasecmp (command, "kick") != 0))
+    {
+        return 0;
+    }
+
+    /* messages must be a single message ending with "\r\n", without tags */
+    length1 = strlen (ptr_outqueue->message_after_mod);
+    length2 = strlen (message);
+    if ((length1 < 2) || (length2 < 2)
+        || (strcspn (ptr_outqueue->message_after_mod, "\r\n") != (size_t)length1 - 2)
+        || (strcspn (message, "\r\n") != (size_t)length2 - 2)
+        || (ptr_outqueue->message_after_mod[0] == '@')
+        || (message[0] == '@'))
+    {
+        return 0;
+    }
+
+    message1 = weechat_strndup (ptr_outqueue->message_after_mod, length1 - 2);
+    message2 = weechat_strndup (message, length2 - 2);
+    merged = NULL;
+    if (message1 && message2)
+    {
+        merged = (weechat_strcasecmp (command, "mode") == 0) ?
+            irc_server_outqueue_merge_mode (server, message1, message2) :
+            irc_server_outqueue_merge_kick (server, message1, message2);
+    }
+    free (message1);
+    free (message2);
+
+    /* merged message must not exceed 512 bytes (with "\r\n") */
+    if (!merged || (strlen (merged) + 2 > 512))
+    {
+        free (merged);
+        return 0;
+    }
+
+    if (weechat_asprintf (&new_message, "%s\r\n", merged) < 0)
+    {
+        free (merged);
+        return 0;
+    }
+    free (merged);
+
+    free (ptr_outqueue->message_after_mod);
+    ptr_outqueue->message_after_mod = new_message;
+    server->outqueue_merged++;
+
+    return 1;
+}
+
 /*
  * Adds a message in out queue.
+ *
+ * Messages "MODE" and "KICK" are merged with the last message of queue if
+ * possible (see function irc_server_outqueue_merge).
  */
 
 void
@@ -2214,6 +2616,12 @@ irc_server_outqueue_add (struct t_irc_server *server, int priority,
 {
     struct t_irc_outqueue *new_outqueue;
 
+    if (irc_server_outqueue_merge (server, priority, command, msg2,
+                                   modified, tags, redirect))
+    {
+        return;
+    }
+
     new_outqueue = malloc (sizeof (*new_outqueue));
     if (new_outqueue)
     {
@@ -2223,6 +2631,7 @@ irc_server_outqueue_add (struct t_irc_server *server, int priority,
         new_outqueue->modified = modified;
         new_outqueue->tags = (tags) ? strdup (tags) : NULL;
         new_outqueue->redirect = redirect;
+        gettimeofday (&new_outqueue->date_added, NULL);
 
         new_outqueue->prev_outqueue = server->last_outqueue[priority];
         new_outqueue->next_outqueue = NULL;
@@ -2231,6 +2640,7 @@ irc_server_outqueue_add (struct t_irc_server *server, int priority,
         else
             server->outqueue[priority] = new_outqueue;
         server->last_outqueue[priority] = new_outqueue;
+        server->outqueue_size[priority]++;
     }
 }
 
@@ -2271,6 +2681,9 @@ irc_server_outqueue_free (struct t_irc_server *server,
 
     /* set new head */
     server->outqueue[priority] = new_outqueue;
+
+    if (server->outqueue_size[priority] > 0)
+        server->outqueue_size[priority]--;
 }
 
 /*
@@ -2368,8 +2781,9 @@ irc_server_free_data (struct t_irc_server *server)
     weechat_unhook (server->hook_timer_connection);
     weechat_unhook (server->hook_timer_sasl);
     weechat_unhook (server->hook_timer_anti_flood);
+    weechat_unhook (server->hook_timer_msgq);
     irc_server_free_sasl_data (server);
-    free (server->unterminated_message);
+    irc_server_recv_buffer_free (server);
     weechat_string_free_split (server->nicks_array);
     free (server->nick);
     free (server->nick_modes);
@@ -2844,6 +3258,43 @@ irc_server_outqueue_all_empty (struct t_irc_server *server)
     return 1;
 }
 
+/*
+ * Refills the anti-flood credit of a server (token bucket): the credit grows
+ * with the time elapsed since last refill, up to "anti_flood_burst" messages
+ * (each message sent costs "anti_flood" milliseconds of credit).
+ *
+ * On first call (or after a disconnection), the credit is full.
+ */
+
+void
+irc_server_anti_flood_refill (struct t_irc_server *server)
+{
+    struct timeval now;
+    long long credit_max, diff;
+
+    gettimeofday (&now, NULL);
+
+    credit_max = (long long)IRC_SERVER_OPTION_INTEGER(
+        server, IRC_SERVER_OPTION_ANTI_FLOOD) * 1000
+        * IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST);
+
+    if (server->anti_flood_last_refill.tv_sec == 0)
+    {
+        server->anti_flood_credit = credit_max;
+    }
+    else
+    {
+        diff = weechat_util_timeval_diff (&server->anti_flood_last_refill,
+                                          &now);
+        if (diff > 0)
+            server->anti_flood_credit += diff;
+    }
+    if (server->anti_flood_credit > credit_max)
+        server->anti_flood_credit = credit_max;
+
+    server->anti_flood_last_refill = now;
+}
+
 /*
  * Timer called to send out queue (anti-flood).
  */
@@ -2859,6 +3310,9 @@ irc_server_outqueue_timer_cb (const void *pointer, void *data, int remaining_cal
 
     server = (struct t_irc_server *)pointer;
 
+    /* timer is called only once */
+    server->hook_timer_anti_flood = NULL;
+
     irc_server_outqueue_send (server);
 
     return WEECHAT_RC_OK;
@@ -2882,21 +3336,32 @@ irc_server_outqueue_timer_remove (struct t_irc_server *server)
 }
 
 /*
- * Adds anti-flood timer in a server (removes it first if already set).
+ * Adds anti-flood timer in a server (removes it first if already set): the
+ * timer is called once, when the credit is enough to send one message.
  */
 
 void
 irc_server_outqueue_timer_add (struct t_irc_server *server)
 {
+    long long cost, delay;
+
     if (!server)
         return;
 
     if (server->hook_timer_anti_flood)
         irc_server_outqueue_timer_remove (server);
 
+    irc_server_anti_flood_refill (server);
+
+    cost = (long long)IRC_SERVER_OPTION_INTEGER(
+        server, IRC_SERVER_OPTION_ANTI_FLOOD) * 1000;
+    delay = (cost - server->anti_flood_credit + 999) / 1000;
+    if (delay < 1)
+        delay = 1;
+
     server->hook_timer_anti_flood = weechat_hook_timer (
-        IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD),
-        0, 0,
+        delay,
+        0, 1,
         &irc_server_outqueue_timer_cb,
         server, NULL);
 }
@@ -2969,14 +3434,53 @@ irc_server_outqueue_send_one_msg (struct t_irc_server *server,
 }
 
 /*
- * Sends one or multiple message from out queues, by order of priority
- * (immediate/high/low), then from oldest message to newest in queue.
+ * Sends the first message of an out queue, then removes it from queue
+ * (the anti-flood credit and statistics of queues are updated).
+ */
+
+void
+irc_server_outqueue_send_first (struct t_irc_server *server, int priority,
+                                long long cost)
+{
+    struct timeval now;
+    long long latency;
+
+    if (priority > 0)
+    {
+        gettimeofday (&now, NULL);
+        latency = weechat_util_timeval_diff (
+            &server->outqueue[priority]->date_added, &now);
+        if (latency < 0)
+            latency = 0;
+        server->outqueue_sent++;
+        server->outqueue_latency_total += latency;
+        if (latency > server->outqueue_latency_max)
+            server->outqueue_latency_max = latency;
+    }
+
+    server->anti_flood_credit -= cost;
+    if (server->anti_flood_credit < 0)
+        server->anti_flood_credit = 0;
+
+    irc_server_outqueue_send_one_msg (server, server->outqueue[priority]);
+    irc_server_outqueue_free (server, priority, server->outqueue[priority]);
+}
+
+/*
+ * Sends messages from out queues, by order of priority (immediate/high/low),
+ * then from oldest message to newest in queue.
+ *
+ * Messages with immediate priority are always sent; other messages are sent
+ * while the anti-flood credit is enough (token bucket, see function
+ * irc_server_anti_flood_refill), then a timer is scheduled to send next
+ * messages.
  */
 
 void
 irc_server_outqueue_send (struct t_irc_server *server)
 {
-    int priority, anti_flood;
+    int priority;
+    long long cost;
 
     if (irc_server_outqueue_all_empty (server))
     {
@@ -2984,33 +3488,27 @@ irc_server_outqueue_send (struct t_irc_server *server)
         return;
     }
 
-    anti_flood = IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD);
+    cost = (long long)IRC_SERVER_OPTION_INTEGER(
+        server, IRC_SERVER_OPTION_ANTI_FLOOD) * 1000;
+
+    irc_server_anti_flood_refill (server);
 
     for (priority = 0; priority < IRC_SERVER_NUM_OUTQUEUES_PRIO; priority++)
     {
-        if (!server->outqueue[priority])
-            continue;
-
-        /* send all messages with anti_flood == 0, or just one */
-        while (server->outqueue[priority])
+        while (server->outqueue[priority]
+               && ((priority == 0) || (cost == 0)
+                   || (server->anti_flood_credit >= cost)))
         {
-            irc_server_outqueue_send_one_msg (server, server->outqueue[priority]);
-            irc_server_outqueue_free (server, priority, server->outqueue[priority]);
-            if (anti_flood > 0)
-                break;
+            irc_server_outqueue_send_first (server, priority, cost);
         }
-
-        /*
-         * continue to send for immediate priority (= 0),
-         * exit loop now for high/low priorities (> 0) if anti flood is enabled
-         */
-        if ((priority > 0) && (anti_flood > 0))
-            break;
     }
 
-    /* schedule next send if anti-flood is enabled */
-    if ((anti_flood > 0) && !server->hook_timer_anti_flood)
+    /* schedule next send if messages are remaining in queues */
+    if (!irc_server_outqueue_all_empty (server)
+        && !server->hook_timer_anti_flood)
+    {
         irc_server_outqueue_timer_add (server);
+    }
 }
 
 /*
@@ -3362,8 +3860,10 @@ irc_server_sendf (struct t_irc_server *server, int flags, const char *tags,
     /* send all messages with "immediate" priority */
     while (server->outqueue[0])
     {
-        irc_server_outqueue_send_one_msg (server, server->outqueue[0]);
-        irc_server_outqueue_free (server, 0, server->outqueue[0]);
+        irc_server_outqueue_send_first (
+            server, 0,
+            (long long)IRC_SERVER_OPTION_INTEGER(
+                server, IRC_SERVER_OPTION_ANTI_FLOOD) * 1000);
     }
 
     /* send any other messages, if any, possibly with anti-flood */
@@ -3374,400 +3874,649 @@ irc_server_sendf (struct t_irc_server *server, int flags, const char *tags,
 }
 
 /*
- * Adds a message to received messages queue (at the end).
+ * Frees receive buffer of a server.
+ *
+ * The buffer is not freed if a message in this buffer is being processed:
+ * it is freed at the end of processing of this message.
  */
 
 void
-irc_server_msgq_add_msg (struct t_irc_server *server, const char *msg)
+irc_server_recv_buffer_free (struct t_irc_server *server)
 {
-    struct t_irc_message *message;
-
-    if (!server->unterminated_message && !msg[0])
+    if (!server)
         return;
 
-    message = malloc (sizeof (*message));
-    if (!message)
+    if (server->recv_buffer != server->recv_buffer_flush)
+        free (server->recv_buffer);
+    server->recv_buffer = NULL;
+    server->recv_buffer_size = 0;
+    server->recv_buffer_start = 0;
+    server->recv_buffer_parsed = 0;
+    server->recv_buffer_length = 0;
+}
+
+/*
+ * Reserves space at the end of receive buffer of a server to add "size"
+ * bytes (+ final '\0'): messages already processed are removed from the
+ * beginning of buffer and the buffer is enlarged if needed.
+ *
+ * The buffer is never moved or changed in place while a message in this
+ * buffer is being processed: a new buffer is allocated instead.
+ *
+ * Returns pointer to the space reserved, NULL if error.
+ */
+
+char *
+irc_server_recv_buffer_reserve (struct t_irc_server *server, int size)
+{
+    char *new_buffer;
+    int used, new_size;
+
+    if (!server || (size < 0))
+        return NULL;
+
+    if (server->recv_buffer
+        && (server->recv_buffer_length + size < server->recv_buffer_size))
     {
-        weechat_printf (server->buffer,
-                        _("%s%s: not enough memory for received message"),
-                        weechat_prefix ("error"), IRC_PLUGIN_NAME);
-        return;
+        return server->recv_buffer + server->recv_buffer_length;
     }
-    message->server = server;
-    if (server->unterminated_message)
+
+    used = server->recv_buffer_length - server->recv_buffer_start;
+    new_size = (server->recv_buffer_size > 0) ?
+        server->recv_buffer_size : IRC_SERVER_RECV_BUFFER_SIZE;
+    while (used + size >= new_size)
     {
-        message->data = malloc (strlen (server->unterminated_message) +
-                                strlen (msg) + 1);
-        if (!message->data)
-        {
-            weechat_printf (server->buffer,
-                            _("%s%s: not enough memory for received message"),
-                            weechat_prefix ("error"), IRC_PLUGIN_NAME);
-        }
-        else
-        {
-            strcpy (message->data, server->unterminated_message);
-            strcat (message->data, msg);
-        }
-        free (server->unterminated_message);
-        server->unterminated_message = NULL;
+        new_size *= 2;
     }
-    else
-        message->data = strdup (msg);
 
-    message->next_message = NULL;
-
-    if (irc_msgq_last_msg)
+    if (server->recv_buffer
+        && (server->recv_buffer != server->recv_buffer_flush)
+        && (new_size == server->recv_buffer_size))
     {
-        irc_msgq_last_msg->next_message = message;
-        irc_msgq_last_msg = message;
+        /* enough space after removal of messages already processed */
+        memmove (server->recv_buffer,
+                 server->recv_buffer + server->recv_buffer_start,
+                 used);
     }
     else
     {
-        irc_recv_msgq = message;
-        irc_msgq_last_msg = message;
+        new_buffer = malloc (new_size);
+        if (!new_buffer)
+            return NULL;
+        if (used > 0)
+        {
+            memcpy (new_buffer,
+                    server->recv_buffer + server->recv_buffer_start,
+                    used);
+        }
+        if (server->recv_buffer != server->recv_buffer_flush)
+            free (server->recv_buffer);
+        server->recv_buffer = new_buffer;
+        server->recv_buffer_size = new_size;
     }
+    server->recv_buffer_parsed -= server->recv_buffer_start;
+    server->recv_buffer_length = used;
+    server->recv_buffer_start = 0;
+
+    return server->recv_buffer + server->recv_buffer_length;
 }
 
 /*
- * Adds an unterminated message to queue.
+ * Adds "length" bytes written at the end of receive buffer of a server
+ * (in space returned by function irc_server_recv_buffer_reserve) and splits
+ * complete messages in place: the "\n" at the end of each message is
+ * replaced by '\0' and chars "\r" are removed.
  */
 
 void
-irc_server_msgq_add_unterminated (struct t_irc_server *server,
-                                  const char *string)
+irc_server_recv_buffer_add (struct t_irc_server *server, int length)
 {
-    char *unterminated_message2;
+    char *ptr_msg, *ptr_end, *pos_lf, *ptr_src, *ptr_dst;
 
-    if (!string[0])
+    if (!server || !server->recv_buffer || (length <= 0))
         return;
 
-    if (server->unterminated_message)
+    server->recv_buffer_length += length;
+    server->recv_buffer[server->recv_buffer_length] = '\0';
+
+    ptr_msg = server->recv_buffer + server->recv_buffer_parsed;
+    ptr_end = server->recv_buffer + server->recv_buffer_length;
+    while ((pos_lf = memchr (ptr_msg, '\n', ptr_end - ptr_msg)))
     {
-        unterminated_message2 =
-            realloc (server->unterminated_message,
-                     (strlen (server->unterminated_message) +
-                      strlen (string) + 1));
-        if (!unterminated_message2)
+        pos_lf[0] = '\0';
+        if (memchr (ptr_msg, '\r', pos_lf - ptr_msg)
+            || memchr (ptr_msg, '\0', pos_lf - ptr_msg))
         {
-            weechat_printf (server->buffer,
-                            _("%s%s: not enough memory for received message"),
-                            weechat_prefix ("error"), IRC_PLUGIN_NAME);
-            free (server->unterminated_message);
-            server->unterminated_message = NULL;
-            return;
+            /*
+             * remove "\r" and truncate message on first '\0' received;
+             * bytes not used any more are set to '\0' (they are skipped
+             * like empty messages)
+             */
+            ptr_dst = ptr_msg;
+            for (ptr_src = ptr_msg; ptr_src[0]; ptr_src++)
+            {
+                if (ptr_src[0] != '\r')
+                {
+                    ptr_dst[0] = ptr_src[0];
+                    ptr_dst++;
+                }
+            }
+            memset (ptr_dst, 0, pos_lf - ptr_dst);
         }
-        server->unterminated_message = unterminated_message2;
-        strcat (server->unterminated_message, string);
+        ptr_msg = pos_lf + 1;
     }
-    else
+    server->recv_buffer_parsed = ptr_msg - server->recv_buffer;
+}
+
+/*
+ * Returns data received from a server and not yet processed: complete
+ * messages (each one followed by "\n") then the unterminated message.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_server_recv_buffer_pending (struct t_irc_server *server)
+{
+    char *result, *ptr_result;
+    int pos, length;
+
+    if (!server || !server->recv_buffer)
+        return NULL;
+
+    result = malloc (server->recv_buffer_length
+                     - server->recv_buffer_start + 1);
+    if (!result)
+        return NULL;
+
+    ptr_result = result;
+    pos = server->recv_buffer_start;
+    while (pos < server->recv_buffer_parsed)
     {
-        server->unterminated_message = strdup (string);
-        if (!server->unterminated_message)
+        length = strlen (server->recv_buffer + pos);
+        if (length > 0)
         {
-            weechat_printf (server->buffer,
-                            _("%s%s: not enough memory for received message"),
-                            weechat_prefix ("error"), IRC_PLUGIN_NAME);
+            memcpy (ptr_result, server->recv_buffer + pos, length);
+            ptr_result += length;
+            ptr_result[0] = '\n';
+            ptr_result++;
         }
+        pos += length + 1;
     }
+    length = strlen (server->recv_buffer + server->recv_buffer_parsed);
+    memcpy (ptr_result, server->recv_buffer + server->recv_buffer_parsed,
+            length);
+    ptr_result[length] = '\0';
+
+    return result;
 }
 
 /*
- * Splits received buffer, creating queued messages.
+ * Adds data received (string) in receive buffer of a server, splitting
+ * complete messages.
  */
 
 void
 irc_server_msgq_add_buffer (struct t_irc_server *server, const char *buffer)
 {
-    char *pos_cr, *pos_lf;
+    char *ptr_buffer;
+    int length;
 
-    while (buffer[0])
+    if (!server || !buffer || !buffer[0])
+        return;
+
+    length = strlen (buffer);
+    ptr_buffer = irc_server_recv_buffer_reserve (server, length);
+    if (!ptr_buffer)
     {
-        pos_cr = strchr (buffer, '\r');
-        pos_lf = strchr (buffer, '\n');
+        weechat_printf (server->buffer,
+                        _("%s%s: not enough memory for received message"),
+                        weechat_prefix ("error"), IRC_PLUGIN_NAME);
+        return;
+    }
+    memcpy (ptr_buffer, buffer, length);
+    irc_server_recv_buffer_add (server, length);
+}
 
-        if (!pos_cr && !pos_lf)
-        {
-            /* no CR/LF found => add to unterminated and return */
-            irc_server_msgq_add_unterminated (server, buffer);
-            return;
-        }
+/*
+ * Starts a batch of lines in server buffer and buffers of all channels
+ * (buffer property "print_batch"): hotlist, nicklist bar items and refresh
+ * of buffers are updated only once, when the batch is ended.
+ *
+ * Returns:
+ *   1: batch started
+ *   0: batch already started by server (or error)
+ */
 
-        if (pos_cr && ((!pos_lf) || (pos_lf > pos_cr)))
+int
+irc_server_print_batch_start (struct t_irc_server *server)
+{
+    struct t_irc_channel *ptr_channel;
+
+    if (!server || server->print_batch)
+        return 0;
+
+    if (server->buffer)
+        weechat_buffer_set (server->buffer, "print_batch", "1");
+
+    for (ptr_channel = server->channels; ptr_channel;
+         ptr_channel = ptr_channel->next_channel)
+    {
+        if (ptr_channel->buffer && !ptr_channel->print_batch)
         {
-            /* found '\r' first => ignore this char */
-            pos_cr[0] = '\0';
-            irc_server_msgq_add_unterminated (server, buffer);
-            buffer = pos_cr + 1;
+            weechat_buffer_set (ptr_channel->buffer, "print_batch", "1");
+            ptr_channel->print_batch = 1;
         }
-        else
+    }
+
+    server->print_batch = 1;
+
+    return 1;
+}
+
+/*
+ * Ends a batch of lines started by server (channels created during the batch
+ * are ignored).
+ */
+
+void
+irc_server_print_batch_end (struct t_irc_server *server)
+{
+    struct t_irc_channel *ptr_channel;
+
+    if (!server || !server->print_batch)
+        return;
+
+    for (ptr_channel = server->channels; ptr_channel;
+         ptr_channel = ptr_channel->next_channel)
+    {
+        if (ptr_channel->print_batch)
         {
-            /* found: '\n' first => terminate message */
-            pos_lf[0] = '\0';
-            irc_server_msgq_add_msg (server, buffer);
-            buffer = pos_lf + 1;
+            if (ptr_channel->buffer)
+                weechat_buffer_set (ptr_channel->buffer, "print_batch", "0");
+            ptr_channel->print_batch = 0;
         }
     }
+
+    if (server->buffer)
+        weechat_buffer_set (server->buffer, "print_batch", "0");
+
+    server->print_batch = 0;
 }
 
 /*
- * Flushes message queue.
+ * Processes a message received from a server.
  */
 
 void
-irc_server_msgq_flush ()
+irc_server_msgq_flush_message (struct t_irc_server *server, char *ptr_data)
 {
-    struct t_irc_message *next;
-    char *ptr_data, *new_msg, *new_msg2, *ptr_msg, *ptr_msg2, *pos;
-    char *nick, *host, *command, *channel, *arguments;
+    struct t_irc_message_spans spans;
+    char *new_msg, *new_msg2, *ptr_msg, *ptr_msg2, *pos;
+    char *nick, *command, *channel;
+    const char *ptr_arguments;
     char *msg_decoded, *msg_decoded_without_color;
     char str_modifier[128], modifier_data[1024];
-    int pos_channel, pos_text, pos_decode;
+    int pos_decode;
 
-    while (irc_recv_msgq)
+    while (ptr_data[0] == ' ')
     {
-        if (irc_recv_msgq->data)
+        ptr_data++;
+    }
+
+    if (ptr_data[0])
+    {
+        irc_raw_print (server, IRC_RAW_FLAG_RECV, ptr_data);
+
+        /*
+         * parse message once: parts of message are used again
+         * below if the message is not changed by modifier
+         */
+        irc_message_parse_spans (server, ptr_data, &spans);
+        command = irc_message_span_dup (ptr_data, &spans.command);
+        snprintf (str_modifier, sizeof (str_modifier),
+                  "irc_in_%s",
+                  (command) ? command : "unknown");
+        new_msg = weechat_hook_modifier_exec (str_modifier, server->name,
+                                              ptr_data);
+
+        /* no changes in new message */
+        if (new_msg && (strcmp (ptr_data, new_msg) == 0))
         {
-            /*
-             * read message only if connection was not lost
-             * (or if we are on a fake server)
-             */
-            if ((irc_recv_msgq->server->sock != -1)
-                || irc_recv_msgq->server->fake_server)
+            free (new_msg);
+            new_msg = NULL;
+        }
+
+        /* message not dropped? */
+        if (!new_msg || new_msg[0])
+        {
+            /* use new message (returned by plugin) */
+            ptr_msg = (new_msg) ? new_msg : ptr_data;
+
+            while (ptr_msg && ptr_msg[0])
             {
-                ptr_data = irc_recv_msgq->data;
-                while (ptr_data[0] == ' ')
-                {
-                    ptr_data++;
-                }
+                pos = strchr (ptr_msg, '\n');
+                if (pos)
+                    pos[0] = '\0';
 
-                if (ptr_data[0])
+                if (new_msg)
                 {
-                    irc_raw_print (irc_recv_msgq->server, IRC_RAW_FLAG_RECV,
-                                   ptr_data);
-
-                    irc_message_parse (irc_recv_msgq->server,
-                                       ptr_data,
-                                       NULL,  /* tags */
-                                       NULL,  /* message_without_tags */
-                                       NULL,  /* nick */
-                                       NULL,  /* user */
-                                       NULL,  /* host */
-                                       &command,
-                                       NULL,  /* channel */
-                                       NULL,  /* arguments */
-                                       NULL,  /* text */
-                                       NULL,  /* params */
-                                       NULL,  /* num_params */
-                                       NULL,  /* pos_command */
-                                       NULL,  /* pos_arguments */
-                                       NULL,  /* pos_channel */
-                                       NULL);  /* pos_text */
-                    snprintf (str_modifier, sizeof (str_modifier),
-                              "irc_in_%s",
-                              (command) ? command : "unknown");
-                    new_msg = weechat_hook_modifier_exec (
-                        str_modifier,
-                        irc_recv_msgq->server->name,
-                        ptr_data);
+                    irc_raw_print (
+                        server,
+                        IRC_RAW_FLAG_RECV | IRC_RAW_FLAG_MODIFIED,
+                        ptr_msg);
+                    /* message changed by modifier: parse it */
+                    irc_message_parse_spans (server, ptr_msg, &spans);
                     free (command);
+                    command = irc_message_span_dup (ptr_msg,
+                                                    &spans.command);
+                }
+
+                channel = irc_message_span_dup (ptr_msg,
+                                                &spans.channel);
+                ptr_arguments = (spans.arguments.pos >= 0) ?
+                    ptr_msg + spans.arguments.pos : NULL;
 
-                    /* no changes in new message */
-                    if (new_msg && (strcmp (ptr_data, new_msg) == 0))
+                msg_decoded = NULL;
+
+                switch (IRC_SERVER_OPTION_ENUM(server,
+                                               IRC_SERVER_OPTION_CHARSET_MESSAGE))
+                {
+                    case IRC_SERVER_CHARSET_MESSAGE_MESSAGE:
+                        pos_decode = 0;
+                        break;
+                    case IRC_SERVER_CHARSET_MESSAGE_CHANNEL:
+                        pos_decode = (spans.channel.pos >= 0) ?
+                            spans.channel.pos : spans.text.pos;
+                        break;
+                    case IRC_SERVER_CHARSET_MESSAGE_TEXT:
+                        pos_decode = spans.text.pos;
+                        break;
+                    default:
+                        pos_decode = 0;
+                        break;
+                }
+                if (pos_decode >= 0)
+                {
+                    /* convert charset for message */
+                    if (channel
+                        && irc_channel_is_channel (server, channel))
                     {
-                        free (new_msg);
-                        new_msg = NULL;
+                        snprintf (modifier_data, sizeof (modifier_data),
+                                  "%s.%s.%s",
+                                  weechat_plugin->name,
+                                  server->name,
+                                  channel);
                     }
-
-                    /* message not dropped? */
-                    if (!new_msg || new_msg[0])
+                    else
                     {
-                        /* use new message (returned by plugin) */
-                        ptr_msg = (new_msg) ? new_msg : ptr_data;
-
-                        while (ptr_msg && ptr_msg[0])
+                        if ((spans.nick.pos >= 0)
+                            && ((spans.host.pos < 0)
+                                || (spans.nick.length != spans.host.length)
+                                || (strncmp (ptr_msg + spans.nick.pos,
+                                             ptr_msg + spans.host.pos,
+                                             spans.nick.length) != 0)))
                         {
-                            pos = strchr (ptr_msg, '\n');
-                            if (pos)
-                                pos[0] = '\0';
-
-                            if (new_msg)
-                            {
-                                irc_raw_print (
-                                    irc_recv_msgq->server,
-                                    IRC_RAW_FLAG_RECV | IRC_RAW_FLAG_MODIFIED,
-                                    ptr_msg);
-                            }
-
-                            irc_message_parse (irc_recv_msgq->server,
-                                               ptr_msg,
-                                               NULL,  /* tags */
-                                               NULL,  /* message_without_tags */
-                                               &nick,
-                                               NULL,  /* user */
-                                               &host,
-                                               &command,
-                                               &channel,
-                                               &arguments,
-                                               NULL,  /* text */
-                                               NULL,  /* params */
-                                               NULL,  /* num_params */
-                                               NULL,  /* pos_command */
-                                               NULL,  /* pos_arguments */
-                                               &pos_channel,
-                                               &pos_text);
-
-                            msg_decoded = NULL;
-
-                            switch (IRC_SERVER_OPTION_ENUM(irc_recv_msgq->server,
-                                                           IRC_SERVER_OPTION_CHARSET_MESSAGE))
-                            {
-                                case IRC_SERVER_CHARSET_MESSAGE_MESSAGE:
-                                    pos_decode = 0;
-                                    break;
-                                case IRC_SERVER_CHARSET_MESSAGE_CHANNEL:
-                                    pos_decode = (pos_channel >= 0) ? pos_channel : pos_text;
-                                    break;
-                                case IRC_SERVER_CHARSET_MESSAGE_TEXT:
-                                    pos_decode = pos_text;
-                                    break;
-                                default:
-                                    pos_decode = 0;
-                                    break;
-                            }
-                            if (pos_decode >= 0)
-                            {
-                                /* convert charset for message */
-                                if (channel
-                                    && irc_channel_is_channel (irc_recv_msgq->server,
-                                                               channel))
-                                {
-                                    snprintf (modifier_data, sizeof (modifier_data),
-                                              "%s.%s.%s",
-                                              weechat_plugin->name,
-                                              irc_recv_msgq->server->name,
-                                              channel);
-                                }
-                                else
-                                {
-                                    if (nick && (!host || (strcmp (nick, host) != 0)))
-                                    {
-                                        snprintf (modifier_data,
-                                                  sizeof (modifier_data),
-                                                  "%s.%s.%s",
-                                                  weechat_plugin->name,
-                                                  irc_recv_msgq->server->name,
-                                                  nick);
-                                    }
-                                    else
-                                    {
-                                        snprintf (modifier_data,
-                                                  sizeof (modifier_data),
-                                                  "%s.%s",
-                                                  weechat_plugin->name,
-                                                  irc_recv_msgq->server->name);
-                                    }
-                                }
-
-                                /*
-                                 * when UTF8ONLY is enabled, servers must
-                                 * not relay content containing non-UTF-8
-                                 * data to clients; the charset decoding below
-                                 * is then done only if UTF8ONLY is *NOT*
-                                 * enabled
-                                 * (see: https://ircv3.net/specs/extensions/utf8-only)
-                                 */
-                                if (!irc_recv_msgq->server->utf8only)
-                                {
-                                    msg_decoded = irc_message_convert_charset (
-                                        ptr_msg, pos_decode,
-                                        "charset_decode", modifier_data);
-                                }
-                            }
-
-                            /* replace WeeChat internal color codes by "?" */
-                            msg_decoded_without_color =
-                                weechat_string_remove_color (
-                                    (msg_decoded) ? msg_decoded : ptr_msg,
-                                    "?");
-
-                            /* call modifier after charset */
-                            ptr_msg2 = (msg_decoded_without_color) ?
-                                msg_decoded_without_color : ((msg_decoded) ? msg_decoded : ptr_msg);
-                            snprintf (str_modifier, sizeof (str_modifier),
-                                      "irc_in2_%s",
-                                      (command) ? command : "unknown");
-                            new_msg2 = weechat_hook_modifier_exec (
-                                str_modifier,
-                                irc_recv_msgq->server->name,
-                                ptr_msg2);
-                            if (new_msg2 && (strcmp (ptr_msg2, new_msg2) == 0))
-                            {
-                                free (new_msg2);
-                                new_msg2 = NULL;
-                            }
-
-                            /* message not dropped? */
-                            if (!new_msg2 || new_msg2[0])
-                            {
-                                /* use new message (returned by plugin) */
-                                if (new_msg2)
-                                    ptr_msg2 = new_msg2;
-
-                                /* parse and execute command */
-                                if (irc_redirect_message (irc_recv_msgq->server,
-                                                          ptr_msg2, command,
-                                                          arguments))
-                                {
-                                    /* message redirected, we'll not display it! */
-                                }
-                                else
-                                {
-                                    /* message not redirected, display it */
-                                    irc_protocol_recv_command (
-                                        irc_recv_msgq->server,
-                                        ptr_msg2,
-                                        command,
-                                        channel,
-                                        0);  /* ignore_batch_tag */
-                                }
-                            }
-
-                            free (new_msg2);
+                            nick = irc_message_span_dup (
+                                ptr_msg, &spans.nick);
+                            snprintf (modifier_data,
+                                      sizeof (modifier_data),
+                                      "%s.%s.%s",
+                                      weechat_plugin->name,
+                                      server->name,
+                                      (nick) ? nick : "");
                             free (nick);
-                            free (host);
-                            free (command);
-                            free (channel);
-                            free (arguments);
-                            free (msg_decoded);
-                            free (msg_decoded_without_color);
-
-                            if (pos)
-                            {
-                                pos[0] = '\n';
-                                ptr_msg = pos + 1;
-                            }
-                            else
-                                ptr_msg = NULL;
+                        }
+                        else
+                        {
+                            snprintf (modifier_data,
+                                      sizeof (modifier_data),
+                                      "%s.%s",
+                                      weechat_plugin->name,
+                                      server->name);
                         }
                     }
+
+                    /*
+                     * when UTF8ONLY is enabled, servers must
+                     * not relay content containing non-UTF-8
+                     * data to clients; the charset decoding below
+                     * is then done only if UTF8ONLY is *NOT*
+                     * enabled
+                     * (see: https://ircv3.net/specs/extensions/utf8-only)
+                     */
+                    if (!server->utf8only)
+                    {
+                        msg_decoded = irc_message_convert_charset (
+                            ptr_msg, pos_decode,
+                            "charset_decode", modifier_data);
+                    }
+                }
+
+                /* replace WeeChat internal color codes by "?" */
+                msg_decoded_without_color =
+                    weechat_string_remove_color (
+                        (msg_decoded) ? msg_decoded : ptr_msg,
+                        "?");
+
+                /* call modifier after charset */
+                ptr_msg2 = (msg_decoded_without_color) ?
+                    msg_decoded_without_color : ((msg_decoded) ? msg_decoded : ptr_msg);
+                snprintf (str_modifier, sizeof (str_modifier),
+                          "irc_in2_%s",
+                          (command) ? command : "unknown");
+                new_msg2 = weechat_hook_modifier_exec (
+                    str_modifier,
+                    server->name,
+                    ptr_msg2);
+                if (new_msg2 && (strcmp (ptr_msg2, new_msg2) == 0))
+                {
+                    free (new_msg2);
+                    new_msg2 = NULL;
+                }
+
+                /* message not dropped? */
+                if (!new_msg2 || new_msg2[0])
+                {
+                    /* use new message (returned by plugin) */
+                    if (new_msg2)
+                        ptr_msg2 = new_msg2;
+
+                    /* parse and execute command */
+                    if (irc_redirect_message (server,
+                                              ptr_msg2, command,
+                                              ptr_arguments))
+                    {
+                        /* message redirected, we'll not display it! */
+                    }
                     else
                     {
-                        irc_raw_print (irc_recv_msgq->server,
-                                       IRC_RAW_FLAG_RECV | IRC_RAW_FLAG_MODIFIED,
-                                       _("(message dropped)"));
+                        /* message not redirected, display it */
+                        irc_protocol_recv_command (
+                            server,
+                            ptr_msg2,
+                            command,
+                            channel,
+                            0);  /* ignore_batch_tag */
                     }
-                    free (new_msg);
                 }
+
+                free (new_msg2);
+                free (command);
+                command = NULL;
+                free (channel);
+                free (msg_decoded);
+                free (msg_decoded_without_color);
+
+                if (pos)
+                {
+                    pos[0] = '\n';
+                    ptr_msg = pos + 1;
+                }
+                else
+                    ptr_msg = NULL;
             }
-            free (irc_recv_msgq->data);
         }
+        else
+        {
+            irc_raw_print (server,
+                           IRC_RAW_FLAG_RECV | IRC_RAW_FLAG_MODIFIED,
+                           _("(message dropped)"));
+        }
+        free (new_msg);
+        free (command);
+    }
+}
+
+/*
+ * Processes messages received from a server, at most "max_messages"
+ * messages (0 = no limit), so that a flood on a server does not delay other
+ * servers too long.
+ *
+ * On a burst of messages (more than IRC_SERVER_MSGQ_BURST messages), a batch
+ * of lines is started in buffers of server, so that hotlist, nicklist and
+ * buffers are updated only once.
+ *
+ * If this function is called while a message of this server is being
+ * processed (for example with command "/server fakerecv" in a callback),
+ * it does nothing: new messages are processed by the first call.
+ *
+ * Returns:
+ *   1: messages are remaining in queue
+ *   0: queue is empty
+ */
+
+int
+irc_server_msgq_flush_server (struct t_irc_server *server, int max_messages)
+{
+    char *ptr_msg;
+    int length, count, print_batch;
+
+    if (!server || server->recv_buffer_flush)
+        return 0;
+
+    count = 0;
+    print_batch = 0;
+    while (server->recv_buffer
+           && (server->recv_buffer_start < server->recv_buffer_parsed)
+           && ((max_messages <= 0) || (count < max_messages)))
+    {
+        ptr_msg = server->recv_buffer + server->recv_buffer_start;
+        length = strlen (ptr_msg);
+        server->recv_buffer_start += length + 1;
+        if (length == 0)
+            continue;
+
+        /*
+         * read message only if connection was not lost
+         * (or if we are on a fake server)
+         */
+        if ((server->sock == -1) && !server->fake_server)
+            continue;
+
+        /* burst of messages (netsplit, join of many nicks, ...) */
+        if ((count == IRC_SERVER_MSGQ_BURST)
+            && (server->recv_buffer_start < server->recv_buffer_parsed))
+        {
+            print_batch = irc_server_print_batch_start (server);
+        }
+
+        server->recv_buffer_flush = server->recv_buffer;
+        irc_server_msgq_flush_message (server, ptr_msg);
+        if (server->recv_buffer_flush != server->recv_buffer)
+            free (server->recv_buffer_flush);
+        server->recv_buffer_flush = NULL;
+        count++;
+    }
+
+    if (print_batch)
+        irc_server_print_batch_end (server);
+
+    if (!server->recv_buffer)
+        return 0;
+
+    if (server->recv_buffer_start < server->recv_buffer_parsed)
+        return 1;
+
+    if (server->recv_buffer_start == server->recv_buffer_length)
+    {
+        /* buffer is empty: free it if it has grown, otherwise reuse it */
+        if (server->recv_buffer_size > IRC_SERVER_RECV_BUFFER_SIZE * 4)
+        {
+            irc_server_recv_buffer_free (server);
+        }
+        else
+        {
+            server->recv_buffer_start = 0;
+            server->recv_buffer_parsed = 0;
+            server->recv_buffer_length = 0;
+            server->recv_buffer[0] = '\0';
+        }
+    }
+
+    return 0;
+}
 
-        next = irc_recv_msgq->next_message;
-        free (irc_recv_msgq);
-        irc_recv_msgq = next;
-        if (!irc_recv_msgq)
-            irc_msgq_last_msg = NULL;
+/*
+ * Callback of timer used to process messages remaining in receive buffer of
+ * a server.
+ */
+
+int
+irc_server_msgq_timer_cb (const void *pointer, void *data,
+                          int remaining_calls)
+{
+    struct t_irc_server *server;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) remaining_calls;
+
+    server = (struct t_irc_server *)pointer;
+
+    if (!server)
+        return WEECHAT_RC_ERROR;
+
+    server->hook_timer_msgq = NULL;
+
+    if (irc_server_msgq_flush_server (server, IRC_SERVER_MSGQ_FLUSH_MAX))
+        irc_server_msgq_timer_add (server);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Adds timer to process messages remaining in receive buffer of a server
+ * on next main loop iteration (if not already set).
+ */
+
+void
+irc_server_msgq_timer_add (struct t_irc_server *server)
+{
+    if (!server || server->hook_timer_msgq)
+        return;
+
+    server->hook_timer_msgq = weechat_hook_timer (
+        1, 0, 1,
+        &irc_server_msgq_timer_cb,
+        server, NULL);
+}
+
+/*
+ * Processes all messages received from all servers.
+ */
+
+void
+irc_server_msgq_flush ()
+{
+    struct t_irc_server *ptr_server, *ptr_next_server;
+
+    ptr_server = irc_servers;
+    while (ptr_server)
+    {
+        ptr_next_server = ptr_server->next_server;
+        irc_server_msgq_flush_server (ptr_server, 0);
+        ptr_server = ptr_next_server;
     }
 }
 
@@ -3783,7 +4532,7 @@ int
 irc_server_recv_cb (const void *pointer, void *data, int fd)
 {
     struct t_irc_server *server;
-    static char buffer[4096 + 2];
+    char *ptr_buffer;
     int num_read, msgq_flush, end_recv;
 
     /* make C compiler happy */
@@ -3801,22 +4550,33 @@ irc_server_recv_cb (const void *pointer, void *data, int fd)
     {
         end_recv = 1;
 
+        /* read data directly at the end of receive buffer */
+        ptr_buffer = irc_server_recv_buffer_reserve (
+            server, IRC_SERVER_RECV_BUFFER_SIZE);
+        if (!ptr_buffer)
+        {
+            weechat_printf (server->buffer,
+                            _("%s%s: not enough memory for received message"),
+                            weechat_prefix ("error"), IRC_PLUGIN_NAME);
+            return WEECHAT_RC_ERROR;
+        }
+
         if (server->tls_connected)
         {
             if (!server->gnutls_sess)
                 return WEECHAT_RC_ERROR;
-            num_read = gnutls_record_recv (server->gnutls_sess, buffer,
-                                           sizeof (buffer) - 2);
+            num_read = gnutls_record_recv (server->gnutls_sess, ptr_buffer,
+                                           IRC_SERVER_RECV_BUFFER_SIZE);
         }
         else
         {
-            num_read = recv (server->sock, buffer, sizeof (buffer) - 2, 0);
+            num_read = recv (server->sock, ptr_buffer,
+                             IRC_SERVER_RECV_BUFFER_SIZE, 0);
         }
 
         if (num_read > 0)
         {
-            buffer[num_read] = '\0';
-            irc_server_msgq_add_buffer (server, buffer);
+            irc_server_recv_buffer_add (server, num_read);
             msgq_flush = 1;  /* the flush will be done after the loop */
             if (server->tls_connected
                 && (gnutls_record_check_pending (server->gnutls_sess) > 0))
@@ -3872,8 +4632,15 @@ irc_server_recv_cb (const void *pointer, void *data, int fd)
         }
     }
 
-    if (msgq_flush)
-        irc_server_msgq_flush ();
+    /*
+     * process a limited number of messages, the next ones are processed
+     * by a timer, on next main loop iteration
+     */
+    if (msgq_flush
+        && irc_server_msgq_flush_server (server, IRC_SERVER_MSGQ_FLUSH_MAX))
+    {
+        irc_server_msgq_timer_add (server);
+    }
 
     return WEECHAT_RC_OK;
 }
@@ -4257,6 +5024,9 @@ irc_server_close_connection (struct t_irc_server *server)
         weechat_unhook (server->hook_timer_anti_flood);
         server->hook_timer_anti_flood = NULL;
     }
+    server->anti_flood_credit = 0;
+    server->anti_flood_last_refill.tv_sec = 0;
+    server->anti_flood_last_refill.tv_usec = 0;
 
     if (server->hook_fd)
     {
@@ -4290,10 +5060,11 @@ irc_server_close_connection (struct t_irc_server *server)
     }
 
     /* free any pending message */
-    if (server->unterminated_message)
+    irc_server_recv_buffer_free (server);
+    if (server->hook_timer_msgq)
     {
-        free (server->unterminated_message);
-        server->unterminated_message = NULL;
+        weechat_unhook (server->hook_timer_msgq);
+        server->hook_timer_msgq = NULL;
     }
     for (i = 0; i < IRC_SERVER_NUM_OUTQUEUES_PRIO; i++)
     {
@@ -5831,7 +6602,7 @@ irc_server_disconnect (struct t_irc_server *server, int switch_address,
     server->nick_max_length = 0;
     server->user_max_length = 0;
     server->host_max_length = 0;
-    server->casemapping = IRC_SERVER_CASEMAPPING_RFC1459;
+    irc_server_set_casemapping (server, IRC_SERVER_CASEMAPPING_RFC1459);
     server->utf8mapping = IRC_SERVER_UTF8MAPPING_NONE;
     server->utf8only = 0;
     if (server->chantypes)
@@ -6580,6 +7351,7 @@ irc_server_hdata_server_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_server, hook_timer_connection, POINTER, 0, NULL, "hook");
         WEECHAT_HDATA_VAR(struct t_irc_server, hook_timer_sasl, POINTER, 0, NULL, "hook");
         WEECHAT_HDATA_VAR(struct t_irc_server, hook_timer_anti_flood, POINTER, 0, NULL, "hook");
+        WEECHAT_HDATA_VAR(struct t_irc_server, hook_timer_msgq, POINTER, 0, NULL, "hook");
         WEECHAT_HDATA_VAR(struct t_irc_server, sasl_scram_client_first, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, sasl_scram_salted_pwd, OTHER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, sasl_scram_salted_pwd_size, INTEGER, 0, NULL, NULL);
@@ -6594,7 +7366,13 @@ irc_server_hdata_server_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_server, gnutls_sess, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, tls_cert, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, tls_cert_key, POINTER, 0, NULL, NULL);
-        WEECHAT_HDATA_VAR(struct t_irc_server, unterminated_message, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, recv_buffer, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, recv_buffer_size, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, recv_buffer_start, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, recv_buffer_parsed, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, recv_buffer_length, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, recv_buffer_flush, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, print_batch, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, nicks_count, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, nicks_array, STRING, 0, "*,nicks_count", NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, nick_first_tried, INTEGER, 0, NULL, NULL);
@@ -6645,6 +7423,11 @@ irc_server_hdata_server_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_server, last_data_purge, TIME, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, outqueue, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, last_outqueue, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, anti_flood_credit, LONGLONG, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, outqueue_sent, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, outqueue_merged, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, outqueue_latency_total, LONGLONG, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, outqueue_latency_max, LONGLONG, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, redirects, POINTER, 0, NULL, "irc_redirect");
         WEECHAT_HDATA_VAR(struct t_irc_server, last_redirect, POINTER, 0, NULL, "irc_redirect");
         WEECHAT_HDATA_VAR(struct t_irc_server, notify_list, POINTER, 0, NULL, "irc_notify");
@@ -6687,6 +7470,8 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
                             int force_disconnected_state)
 {
     struct t_infolist_item *ptr_item;
+    struct t_infolist_var *ptr_var;
+    char *pending;
     int reconnect_delay, reconnect_start;
     struct timeval lag_check_time;
     time_t lag_next_check;
@@ -6815,6 +7600,9 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
     if (!weechat_infolist_new_var_integer (ptr_item, "anti_flood",
                                            IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD)))
         return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "anti_flood_burst",
+                                           IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST)))
+        return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "away_check",
                                            IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_AWAY_CHECK)))
         return 0;
@@ -6931,7 +7719,11 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
             return 0;
         if (!weechat_infolist_new_var_integer (ptr_item, "disconnected", server->disconnected))
             return 0;
-        if (!weechat_infolist_new_var_string (ptr_item, "unterminated_message", server->unterminated_message))
+        /* data received and not yet processed (restored after upgrade) */
+        pending = irc_server_recv_buffer_pending (server);
+        ptr_var = weechat_infolist_new_var_string (ptr_item, "unterminated_message", pending);
+        free (pending);
+        if (!ptr_var)
             return 0;
         if (!weechat_infolist_new_var_integer (ptr_item, "monitor", server->monitor))
             return 0;
@@ -7024,6 +7816,27 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_time (ptr_item, "last_data_purge", server->last_data_purge))
         return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "outqueue_size_immediate", server->outqueue_size[0]))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "outqueue_size_high", server->outqueue_size[1]))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "outqueue_size_low", server->outqueue_size[2]))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "outqueue_sent", server->outqueue_sent))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "outqueue_merged", server->outqueue_merged))
+        return 0;
+    if (!weechat_infolist_new_var_integer (
+            ptr_item, "outqueue_latency_avg",
+            (server->outqueue_sent > 0) ?
+            (int)(server->outqueue_latency_total / server->outqueue_sent / 1000) : 0))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "outqueue_latency_max",
+                                           (int)(server->outqueue_latency_max / 1000)))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "anti_flood_credit",
+                                           (int)(server->anti_flood_credit / 1000)))
+        return 0;
 
     return 1;
 }
@@ -7295,6 +8108,13 @@ irc_server_print_log ()
         else
             weechat_log_printf ("  anti_flood. . . . . . . . : %d",
                                 weechat_config_integer (ptr_server->options[IRC_SERVER_OPTION_ANTI_FLOOD]));
+        /* anti_flood_burst */
+        if (weechat_config_option_is_null (ptr_server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST]))
+            weechat_log_printf ("  anti_flood_burst. . . . . : null (%d)",
+                                IRC_SERVER_OPTION_INTEGER(ptr_server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST));
+        else
+            weechat_log_printf ("  anti_flood_burst. . . . . : %d",
+                                weechat_config_integer (ptr_server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST]));
         /* away_check */
         if (weechat_config_option_is_null (ptr_server->options[IRC_SERVER_OPTION_AWAY_CHECK]))
             weechat_log_printf ("  away_check. . . . . . . . : null (%d)",
@@ -7351,6 +8171,7 @@ irc_server_print_log ()
         weechat_log_printf ("  hook_timer_connection . . : %p", ptr_server->hook_timer_connection);
         weechat_log_printf ("  hook_timer_sasl . . . . . : %p", ptr_server->hook_timer_sasl);
         weechat_log_printf ("  hook_timer_anti_flood . . : %p", ptr_server->hook_timer_anti_flood);
+        weechat_log_printf ("  hook_timer_msgq . . . . . : %p", ptr_server->hook_timer_msgq);
         weechat_log_printf ("  sasl_scram_client_first . : '%s'", ptr_server->sasl_scram_client_first);
         weechat_log_printf ("  sasl_scram_salted_pwd . . : (hidden)");
         weechat_log_printf ("  sasl_scram_salted_pwd_size: %d", ptr_server->sasl_scram_salted_pwd_size);
@@ -7365,7 +8186,13 @@ irc_server_print_log ()
         weechat_log_printf ("  gnutls_sess . . . . . . . : %p", ptr_server->gnutls_sess);
         weechat_log_printf ("  tls_cert. . . . . . . . . : %p", ptr_server->tls_cert);
         weechat_log_printf ("  tls_cert_key. . . . . . . : %p", ptr_server->tls_cert_key);
-        weechat_log_printf ("  unterminated_message. . . : '%s'", ptr_server->unterminated_message);
+        weechat_log_printf ("  recv_buffer . . . . . . . : %p", ptr_server->recv_buffer);
+        weechat_log_printf ("  recv_buffer_size. . . . . : %d", ptr_server->recv_buffer_size);
+        weechat_log_printf ("  recv_buffer_start . . . . : %d", ptr_server->recv_buffer_start);
+        weechat_log_printf ("  recv_buffer_parsed. . . . : %d", ptr_server->recv_buffer_parsed);
+        weechat_log_printf ("  recv_buffer_length. . . . : %d", ptr_server->recv_buffer_length);
+        weechat_log_printf ("  recv_buffer_flush . . . . : %p", ptr_server->recv_buffer_flush);
+        weechat_log_printf ("  print_batch . . . . . . . : %d", ptr_server->print_batch);
         weechat_log_printf ("  nicks_count . . . . . . . : %d", ptr_server->nicks_count);
         weechat_log_printf ("  nicks_array . . . . . . . : %p", ptr_server->nicks_array);
         weechat_log_printf ("  nick_first_tried. . . . . : %d", ptr_server->nick_first_tried);
@@ -7436,6 +8263,18 @@ irc_server_print_log ()
             weechat_log_printf ("  outqueue[%02d]. . . . . . . : %p", i, ptr_server->outqueue[i]);
             weechat_log_printf ("  last_outqueue[%02d] . . . . : %p", i, ptr_server->last_outqueue[i]);
         }
+        for (i = 0; i < IRC_SERVER_NUM_OUTQUEUES_PRIO; i++)
+        {
+            weechat_log_printf ("  outqueue_size[%02d]. . . . : %d", i, ptr_server->outqueue_size[i]);
+        }
+        weechat_log_printf ("  anti_flood_credit . . . . : %lld", ptr_server->anti_flood_credit);
+        weechat_log_printf ("  anti_flood_last_refill. . : %ld.%06ld",
+                            (long)ptr_server->anti_flood_last_refill.tv_sec,
+                            (long)ptr_server->anti_flood_last_refill.tv_usec);
+        weechat_log_printf ("  outqueue_sent . . . . . . : %d", ptr_server->outqueue_sent);
+        weechat_log_printf ("  outqueue_merged . . . . . : %d", ptr_server->outqueue_merged);
+        weechat_log_printf ("  outqueue_latency_total. . : %lld", ptr_server->outqueue_latency_total);
+        weechat_log_printf ("  outqueue_latency_max. . . : %lld", ptr_server->outqueue_latency_max);
         weechat_log_printf ("  redirects . . . . . . . . : %p", ptr_server->redirects);
         weechat_log_printf ("  last_redirect . . . . . . : %p", ptr_server->last_redirect);
         weechat_log_printf ("  notify_list . . . . . . . : %p", ptr_server->notify_list);
@@ -94,6 +94,7 @@ enum t_irc_server_option
     IRC_SERVER_OPTION_AUTOREJOIN_DELAY,     /* delay before auto rejoin      */
     IRC_SERVER_OPTION_CONNECTION_TIMEOUT,   /* timeout for connection        */
     IRC_SERVER_OPTION_ANTI_FLOOD,           /* anti-flood (in ms)            */
+    IRC_SERVER_OPTION_ANTI_FLOOD_BURST,     /* anti-flood: max burst of msgs */
     IRC_SERVER_OPTION_AWAY_CHECK,           /* delay between away checks     */
     IRC_SERVER_OPTION_AWAY_CHECK_MAX_NICKS, /* max nicks for away check      */
     IRC_SERVER_OPTION_MSG_KICK,             /* default kick message          */
@@ -128,6 +129,15 @@ enum t_irc_server_option
 /* number of queues for sending messages */
 #define IRC_SERVER_NUM_OUTQUEUES_PRIO 3
 
+/* receive buffer: initial size (also max bytes read at once) */
+#define IRC_SERVER_RECV_BUFFER_SIZE 16384
+
+/* max messages received processed at once (then a timer processes others) */
+#define IRC_SERVER_MSGQ_FLUSH_MAX 500
+
+/* messages received processed at once to start a batch of lines in buffers */
+#define IRC_SERVER_MSGQ_BURST 16
+
 /* flags for irc_server_sendf() */
 #define IRC_SERVER_SEND_OUTQ_PRIO_IMMEDIATE (1 << 0)
 #define IRC_SERVER_SEND_OUTQ_PRIO_HIGH      (1 << 1)
@@ -179,6 +189,7 @@ struct t_irc_outqueue
     int modified;                         /* msg was modified by modifier(s) */
     char *tags;                           /* tags (used by Relay plugin)     */
     struct t_irc_redirect *redirect;      /* command redirection             */
+    struct timeval date_added;            /* date of msg added in queue      */
     struct t_irc_outqueue *next_outqueue; /* link to next msg in queue       */
     struct t_irc_outqueue *prev_outqueue; /* link to prev msg in queue       */
 };
@@ -211,6 +222,7 @@ struct t_irc_server
     struct t_hook *hook_timer_connection; /* timer for connection            */
     struct t_hook *hook_timer_sasl; /* timer for SASL authentication         */
     struct t_hook *hook_timer_anti_flood; /* anti-flood timer                */
+    struct t_hook *hook_timer_msgq; /* timer to process received messages    */
     char *sasl_scram_client_first;  /* first message sent for SASL SCRAM     */
     char *sasl_scram_salted_pwd;    /* salted password for SASL SCRAM        */
     int sasl_scram_salted_pwd_size; /* size of salted password for SASL SCRAM*/
@@ -225,7 +237,16 @@ struct t_irc_server
     gnutls_session_t gnutls_sess;   /* gnutls session (only if TLS is used)  */
     gnutls_x509_crt_t tls_cert;     /* certificate used if tls_cert is set   */
     gnutls_x509_privkey_t tls_cert_key; /* key used if tls_cert is set       */
-    char *unterminated_message;     /* beginning of a message in input buf   */
+    char *recv_buffer;              /* data received: messages split in      */
+                                    /* place ('\0' after each message),      */
+                                    /* then an unterminated message          */
+    int recv_buffer_size;           /* allocated size of recv_buffer         */
+    int recv_buffer_start;          /* start of first message to process     */
+    int recv_buffer_parsed;         /* end of complete messages in buffer    */
+    int recv_buffer_length;         /* length of data in recv_buffer         */
+    char *recv_buffer_flush;        /* buffer of message being processed     */
+    int print_batch;                /* 1 if a batch of lines is started in   */
+                                    /* server and channels buffers           */
     int nicks_count;                /* number of nicknames                   */
     char **nicks_array;             /* nicknames (after split)               */
     int nick_first_tried;           /* first nick tried in list of nicks     */
@@ -285,6 +306,17 @@ struct t_irc_server
                                              /* with 2 priorities (high/low) */
     struct t_irc_outqueue *last_outqueue[IRC_SERVER_NUM_OUTQUEUES_PRIO];
                                              /* last outgoing message        */
+    int outqueue_size[IRC_SERVER_NUM_OUTQUEUES_PRIO];
+                                             /* number of messages in queues */
+    long long anti_flood_credit;             /* anti-flood: time credit to   */
+                                             /* send messages (microseconds) */
+    struct timeval anti_flood_last_refill;   /* last refill of credit        */
+    int outqueue_sent;                       /* number of messages sent from */
+                                             /* queues (high/low priority)   */
+    int outqueue_merged;                     /* number of messages merged    */
+                                             /* with previous one in queue   */
+    long long outqueue_latency_total;        /* total/max time spent by msgs */
+    long long outqueue_latency_max;          /* in queues (microseconds)     */
     struct t_irc_redirect *redirects;        /* command redirections         */
     struct t_irc_redirect *last_redirect;    /* last command redirection     */
     struct t_irc_notify *notify_list;        /* list of notify               */
@@ -305,15 +337,6 @@ struct t_irc_server
     struct t_irc_server *next_server;     /* link to next server             */
 };
 
-/* IRC messages */
-
-struct t_irc_message
-{
-    struct t_irc_server *server;        /* server pointer for received msg   */
-    char *data;                         /* message content                   */
-    struct t_irc_message *next_message; /* link to next message              */
-};
-
 /* digest algorithms for fingerprint */
 
 enum t_irc_fingerprint_digest_algo
@@ -332,7 +355,6 @@ extern char *irc_server_chanmodes_default;
 extern struct t_irc_server *irc_servers;
 extern const int gnutls_cert_type_prio[];
 extern const int gnutls_prot_prio[];
-extern struct t_irc_message *irc_recv_msgq, *irc_msgq_last_msg;
 extern char *irc_server_ipv6_string[];
 extern char *irc_server_sasl_fail_string[];
 extern char *irc_server_options[][2];
@@ -347,6 +369,10 @@ extern int irc_server_strcasecmp (struct t_irc_server *server,
 extern int irc_server_strncasecmp (struct t_irc_server *server,
                                    const char *string1, const char *string2,
                                    int max);
+extern char *irc_server_string_casemap (struct t_irc_server *server,
+                                       const char *string);
+extern void irc_server_set_casemapping (struct t_irc_server *server,
+                                        int casemapping);
 extern char *irc_server_eval_expression (struct t_irc_server *server,
                                          const char *string);
 extern void irc_server_sasl_get_creds (struct t_irc_server *server,
@@ -388,6 +414,8 @@ extern const char *irc_server_get_chanmodes (struct t_irc_server *server);
 extern int irc_server_prefix_char_statusmsg (struct t_irc_server *server,
                                              char prefix_char);
 extern int irc_server_get_max_modes (struct t_irc_server *server);
+extern int irc_server_get_targmax (struct t_irc_server *server,
+                                   const char *command);
 extern char *irc_server_get_default_msg (const char *default_msg,
                                          struct t_irc_server *server,
                                          const char *channel_name,
@@ -416,8 +444,19 @@ extern struct t_arraylist *irc_server_sendf (struct t_irc_server *server,
                                              int flags,
                                              const char *tags,
                                              const char *format, ...);
+extern void irc_server_recv_buffer_free (struct t_irc_server *server);
+extern char *irc_server_recv_buffer_reserve (struct t_irc_server *server,
+                                             int size);
+extern void irc_server_recv_buffer_add (struct t_irc_server *server,
+                                        int length);
+extern char *irc_server_recv_buffer_pending (struct t_irc_server *server);
 extern void irc_server_msgq_add_buffer (struct t_irc_server *server,
                                         const char *buffer);
+extern int irc_server_print_batch_start (struct t_irc_server *server);
+extern void irc_server_print_batch_end (struct t_irc_server *server);
+extern int irc_server_msgq_flush_server (struct t_irc_server *server,
+                                         int max_messages);
+extern void irc_server_msgq_timer_add (struct t_irc_server *server);
 extern void irc_server_msgq_flush ();
 extern void irc_server_set_buffer_title (struct t_irc_server *server);
 extern struct t_gui_buffer *irc_server_create_buffer (struct t_irc_server *server);
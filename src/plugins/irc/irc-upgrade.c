@@ -449,8 +449,12 @@ irc_upgrade_read_cb (const void *pointer, void *data,
                         irc_upgrade_current_server->tls_connected = weechat_infolist_integer (infolist, "ssl_connected");
                     irc_upgrade_current_server->disconnected = weechat_infolist_integer (infolist, "disconnected");
                     str = weechat_infolist_string (infolist, "unterminated_message");
-                    if (str)
-                        irc_upgrade_current_server->unterminated_message = strdup (str);
+                    if (str && str[0])
+                    {
+                        irc_server_msgq_add_buffer (irc_upgrade_current_server,
+                                                    str);
+                        irc_server_msgq_timer_add (irc_upgrade_current_server);
+                    }
                     str = weechat_infolist_string (infolist, "nick");
                     if (str)
                         irc_server_set_nick (irc_upgrade_current_server, str);
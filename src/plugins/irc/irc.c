@@ -211,6 +211,8 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 
     irc_redirect_init ();
 
+    irc_protocol_init ();
+
     irc_notify_init ();
 
     /* hook some signals */
@@ -346,6 +348,8 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
 
     irc_redirect_end ();
 
+    irc_protocol_end ();
+
     irc_color_end ();
 
     return WEECHAT_RC_OK;
@@ -44,6 +44,7 @@
 #include "logger-config.h"
 #include "logger-info.h"
 #include "logger-tail.h"
+#include "logger-writer.h"
 
 
 /*
@@ -54,7 +55,7 @@ void
 logger_backlog_display_line (struct t_gui_buffer *buffer, const char *line)
 {
     const char *pos_message;
-    char *str_date, *charset, *pos_tab, *error, *message, *message2;
+    char *str_date, *pos_tab, *error, *message, *message2;
     time_t datetime, time_now;
     struct tm tm_line;
     int color_lines;
@@ -97,10 +98,9 @@ logger_backlog_display_line (struct t_gui_buffer *buffer, const char *line)
         pos_message);
     if (message)
     {
-        charset = weechat_info_get ("charset_terminal", "");
-        message2 = (charset) ?
-            weechat_iconv_to_internal (charset, message) : strdup (message);
-        free (charset);
+        message2 = (logger_charset_terminal) ?
+            weechat_iconv_to_internal (logger_charset_terminal, message) :
+            strdup (message);
         if (message2)
         {
             pos_tab = strchr (message2, '\t');
@@ -258,6 +258,9 @@ logger_backlog_file (struct t_gui_buffer *buffer, const char *filename,
     struct t_arraylist *last_lines, *messages;
     int i, num_msgs, old_input_multiline;
 
+    /* lines not yet written by the writer thread must be in file */
+    logger_writer_sync ();
+
     last_lines = logger_tail_file (filename, lines);
     if (!last_lines)
         return;
@@ -278,6 +281,9 @@ logger_backlog_file (struct t_gui_buffer *buffer, const char *filename,
     old_input_multiline = weechat_buffer_get_integer (buffer, "input_multiline");
     weechat_buffer_set (buffer, "input_multiline", "1");
 
+    /* update hotlist and refresh buffer only once, after all lines */
+    weechat_buffer_set (buffer, "print_batch", "1");
+
     num_msgs = weechat_arraylist_size (messages);
     for (i = 0; i < num_msgs; i++)
     {
@@ -295,9 +301,13 @@ logger_backlog_file (struct t_gui_buffer *buffer, const char *filename,
                                   weechat_color (weechat_config_string (logger_config_color_backlog_end)),
                                   weechat_color (weechat_config_string (logger_config_color_backlog_end)),
                                   num_msgs);
-        weechat_buffer_set (buffer, "unread", "");
     }
 
+    weechat_buffer_set (buffer, "print_batch", "0");
+
+    if (num_msgs > 0)
+        weechat_buffer_set (buffer, "unread", "");
+
     weechat_buffer_set (buffer, "input_multiline",
                         (old_input_multiline) ? "1" : "0");
     weechat_buffer_set (buffer, "print_hooks_enabled", "1");
@@ -35,6 +35,7 @@
 #include "logger.h"
 #include "logger-buffer.h"
 #include "logger-config.h"
+#include "logger-writer.h"
 
 
 char *logger_buffer_compression_extension[LOGGER_BUFFER_NUM_COMPRESSION_TYPES] =
@@ -105,6 +106,8 @@ logger_buffer_add (struct t_gui_buffer *buffer, int log_level)
         new_logger_buffer->write_start_info_line = 1;
         new_logger_buffer->flush_needed = 0;
         new_logger_buffer->compressing = 0;
+        new_logger_buffer->rotate_needed = 0;
+        new_logger_buffer->writer_flush_needed = 0;
 
         new_logger_buffer->prev_buffer = last_logger_buffer;
         new_logger_buffer->next_buffer = NULL;
@@ -236,7 +239,7 @@ logger_buffer_set_log_filename (struct t_logger_buffer *logger_buffer)
 int
 logger_buffer_create_log_file (struct t_logger_buffer *logger_buffer)
 {
-    char *charset, *message, buf_time[256], buf_beginning[1024];
+    char *message, buf_time[256], buf_beginning[1024];
     int log_level, rc;
     struct timeval tv_now;
     struct stat statbuf;
@@ -253,6 +256,7 @@ logger_buffer_create_log_file (struct t_logger_buffer *logger_buffer)
             /* inode has not changed, we can write in this file */
             return 1;
         }
+        logger_writer_sync ();
         fclose (logger_buffer->log_file);
         logger_buffer->log_file = NULL;
         logger_buffer->log_file_inode = 0;
@@ -320,12 +324,11 @@ logger_buffer_create_log_file (struct t_logger_buffer *logger_buffer)
         snprintf (buf_beginning, sizeof (buf_beginning),
                   _("%s\t****  Beginning of log  ****"),
                   buf_time);
-        charset = weechat_info_get ("charset_terminal", "");
-        message = (charset) ?
-            weechat_iconv_from_internal (charset, buf_beginning) : NULL;
+        message = (logger_charset_terminal) ?
+            weechat_iconv_from_internal (logger_charset_terminal,
+                                         buf_beginning) : NULL;
         fprintf (logger_buffer->log_file,
                  "%s\n", (message) ? message : buf_beginning);
-        free (charset);
         free (message);
         logger_buffer->flush_needed = 1;
     }
@@ -514,6 +517,7 @@ logger_buffer_rotate (struct t_logger_buffer *logger_buffer)
     extension_index--;
 
     /* close current log file */
+    logger_writer_sync ();
     fclose (logger_buffer->log_file);
     logger_buffer->log_file = NULL;
     logger_buffer->log_file_inode = 0;
@@ -609,6 +613,33 @@ logger_buffer_rotate (struct t_logger_buffer *logger_buffer)
     }
 }
 
+/*
+ * Rotates log files that reached the max size, as found by the writer thread
+ * after the flush of log files.
+ */
+
+void
+logger_buffer_rotate_from_writer ()
+{
+    struct t_logger_buffer *ptr_logger_buffer;
+
+    if (!logger_writer_rotate_needed ())
+        return;
+
+    logger_writer_sync ();
+
+    for (ptr_logger_buffer = logger_buffers; ptr_logger_buffer;
+         ptr_logger_buffer = ptr_logger_buffer->next_buffer)
+    {
+        if (ptr_logger_buffer->rotate_needed)
+        {
+            ptr_logger_buffer->rotate_needed = 0;
+            if (ptr_logger_buffer->log_file)
+                logger_buffer_rotate (ptr_logger_buffer);
+        }
+    }
+}
+
 /*
  * Writes a line to log file.
  */
@@ -617,7 +648,7 @@ void
 logger_buffer_write_line (struct t_logger_buffer *logger_buffer,
                           const char *format, ...)
 {
-    char *charset, *message;
+    char *message;
 
     if (!logger_buffer_create_log_file (logger_buffer))
         return;
@@ -626,25 +657,37 @@ logger_buffer_write_line (struct t_logger_buffer *logger_buffer,
         return;
 
     weechat_va_format (format);
-    if (vbuffer)
-    {
-        charset = weechat_info_get ("charset_terminal", "");
-        message = (charset) ?
-            weechat_iconv_from_internal (charset, vbuffer) : NULL;
-        fprintf (logger_buffer->log_file,
-                 "%s\n", (message) ? message : vbuffer);
-        free (charset);
-        free (message);
-        logger_buffer->flush_needed = 1;
-        if (!logger_hook_timer)
-        {
-            fflush (logger_buffer->log_file);
-            if (weechat_config_boolean (logger_config_file_fsync))
-                fsync (fileno (logger_buffer->log_file));
-            logger_buffer->flush_needed = 0;
-            logger_buffer_rotate (logger_buffer);
-        }
+    if (!vbuffer)
+        return;
+
+    message = (logger_charset_terminal) ?
+        weechat_iconv_from_internal (logger_charset_terminal, vbuffer) : NULL;
+    if (message)
         free (vbuffer);
+    else
+        message = vbuffer;
+
+    /* line is written (and then freed) by the writer thread */
+    if (logger_writer_add (logger_buffer, message,
+                           (logger_hook_timer) ? 0 : 1))
+    {
+        logger_buffer_rotate_from_writer ();
+        return;
+    }
+
+    /* lines pending in the writer thread must be written before this one */
+    logger_writer_sync ();
+
+    fprintf (logger_buffer->log_file, "%s\n", message);
+    free (message);
+    logger_buffer->flush_needed = 1;
+    if (!logger_hook_timer)
+    {
+        fflush (logger_buffer->log_file);
+        if (weechat_config_boolean (logger_config_file_fsync))
+            fsync (fileno (logger_buffer->log_file));
+        logger_buffer->flush_needed = 0;
+        logger_buffer_rotate (logger_buffer);
     }
 }
 
@@ -779,6 +822,13 @@ logger_buffer_flush ()
 {
     struct t_logger_buffer *ptr_logger_buffer;
 
+    if (logger_writer_running)
+    {
+        /* write and flush pending lines in the writer thread */
+        logger_writer_wake_up ();
+        logger_buffer_rotate_from_writer ();
+    }
+
     for (ptr_logger_buffer = logger_buffers; ptr_logger_buffer;
          ptr_logger_buffer = ptr_logger_buffer->next_buffer)
     {
@@ -876,7 +926,10 @@ logger_buffer_free (struct t_logger_buffer *logger_buffer)
     /* free data */
     free (logger_buffer->log_filename);
     if (logger_buffer->log_file)
+    {
+        logger_writer_sync ();
         fclose (logger_buffer->log_file);
+    }
 
     free (logger_buffer);
 
@@ -51,6 +51,9 @@ struct t_logger_buffer
     int compressing;                      /* compressing rotated log, this  */
                                           /* prevents any new rotation      */
                                           /* before the end of compression  */
+    int rotate_needed;                    /* rotation asked by writer thread*/
+    int writer_flush_needed;              /* flush needed (used only by     */
+                                          /* writer thread)                 */
     struct t_logger_buffer *prev_buffer;  /* link to previous buffer        */
     struct t_logger_buffer *next_buffer;  /* link to next buffer            */
 };
@@ -66,6 +69,7 @@ extern struct t_logger_buffer *logger_buffer_search_log_filename (const char *lo
 extern void logger_buffer_set_log_filename (struct t_logger_buffer *logger_buffer);
 extern int logger_buffer_create_log_file (struct t_logger_buffer *logger_buffer);
 extern void logger_buffer_rotate (struct t_logger_buffer *logger_buffer);
+extern void logger_buffer_rotate_from_writer ();
 extern void logger_buffer_write_line (struct t_logger_buffer *logger_buffer,
                                       const char *format, ...);
 extern void logger_buffer_stop (struct t_logger_buffer *logger_buffer,
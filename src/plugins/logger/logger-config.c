@@ -27,6 +27,7 @@
 #include "logger.h"
 #include "logger-config.h"
 #include "logger-buffer.h"
+#include "logger-writer.h"
 
 
 struct t_config_file *logger_config_file = NULL;
@@ -69,6 +70,7 @@ struct t_config_option *logger_config_file_rotation_compression_level = NULL;
 struct t_config_option *logger_config_file_rotation_compression_type = NULL;
 struct t_config_option *logger_config_file_rotation_size_max = NULL;
 struct t_config_option *logger_config_file_time_format = NULL;
+struct t_config_option *logger_config_file_write_thread = NULL;
 
 /* other */
 
@@ -187,6 +189,28 @@ logger_config_flush_delay_change (const void *pointer, void *data,
     }
 }
 
+/*
+ * Callback for changes on option "logger.file.write_thread".
+ */
+
+void
+logger_config_write_thread_change (const void *pointer, void *data,
+                                   struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    if (logger_config_loading)
+        return;
+
+    if (weechat_config_boolean (logger_config_file_write_thread))
+        logger_writer_start ();
+    else
+        logger_writer_stop ();
+}
+
 /*
  * Callback called when option "logger.file.rotation_size_max" is changed,
  * to check if value is valid.
@@ -718,6 +742,17 @@ logger_config_init ()
                "util_strftimeval in Plugin API reference)"),
             NULL, 0, 0, "%Y-%m-%d %H:%M:%S", NULL, 0,
             NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+        logger_config_file_write_thread = weechat_config_new_option (
+            logger_config_file, logger_config_section_file,
+            "write_thread", "boolean",
+            N_("write lines in log files with a separate thread: the flush "
+               "of log files (and fsync, if enabled) is done by this thread "
+               "once for each batch of lines, so that a slow storage does "
+               "not freeze WeeChat"),
+            NULL, 0, 0, "off", NULL, 0,
+            NULL, NULL, NULL,
+            &logger_config_write_thread_change, NULL, NULL,
+            NULL, NULL, NULL);
     }
 
     /* level */
@@ -757,6 +792,7 @@ logger_config_read ()
     logger_config_loading = 0;
 
     logger_config_flush_delay_change (NULL, NULL, NULL);
+    logger_config_write_thread_change (NULL, NULL, NULL);
 
     return rc;
 }
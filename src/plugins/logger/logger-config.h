@@ -45,6 +45,7 @@ extern struct t_config_option *logger_config_file_rotation_compression_level;
 extern struct t_config_option *logger_config_file_rotation_compression_type;
 extern struct t_config_option *logger_config_file_rotation_size_max;
 extern struct t_config_option *logger_config_file_time_format;
+extern struct t_config_option *logger_config_file_write_thread;
 
 extern unsigned long long logger_config_rotation_size_max;
 
@@ -25,8 +25,10 @@
 
 #include <unistd.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <string.h>
 
@@ -37,17 +39,42 @@
 
 #define LOGGER_TAIL_BUFSIZE 4096
 
+/* byte repeated in a 64-bit word */
+#define LOGGER_TAIL_REPEAT_BYTE(__byte)                                 \
+    ((uint64_t)0x0101010101010101ULL * (uint8_t)(__byte))
+
+/* non-zero if a 64-bit word contains at least one zero byte */
+#define LOGGER_TAIL_HAS_ZERO_BYTE(__word)                               \
+    (((__word) - (uint64_t)0x0101010101010101ULL) & ~(__word)           \
+     & (uint64_t)0x8080808080808080ULL)
+
 
 /*
  * Searches for last EOL in a string.
+ *
+ * The string is scanned backwards by words of 8 bytes, then byte by byte
+ * in the word which contains an EOL.
  */
 
 const char *
 logger_tail_last_eol (const char *string_start, const char *string_ptr)
 {
+    uint64_t word;
+
     if (!string_start || !string_ptr)
         return NULL;
 
+    while (string_ptr - string_start >= 7)
+    {
+        memcpy (&word, string_ptr - 7, sizeof (word));
+        if (LOGGER_TAIL_HAS_ZERO_BYTE(word ^ LOGGER_TAIL_REPEAT_BYTE('\n'))
+            || LOGGER_TAIL_HAS_ZERO_BYTE(word ^ LOGGER_TAIL_REPEAT_BYTE('\r')))
+        {
+            break;
+        }
+        string_ptr -= 8;
+    }
+
     while (string_ptr >= string_start)
     {
         if ((string_ptr[0] == '\n') || (string_ptr[0] == '\r'))
@@ -92,13 +119,14 @@ logger_tail_lines_free_cb (void *data, struct t_arraylist *arraylist,
 }
 
 /*
- * Returns last lines of a file.
+ * Returns last lines of a file, read by blocks from the end of file
+ * (used if the file can not be mapped in memory).
  *
  * Note: result must be freed after use.
  */
 
 struct t_arraylist *
-logger_tail_file (const char *filename, int lines)
+logger_tail_file_read (const char *filename, int lines)
 {
     int fd, count_read;
     off_t file_length, file_pos;
@@ -238,3 +266,143 @@ error:
         close (fd);
     return NULL;
 }
+
+/*
+ * Returns last lines of a file mapped in memory.
+ *
+ * Lines are first searched from the end of file (only the end of file is
+ * read, until the requested number of lines is found), then added to the
+ * arraylist in order.
+ *
+ * Note: result must be freed after use.
+ */
+
+struct t_arraylist *
+logger_tail_data (const char *data, size_t size, int lines)
+{
+    const char *ptr_end, *ptr_start, *ptr_eol, *ptr_line;
+    char *line;
+    struct t_arraylist *list_lines;
+    int count;
+
+    if (!data || (lines < 1))
+        return NULL;
+
+    list_lines = weechat_arraylist_new (lines, 0, 1,
+                                        &logger_tail_lines_cmp_cb, NULL,
+                                        &logger_tail_lines_free_cb, NULL);
+    if (!list_lines)
+        return NULL;
+
+    if (size == 0)
+        return list_lines;
+
+    ptr_end = data + size;
+
+    /* ignore last new line of the file */
+    if ((ptr_end[-1] == '\n') || (ptr_end[-1] == '\r'))
+    {
+        ptr_end--;
+        if (ptr_end == data)
+            return list_lines;
+    }
+
+    /* search start of the first line to return */
+    ptr_start = data;
+    ptr_eol = ptr_end;
+    count = 0;
+    while (ptr_eol > data)
+    {
+        ptr_eol = logger_tail_last_eol (data, ptr_eol - 1);
+        if (!ptr_eol)
+            break;
+        count++;
+        if (count >= lines)
+        {
+            ptr_start = ptr_eol + 1;
+            break;
+        }
+    }
+
+    /*
+     * ignore empty line before the first new line of the file (like
+     * function logger_tail_file_read)
+     */
+    if ((ptr_start == data) && ((data[0] == '\n') || (data[0] == '\r')))
+        ptr_start++;
+
+    /* add lines in arraylist */
+    ptr_line = ptr_start;
+    while (ptr_line <= ptr_end)
+    {
+        ptr_eol = ptr_line;
+        while ((ptr_eol < ptr_end) && (ptr_eol[0] != '\n')
+               && (ptr_eol[0] != '\r'))
+        {
+            ptr_eol++;
+        }
+        line = weechat_strndup (ptr_line, ptr_eol - ptr_line);
+        if (!line)
+        {
+            weechat_arraylist_free (list_lines);
+            return NULL;
+        }
+        weechat_arraylist_add (list_lines, line);
+        ptr_line = ptr_eol + 1;
+    }
+
+    return list_lines;
+}
+
+/*
+ * Returns last lines of a file.
+ *
+ * The file is mapped in memory, so that only the end of file is read;
+ * if the file can not be mapped, it is read by blocks from the end.
+ *
+ * Note: if the file is truncated by another process while it is mapped
+ * (for example by logrotate with option "copytruncate"), reading beyond the
+ * new end of file raises SIGBUS; the file is mapped only while the lines
+ * are searched (rotation done by the logger renames the file, which is
+ * safe).
+ *
+ * Note: result must be freed after use.
+ */
+
+struct t_arraylist *
+logger_tail_file (const char *filename, int lines)
+{
+    int fd;
+    struct stat st;
+    void *data;
+    struct t_arraylist *list_lines;
+
+    if (!filename || !filename[0] || (lines < 1))
+        return NULL;
+
+    fd = open (filename, O_RDONLY);
+    if (fd == -1)
+        return NULL;
+
+    if ((fstat (fd, &st) != 0) || (st.st_size <= 0))
+    {
+        close (fd);
+        return NULL;
+    }
+
+    data = MAP_FAILED;
+    if ((uintmax_t)st.st_size <= (uintmax_t)SIZE_MAX)
+        data = mmap (NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close (fd);
+
+    if (data == MAP_FAILED)
+        return logger_tail_file_read (filename, lines);
+
+    list_lines = logger_tail_data ((const char *)data, (size_t)st.st_size,
+                                   lines);
+
+    munmap (data, (size_t)st.st_size);
+
+    return list_lines;
+}
@@ -0,0 +1,380 @@
+/*
+ * logger-writer.c - thread writing lines in log files
+ *
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * When option logger.file.write_thread is enabled, lines are not written
+ * in log files by the main thread: they are queued and a thread writes them,
+ * then flushes (and optionally syncs) each log file once per batch of lines
+ * (group commit), so that a slow storage does not freeze WeeChat.
+ *
+ * The writer thread never calls the plugin API: it only writes in files
+ * opened by the main thread. The main thread waits for the end of pending
+ * writes (logger_writer_sync) before closing or rotating a log file.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "../weechat-plugin.h"
+#include "logger.h"
+#include "logger-writer.h"
+#include "logger-buffer.h"
+#include "logger-config.h"
+
+
+int logger_writer_running = 0;         /* 1 if writer thread is running     */
+
+pthread_t logger_writer_thread_id;
+pthread_mutex_t logger_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t logger_writer_cond_work = PTHREAD_COND_INITIALIZER;
+pthread_cond_t logger_writer_cond_idle = PTHREAD_COND_INITIALIZER;
+
+/* data below is protected by logger_writer_mutex */
+struct t_logger_writer_record *logger_writer_records = NULL;
+struct t_logger_writer_record *last_logger_writer_record = NULL;
+int logger_writer_wake = 0;            /* 1 if thread must write lines      */
+int logger_writer_busy = 0;            /* 1 if thread is writing lines      */
+int logger_writer_quit = 0;            /* 1 if thread must exit             */
+int logger_writer_rotate = 0;          /* 1 if a log file must be rotated   */
+int logger_writer_fsync = 0;           /* value of logger.file.fsync        */
+unsigned long long logger_writer_rotation_size_max = 0;
+
+
+/*
+ * Writes a batch of lines in log files, then flushes each log file written
+ * (called by the writer thread, without the lock).
+ *
+ * Returns 1 if at least one log file must be rotated, otherwise 0.
+ */
+
+int
+logger_writer_write_records (struct t_logger_writer_record *records,
+                             int use_fsync,
+                             unsigned long long rotation_size_max)
+{
+    struct t_logger_writer_record *ptr_record;
+    struct stat st;
+    int rotate;
+
+    for (ptr_record = records; ptr_record;
+         ptr_record = ptr_record->next_record)
+    {
+        fputs (ptr_record->line, ptr_record->log_file);
+        fputc ('\n', ptr_record->log_file);
+        ptr_record->logger_buffer->writer_flush_needed = 1;
+    }
+
+    rotate = 0;
+    for (ptr_record = records; ptr_record;
+         ptr_record = ptr_record->next_record)
+    {
+        if (!ptr_record->logger_buffer->writer_flush_needed)
+            continue;
+        fflush (ptr_record->log_file);
+        if (use_fsync)
+            fsync (fileno (ptr_record->log_file));
+        ptr_record->logger_buffer->writer_flush_needed = 0;
+        if ((rotation_size_max > 0)
+            && (fstat (fileno (ptr_record->log_file), &st) == 0)
+            && ((unsigned long long)st.st_size > rotation_size_max))
+        {
+            ptr_record->logger_buffer->rotate_needed = 1;
+            rotate = 1;
+        }
+    }
+
+    return rotate;
+}
+
+/*
+ * Frees a list of records.
+ */
+
+void
+logger_writer_free_records (struct t_logger_writer_record *records)
+{
+    struct t_logger_writer_record *next_record;
+
+    while (records)
+    {
+        next_record = records->next_record;
+        free (records->line);
+        free (records);
+        records = next_record;
+    }
+}
+
+/*
+ * Main function of writer thread: waits for lines and writes them.
+ */
+
+void *
+logger_writer_thread (void *arg)
+{
+    struct t_logger_writer_record *records;
+    unsigned long long rotation_size_max;
+    int use_fsync, rotate;
+
+    /* make C compiler happy */
+    (void) arg;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    while (1)
+    {
+        while (!logger_writer_quit
+               && (!logger_writer_wake || !logger_writer_records))
+        {
+            logger_writer_wake = 0;
+            pthread_cond_broadcast (&logger_writer_cond_idle);
+            pthread_cond_wait (&logger_writer_cond_work, &logger_writer_mutex);
+        }
+        if (!logger_writer_records)
+            break;
+
+        /* take all pending lines: they are written as one batch */
+        records = logger_writer_records;
+        logger_writer_records = NULL;
+        last_logger_writer_record = NULL;
+        logger_writer_wake = 0;
+        use_fsync = logger_writer_fsync;
+        rotation_size_max = logger_writer_rotation_size_max;
+        logger_writer_busy = 1;
+        pthread_mutex_unlock (&logger_writer_mutex);
+
+        rotate = logger_writer_write_records (records, use_fsync,
+                                              rotation_size_max);
+        logger_writer_free_records (records);
+
+        pthread_mutex_lock (&logger_writer_mutex);
+        logger_writer_busy = 0;
+        if (rotate)
+            logger_writer_rotate = 1;
+    }
+    pthread_cond_broadcast (&logger_writer_cond_idle);
+    pthread_mutex_unlock (&logger_writer_mutex);
+
+    return NULL;
+}
+
+/*
+ * Starts the writer thread.
+ *
+ * Returns:
+ *   1: OK (thread started or already running)
+ *   0: error
+ */
+
+int
+logger_writer_start ()
+{
+    int rc;
+
+    if (logger_writer_running)
+        return 1;
+
+    logger_writer_records = NULL;
+    last_logger_writer_record = NULL;
+    logger_writer_wake = 0;
+    logger_writer_busy = 0;
+    logger_writer_quit = 0;
+    logger_writer_rotate = 0;
+
+    rc = pthread_create (&logger_writer_thread_id, NULL,
+                         &logger_writer_thread, NULL);
+    if (rc != 0)
+    {
+        weechat_printf_date_tags (
+            NULL, 0, "no_log",
+            _("%s%s: unable to start thread to write log files, lines are "
+              "written by main thread (error: %d)"),
+            weechat_prefix ("error"), LOGGER_PLUGIN_NAME, rc);
+        return 0;
+    }
+
+    logger_writer_running = 1;
+
+    if (weechat_logger_plugin->debug)
+    {
+        weechat_printf_date_tags (NULL, 0, "no_log",
+                                  "%s: writer thread started",
+                                  LOGGER_PLUGIN_NAME);
+    }
+
+    return 1;
+}
+
+/*
+ * Adds a line to write in the log file of a logger buffer (the line is
+ * freed by the writer thread).
+ *
+ * If wake_up == 1, the writer thread writes the line immediately, otherwise
+ * it is written on next call to logger_writer_wake_up (or with another line
+ * added with wake_up == 1).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (line not added)
+ */
+
+int
+logger_writer_add (struct t_logger_buffer *logger_buffer, char *line,
+                   int wake_up)
+{
+    struct t_logger_writer_record *new_record;
+
+    if (!logger_writer_running || !logger_buffer || !logger_buffer->log_file
+        || !line)
+    {
+        return 0;
+    }
+
+    new_record = malloc (sizeof (*new_record));
+    if (!new_record)
+        return 0;
+
+    new_record->logger_buffer = logger_buffer;
+    new_record->log_file = logger_buffer->log_file;
+    new_record->line = line;
+    new_record->next_record = NULL;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    if (last_logger_writer_record)
+        last_logger_writer_record->next_record = new_record;
+    else
+        logger_writer_records = new_record;
+    last_logger_writer_record = new_record;
+    logger_writer_fsync = weechat_config_boolean (logger_config_file_fsync);
+    logger_writer_rotation_size_max = logger_config_rotation_size_max;
+    if (wake_up)
+    {
+        logger_writer_wake = 1;
+        pthread_cond_signal (&logger_writer_cond_work);
+    }
+    pthread_mutex_unlock (&logger_writer_mutex);
+
+    return 1;
+}
+
+/*
+ * Asks the writer thread to write all pending lines.
+ */
+
+void
+logger_writer_wake_up ()
+{
+    if (!logger_writer_running)
+        return;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    logger_writer_wake = 1;
+    pthread_cond_signal (&logger_writer_cond_work);
+    pthread_mutex_unlock (&logger_writer_mutex);
+}
+
+/*
+ * Waits until all pending lines are written by the writer thread.
+ *
+ * This must be called before closing, renaming or reading a log file.
+ */
+
+void
+logger_writer_sync ()
+{
+    if (!logger_writer_running)
+        return;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    if (logger_writer_records)
+    {
+        logger_writer_wake = 1;
+        pthread_cond_signal (&logger_writer_cond_work);
+    }
+    while (logger_writer_records || logger_writer_busy)
+    {
+        pthread_cond_wait (&logger_writer_cond_idle, &logger_writer_mutex);
+    }
+    pthread_mutex_unlock (&logger_writer_mutex);
+}
+
+/*
+ * Checks if the writer thread has found log files to rotate (flag is reset
+ * by this function).
+ *
+ * Logger buffers to rotate have flag "rotate_needed" set to 1, which can be
+ * read safely after a call to logger_writer_sync.
+ *
+ * Returns:
+ *   1: at least one log file must be rotated
+ *   0: no rotation needed
+ */
+
+int
+logger_writer_rotate_needed ()
+{
+    int rotate;
+
+    if (!logger_writer_running)
+        return 0;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    rotate = logger_writer_rotate;
+    logger_writer_rotate = 0;
+    pthread_mutex_unlock (&logger_writer_mutex);
+
+    return rotate;
+}
+
+/*
+ * Stops the writer thread, after all pending lines are written.
+ */
+
+void
+logger_writer_stop ()
+{
+    if (!logger_writer_running)
+        return;
+
+    logger_writer_sync ();
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    logger_writer_quit = 1;
+    pthread_cond_signal (&logger_writer_cond_work);
+    pthread_mutex_unlock (&logger_writer_mutex);
+
+    pthread_join (logger_writer_thread_id, NULL);
+
+    logger_writer_running = 0;
+
+    if (weechat_logger_plugin->debug)
+    {
+        weechat_printf_date_tags (NULL, 0, "no_log",
+                                  "%s: writer thread stopped",
+                                  LOGGER_PLUGIN_NAME);
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_PLUGIN_LOGGER_WRITER_H
+#define WEECHAT_PLUGIN_LOGGER_WRITER_H
+
+#include <stdio.h>
+
+struct t_logger_buffer;
+
+/* line to write in a log file by the writer thread */
+
+struct t_logger_writer_record
+{
+    struct t_logger_buffer *logger_buffer; /* logger buffer                 */
+    FILE *log_file;                    /* log file                          */
+    char *line;                        /* line to write (without "\n")      */
+    struct t_logger_writer_record *next_record; /* link to next record      */
+};
+
+extern int logger_writer_running;
+
+extern int logger_writer_start ();
+extern int logger_writer_add (struct t_logger_buffer *logger_buffer,
+                              char *line, int wake_up);
+extern void logger_writer_wake_up ();
+extern void logger_writer_sync ();
+extern int logger_writer_rotate_needed ();
+extern void logger_writer_stop ();
+
+#endif /* WEECHAT_PLUGIN_LOGGER_WRITER_H */
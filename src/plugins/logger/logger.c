@@ -35,6 +35,7 @@
 #include "logger-config.h"
 #include "logger-info.h"
 #include "logger-tail.h"
+#include "logger-writer.h"
 
 
 WEECHAT_PLUGIN_NAME(LOGGER_PLUGIN_NAME);
@@ -48,6 +49,7 @@ struct t_weechat_plugin *weechat_logger_plugin = NULL;
 
 struct t_hook *logger_hook_timer = NULL;    /* timer to flush log files     */
 struct t_hook *logger_hook_print = NULL;
+char *logger_charset_terminal = NULL;       /* terminal charset (for files) */
 
 
 /*
@@ -782,6 +784,8 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 
     weechat_plugin = plugin;
 
+    logger_charset_terminal = weechat_info_get ("charset_terminal", "");
+
     if (!logger_config_init ())
         return WEECHAT_RC_ERROR;
 
@@ -839,7 +843,12 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
 
     logger_buffer_stop_all (1);
 
+    logger_writer_stop ();
+
     logger_config_free ();
 
+    free (logger_charset_terminal);
+    logger_charset_terminal = NULL;
+
     return WEECHAT_RC_OK;
 }
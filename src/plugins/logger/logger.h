@@ -33,6 +33,7 @@ extern struct t_weechat_plugin *weechat_logger_plugin;
 
 extern struct t_hook *logger_hook_timer;
 extern struct t_hook *logger_hook_print;
+extern char *logger_charset_terminal;
 
 extern int logger_check_conditions (struct t_gui_buffer *buffer,
                                     const char *conditions);
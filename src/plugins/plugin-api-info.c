@@ -35,6 +35,7 @@
 #include "../core/core-hashtable.h"
 #include "../core/core-hook.h"
 #include "../core/core-infolist.h"
+#include "../core/core-profile.h"
 #include "../core/core-proxy.h"
 #include "../core/core-secure.h"
 #include "../core/core-string.h"
@@ -1929,6 +1930,39 @@ plugin_api_infolist_plugin_cb (const void *pointer, void *data,
     return NULL;
 }
 
+/*
+ * Returns WeeChat infolist "profile".
+ *
+ * Note: result must be freed after use with function weechat_infolist_free().
+ */
+
+struct t_infolist *
+plugin_api_infolist_profile_cb (const void *pointer, void *data,
+                                const char *infolist_name,
+                                void *obj_pointer, const char *arguments)
+{
+    struct t_infolist *ptr_infolist;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) infolist_name;
+    (void) obj_pointer;
+    (void) arguments;
+
+    ptr_infolist = infolist_new (NULL);
+    if (!ptr_infolist)
+        return NULL;
+
+    if (!profile_add_to_infolist (ptr_infolist))
+    {
+        infolist_free (ptr_infolist);
+        return NULL;
+    }
+
+    return ptr_infolist;
+}
+
 /*
  * Returns WeeChat infolist "proxy".
  *
@@ -2419,6 +2453,12 @@ plugin_api_info_init ()
                    N_("plugin pointer (optional)"),
                    N_("plugin name (wildcard \"*\" is allowed) (optional)"),
                    &plugin_api_infolist_plugin_cb, NULL, NULL);
+    hook_infolist (NULL, "profile",
+                   N_("statistics of profiler (see /debug profile), sorted "
+                      "by total time"),
+                   NULL,
+                   NULL,
+                   &plugin_api_infolist_profile_cb, NULL, NULL);
     hook_infolist (NULL, "proxy",
                    N_("list of proxies"),
                    N_("proxy pointer (optional)"),
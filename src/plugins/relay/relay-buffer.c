@@ -35,6 +35,7 @@
 
 struct t_gui_buffer *relay_buffer = NULL;
 int relay_buffer_selected_line = 0;
+struct t_hook *relay_buffer_hook_timer_refresh = NULL;
 
 
 /*
@@ -65,6 +66,12 @@ relay_buffer_refresh (const char *hotlist)
     int i, length, line;
     struct tm *date_tmp;
 
+    if (relay_buffer_hook_timer_refresh)
+    {
+        weechat_unhook (relay_buffer_hook_timer_refresh);
+        relay_buffer_hook_timer_refresh = NULL;
+    }
+
     if (!relay_buffer)
         return;
 
@@ -163,6 +170,43 @@ relay_buffer_refresh (const char *hotlist)
         weechat_buffer_set (relay_buffer, "hotlist", hotlist);
 }
 
+/*
+ * Callback for timer used to refresh relay buffer.
+ */
+
+int
+relay_buffer_timer_refresh_cb (const void *pointer, void *data,
+                               int remaining_calls)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) remaining_calls;
+
+    relay_buffer_hook_timer_refresh = NULL;
+
+    relay_buffer_refresh (NULL);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Refreshes relay buffer on next main loop iteration: many refreshes asked
+ * in the same iteration (for example on each data sent to or received from
+ * clients) are done only once.
+ */
+
+void
+relay_buffer_refresh_later ()
+{
+    if (!relay_buffer || relay_buffer_hook_timer_refresh)
+        return;
+
+    relay_buffer_hook_timer_refresh = weechat_hook_timer (
+        1, 0, 1,
+        &relay_buffer_timer_refresh_cb, NULL, NULL);
+}
+
 /*
  * Callback for input data in relay buffer.
  */
@@ -27,6 +27,7 @@ extern int relay_buffer_selected_line;
 
 extern int relay_buffer_is_relay (struct t_gui_buffer *buffer);
 extern void relay_buffer_refresh (const char *hotlist);
+extern void relay_buffer_refresh_later ();
 extern int relay_buffer_input_cb (const void *pointer, void *data,
                                   struct t_gui_buffer *buffer,
                                   const char *input_data);
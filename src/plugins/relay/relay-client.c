@@ -28,6 +28,7 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <gnutls/gnutls.h>
 #include <zlib.h>
 
@@ -700,7 +701,7 @@ relay_client_recv_buffer (struct t_relay_client *client,
             relay_client_recv_text (client, buffer);
         }
     }
-    relay_buffer_refresh (NULL);
+    relay_buffer_refresh_later ();
 }
 
 /*
@@ -795,6 +796,60 @@ relay_client_recv_cb (const void *pointer, void *data, int fd)
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Creates data for out queue (copy of "data").
+ *
+ * The data is created with one reference (for the caller), it can be shared
+ * by out queues of many clients (each message in out queue adds a
+ * reference).
+ *
+ * Returns pointer to new data, NULL if error.
+ */
+
+struct t_relay_client_outqueue_data *
+relay_client_outqueue_data_new (const char *data, int data_size)
+{
+    struct t_relay_client_outqueue_data *new_outqueue_data;
+
+    if (!data || (data_size <= 0))
+        return NULL;
+
+    new_outqueue_data = malloc (sizeof (*new_outqueue_data));
+    if (!new_outqueue_data)
+        return NULL;
+
+    new_outqueue_data->data = malloc (data_size);
+    if (!new_outqueue_data->data)
+    {
+        free (new_outqueue_data);
+        return NULL;
+    }
+    memcpy (new_outqueue_data->data, data, data_size);
+    new_outqueue_data->data_size = data_size;
+    new_outqueue_data->refcount = 1;
+
+    return new_outqueue_data;
+}
+
+/*
+ * Removes a reference on data for out queue, and frees it if it was the
+ * last reference.
+ */
+
+void
+relay_client_outqueue_data_unref (struct t_relay_client_outqueue_data *outqueue_data)
+{
+    if (!outqueue_data)
+        return;
+
+    outqueue_data->refcount--;
+    if (outqueue_data->refcount <= 0)
+    {
+        free (outqueue_data->data);
+        free (outqueue_data);
+    }
+}
+
 /*
  * Frees a message in out queue.
  */
@@ -823,7 +878,7 @@ relay_client_outqueue_free (struct t_relay_client *client,
         (outqueue->next_outqueue)->prev_outqueue = outqueue->prev_outqueue;
 
     /* free data */
-    free (outqueue->data);
+    relay_client_outqueue_data_unref (outqueue->data);
     free (outqueue->raw_message[0]);
     free (outqueue->raw_message[1]);
     free (outqueue);
@@ -845,6 +900,35 @@ relay_client_outqueue_free_all (struct t_relay_client *client)
     }
 }
 
+/*
+ * Prints raw messages of a message in out queue and removes them from the
+ * message (so that they are displayed only one time, even if message is sent
+ * in many chunks).
+ */
+
+void
+relay_client_outqueue_print_raw (struct t_relay_client *client,
+                                 struct t_relay_client_outqueue *outqueue)
+{
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        if (outqueue->raw_message[i])
+        {
+            relay_raw_print_client (client,
+                                    outqueue->raw_msg_type[i],
+                                    outqueue->raw_flags[i],
+                                    outqueue->raw_message[i],
+                                    outqueue->raw_size[i]);
+            outqueue->raw_flags[i] = 0;
+            free (outqueue->raw_message[i]);
+            outqueue->raw_message[i] = NULL;
+            outqueue->raw_size[i] = 0;
+        }
+    }
+}
+
 /*
  * Sends data to a client.
  *
@@ -869,129 +953,225 @@ relay_client_send_data (struct t_relay_client *client,
     }
 }
 
+/*
+ * Sends data corked in the gnutls session of a client.
+ *
+ * Returns:
+ *   >= 0: OK, no more data corked
+ *   < 0: error (if GNUTLS_E_AGAIN or GNUTLS_E_INTERRUPTED, data is still
+ *        corked and must be sent later)
+ */
+
+int
+relay_client_send_corked (struct t_relay_client *client)
+{
+    int rc;
+
+    if (!client->gnutls_corked)
+        return 0;
+
+    rc = gnutls_record_uncork (client->gnutls_sess, 0);
+    if (rc >= 0)
+        client->gnutls_corked = 0;
+
+    return rc;
+}
+
+/*
+ * Sends many buffers to a client: with a single call to writev, or with TLS
+ * records corked then sent together.
+ *
+ * With TLS, the data corked is owned by the gnutls session and is counted as
+ * sent, even if it could not be sent immediately (then the flag
+ * "gnutls_corked" is set in client and data is sent later).
+ *
+ * Returns the number of bytes sent to the client (which can be less than the
+ * total size of buffers), a negative value if error.
+ */
+
+int
+relay_client_send_data_iov (struct t_relay_client *client,
+                            const struct iovec *iov, int iov_count)
+{
+    int i, rc, total;
+
+    if (iov_count == 1)
+    {
+        return relay_client_send_data (client, iov[0].iov_base,
+                                       iov[0].iov_len);
+    }
+
+    if (client->sock < 0)
+    {
+        total = 0;
+        for (i = 0; i < iov_count; i++)
+        {
+            total += iov[i].iov_len;
+        }
+        return total;
+    }
+
+    if (!client->tls)
+        return writev (client->sock, iov, iov_count);
+
+    /*
+     * first buffer is sent alone, because it may be the retry of a send
+     * interrupted (which must be done with the same data)
+     */
+    total = gnutls_record_send (client->gnutls_sess, iov[0].iov_base,
+                                iov[0].iov_len);
+    if (total < (int)iov[0].iov_len)
+        return total;
+
+    gnutls_record_cork (client->gnutls_sess);
+    client->gnutls_corked = 1;
+    for (i = 1; i < iov_count; i++)
+    {
+        rc = gnutls_record_send (client->gnutls_sess, iov[i].iov_base,
+                                 iov[i].iov_len);
+        if (rc < 0)
+            break;
+        total += rc;
+    }
+    rc = relay_client_send_corked (client);
+    if ((rc < 0) && (rc != GNUTLS_E_AGAIN) && (rc != GNUTLS_E_INTERRUPTED))
+        return rc;
+
+    return total;
+}
+
+/*
+ * Checks error returned when sending data to a client: displays the error and
+ * disconnects the client, unless data can be sent later.
+ *
+ * Returns:
+ *   1: data can be sent later (socket not ready)
+ *   0: fatal error, client has been disconnected
+ */
+
+int
+relay_client_send_error (struct t_relay_client *client, int rc)
+{
+    if (client->tls)
+    {
+        if ((rc == GNUTLS_E_AGAIN) || (rc == GNUTLS_E_INTERRUPTED))
+            return 1;
+        weechat_printf_date_tags (
+            NULL, 0, "relay_client",
+            _("%s%s: sending data to client %s%s%s: error %d %s"),
+            weechat_prefix ("error"),
+            RELAY_PLUGIN_NAME,
+            RELAY_COLOR_CHAT_CLIENT,
+            client->desc,
+            RELAY_COLOR_CHAT,
+            rc,
+            gnutls_strerror (rc));
+    }
+    else
+    {
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            return 1;
+        weechat_printf_date_tags (
+            NULL, 0, "relay_client",
+            _("%s%s: sending data to client %s%s%s: error %d %s"),
+            weechat_prefix ("error"),
+            RELAY_PLUGIN_NAME,
+            RELAY_COLOR_CHAT_CLIENT,
+            client->desc,
+            RELAY_COLOR_CHAT,
+            errno,
+            strerror (errno));
+    }
+    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+    return 0;
+}
+
 /*
  * Sends messages in outqueue for a client.
+ *
+ * Many messages are sent with a single call (up to
+ * RELAY_CLIENT_OUTQUEUE_IOV_MAX messages).
  */
 
 void
 relay_client_send_outqueue (struct t_relay_client *client)
 {
-    int i, num_sent;
-    char *buf;
+    struct iovec iov[RELAY_CLIENT_OUTQUEUE_IOV_MAX];
+    struct t_relay_client_outqueue *ptr_outqueue, *ptr_next_outqueue;
+    int num_sent, count, size, total, remaining;
+
+    /* first send data still corked in gnutls session */
+    if (client->gnutls_corked)
+    {
+        num_sent = relay_client_send_corked (client);
+        if (num_sent < 0)
+        {
+            relay_client_send_error (client, num_sent);
+            goto end;
+        }
+    }
 
     while (client->outqueue)
     {
-        num_sent = relay_client_send_data (client,
-                                           client->outqueue->data,
-                                           client->outqueue->data_size);
-        if (num_sent >= 0)
+        count = 0;
+        total = 0;
+        for (ptr_outqueue = client->outqueue;
+             ptr_outqueue && (count < RELAY_CLIENT_OUTQUEUE_IOV_MAX);
+             ptr_outqueue = ptr_outqueue->next_outqueue)
         {
-            for (i = 0; i < 2; i++)
-            {
-                if (client->outqueue->raw_message[i])
-                {
-                    /*
-                     * print raw message and remove it from outqueue
-                     * (so that it is displayed only one time, even if
-                     * message is sent in many chunks)
-                     */
-                    relay_raw_print_client (
-                        client,
-                        client->outqueue->raw_msg_type[i],
-                        client->outqueue->raw_flags[i],
-                        client->outqueue->raw_message[i],
-                        client->outqueue->raw_size[i]);
-                    client->outqueue->raw_flags[i] = 0;
-                    free (client->outqueue->raw_message[i]);
-                    client->outqueue->raw_message[i] = NULL;
-                    client->outqueue->raw_size[i] = 0;
-                }
-            }
-            if (num_sent > 0)
-            {
-                client->bytes_sent += num_sent;
-                relay_buffer_refresh (NULL);
-            }
-            if (num_sent == client->outqueue->data_size)
-            {
-                /* whole data sent, remove outqueue */
-                relay_client_outqueue_free (client, client->outqueue);
-            }
-            else
-            {
-                /*
-                 * some data was not sent, update outqueue and stop
-                 * sending data from outqueue
-                 */
-                if (num_sent > 0)
-                {
-                    buf = malloc (client->outqueue->data_size - num_sent);
-                    if (buf)
-                    {
-                        memcpy (buf,
-                                client->outqueue->data + num_sent,
-                                client->outqueue->data_size - num_sent);
-                        free (client->outqueue->data);
-                        client->outqueue->data = buf;
-                        client->outqueue->data_size = client->outqueue->data_size - num_sent;
-                    }
-                }
-                break;
-            }
+            iov[count].iov_base = ptr_outqueue->data->data
+                + ptr_outqueue->offset;
+            iov[count].iov_len = ptr_outqueue->data->data_size
+                - ptr_outqueue->offset;
+            total += iov[count].iov_len;
+            count++;
         }
-        else
+
+        num_sent = relay_client_send_data_iov (client, iov, count);
+        if (num_sent < 0)
         {
-            if (client->tls)
-            {
-                if ((num_sent == GNUTLS_E_AGAIN)
-                    || (num_sent == GNUTLS_E_INTERRUPTED))
-                {
-                    /* we will retry later this client's queue */
-                    break;
-                }
-                else
-                {
-                    weechat_printf_date_tags (
-                        NULL, 0, "relay_client",
-                        _("%s%s: sending data to client %s%s%s: "
-                          "error %d %s"),
-                        weechat_prefix ("error"),
-                        RELAY_PLUGIN_NAME,
-                        RELAY_COLOR_CHAT_CLIENT,
-                        client->desc,
-                        RELAY_COLOR_CHAT,
-                        num_sent,
-                        gnutls_strerror (num_sent));
-                    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
-                }
-            }
-            else
+            relay_client_send_error (client, num_sent);
+            break;
+        }
+
+        if (num_sent > 0)
+        {
+            client->bytes_sent += num_sent;
+            relay_buffer_refresh_later ();
+        }
+
+        /*
+         * remove messages sent and update offset in the message partially
+         * sent (raw message is printed for first message, even if nothing
+         * was sent)
+         */
+        size = num_sent;
+        ptr_outqueue = client->outqueue;
+        while (ptr_outqueue)
+        {
+            ptr_next_outqueue = ptr_outqueue->next_outqueue;
+            relay_client_outqueue_print_raw (client, ptr_outqueue);
+            remaining = ptr_outqueue->data->data_size - ptr_outqueue->offset;
+            if (size < remaining)
             {
-                if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                {
-                    /* we will retry later this client's queue */
-                    break;
-                }
-                else
-                {
-                    weechat_printf_date_tags (
-                        NULL, 0, "relay_client",
-                        _("%s%s: sending data to client %s%s%s: "
-                          "error %d %s"),
-                        weechat_prefix ("error"),
-                        RELAY_PLUGIN_NAME,
-                        RELAY_COLOR_CHAT_CLIENT,
-                        client->desc,
-                        RELAY_COLOR_CHAT,
-                        errno,
-                        strerror (errno));
-                    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
-                }
+                ptr_outqueue->offset += size;
+                break;
             }
+            size -= remaining;
+            relay_client_outqueue_free (client, ptr_outqueue);
+            if (size == 0)
+                break;
+            ptr_outqueue = ptr_next_outqueue;
         }
+
+        /* some data was not sent: stop sending data from outqueue */
+        if ((num_sent < total) || client->gnutls_corked)
+            break;
     }
 
-    if (!client->outqueue && client->hook_timer_send)
+end:
+    /* timer is kept while some data is corked (sent by the timer) */
+    if (!client->outqueue && !client->gnutls_corked && client->hook_timer_send)
     {
         weechat_unhook (client->hook_timer_send);
         client->hook_timer_send = NULL;
@@ -1024,11 +1204,18 @@ relay_client_timer_send_cb (const void *pointer, void *data,
 
 /*
  * Adds a message in out queue.
+ *
+ * The bytes before "offset" in data have already been sent.
+ *
+ * If "shared_data" is not NULL, the data is shared with other clients: it is
+ * created in *shared_data if needed, and a reference is added (no copy of
+ * data).
  */
 
 void
 relay_client_outqueue_add (struct t_relay_client *client,
-                           const char *data, int data_size,
+                           const char *data, int data_size, int offset,
+                           struct t_relay_client_outqueue_data **shared_data,
                            enum t_relay_msg_type raw_msg_type[2],
                            int raw_flags[2],
                            const char *raw_message[2],
@@ -1037,22 +1224,35 @@ relay_client_outqueue_add (struct t_relay_client *client,
     struct t_relay_client_outqueue *new_outqueue;
     int i;
 
-    if (!client || !data || (data_size <= 0))
+    if (!client || !data || (offset < 0) || (data_size <= offset))
         return;
 
     new_outqueue = malloc (sizeof (*new_outqueue));
     if (!new_outqueue)
         return;
 
-    new_outqueue->data = malloc (data_size);
+    if (shared_data)
+    {
+        if (!*shared_data)
+            *shared_data = relay_client_outqueue_data_new (data, data_size);
+        new_outqueue->data = *shared_data;
+        new_outqueue->offset = offset;
+        if (new_outqueue->data)
+            new_outqueue->data->refcount++;
+    }
+    else
+    {
+        /* copy only data not yet sent */
+        new_outqueue->data = relay_client_outqueue_data_new (
+            data + offset, data_size - offset);
+        new_outqueue->offset = 0;
+    }
     if (!new_outqueue->data)
     {
         free (new_outqueue);
         return;
     }
 
-    memcpy (new_outqueue->data, data, data_size);
-    new_outqueue->data_size = data_size;
     for (i = 0; i < 2; i++)
     {
         new_outqueue->raw_msg_type[i] = RELAY_MSG_STANDARD;
@@ -1095,14 +1295,20 @@ relay_client_outqueue_add (struct t_relay_client *client,
  * If "message_raw_buffer" is not NULL, it is used for display in raw buffer
  * and replaces display of data, which is default.
  *
+ * If "shared_data" is not NULL, the same data is sent to many clients: if
+ * data must be added in out queue, it is shared by all clients (created in
+ * *shared_data on first use, the caller must remove its reference with
+ * relay_client_outqueue_data_unref when done).
+ *
  * Returns number of bytes sent to client, -1 if error.
  */
 
 int
-relay_client_send (struct t_relay_client *client,
-                   enum t_relay_msg_type msg_type,
-                   const char *data, int data_size,
-                   const char *message_raw_buffer)
+relay_client_send_shared (struct t_relay_client *client,
+                          enum t_relay_msg_type msg_type,
+                          const char *data, int data_size,
+                          const char *message_raw_buffer,
+                          struct t_relay_client_outqueue_data **shared_data)
 {
     int num_sent, raw_size[2], raw_flags[2], opcode, i;
     enum t_relay_msg_type raw_msg_type[2];
@@ -1205,9 +1411,10 @@ relay_client_send (struct t_relay_client *client,
      * if outqueue is not empty, add to outqueue
      * (because message must be sent *after* messages already in outqueue)
      */
-    if (client->outqueue)
+    if (client->outqueue || client->gnutls_corked)
     {
-        relay_client_outqueue_add (client, ptr_data, data_size,
+        relay_client_outqueue_add (client, ptr_data, data_size, 0,
+                                   (ptr_data == data) ? shared_data : NULL,
                                    raw_msg_type, raw_flags, raw_msg, raw_size);
     }
     else
@@ -1227,69 +1434,25 @@ relay_client_send (struct t_relay_client *client,
             if (num_sent > 0)
             {
                 client->bytes_sent += num_sent;
-                relay_buffer_refresh (NULL);
+                relay_buffer_refresh_later ();
             }
             if (num_sent < data_size)
             {
                 /* some data was not sent, add it to outqueue */
-                relay_client_outqueue_add (client,
-                                           ptr_data + num_sent,
-                                           data_size - num_sent,
+                relay_client_outqueue_add (client, ptr_data, data_size,
+                                           num_sent,
+                                           (ptr_data == data) ?
+                                           shared_data : NULL,
                                            NULL, NULL, NULL, NULL);
             }
         }
-        else
+        else if (relay_client_send_error (client, num_sent))
         {
-            if (client->tls)
-            {
-                if ((num_sent == GNUTLS_E_AGAIN)
-                    || (num_sent == GNUTLS_E_INTERRUPTED))
-                {
-                    /* add message to queue (will be sent later) */
-                    relay_client_outqueue_add (client,
-                                               ptr_data, data_size,
-                                               raw_msg_type, raw_flags,
-                                               raw_msg, raw_size);
-                }
-                else
-                {
-                    weechat_printf_date_tags (
-                        NULL, 0, "relay_client",
-                        _("%s%s: sending data to client %s%s%s: error %d %s"),
-                        weechat_prefix ("error"),
-                        RELAY_PLUGIN_NAME,
-                        RELAY_COLOR_CHAT_CLIENT,
-                        client->desc,
-                        RELAY_COLOR_CHAT,
-                        num_sent,
-                        gnutls_strerror (num_sent));
-                    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
-                }
-            }
-            else
-            {
-                if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                {
-                    /* add message to queue (will be sent later) */
-                    relay_client_outqueue_add (client, ptr_data, data_size,
-                                               raw_msg_type, raw_flags,
-                                               raw_msg, raw_size);
-                }
-                else
-                {
-                    weechat_printf_date_tags (
-                        NULL, 0, "relay_client",
-                        _("%s%s: sending data to client %s%s%s: error %d %s"),
-                        weechat_prefix ("error"),
-                        RELAY_PLUGIN_NAME,
-                        RELAY_COLOR_CHAT_CLIENT,
-                        client->desc,
-                        RELAY_COLOR_CHAT,
-                        errno,
-                        strerror (errno));
-                    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
-                }
-            }
+            /* add message to queue (will be sent later) */
+            relay_client_outqueue_add (client, ptr_data, data_size, 0,
+                                       (ptr_data == data) ? shared_data : NULL,
+                                       raw_msg_type, raw_flags,
+                                       raw_msg, raw_size);
         }
     }
 
@@ -1298,6 +1461,25 @@ relay_client_send (struct t_relay_client *client,
     return num_sent;
 }
 
+/*
+ * Sends data to client (adds in out queue if it's impossible to send now).
+ *
+ * If "message_raw_buffer" is not NULL, it is used for display in raw buffer
+ * and replaces display of data, which is default.
+ *
+ * Returns number of bytes sent to client, -1 if error.
+ */
+
+int
+relay_client_send (struct t_relay_client *client,
+                   enum t_relay_msg_type msg_type,
+                   const char *data, int data_size,
+                   const char *message_raw_buffer)
+{
+    return relay_client_send_shared (client, msg_type, data, data_size,
+                                     message_raw_buffer, NULL);
+}
+
 /*
  * Timer callback, called each second.
  */
@@ -1375,6 +1557,7 @@ relay_client_new (int sock, const char *address, struct t_relay_server *server)
         new_client->fake_send_func = NULL;
         new_client->hook_timer_handshake = NULL;
         new_client->gnutls_handshake_ok = 0;
+        new_client->gnutls_corked = 0;
         new_client->websocket = RELAY_CLIENT_WEBSOCKET_NOT_USED;
         new_client->ws_deflate = relay_websocket_deflate_alloc ();
         new_client->http_req = relay_http_request_alloc ();
@@ -1606,6 +1789,7 @@ relay_client_new_with_infolist (struct t_infolist *infolist)
         new_client->fake_send_func = NULL;
         new_client->hook_timer_handshake = NULL;
         new_client->gnutls_handshake_ok = 0;
+        new_client->gnutls_corked = 0;
         new_client->websocket = weechat_infolist_integer (infolist, "websocket");
         new_client->ws_deflate = relay_websocket_deflate_alloc ();
         new_client->ws_deflate->enabled = weechat_infolist_integer (infolist, "ws_deflate_enabled");
@@ -1799,6 +1983,7 @@ relay_client_set_status (struct t_relay_client *client,
             client->hook_timer_handshake = NULL;
         }
         client->gnutls_handshake_ok = 0;
+        client->gnutls_corked = 0;
         if (client->hook_fd)
         {
             weechat_unhook (client->hook_fd);
@@ -2188,6 +2373,7 @@ relay_client_print_log ()
         weechat_log_printf ("  fake_send_func. . . . . . : %p", ptr_client->fake_send_func);
         weechat_log_printf ("  hook_timer_handshake. . . : %p", ptr_client->hook_timer_handshake);
         weechat_log_printf ("  gnutls_handshake_ok . . . : %p", ptr_client->gnutls_handshake_ok);
+        weechat_log_printf ("  gnutls_corked . . . . . . : %d", ptr_client->gnutls_corked);
         weechat_log_printf ("  websocket . . . . . . . . ; %d", ptr_client->websocket);
         relay_websocket_deflate_print_log (ptr_client->ws_deflate, "");
         relay_http_print_log_request (ptr_client->http_req);
@@ -57,10 +57,20 @@ typedef void (t_relay_fake_send_func)(void *client,
 
 /* output queue of messages to client */
 
-struct t_relay_client_outqueue
+#define RELAY_CLIENT_OUTQUEUE_IOV_MAX 64 /* max messages sent in one call   */
+
+struct t_relay_client_outqueue_data
 {
     char *data;                         /* data to send                     */
     int data_size;                      /* number of bytes                  */
+    int refcount;                       /* number of references (outqueue  */
+                                        /* of clients and owner of data)    */
+};
+
+struct t_relay_client_outqueue
+{
+    struct t_relay_client_outqueue_data *data; /* data (can be shared)      */
+    int offset;                         /* number of bytes already sent     */
     int raw_msg_type[2];                /* msgs types                       */
     int raw_flags[2];                   /* flags for raw messages           */
     char *raw_message[2];               /* msgs for raw buffer (can be NULL)*/
@@ -83,6 +93,8 @@ struct t_relay_client
                                        /* (used in tests only)              */
     struct t_hook *hook_timer_handshake; /* timer for doing gnutls handshake*/
     int gnutls_handshake_ok;           /* 1 if handshake was done and OK    */
+    int gnutls_corked;                 /* 1 if some data is still corked in */
+                                       /* gnutls session (not yet sent)     */
     enum t_relay_client_websocket_status websocket; /* websocket status     */
     struct t_relay_websocket_deflate *ws_deflate; /* websocket deflate data */
     struct t_relay_http_request *http_req; /* HTTP request                  */
@@ -127,6 +139,14 @@ extern void relay_client_set_desc (struct t_relay_client *client);
 extern void relay_client_recv_buffer (struct t_relay_client *client,
                                       const char *buffer, int buffer_size);
 extern int relay_client_recv_cb (const void *pointer, void *data, int fd);
+extern struct t_relay_client_outqueue_data *relay_client_outqueue_data_new (const char *data,
+                                                                            int data_size);
+extern void relay_client_outqueue_data_unref (struct t_relay_client_outqueue_data *outqueue_data);
+extern int relay_client_send_shared (struct t_relay_client *client,
+                                     enum t_relay_msg_type msg_type,
+                                     const char *data, int data_size,
+                                     const char *message_raw_buffer,
+                                     struct t_relay_client_outqueue_data **shared_data);
 extern int relay_client_send (struct t_relay_client *client,
                               enum t_relay_msg_type msg_type,
                               const char *data,
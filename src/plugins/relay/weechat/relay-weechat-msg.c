@@ -54,6 +54,7 @@ struct t_relay_weechat_msg *
 relay_weechat_msg_new (const char *id)
 {
     struct t_relay_weechat_msg *new_msg;
+    int i;
 
     new_msg = malloc (sizeof (*new_msg));
     if (!new_msg)
@@ -68,6 +69,13 @@ relay_weechat_msg_new (const char *id)
     }
     new_msg->data_alloc = RELAY_WEECHAT_MSG_INITIAL_ALLOC;
     new_msg->data_size = 0;
+    for (i = 0; i < RELAY_WEECHAT_NUM_COMPRESSIONS; i++)
+    {
+        new_msg->compressed[i] = NULL;
+        new_msg->compressed_size[i] = 0;
+        new_msg->compressed_raw[i] = NULL;
+        new_msg->shared[i] = NULL;
+    }
 
     /* add size and compression flag (they will be set later) */
     relay_weechat_msg_add_int (new_msg, 0);
@@ -1061,14 +1069,16 @@ relay_weechat_msg_add_nicklist (struct t_relay_weechat_msg *msg,
 /*
  * Compresses the message with zlib.
  *
+ * The compressed data is stored in the message, so that it is compressed only
+ * once if the message is sent to multiple clients.
+ *
  * Returns:
- *   1: OK, message compressed and sent
- *   0: error, no message sent
+ *   1: OK, message compressed
+ *   0: error, message not compressed
  */
 
 int
-relay_weechat_msg_compress_zlib (struct t_relay_client *client,
-                                 struct t_relay_weechat_msg *msg)
+relay_weechat_msg_compress_zlib (struct t_relay_weechat_msg *msg)
 {
     char raw_message[1024];
     uint32_t size32;
@@ -1076,10 +1086,7 @@ relay_weechat_msg_compress_zlib (struct t_relay_client *client,
     uLongf dest_size;
     struct timeval tv1, tv2;
     long long time_diff;
-    int rc, rc_compress, compression, compression_level;
-
-    rc = 0;
-    dest = NULL;
+    int rc_compress, compression, compression_level;
 
     dest_size = compressBound (msg->data_size - 5);
     dest = malloc (dest_size + 5);
@@ -1107,7 +1114,7 @@ relay_weechat_msg_compress_zlib (struct t_relay_client *client,
     memcpy (dest, &size32, 4);
     dest[4] = RELAY_WEECHAT_COMPRESSION_ZLIB;
 
-    /* display message in raw buffer */
+    /* message displayed in raw buffer */
     snprintf (raw_message, sizeof (raw_message),
               "obj: %d/%d bytes (zlib: %d%%, %.2fms), id: %s",
               (int)dest_size + 5,
@@ -1116,30 +1123,31 @@ relay_weechat_msg_compress_zlib (struct t_relay_client *client,
               ((float)time_diff) / 1000,
               msg->id);
 
-    /* send compressed data */
-    relay_client_send (client, RELAY_MSG_STANDARD,
-                       (const char *)dest, dest_size + 5,
-                       raw_message);
+    msg->compressed[RELAY_WEECHAT_COMPRESSION_ZLIB] = (char *)dest;
+    msg->compressed_size[RELAY_WEECHAT_COMPRESSION_ZLIB] = dest_size + 5;
+    msg->compressed_raw[RELAY_WEECHAT_COMPRESSION_ZLIB] = strdup (raw_message);
 
-    rc = 1;
+    return 1;
 
 error:
     free (dest);
-
-    return rc;
+    msg->compressed_size[RELAY_WEECHAT_COMPRESSION_ZLIB] = -1;
+    return 0;
 }
 
 /*
  * Compresses the message with zstd.
  *
+ * The compressed data is stored in the message, so that it is compressed only
+ * once if the message is sent to multiple clients.
+ *
  * Returns:
- *   1: OK, message compressed and sent
- *   0: error, no message sent
+ *   1: OK, message compressed
+ *   0: error, message not compressed
  */
 
 int
-relay_weechat_msg_compress_zstd (struct t_relay_client *client,
-                                 struct t_relay_weechat_msg *msg)
+relay_weechat_msg_compress_zstd (struct t_relay_weechat_msg *msg)
 {
 #ifdef HAVE_ZSTD
     char raw_message[1024];
@@ -1148,10 +1156,7 @@ relay_weechat_msg_compress_zstd (struct t_relay_client *client,
     size_t dest_size, comp_size;
     struct timeval tv1, tv2;
     long long time_diff;
-    int rc, compression, compression_level;
-
-    rc = 0;
-    dest = NULL;
+    int compression, compression_level;
 
     dest_size = ZSTD_compressBound (msg->data_size - 5);
     dest = malloc (dest_size + 5);
@@ -1179,7 +1184,7 @@ relay_weechat_msg_compress_zstd (struct t_relay_client *client,
     memcpy (dest, &size32, 4);
     dest[4] = RELAY_WEECHAT_COMPRESSION_ZSTD;
 
-    /* display message in raw buffer */
+    /* message displayed in raw buffer */
     snprintf (raw_message, sizeof (raw_message),
               "obj: %d/%d bytes (zstd: %d%%, %.2fms), id: %s",
               (int)comp_size + 5,
@@ -1188,17 +1193,180 @@ relay_weechat_msg_compress_zstd (struct t_relay_client *client,
               ((float)time_diff) / 1000,
               msg->id);
 
-    /* send compressed data */
-    relay_client_send (client, RELAY_MSG_STANDARD,
-                       (const char *)dest, comp_size + 5,
-                       raw_message);
+    msg->compressed[RELAY_WEECHAT_COMPRESSION_ZSTD] = (char *)dest;
+    msg->compressed_size[RELAY_WEECHAT_COMPRESSION_ZSTD] = comp_size + 5;
+    msg->compressed_raw[RELAY_WEECHAT_COMPRESSION_ZSTD] = strdup (raw_message);
 
-    rc = 1;
+    return 1;
 
 error:
     free (dest);
+    msg->compressed_size[RELAY_WEECHAT_COMPRESSION_ZSTD] = -1;
+    return 0;
+#else
+    /* make C compiler happy */
+    (void) msg;
 
-    return rc;
+    return 0;
+#endif /* HAVE_ZSTD */
+}
+
+/*
+ * Compresses the message with a zstd stream: the stream is kept between
+ * messages (so that data of previous messages is used to compress the next
+ * ones) and it is flushed after each message.
+ *
+ * Note: the client must decompress all messages with the same zstd stream;
+ * if an error occurs, the stream is reset and the next message starts a new
+ * zstd frame.
+ *
+ * Returns compressed message (with header), NULL if error; the size of
+ * compressed message is set in *size and the message for raw buffer is set
+ * in raw_message.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+relay_weechat_msg_compress_zstd_stream (struct t_relay_weechat_msg *msg,
+                                        void *zstd_stream,
+                                        int *size,
+                                        char *raw_message,
+                                        int raw_message_size)
+{
+#ifdef HAVE_ZSTD
+    ZSTD_inBuffer input;
+    ZSTD_outBuffer output;
+    uint32_t size32;
+    char *dest, *dest2;
+    size_t dest_size, remaining;
+    struct timeval tv1, tv2;
+    long long time_diff;
+
+    if (!msg || !zstd_stream || !size)
+        return NULL;
+
+    dest_size = ZSTD_compressBound (msg->data_size - 5) + 5;
+    dest = malloc (dest_size);
+    if (!dest)
+        return NULL;
+
+    input.src = msg->data + 5;
+    input.size = msg->data_size - 5;
+    input.pos = 0;
+    output.dst = dest + 5;
+    output.size = dest_size - 5;
+    output.pos = 0;
+
+    gettimeofday (&tv1, NULL);
+    while (1)
+    {
+        remaining = ZSTD_compressStream2 ((ZSTD_CCtx *)zstd_stream,
+                                          &output, &input, ZSTD_e_flush);
+        if (ZSTD_isError (remaining))
+            goto error;
+        if (remaining == 0)
+            break;
+        /* output buffer is full, make it bigger */
+        dest2 = realloc (dest, dest_size + ZSTD_CStreamOutSize ());
+        if (!dest2)
+            goto error;
+        dest = dest2;
+        dest_size += ZSTD_CStreamOutSize ();
+        output.dst = dest + 5;
+        output.size = dest_size - 5;
+    }
+    gettimeofday (&tv2, NULL);
+    time_diff = weechat_util_timeval_diff (&tv1, &tv2);
+
+    /* set size and compression flag */
+    size32 = htonl ((uint32_t)(output.pos + 5));
+    memcpy (dest, &size32, 4);
+    dest[4] = RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM;
+
+    *size = output.pos + 5;
+
+    /* message displayed in raw buffer */
+    if (raw_message)
+    {
+        snprintf (raw_message, raw_message_size,
+                  "obj: %d/%d bytes (zstd_stream: %d%%, %.2fms), id: %s",
+                  *size,
+                  msg->data_size,
+                  100 - ((*size * 100) / msg->data_size),
+                  ((float)time_diff) / 1000,
+                  msg->id);
+    }
+
+    return dest;
+
+error:
+    /*
+     * the stream is in an undefined state after an error (or contains data
+     * that is never sent): reset it so that next message starts a new frame
+     */
+    ZSTD_CCtx_reset ((ZSTD_CCtx *)zstd_stream, ZSTD_reset_session_only);
+    free (dest);
+    return NULL;
+#else
+    /* make C compiler happy */
+    (void) msg;
+    (void) zstd_stream;
+    (void) size;
+    (void) raw_message;
+    (void) raw_message_size;
+
+    return NULL;
+#endif /* HAVE_ZSTD */
+}
+
+/*
+ * Sends a message compressed with the zstd stream of client (the stream is
+ * created on first use).
+ *
+ * Returns:
+ *   1: OK, message compressed and sent
+ *   0: error, no message sent
+ */
+
+int
+relay_weechat_msg_send_zstd_stream (struct t_relay_client *client,
+                                    struct t_relay_weechat_msg *msg)
+{
+#ifdef HAVE_ZSTD
+    char *data, raw_message[1024];
+    int size, compression;
+
+    if (!RELAY_WEECHAT_DATA(client, zstd_stream))
+    {
+        RELAY_WEECHAT_DATA(client, zstd_stream) = ZSTD_createCCtx ();
+        if (!RELAY_WEECHAT_DATA(client, zstd_stream))
+            return 0;
+    }
+
+    /*
+     * convert % to zstd compression level (1-19), set on each message so
+     * that a change of option applies to existing clients
+     */
+    compression = weechat_config_integer (relay_config_network_compression);
+    ZSTD_CCtx_setParameter (RELAY_WEECHAT_DATA(client, zstd_stream),
+                            ZSTD_c_compressionLevel,
+                            (((compression - 1) * 19) / 100) + 1);
+
+    data = relay_weechat_msg_compress_zstd_stream (
+        msg,
+        RELAY_WEECHAT_DATA(client, zstd_stream),
+        &size,
+        raw_message,
+        sizeof (raw_message));
+    if (!data)
+        return 0;
+
+    relay_client_send (client, RELAY_MSG_STANDARD, data, size, raw_message);
+
+    free (data);
+
+    return 1;
 #else
     /* make C compiler happy */
     (void) client;
@@ -1210,6 +1378,10 @@ error:
 
 /*
  * Sends a message.
+ *
+ * The message can be sent to multiple clients: it is compressed only once
+ * for each compression type, and data added in out queue of clients is
+ * shared (the message must not be modified after it has been sent).
  */
 
 void
@@ -1218,23 +1390,56 @@ relay_weechat_msg_send (struct t_relay_client *client,
 {
     char compression, raw_message[1024];
     uint32_t size32;
+    int index;
 
-    if (weechat_config_integer (relay_config_network_compression) > 0)
+    index = (weechat_config_integer (relay_config_network_compression) > 0) ?
+        (int)RELAY_WEECHAT_DATA(client, compression) :
+        RELAY_WEECHAT_COMPRESSION_OFF;
+
+#ifdef HAVE_ZSTD
+    if (index == RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM)
+    {
+        /* stream is specific to the client: data can not be shared */
+        if (relay_weechat_msg_send_zstd_stream (client, msg))
+            return;
+        index = RELAY_WEECHAT_COMPRESSION_OFF;
+    }
+    /* message not sent with the stream: next one starts a new frame */
+    if (RELAY_WEECHAT_DATA(client, zstd_stream))
     {
-        switch (RELAY_WEECHAT_DATA(client, compression))
+        ZSTD_CCtx_reset (RELAY_WEECHAT_DATA(client, zstd_stream),
+                         ZSTD_reset_session_only);
+    }
+#endif
+
+    if ((index > RELAY_WEECHAT_COMPRESSION_OFF)
+        && (index < RELAY_WEECHAT_NUM_COMPRESSIONS))
+    {
+        if (msg->compressed_size[index] == 0)
         {
-            case RELAY_WEECHAT_COMPRESSION_ZLIB:
-                if (relay_weechat_msg_compress_zlib (client, msg))
-                    return;
-                break;
+            switch (index)
+            {
+                case RELAY_WEECHAT_COMPRESSION_ZLIB:
+                    relay_weechat_msg_compress_zlib (msg);
+                    break;
 #ifdef HAVE_ZSTD
-            case RELAY_WEECHAT_COMPRESSION_ZSTD:
-                if (relay_weechat_msg_compress_zstd (client, msg))
-                    return;
-                break;
+                case RELAY_WEECHAT_COMPRESSION_ZSTD:
+                    relay_weechat_msg_compress_zstd (msg);
+                    break;
 #endif
-            default:
-                break;
+                default:
+                    break;
+            }
+        }
+        if (msg->compressed_size[index] > 0)
+        {
+            /* send compressed data */
+            relay_client_send_shared (client, RELAY_MSG_STANDARD,
+                                      msg->compressed[index],
+                                      msg->compressed_size[index],
+                                      msg->compressed_raw[index],
+                                      &msg->shared[index]);
+            return;
         }
     }
 
@@ -1249,8 +1454,9 @@ relay_weechat_msg_send (struct t_relay_client *client,
     /* send uncompressed data */
     snprintf (raw_message, sizeof (raw_message),
               "obj: %d bytes, id: %s", msg->data_size, msg->id);
-    relay_client_send (client, RELAY_MSG_STANDARD,
-                       msg->data, msg->data_size, raw_message);
+    relay_client_send_shared (client, RELAY_MSG_STANDARD,
+                              msg->data, msg->data_size, raw_message,
+                              &msg->shared[RELAY_WEECHAT_COMPRESSION_OFF]);
 }
 
 /*
@@ -1260,11 +1466,19 @@ relay_weechat_msg_send (struct t_relay_client *client,
 void
 relay_weechat_msg_free (struct t_relay_weechat_msg *msg)
 {
+    int i;
+
     if (!msg)
         return;
 
     free (msg->id);
     free (msg->data);
+    for (i = 0; i < RELAY_WEECHAT_NUM_COMPRESSIONS; i++)
+    {
+        free (msg->compressed[i]);
+        free (msg->compressed_raw[i]);
+        relay_client_outqueue_data_unref (msg->shared[i]);
+    }
 
     free (msg);
 }
@@ -23,6 +23,7 @@
 #include <time.h>
 
 struct t_relay_weechat_nicklist;
+struct t_relay_client_outqueue_data;
 
 #define RELAY_WEECHAT_MSG_INITIAL_ALLOC 4096
 
@@ -46,6 +47,13 @@ struct t_relay_weechat_msg
     char *data;                        /* binary buffer                     */
     int data_alloc;                    /* currently allocated size          */
     int data_size;                     /* current size of buffer            */
+    /* compressed data, computed once and shared by all clients */
+    char *compressed[RELAY_WEECHAT_NUM_COMPRESSIONS];
+    int compressed_size[RELAY_WEECHAT_NUM_COMPRESSIONS]; /* 0 = not done,   */
+                                       /* -1 = compression failed           */
+    char *compressed_raw[RELAY_WEECHAT_NUM_COMPRESSIONS]; /* raw message    */
+    /* data shared by out queues of clients (for each compression) */
+    struct t_relay_client_outqueue_data *shared[RELAY_WEECHAT_NUM_COMPRESSIONS];
 };
 
 extern struct t_relay_weechat_msg *relay_weechat_msg_new (const char *id);
@@ -83,6 +91,11 @@ extern void relay_weechat_msg_add_infolist (struct t_relay_weechat_msg *msg,
 extern void relay_weechat_msg_add_nicklist (struct t_relay_weechat_msg *msg,
                                             struct t_gui_buffer *buffer,
                                             struct t_relay_weechat_nicklist *nicklist);
+extern char *relay_weechat_msg_compress_zstd_stream (struct t_relay_weechat_msg *msg,
+                                                     void *zstd_stream,
+                                                     int *size,
+                                                     char *raw_message,
+                                                     int raw_message_size);
 extern void relay_weechat_msg_send (struct t_relay_client *client,
                                     struct t_relay_weechat_msg *msg);
 extern void relay_weechat_msg_free (struct t_relay_weechat_msg *msg);
@@ -833,6 +833,10 @@ error:
 
 /*
  * Callback for signals "buffer_*".
+ *
+ * This hook is shared by all clients: the message is built only once (and
+ * compressed only once for each compression type), then sent to all clients
+ * synchronized with the buffer.
  */
 
 int
@@ -841,358 +845,189 @@ relay_weechat_protocol_signal_buffer_cb (const void *pointer, void *data,
                                          const char *type_data,
                                          void *signal_data)
 {
-    struct t_relay_client *ptr_client;
+    struct t_relay_client *ptr_client, *ptr_next_client;
     struct t_gui_line *ptr_line;
     struct t_gui_line_data *ptr_line_data;
     struct t_gui_buffer *ptr_buffer;
     struct t_relay_weechat_msg *msg;
     char cmd_hdata[64], str_signal[128];
-    const char *ptr_old_full_name;
-    int *ptr_old_flags, flags;
+    const char *ptr_old_full_name, *ptr_keys;
+    int *ptr_old_flags, flags, sync_flags, renamed, closing;
 
     /* make C compiler happy */
+    (void) pointer;
     (void) data;
     (void) type_data;
 
-    ptr_client = (struct t_relay_client *)pointer;
-    if (!ptr_client || !relay_client_valid (ptr_client))
-        return WEECHAT_RC_OK;
-
-    snprintf (str_signal, sizeof (str_signal), "_%s", signal);
+    ptr_buffer = NULL;
+    ptr_line_data = NULL;
+    ptr_keys = NULL;
+    sync_flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS
+        | RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
+    renamed = 0;
+    closing = 0;
 
     if (strcmp (signal, "buffer_opened") == 0)
     {
         ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "id,number,full_name,short_name,"
-                                             "nicklist,title,local_variables,"
-                                             "prev_buffer,next_buffer");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        ptr_keys = "id,number,full_name,short_name,nicklist,title,"
+            "local_variables,prev_buffer,next_buffer";
     }
     else if (strcmp (signal, "buffer_type_changed") == 0)
     {
         ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "id,number,full_name,type");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        ptr_keys = "id,number,full_name,type";
     }
-    else if (strcmp (signal, "buffer_moved") == 0)
+    else if ((strcmp (signal, "buffer_moved") == 0)
+             || (strcmp (signal, "buffer_merged") == 0)
+             || (strcmp (signal, "buffer_unmerged") == 0)
+             || (strcmp (signal, "buffer_hidden") == 0)
+             || (strcmp (signal, "buffer_unhidden") == 0))
     {
         ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "id,number,full_name,"
-                                             "prev_buffer,next_buffer");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        ptr_keys = "id,number,full_name,prev_buffer,next_buffer";
     }
-    else if ((strcmp (signal, "buffer_merged") == 0)
-             || (strcmp (signal, "buffer_unmerged") == 0))
+    else if (strcmp (signal, "buffer_renamed") == 0)
     {
         ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "id,number,full_name,"
-                                             "prev_buffer,next_buffer");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        ptr_keys = "id,number,full_name,short_name,local_variables";
+        renamed = 1;
     }
-    else if ((strcmp (signal, "buffer_hidden") == 0)
-             || (strcmp (signal, "buffer_unhidden") == 0))
+    else if (strcmp (signal, "buffer_title_changed") == 0)
     {
         ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "id,number,full_name,"
-                                             "prev_buffer,next_buffer");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        ptr_keys = "id,number,full_name,title";
     }
-    else if (strcmp (signal, "buffer_renamed") == 0)
+    else if (strncmp (signal, "buffer_localvar_", 16) == 0)
     {
         ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* rename old buffer name if present in hashtable "buffers_sync" */
-        ptr_old_full_name = weechat_buffer_get_string (ptr_buffer,
-                                                       "old_full_name");
-        if (ptr_old_full_name && ptr_old_full_name[0])
-        {
-            ptr_old_flags = weechat_hashtable_get (
-                RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
-                ptr_old_full_name);
-            if (ptr_old_flags)
-            {
-                flags = *ptr_old_flags;
-                weechat_hashtable_remove (
-                    RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
-                    ptr_old_full_name);
-                weechat_hashtable_set (
-                    RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
-                    weechat_buffer_get_string (ptr_buffer, "full_name"),
-                    &flags);
-            }
-        }
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "id,number,full_name,short_name,"
-                                             "local_variables");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        ptr_keys = "id,number,full_name,local_variables";
     }
-    else if (strcmp (signal, "buffer_title_changed") == 0)
+    else if (strcmp (signal, "buffer_cleared") == 0)
     {
         ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
+        if (ptr_buffer && relay_buffer_is_relay (ptr_buffer))
             return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "id,number,full_name,title");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        ptr_keys = "id,number,full_name";
+        sync_flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
     }
-    else if (strncmp (signal, "buffer_localvar_", 16) == 0)
+    else if ((strcmp (signal, "buffer_line_added") == 0)
+             || (strcmp (signal, "buffer_line_data_changed") == 0))
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
+        if (strcmp (signal, "buffer_line_added") == 0)
         {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "id,number,full_name,local_variables");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
+            ptr_line = (struct t_gui_line *)signal_data;
+            if (!ptr_line)
+                return WEECHAT_RC_OK;
+            ptr_line_data = weechat_hdata_pointer (relay_hdata_line, ptr_line,
+                                                   "data");
+        }
+        else
+        {
+            ptr_line_data = (struct t_gui_line_data *)signal_data;
         }
+        if (!ptr_line_data)
+            return WEECHAT_RC_OK;
+        ptr_buffer = weechat_hdata_pointer (relay_hdata_line_data,
+                                            ptr_line_data, "buffer");
+        if (ptr_buffer && relay_buffer_is_relay (ptr_buffer))
+            return WEECHAT_RC_OK;
+        ptr_keys = "buffer,id,date,date_usec,date_printed,date_usec_printed,"
+            "displayed,notify_level,highlight,tags_array,prefix,message";
+        sync_flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
     }
-    else if (strcmp (signal, "buffer_cleared") == 0)
+    else if (strcmp (signal, "buffer_closing") == 0)
     {
         ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer || relay_buffer_is_relay (ptr_buffer))
-            return WEECHAT_RC_OK;
+        ptr_keys = "id,number,full_name";
+        closing = 1;
+    }
 
-        /* send signal only if sync with flag "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "id,number,full_name");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+    if (!ptr_buffer || !ptr_keys)
+        return WEECHAT_RC_OK;
+
+    if (ptr_line_data)
+    {
+        snprintf (cmd_hdata, sizeof (cmd_hdata),
+                  "line_data:0x%lx", (unsigned long)ptr_line_data);
     }
-    else if (strcmp (signal, "buffer_line_added") == 0)
+    else
     {
-        ptr_line = (struct t_gui_line *)signal_data;
-        if (!ptr_line)
-            return WEECHAT_RC_OK;
+        snprintf (cmd_hdata, sizeof (cmd_hdata),
+                  "buffer:0x%lx", (unsigned long)ptr_buffer);
+    }
+    snprintf (str_signal, sizeof (str_signal), "_%s", signal);
 
-        ptr_line_data = weechat_hdata_pointer (relay_hdata_line, ptr_line, "data");
-        if (!ptr_line_data)
-            return WEECHAT_RC_OK;
+    /* message is built on first client synchronized with the buffer */
+    msg = NULL;
 
-        ptr_buffer = weechat_hdata_pointer (relay_hdata_line_data, ptr_line_data,
-                                            "buffer");
-        if (!ptr_buffer || relay_buffer_is_relay (ptr_buffer))
-            return WEECHAT_RC_OK;
+    ptr_client = relay_clients;
+    while (ptr_client)
+    {
+        ptr_next_client = ptr_client->next_client;
 
-        /* send signal only if sync with flag "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
+        if ((ptr_client->protocol != RELAY_PROTOCOL_WEECHAT)
+            || !ptr_client->protocol_data
+            || !RELAY_WEECHAT_DATA(ptr_client, signal_buffer_hooked))
         {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "line_data:0x%lx",
-                          (unsigned long)ptr_line_data);
-                relay_weechat_msg_add_hdata (
-                    msg, cmd_hdata,
-                    "buffer,id,date,date_usec,date_printed,date_usec_printed,"
-                    "displayed,notify_level,highlight,tags_array,"
-                    "prefix,message");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
+            ptr_client = ptr_next_client;
+            continue;
         }
-    }
-    else if (strcmp (signal, "buffer_line_data_changed") == 0)
-    {
-        ptr_line_data = (struct t_gui_line_data *)signal_data;
-        if (!ptr_line_data)
-            return WEECHAT_RC_OK;
 
-        ptr_buffer = weechat_hdata_pointer (relay_hdata_line_data, ptr_line_data,
-                                            "buffer");
-        if (!ptr_buffer || relay_buffer_is_relay (ptr_buffer))
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
+        /* rename old buffer name if present in hashtable "buffers_sync" */
+        if (renamed)
         {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
+            ptr_old_full_name = weechat_buffer_get_string (ptr_buffer,
+                                                           "old_full_name");
+            if (ptr_old_full_name && ptr_old_full_name[0])
             {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "line_data:0x%lx",
-                          (unsigned long)ptr_line_data);
-                relay_weechat_msg_add_hdata (
-                    msg, cmd_hdata,
-                    "buffer,id,date,date_usec,date_printed,date_usec_printed,"
-                    "displayed,notify_level,highlight,tags_array,"
-                    "prefix,message");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
+                ptr_old_flags = weechat_hashtable_get (
+                    RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
+                    ptr_old_full_name);
+                if (ptr_old_flags)
+                {
+                    flags = *ptr_old_flags;
+                    weechat_hashtable_remove (
+                        RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
+                        ptr_old_full_name);
+                    weechat_hashtable_set (
+                        RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
+                        weechat_buffer_get_string (ptr_buffer, "full_name"),
+                        &flags);
+                }
             }
         }
-    }
-    else if (strcmp (signal, "buffer_closing") == 0)
-    {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
 
-        /* send signal only if sync with flag "buffers" or "buffer" */
+        /* send signal only if sync with the flags */
         if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
+                                            sync_flags))
         {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
+            if (!msg)
             {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "id,number,full_name");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
+                msg = relay_weechat_msg_new (str_signal);
+                if (msg)
+                    relay_weechat_msg_add_hdata (msg, cmd_hdata, ptr_keys);
             }
+            if (msg)
+                relay_weechat_msg_send (ptr_client, msg);
         }
 
         /* remove buffer from hashtables */
-        weechat_hashtable_remove (
-            RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
-            weechat_buffer_get_string (ptr_buffer, "full_name"));
-        weechat_hashtable_remove (
-            RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist),
-            ptr_buffer);
+        if (closing)
+        {
+            weechat_hashtable_remove (
+                RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
+                weechat_buffer_get_string (ptr_buffer, "full_name"));
+            weechat_hashtable_remove (
+                RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist),
+                ptr_buffer);
+        }
+
+        ptr_client = ptr_next_client;
     }
 
+    relay_weechat_msg_free (msg);
+
     return WEECHAT_RC_OK;
 }
 
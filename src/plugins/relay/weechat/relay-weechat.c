@@ -46,9 +46,14 @@ char *relay_weechat_compression_string[RELAY_WEECHAT_NUM_COMPRESSIONS] = {
     "zlib",
 #ifdef HAVE_ZSTD
     "zstd",
+    "zstd_stream",
 #endif
 };
 
+/* shared hook for signals "buffer_*" (one hook for all clients) */
+struct t_hook *relay_weechat_hook_signal_buffer = NULL;
+int relay_weechat_hook_signal_buffer_clients = 0;
+
 
 /*
  * Searches for a compression.
@@ -77,15 +82,27 @@ relay_weechat_compression_search (const char *compression)
 
 /*
  * Hooks signals for a client.
+ *
+ * Signals "buffer_*" are received by a single hook shared by all clients:
+ * each message is built and compressed only once, then sent to all clients
+ * synchronized with the buffer.
  */
 
 void
 relay_weechat_hook_signals (struct t_relay_client *client)
 {
-    RELAY_WEECHAT_DATA(client, hook_signal_buffer) =
-        weechat_hook_signal ("buffer_*",
-                             &relay_weechat_protocol_signal_buffer_cb,
-                             client, NULL);
+    if (!RELAY_WEECHAT_DATA(client, signal_buffer_hooked))
+    {
+        if (!relay_weechat_hook_signal_buffer)
+        {
+            relay_weechat_hook_signal_buffer = weechat_hook_signal (
+                "buffer_*",
+                &relay_weechat_protocol_signal_buffer_cb,
+                NULL, NULL);
+        }
+        RELAY_WEECHAT_DATA(client, signal_buffer_hooked) = 1;
+        relay_weechat_hook_signal_buffer_clients++;
+    }
     RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) =
         weechat_hook_hsignal ("nicklist_*",
                               &relay_weechat_protocol_hsignal_nicklist_cb,
@@ -103,10 +120,17 @@ relay_weechat_hook_signals (struct t_relay_client *client)
 void
 relay_weechat_unhook_signals (struct t_relay_client *client)
 {
-    if (RELAY_WEECHAT_DATA(client, hook_signal_buffer))
+    if (RELAY_WEECHAT_DATA(client, signal_buffer_hooked))
     {
-        weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_buffer));
-        RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
+        RELAY_WEECHAT_DATA(client, signal_buffer_hooked) = 0;
+        relay_weechat_hook_signal_buffer_clients--;
+        if ((relay_weechat_hook_signal_buffer_clients <= 0)
+            && relay_weechat_hook_signal_buffer)
+        {
+            weechat_unhook (relay_weechat_hook_signal_buffer);
+            relay_weechat_hook_signal_buffer = NULL;
+            relay_weechat_hook_signal_buffer_clients = 0;
+        }
     }
     if (RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist))
     {
@@ -195,13 +219,16 @@ relay_weechat_alloc (struct t_relay_client *client)
     RELAY_WEECHAT_DATA(client, password_ok) = 0;
     RELAY_WEECHAT_DATA(client, totp_ok) = 0;
     RELAY_WEECHAT_DATA(client, compression) = RELAY_WEECHAT_COMPRESSION_OFF;
+#ifdef HAVE_ZSTD
+    RELAY_WEECHAT_DATA(client, zstd_stream) = NULL;
+#endif
     RELAY_WEECHAT_DATA(client, escape_commands) = 0;
     RELAY_WEECHAT_DATA(client, buffers_sync) =
         weechat_hashtable_new (32,
                                WEECHAT_HASHTABLE_STRING,
                                WEECHAT_HASHTABLE_INTEGER,
                                NULL, NULL);
-    RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
+    RELAY_WEECHAT_DATA(client, signal_buffer_hooked) = 0;
     RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) = NULL;
     RELAY_WEECHAT_DATA(client, hook_signal_upgrade) = NULL;
     RELAY_WEECHAT_DATA(client, buffers_nicklist) =
@@ -250,6 +277,15 @@ relay_weechat_alloc_with_infolist (struct t_relay_client *client,
         RELAY_WEECHAT_DATA(client, totp_ok) = 1;
     RELAY_WEECHAT_DATA(client, compression) = weechat_infolist_integer (
         infolist, "compression");
+#ifdef HAVE_ZSTD
+    /*
+     * the zstd stream can not be restored: messages are now compressed
+     * independently (the compression flag is sent in each message)
+     */
+    if (RELAY_WEECHAT_DATA(client, compression) == RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM)
+        RELAY_WEECHAT_DATA(client, compression) = RELAY_WEECHAT_COMPRESSION_ZSTD;
+    RELAY_WEECHAT_DATA(client, zstd_stream) = NULL;
+#endif
     RELAY_WEECHAT_DATA(client, escape_commands) = weechat_infolist_integer (
         infolist, "escape_commands");
 
@@ -273,7 +309,7 @@ relay_weechat_alloc_with_infolist (struct t_relay_client *client,
                                &value);
         index++;
     }
-    RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
+    RELAY_WEECHAT_DATA(client, signal_buffer_hooked) = 0;
     RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) = NULL;
     RELAY_WEECHAT_DATA(client, hook_signal_upgrade) = NULL;
     RELAY_WEECHAT_DATA(client, buffers_nicklist) =
@@ -317,12 +353,12 @@ relay_weechat_free (struct t_relay_client *client)
 
     if (client->protocol_data)
     {
+        relay_weechat_unhook_signals (client);
         weechat_hashtable_free (RELAY_WEECHAT_DATA(client, buffers_sync));
-        weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_buffer));
-        weechat_unhook (RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist));
-        weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_upgrade));
         weechat_hashtable_free (RELAY_WEECHAT_DATA(client, buffers_nicklist));
-        weechat_unhook (RELAY_WEECHAT_DATA(client, hook_timer_nicklist));
+#ifdef HAVE_ZSTD
+        ZSTD_freeCCtx (RELAY_WEECHAT_DATA(client, zstd_stream));
+#endif
 
         free (client->protocol_data);
 
@@ -382,12 +418,15 @@ relay_weechat_print_log (struct t_relay_client *client)
         weechat_log_printf ("    password_ok . . . . . . : %d", RELAY_WEECHAT_DATA(client, password_ok));
         weechat_log_printf ("    totp_ok . . . . . . . . : %d", RELAY_WEECHAT_DATA(client, totp_ok));
         weechat_log_printf ("    compression . . . . . . : %d", RELAY_WEECHAT_DATA(client, compression));
+#ifdef HAVE_ZSTD
+        weechat_log_printf ("    zstd_stream . . . . . . : %p", RELAY_WEECHAT_DATA(client, zstd_stream));
+#endif
         weechat_log_printf ("    escape_commands . . . . : %d", RELAY_WEECHAT_DATA(client, escape_commands));
         weechat_log_printf ("    buffers_sync. . . . . . : %p (hashtable: '%s')",
                             RELAY_WEECHAT_DATA(client, buffers_sync),
                             weechat_hashtable_get_string (RELAY_WEECHAT_DATA(client, buffers_sync),
                                                           "keys_values"));
-        weechat_log_printf ("    hook_signal_buffer. . . : %p", RELAY_WEECHAT_DATA(client, hook_signal_buffer));
+        weechat_log_printf ("    signal_buffer_hooked. . : %d", RELAY_WEECHAT_DATA(client, signal_buffer_hooked));
         weechat_log_printf ("    hook_hsignal_nicklist . : %p", RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist));
         weechat_log_printf ("    hook_signal_upgrade . . : %p", RELAY_WEECHAT_DATA(client, hook_signal_upgrade));
         weechat_log_printf ("    buffers_nicklist. . . . : %p (hashtable: '%s')",
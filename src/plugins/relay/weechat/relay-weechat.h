@@ -20,6 +20,10 @@
 #ifndef WEECHAT_PLUGIN_RELAY_WEECHAT_H
 #define WEECHAT_PLUGIN_RELAY_WEECHAT_H
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 struct t_relay_client;
 enum t_relay_status;
 
@@ -36,6 +40,8 @@ enum t_relay_weechat_compression
     RELAY_WEECHAT_COMPRESSION_ZLIB,    /* zlib compression                  */
 #ifdef HAVE_ZSTD
     RELAY_WEECHAT_COMPRESSION_ZSTD,    /* Zstandard compression             */
+    RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM, /* Zstandard stream (one stream  */
+                                       /* per client, flushed on each msg)  */
 #endif
     /* number of compressions */
     RELAY_WEECHAT_NUM_COMPRESSIONS,
@@ -48,6 +54,10 @@ struct t_relay_weechat_data
 
     /* handshake options */
     enum t_relay_weechat_compression compression; /* compression type       */
+#ifdef HAVE_ZSTD
+    ZSTD_CCtx *zstd_stream;            /* zstd stream (compression          */
+                                       /* "zstd_stream" only)               */
+#endif
     int escape_commands;               /* 1 if backslashes are interpreted  */
                                        /* in commands sent by client        */
 
@@ -58,7 +68,8 @@ struct t_relay_weechat_data
     /* sync of buffers */
     struct t_hashtable *buffers_sync;  /* buffers synchronized (events      */
                                        /* received for these buffers)       */
-    struct t_hook *hook_signal_buffer;    /* hook for signals "buffer_*"    */
+    int signal_buffer_hooked;          /* 1 if client receives signals      */
+                                       /* "buffer_*" (shared hook)          */
     struct t_hook *hook_hsignal_nicklist; /* hook for hsignals "nicklist_*" */
     struct t_hook *hook_signal_upgrade;   /* hook for signals "upgrade*"    */
     struct t_hashtable *buffers_nicklist; /* send nicklist for these buffers*/
@@ -66,6 +77,8 @@ struct t_relay_weechat_data
 };
 
 extern char *relay_weechat_compression_string[];
+extern struct t_hook *relay_weechat_hook_signal_buffer;
+extern int relay_weechat_hook_signal_buffer_clients;
 
 extern int relay_weechat_compression_search (const char *compression);
 extern void relay_weechat_hook_signals (struct t_relay_client *client);
@@ -354,6 +354,16 @@ trigger_buffer_display_trigger (struct t_trigger *trigger,
         weechat_config_string (trigger->options[TRIGGER_OPTION_ARGUMENTS]),
         weechat_color ("chat_delimiters"),
         weechat_color ("reset"));
+    weechat_printf_date_tags (
+        trigger_buffer, 0, "no_trigger",
+        "%s%lu\t  stats: calls: %llu, prefiltered: %llu, conditions OK: %llu, "
+        "time (monitored): %.6fs",
+        weechat_color (weechat_config_string (trigger_config_color_identifier)),
+        context->id,
+        trigger->hook_count_cb,
+        trigger->hook_count_prefilter,
+        trigger->hook_count_match,
+        (float)trigger->hook_time_usec / 1000000);
     if (context->buffer)
     {
         weechat_printf_date_tags (
@@ -31,6 +31,7 @@
 #include "trigger-callback.h"
 #include "trigger-buffer.h"
 #include "trigger-config.h"
+#include "trigger-prefilter.h"
 
 
 /*
@@ -601,6 +602,7 @@ trigger_callback_execute (struct t_trigger *trigger,
             gettimeofday (&(context->start_run_command), NULL);
         trigger_callback_run_command (trigger, context, display_monitor);
 
+        trigger->hook_count_match++;
         rc = 1;
     }
 
@@ -637,6 +639,35 @@ trigger_callback_execute (struct t_trigger *trigger,
     return rc;
 }
 
+/*
+ * Displays on monitor buffer a trigger not executed because its prefilters
+ * failed (like a trigger executed with conditions false).
+ */
+
+void
+trigger_callback_prefiltered (struct t_trigger *trigger,
+                              struct t_trigger_context *context)
+{
+    if (!trigger_buffer && (weechat_trigger_plugin->debug >= 1))
+        trigger_buffer_open (NULL, 0);
+    if (!trigger_buffer)
+        return;
+
+    trigger_context_id = (trigger_context_id < ULONG_MAX) ?
+        trigger_context_id + 1 : 0;
+    context->id = trigger_context_id;
+
+    if (trigger_buffer_display_trigger (trigger, context))
+    {
+        weechat_printf_date_tags (
+            trigger_buffer, 0, "no_trigger",
+            _("%s%lu%s  prefiltered: trigger not executed"),
+            weechat_color (weechat_config_string (trigger_config_color_identifier)),
+            context->id,
+            "\t");
+    }
+}
+
 /*
  * Callback for a signal hooked.
  */
@@ -808,20 +839,57 @@ trigger_callback_modifier_cb (const void *pointer, void *data,
                               const char *modifier, const char *modifier_data,
                               const char *string)
 {
-    const char *ptr_string;
+    const char *ptr_string, *ptr_tags;
     char *string_modified, *pos, *buffer_pointer;
     char *str_tags, **tags, *prefix, *string_no_color;
     int length, num_tags, rc;
     void *ptr_irc_server, *ptr_irc_channel;
     struct t_gui_buffer *ptr_buffer;
+    struct t_trigger_prefilter_data prefilter_data;
 
     TRIGGER_CALLBACK_CB_INIT(NULL);
 
     ctx.buffer = NULL;
+    ptr_tags = NULL;
     tags = NULL;
     num_tags = 0;
     string_no_color = NULL;
 
+    /*
+     * extract buffer/tags from modifier data for a WeeChat message
+     * (format: "buffer_pointer;tags")
+     */
+    if (strcmp (modifier, "weechat_print") == 0)
+    {
+        pos = strchr (modifier_data, ';');
+        if (pos)
+        {
+            buffer_pointer = weechat_strndup (modifier_data,
+                                              pos - modifier_data);
+            if (buffer_pointer)
+            {
+                rc = sscanf (buffer_pointer, "%p", &ptr_buffer);
+                if ((rc != EOF) && (rc != 0))
+                {
+                    ctx.buffer = ptr_buffer;
+                    ptr_tags = pos + 1;
+                }
+                free (buffer_pointer);
+            }
+        }
+    }
+
+    /* do nothing if prefilters fail (before building hashtables) */
+    trigger_prefilter_data_init (&prefilter_data);
+    prefilter_data.buffer = ctx.buffer;
+    prefilter_data.str_tags = ptr_tags;
+    prefilter_data.message = string;
+    if (!trigger_prefilter_check (trigger, &prefilter_data))
+    {
+        trigger_callback_prefiltered (trigger, &ctx);
+        goto end;
+    }
+
     TRIGGER_CALLBACK_CB_NEW_POINTERS;
 
     /* split IRC message (if string is an IRC message) */
@@ -915,53 +983,37 @@ trigger_callback_modifier_cb (const void *pointer, void *data,
             }
         }
 
-        /*
-         * extract buffer/tags from modifier data
-         * (format: "buffer_pointer;tags")
-         */
-        pos = strchr (modifier_data, ';');
-        if (pos)
+        /* set buffer/tags extracted from modifier data */
+        if (ptr_tags)
         {
-            buffer_pointer = weechat_strndup (modifier_data,
-                                              pos - modifier_data);
-            if (buffer_pointer)
+            weechat_hashtable_set (
+                ctx.extra_vars,
+                "tg_plugin",
+                weechat_buffer_get_string (ctx.buffer, "plugin"));
+            weechat_hashtable_set (
+                ctx.extra_vars,
+                "tg_buffer",
+                weechat_buffer_get_string (ctx.buffer, "full_name"));
+            if (ptr_tags[0])
             {
-                rc = sscanf (buffer_pointer, "%p", &ptr_buffer);
-                if ((rc != EOF) && (rc != 0))
+                tags = weechat_string_split (
+                    ptr_tags,
+                    ",",
+                    NULL,
+                    WEECHAT_STRING_SPLIT_STRIP_LEFT
+                    | WEECHAT_STRING_SPLIT_STRIP_RIGHT
+                    | WEECHAT_STRING_SPLIT_COLLAPSE_SEPS,
+                    0,
+                    &num_tags);
+                length = 1 + strlen (ptr_tags) + 1 + 1;
+                str_tags = malloc (length);
+                if (str_tags)
                 {
-                    ctx.buffer = ptr_buffer;
-                    weechat_hashtable_set (
-                        ctx.extra_vars,
-                        "tg_plugin",
-                        weechat_buffer_get_string (ctx.buffer, "plugin"));
-                    weechat_hashtable_set (
-                        ctx.extra_vars,
-                        "tg_buffer",
-                        weechat_buffer_get_string (ctx.buffer, "full_name"));
-                    pos++;
-                    if (pos[0])
-                    {
-                        tags = weechat_string_split (
-                            pos,
-                            ",",
-                            NULL,
-                            WEECHAT_STRING_SPLIT_STRIP_LEFT
-                            | WEECHAT_STRING_SPLIT_STRIP_RIGHT
-                            | WEECHAT_STRING_SPLIT_COLLAPSE_SEPS,
-                            0,
-                            &num_tags);
-                        length = 1 + strlen (pos) + 1 + 1;
-                        str_tags = malloc (length);
-                        if (str_tags)
-                        {
-                            snprintf (str_tags, length, ",%s,", pos);
-                            weechat_hashtable_set (ctx.extra_vars, "tg_tags",
-                                                   str_tags);
-                            free (str_tags);
-                        }
-                    }
+                    snprintf (str_tags, length, ",%s,", ptr_tags);
+                    weechat_hashtable_set (ctx.extra_vars, "tg_tags",
+                                           str_tags);
+                    free (str_tags);
                 }
-                free (buffer_pointer);
             }
         }
         weechat_hashtable_set (ctx.pointers, "buffer", ctx.buffer);
@@ -1004,12 +1056,32 @@ trigger_callback_line_cb (const void *pointer, void *data,
     const char *ptr_key, *ptr_value;
     char **tags, *str_tags, *string_no_color;
     int rc, num_tags, length;
+    struct t_trigger_prefilter_data prefilter_data;
 
     TRIGGER_CALLBACK_CB_INIT(NULL);
 
     hashtable = NULL;
     tags = NULL;
 
+    ptr_value = weechat_hashtable_get (line, "buffer");
+    if (!ptr_value || (ptr_value[0] != '0') || (ptr_value[1] != 'x'))
+        goto end;
+    rc = sscanf (ptr_value, "%p", &ptr);
+    if ((rc == EOF) || (rc < 1))
+        goto end;
+    ctx.buffer = ptr;
+
+    /* do nothing if prefilters fail (before building hashtables) */
+    trigger_prefilter_data_init (&prefilter_data);
+    prefilter_data.buffer = ctx.buffer;
+    prefilter_data.str_tags = weechat_hashtable_get (line, "tags");
+    prefilter_data.message = weechat_hashtable_get (line, "message");
+    if (!trigger_prefilter_check (trigger, &prefilter_data))
+    {
+        trigger_callback_prefiltered (trigger, &ctx);
+        goto end;
+    }
+
     TRIGGER_CALLBACK_CB_NEW_POINTERS;
     TRIGGER_CALLBACK_CB_NEW_VARS_UPDATED;
 
@@ -1021,14 +1093,6 @@ trigger_callback_line_cb (const void *pointer, void *data,
 
     /* add data in hashtables used for conditions/replace/command */
     trigger_callback_set_common_vars (trigger, ctx.extra_vars);
-    ptr_value = weechat_hashtable_get (line, "buffer");
-    if (!ptr_value || (ptr_value[0] != '0') || (ptr_value[1] != 'x'))
-        goto end;
-    rc = sscanf (ptr_value, "%p", &ptr);
-    if ((rc == EOF) || (rc < 1))
-        goto end;
-    ctx.buffer = ptr;
-
     weechat_hashtable_set (ctx.pointers, "buffer", ctx.buffer);
     ptr_value = weechat_hashtable_get (line, "tags");
     tags = weechat_string_split ((ptr_value) ? ptr_value : "",
@@ -1142,6 +1206,7 @@ trigger_callback_print_cb  (const void *pointer, void *data,
     char *str_tags, *str_tags2, str_temp[128], *str_no_color;
     int length;
     struct timeval tv;
+    struct t_trigger_prefilter_data prefilter_data;
 
     TRIGGER_CALLBACK_CB_INIT(WEECHAT_RC_OK);
 
@@ -1150,7 +1215,24 @@ trigger_callback_print_cb  (const void *pointer, void *data,
     /* do nothing if the buffer does not match buffers defined in the trigger */
     if (trigger->hook_print_buffers
         && !weechat_buffer_match_list (buffer, trigger->hook_print_buffers))
+    {
+        trigger->hook_count_prefilter++;
         goto end;
+    }
+
+    /* do nothing if prefilters fail (before building hashtables) */
+    trigger_prefilter_data_init (&prefilter_data);
+    prefilter_data.buffer = buffer;
+    prefilter_data.tags = tags;
+    prefilter_data.tags_count = tags_count;
+    prefilter_data.message = message;
+    prefilter_data.displayed = displayed;
+    prefilter_data.highlight = highlight;
+    if (!trigger_prefilter_check (trigger, &prefilter_data))
+    {
+        trigger_callback_prefiltered (trigger, &ctx);
+        goto end;
+    }
 
     TRIGGER_CALLBACK_CB_NEW_POINTERS;
     TRIGGER_CALLBACK_CB_NEW_EXTRA_VARS;
@@ -35,6 +35,10 @@ struct t_trigger_context
     struct timeval start_regex;
     struct timeval start_run_command;
     struct timeval end_exec;
+    struct timeval end_callback;
+    long long time_callback;
+    int timed;                         /* 1 if time of callback is measured */
+                                       /* (monitor buffer open or debug)    */
 };
 
 #define TRIGGER_CALLBACK_CB_INIT(__rc)                          \
@@ -49,7 +53,9 @@ struct t_trigger_context
     if (!trigger || trigger->hook_running)                      \
         return __rc;                                            \
     memset (&ctx, 0, sizeof (ctx));                             \
-    if (weechat_trigger_plugin->debug >= 1)                     \
+    ctx.timed = (trigger_buffer                                 \
+                 || (weechat_trigger_plugin->debug >= 1));      \
+    if (ctx.timed)                                              \
         gettimeofday (&(ctx.start_exec), NULL);                 \
     trigger->hook_count_cb++;                                   \
     trigger->hook_running = 1;                                  \
@@ -87,6 +93,14 @@ struct t_trigger_context
         weechat_hashtable_free (ctx.extra_vars);                \
     if (ctx.vars_updated)                                       \
         weechat_list_free (ctx.vars_updated);                   \
+    if (ctx.timed)                                              \
+    {                                                           \
+        gettimeofday (&(ctx.end_callback), NULL);               \
+        ctx.time_callback = weechat_util_timeval_diff (         \
+            &(ctx.start_exec), &(ctx.end_callback));            \
+        if (ctx.time_callback > 0)                              \
+            trigger->hook_time_usec += ctx.time_callback;       \
+    }                                                           \
     trigger->hook_running = 0;                                  \
     switch (weechat_config_enum (                               \
                 trigger->options[TRIGGER_OPTION_POST_ACTION]))  \
@@ -150,6 +164,8 @@ extern struct t_hashtable *trigger_callback_info_hashtable_cb (const void *point
                                                                void *data,
                                                                const char *info_name,
                                                                struct t_hashtable *hashtable);
+extern void trigger_callback_prefiltered (struct t_trigger *trigger,
+                                         struct t_trigger_context *context);
 extern void trigger_callback_init ();
 extern void trigger_callback_end ();
 
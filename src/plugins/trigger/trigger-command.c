@@ -55,6 +55,9 @@ trigger_command_display_trigger_internal (const char *name,
                                           int hooks_count,
                                           int hook_count_cb,
                                           int hook_count_cmd,
+                                          unsigned long long hook_count_prefilter,
+                                          unsigned long long hook_count_match,
+                                          unsigned long long hook_time_usec,
                                           int regex_count,
                                           struct t_trigger_regex *regex,
                                           int commands_count,
@@ -97,6 +100,16 @@ trigger_command_display_trigger_internal (const char *name,
             weechat_printf_date_tags (NULL, 0, "no_trigger",
                                       "%s commands: %d",
                                       spaces, hook_count_cmd);
+            weechat_printf_date_tags (NULL, 0, "no_trigger",
+                                      "%s prefiltered: %llu",
+                                      spaces, hook_count_prefilter);
+            weechat_printf_date_tags (NULL, 0, "no_trigger",
+                                      "%s conditions OK: %llu",
+                                      spaces, hook_count_match);
+            weechat_printf_date_tags (NULL, 0, "no_trigger",
+                                      "%s time (monitored): %.6fs",
+                                      spaces,
+                                      (float)hook_time_usec / 1000000);
         }
         if (conditions && conditions[0])
         {
@@ -250,6 +263,9 @@ trigger_command_display_trigger (struct t_trigger *trigger, int verbose)
         trigger->hooks_count,
         trigger->hook_count_cb,
         trigger->hook_count_cmd,
+        trigger->hook_count_prefilter,
+        trigger->hook_count_match,
+        trigger->hook_time_usec,
         trigger->regex_count,
         trigger->regex,
         trigger->commands_count,
@@ -426,6 +442,9 @@ trigger_command_list_default (int verbose)
             0,
             0,
             0,
+            0,
+            0,
+            0,
             regex_count,
             regex,
             commands_count,
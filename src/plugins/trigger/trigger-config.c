@@ -26,6 +26,7 @@
 #include "../weechat-plugin.h"
 #include "trigger.h"
 #include "trigger-config.h"
+#include "trigger-prefilter.h"
 
 
 struct t_config_file *trigger_config_file = NULL;
@@ -265,6 +266,27 @@ trigger_config_change_trigger_arguments (const void *pointer, void *data,
         trigger_hook (ptr_trigger);
 }
 
+/*
+ * Callback for changes on option "trigger.trigger.xxx.conditions".
+ */
+
+void
+trigger_config_change_trigger_conditions (const void *pointer, void *data,
+                                          struct t_config_option *option)
+{
+    struct t_trigger *ptr_trigger;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+
+    ptr_trigger = trigger_search_with_option (option);
+    if (!ptr_trigger)
+        return;
+
+    trigger_prefilter_free (ptr_trigger);
+}
+
 /*
  * Callback for changes on option "trigger.trigger.xxx.regex".
  */
@@ -309,6 +331,8 @@ trigger_config_change_trigger_regex (const void *pointer, void *data,
                             weechat_prefix ("error"), TRIGGER_PLUGIN_NAME);
             break;
     }
+
+    trigger_prefilter_free (ptr_trigger);
 }
 
 /*
@@ -332,6 +356,29 @@ trigger_config_change_trigger_command (const void *pointer, void *data,
     trigger_split_command (weechat_config_string (option),
                            &ptr_trigger->commands_count,
                            &ptr_trigger->commands);
+
+    trigger_prefilter_free (ptr_trigger);
+}
+
+/*
+ * Callback for changes on option "trigger.trigger.xxx.post_action".
+ */
+
+void
+trigger_config_change_trigger_post_action (const void *pointer, void *data,
+                                           struct t_config_option *option)
+{
+    struct t_trigger *ptr_trigger;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+
+    ptr_trigger = trigger_search_with_option (option);
+    if (!ptr_trigger)
+        return;
+
+    trigger_prefilter_free (ptr_trigger);
 }
 
 /*
@@ -402,7 +449,9 @@ trigger_config_create_trigger_option (const char *trigger_name, int index_option
                    "hook callback) (note: content is evaluated when trigger is "
                    "run, see /help eval)"),
                 NULL, 0, 0, value, NULL, 0,
-                NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+                NULL, NULL, NULL,
+                &trigger_config_change_trigger_conditions, NULL, NULL,
+                NULL, NULL, NULL);
             break;
         case TRIGGER_OPTION_REGEX:
             ptr_option = weechat_config_new_option (
@@ -452,7 +501,9 @@ trigger_config_create_trigger_option (const char *trigger_name, int index_option
                 option_name, "enum",
                 N_("action to take on the trigger after execution"),
                 "none|disable|delete", 0, 0, value, NULL, 0,
-                NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+                NULL, NULL, NULL,
+                &trigger_config_change_trigger_post_action, NULL, NULL,
+                NULL, NULL, NULL);
             break;
         case TRIGGER_NUM_OPTIONS:
             break;
@@ -0,0 +1,989 @@
+/*
+ * trigger-prefilter.c - cheap tests done before executing triggers
+ *
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <regex.h>
+
+#include "../weechat-plugin.h"
+#include "trigger.h"
+#include "trigger-prefilter.h"
+
+
+/*
+ * comparisons that can be checked by a prefilter, the other ones
+ * (regex, equal, less than, ...) are only checked by the conditions
+ */
+char *trigger_prefilter_comparisons[] =
+{ "==*", "!!*", "=*", "!*",    /* string match */
+  "==-", "!!-", "=-", "!-",    /* includes */
+  NULL,
+};
+
+/*
+ * variables used in conditions that can be checked by a prefilter,
+ * by hook type (NULL if not available)
+ */
+char *trigger_prefilter_var_tags[TRIGGER_NUM_HOOK_TYPES] =
+{ NULL, NULL, "tg_tags", "tags", "tg_tags", NULL,
+  NULL, NULL, NULL, NULL, NULL, NULL };
+char *trigger_prefilter_var_message[TRIGGER_NUM_HOOK_TYPES] =
+{ NULL, NULL, "tg_string", "message", "tg_message", NULL,
+  NULL, NULL, NULL, NULL, NULL, NULL };
+
+
+/*
+ * Keeps the longest literal: copies "literal" into "best" if it is longer.
+ */
+
+void
+trigger_prefilter_literal_keep_longest (char *best, const char *literal)
+{
+    if (strlen (literal) > strlen (best))
+        strcpy (best, literal);
+}
+
+/*
+ * Ends the current run of literal chars in a regex sequence.
+ */
+
+void
+trigger_prefilter_literal_end_run (char *run, int *length_run,
+                                   char *best, char *prefix, int *at_start)
+{
+    run[*length_run] = '\0';
+    trigger_prefilter_literal_keep_longest (best, run);
+    if (*at_start)
+    {
+        strcpy (prefix, run);
+        *at_start = 0;
+    }
+    run[0] = '\0';
+    *length_run = 0;
+}
+
+/*
+ * Skips quantifier(s) in a regex ("?", "*", "+", "{n,m}").
+ *
+ * Returns:
+ *   -1: no quantifier
+ *    0: quantifier requires at least one occurrence ("+", "{1,}", ...)
+ *    1: quantifier allows zero occurrence ("?", "*", "{0,n}", ...)
+ */
+
+int
+trigger_prefilter_regex_quantifier (const char **ptr)
+{
+    const char *pos;
+    int optional;
+
+    optional = -1;
+
+    while ((*ptr)[0])
+    {
+        switch ((*ptr)[0])
+        {
+            case '?':
+            case '*':
+                optional = 1;
+                (*ptr)++;
+                break;
+            case '+':
+                if (optional < 0)
+                    optional = 0;
+                (*ptr)++;
+                break;
+            case '{':
+                pos = strchr (*ptr, '}');
+                if (!isdigit ((unsigned char)(*ptr)[1])
+                    || (atoi (*ptr + 1) == 0))
+                {
+                    optional = 1;
+                }
+                else if (optional < 0)
+                {
+                    optional = 0;
+                }
+                *ptr = (pos) ? pos + 1 : *ptr + strlen (*ptr);
+                break;
+            default:
+                return optional;
+        }
+    }
+
+    return optional;
+}
+
+/*
+ * Skips a bracket expression in a regex ("[...]").
+ *
+ * Returns pointer to char after the bracket expression, NULL if error.
+ */
+
+const char *
+trigger_prefilter_regex_skip_bracket (const char *ptr)
+{
+    const char *pos;
+    char end[3];
+
+    ptr++;
+    if (ptr[0] == '^')
+        ptr++;
+    if (ptr[0] == ']')
+        ptr++;
+    while (ptr[0] && (ptr[0] != ']'))
+    {
+        if ((ptr[0] == '[')
+            && ((ptr[1] == ':') || (ptr[1] == '.') || (ptr[1] == '=')))
+        {
+            /* character class, collating symbol or equivalence class */
+            end[0] = ptr[1];
+            end[1] = ']';
+            end[2] = '\0';
+            pos = strstr (ptr + 2, end);
+            if (!pos)
+                return NULL;
+            ptr = pos + 2;
+        }
+        else
+        {
+            ptr++;
+        }
+    }
+
+    return (ptr[0]) ? ptr + 1 : NULL;
+}
+
+const char *trigger_prefilter_regex_alternation (const char *ptr, int depth,
+                                                 char *best, char *prefix);
+
+/*
+ * Parses a sequence of atoms in a regex (until "|", ")" or end of string).
+ *
+ * Sets in "best" the longest literal required by the sequence, and in
+ * "prefix" the literal required at the beginning of the sequence.
+ *
+ * Returns pointer to the end of sequence, NULL if error.
+ */
+
+const char *
+trigger_prefilter_regex_sequence (const char *ptr, int depth,
+                                  char *best, char *prefix)
+{
+    char run[TRIGGER_PREFILTER_LITERAL_MAX];
+    char sub_best[TRIGGER_PREFILTER_LITERAL_MAX];
+    char sub_prefix[TRIGGER_PREFILTER_LITERAL_MAX];
+    const char *ptr_char;
+    int length_run, length_char, at_start, optional;
+
+    best[0] = '\0';
+    prefix[0] = '\0';
+    run[0] = '\0';
+    length_run = 0;
+    at_start = 1;
+
+    while (ptr[0] && (ptr[0] != '|') && (ptr[0] != ')'))
+    {
+        ptr_char = NULL;
+        switch (ptr[0])
+        {
+            case '(':
+                ptr = trigger_prefilter_regex_alternation (ptr + 1, depth + 1,
+                                                           sub_best, sub_prefix);
+                if (!ptr || (ptr[0] != ')'))
+                    return NULL;
+                ptr++;
+                optional = trigger_prefilter_regex_quantifier (&ptr);
+                if (at_start && (length_run == 0))
+                {
+                    strcpy (prefix, (optional == 1) ? "" : sub_prefix);
+                    at_start = 0;
+                }
+                trigger_prefilter_literal_end_run (run, &length_run,
+                                                   best, prefix, &at_start);
+                if (optional != 1)
+                    trigger_prefilter_literal_keep_longest (best, sub_best);
+                break;
+            case '[':
+                ptr = trigger_prefilter_regex_skip_bracket (ptr);
+                if (!ptr)
+                    return NULL;
+                trigger_prefilter_regex_quantifier (&ptr);
+                trigger_prefilter_literal_end_run (run, &length_run,
+                                                   best, prefix, &at_start);
+                break;
+            case '^':
+                ptr++;
+                if (!at_start || (length_run > 0))
+                {
+                    trigger_prefilter_literal_end_run (run, &length_run,
+                                                       best, prefix,
+                                                       &at_start);
+                }
+                break;
+            case '.':
+            case '$':
+            case '?':
+            case '*':
+            case '+':
+            case '{':
+                if ((ptr[0] == '.') || (ptr[0] == '$'))
+                    ptr++;
+                trigger_prefilter_regex_quantifier (&ptr);
+                trigger_prefilter_literal_end_run (run, &length_run,
+                                                   best, prefix, &at_start);
+                break;
+            case '\\':
+                if (!ptr[1])
+                    return NULL;
+                if (strchr ("<>`'", ptr[1]))
+                {
+                    /* GNU anchors (zero-width): like "^" and "$" */
+                    ptr += 2;
+                }
+                else if (isalnum ((unsigned char)ptr[1]))
+                {
+                    /* back-reference or class like "\w": not a literal */
+                    ptr += 2;
+                    trigger_prefilter_regex_quantifier (&ptr);
+                    trigger_prefilter_literal_end_run (run, &length_run,
+                                                       best, prefix,
+                                                       &at_start);
+                }
+                else
+                {
+                    ptr_char = ptr + 1;
+                }
+                break;
+            default:
+                ptr_char = ptr;
+                break;
+        }
+        if (!ptr_char)
+            continue;
+
+        /* literal char (optionally followed by a quantifier) */
+        length_char = weechat_utf8_char_size (ptr_char);
+        if (length_char < 1)
+            length_char = 1;
+        ptr = ptr_char + length_char;
+        optional = trigger_prefilter_regex_quantifier (&ptr);
+        if (optional != 1)
+        {
+            if (length_run + length_char < TRIGGER_PREFILTER_LITERAL_MAX)
+            {
+                memcpy (run + length_run, ptr_char, length_char);
+                length_run += length_char;
+            }
+        }
+        if (optional >= 0)
+        {
+            trigger_prefilter_literal_end_run (run, &length_run,
+                                               best, prefix, &at_start);
+        }
+    }
+
+    trigger_prefilter_literal_end_run (run, &length_run,
+                                       best, prefix, &at_start);
+
+    return ptr;
+}
+
+/*
+ * Parses alternatives in a regex (separated by "|", until ")" or end of
+ * string).
+ *
+ * With many alternatives, the only literal required is the common prefix
+ * of all alternatives.
+ *
+ * Returns pointer to the end of alternatives, NULL if error.
+ */
+
+const char *
+trigger_prefilter_regex_alternation (const char *ptr, int depth,
+                                     char *best, char *prefix)
+{
+    char seq_best[TRIGGER_PREFILTER_LITERAL_MAX];
+    char seq_prefix[TRIGGER_PREFILTER_LITERAL_MAX];
+    int count, i;
+
+    if (depth > 32)
+        return NULL;
+
+    best[0] = '\0';
+    prefix[0] = '\0';
+    count = 0;
+
+    while (1)
+    {
+        ptr = trigger_prefilter_regex_sequence (ptr, depth,
+                                                seq_best, seq_prefix);
+        if (!ptr)
+            return NULL;
+        if (count == 0)
+        {
+            strcpy (best, seq_best);
+            strcpy (prefix, seq_prefix);
+        }
+        else
+        {
+            for (i = 0; prefix[i] && (prefix[i] == seq_prefix[i]); i++)
+            {
+            }
+            /* do not cut an UTF-8 char */
+            while ((i > 0) && (((unsigned char)prefix[i] & 0xC0) == 0x80))
+            {
+                i--;
+            }
+            prefix[i] = '\0';
+            strcpy (best, prefix);
+        }
+        count++;
+        if (ptr[0] != '|')
+            break;
+        ptr++;
+    }
+
+    return ptr;
+}
+
+/*
+ * Extracts from a POSIX extended regular expression the longest literal
+ * text that must be found in any string matching the regex.
+ *
+ * Returns the literal text, NULL if the regex does not require any literal
+ * text (or if the regex can not be parsed).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+trigger_prefilter_regex_literal (const char *regex)
+{
+    char best[TRIGGER_PREFILTER_LITERAL_MAX];
+    char prefix[TRIGGER_PREFILTER_LITERAL_MAX];
+    const char *ptr;
+
+    if (!regex)
+        return NULL;
+
+    ptr = trigger_prefilter_regex_alternation (regex, 0, best, prefix);
+    if (!ptr || ptr[0] || !best[0])
+        return NULL;
+
+    return strdup (best);
+}
+
+/*
+ * Adds a prefilter in a trigger.
+ */
+
+void
+trigger_prefilter_add (struct t_trigger *trigger,
+                       enum t_trigger_prefilter_type type,
+                       int match, int case_sensitive, int negate,
+                       const char *value)
+{
+    struct t_trigger_prefilter *new_prefilters;
+
+    new_prefilters = realloc (
+        trigger->prefilters,
+        (trigger->prefilters_count + 1) * sizeof (trigger->prefilters[0]));
+    if (!new_prefilters)
+        return;
+    trigger->prefilters = new_prefilters;
+
+    new_prefilters[trigger->prefilters_count].type = type;
+    new_prefilters[trigger->prefilters_count].match = match;
+    new_prefilters[trigger->prefilters_count].case_sensitive = case_sensitive;
+    new_prefilters[trigger->prefilters_count].negate = negate;
+    new_prefilters[trigger->prefilters_count].value = (value) ?
+        strdup (value) : NULL;
+
+    trigger->prefilters_count++;
+}
+
+/*
+ * Builds prefilter for a condition (one of the conditions joined with "&&"):
+ *   "${var}"
+ *   "${var} <comparison> <text>"
+ */
+
+void
+trigger_prefilter_build_condition (struct t_trigger *trigger, int hook_type,
+                                   const char *condition)
+{
+    const char *pos, *ptr_value;
+    char *var, *value;
+    int i, length, match, case_sensitive, negate;
+
+    if (strncmp (condition, "${", 2) != 0)
+        return;
+    pos = condition + 2;
+    while (isalnum ((unsigned char)pos[0]) || (pos[0] == '_') || (pos[0] == '.'))
+    {
+        pos++;
+    }
+    if ((pos[0] != '}') || (pos == condition + 2))
+        return;
+    var = weechat_strndup (condition + 2, pos - condition - 2);
+    if (!var)
+        return;
+    pos++;
+    while (pos[0] == ' ')
+    {
+        pos++;
+    }
+
+    /* condition is just a variable: its value must be true */
+    if (!pos[0])
+    {
+        if (hook_type == TRIGGER_HOOK_PRINT)
+        {
+            if (strcmp (var, "tg_displayed") == 0)
+            {
+                trigger_prefilter_add (trigger, TRIGGER_PREFILTER_DISPLAYED,
+                                       0, 0, 0, NULL);
+            }
+            else if (strcmp (var, "tg_highlight") == 0)
+            {
+                trigger_prefilter_add (trigger, TRIGGER_PREFILTER_HIGHLIGHT,
+                                       0, 0, 0, NULL);
+            }
+        }
+        goto end;
+    }
+
+    for (i = 0; trigger_prefilter_comparisons[i]; i++)
+    {
+        length = strlen (trigger_prefilter_comparisons[i]);
+        if (strncmp (pos, trigger_prefilter_comparisons[i], length) == 0)
+            break;
+    }
+    if (!trigger_prefilter_comparisons[i])
+        goto end;
+    match = (trigger_prefilter_comparisons[i][length - 1] == '*') ? 1 : 0;
+    case_sensitive = (length == 3) ? 1 : 0;
+    negate = (trigger_prefilter_comparisons[i][0] == '!') ? 1 : 0;
+    ptr_value = pos + length;
+    while (ptr_value[0] == ' ')
+    {
+        ptr_value++;
+    }
+
+    /*
+     * the value must be a constant text, without any char that could be
+     * interpreted by evaluation (variable, parentheses, other comparison)
+     */
+    if (!ptr_value[0] || strpbrk (ptr_value, "$(){}\"\\=!<>~"))
+        goto end;
+
+    if (strcmp (var, "buffer.full_name") == 0)
+    {
+        trigger_prefilter_add (trigger, TRIGGER_PREFILTER_BUFFER,
+                               match, case_sensitive, negate, ptr_value);
+    }
+    else if (trigger_prefilter_var_message[hook_type]
+             && (strcmp (var, trigger_prefilter_var_message[hook_type]) == 0))
+    {
+        trigger_prefilter_add (trigger, TRIGGER_PREFILTER_MESSAGE,
+                               match, case_sensitive, negate, ptr_value);
+    }
+    else if (trigger_prefilter_var_tags[hook_type]
+             && (strcmp (var, trigger_prefilter_var_tags[hook_type]) == 0)
+             && !match)
+    {
+        /* only a single tag is supported: ",tag," */
+        length = strlen (ptr_value);
+        if ((length > 2) && (ptr_value[0] == ',')
+            && (ptr_value[length - 1] == ',')
+            && !memchr (ptr_value + 1, ',', length - 2))
+        {
+            value = strdup (ptr_value);
+            if (value)
+            {
+                trigger_prefilter_add (trigger, TRIGGER_PREFILTER_TAG,
+                                       0, case_sensitive, negate, value);
+                free (value);
+            }
+        }
+    }
+
+end:
+    free (var);
+}
+
+/*
+ * Builds prefilters with conditions of a trigger.
+ *
+ * Conditions are split on logical operators like the evaluation does:
+ * prefilters are built only if conditions are joined with "&&" (at top
+ * level), each condition must then be true.
+ */
+
+void
+trigger_prefilter_build_conditions (struct t_trigger *trigger, int hook_type)
+{
+    const char *conditions, *ptr_cond, *pos_start;
+    char *condition;
+    int level, length;
+
+    conditions = weechat_config_string (
+        trigger->options[TRIGGER_OPTION_CONDITIONS]);
+    if (!conditions || !conditions[0] || strchr (conditions, '\\'))
+        return;
+
+    /* first pass: check that there is no "||" at top level */
+    level = 0;
+    ptr_cond = conditions;
+    while (ptr_cond[0])
+    {
+        if ((strncmp (ptr_cond, "${", 2) == 0) || (ptr_cond[0] == '('))
+        {
+            level++;
+            ptr_cond += (ptr_cond[0] == '(') ? 1 : 2;
+        }
+        else if ((ptr_cond[0] == '}') || (ptr_cond[0] == ')'))
+        {
+            if (level > 0)
+                level--;
+            ptr_cond++;
+        }
+        else if ((level == 0) && (strncmp (ptr_cond, "||", 2) == 0))
+        {
+            return;
+        }
+        else
+        {
+            ptr_cond++;
+        }
+    }
+
+    /* second pass: build a prefilter for each condition joined with "&&" */
+    level = 0;
+    ptr_cond = conditions;
+    pos_start = conditions;
+    while (1)
+    {
+        if (!ptr_cond[0]
+            || ((level == 0) && (strncmp (ptr_cond, "&&", 2) == 0)))
+        {
+            while (pos_start[0] == ' ')
+            {
+                pos_start++;
+            }
+            length = ptr_cond - pos_start;
+            while ((length > 0) && (pos_start[length - 1] == ' '))
+            {
+                length--;
+            }
+            condition = weechat_strndup (pos_start, length);
+            if (condition)
+            {
+                trigger_prefilter_build_condition (trigger, hook_type,
+                                                   condition);
+                free (condition);
+            }
+            if (!ptr_cond[0])
+                break;
+            ptr_cond += 2;
+            pos_start = ptr_cond;
+        }
+        else if ((strncmp (ptr_cond, "${", 2) == 0) || (ptr_cond[0] == '('))
+        {
+            level++;
+            ptr_cond += (ptr_cond[0] == '(') ? 1 : 2;
+        }
+        else if ((ptr_cond[0] == '}') || (ptr_cond[0] == ')'))
+        {
+            if (level > 0)
+                level--;
+            ptr_cond++;
+        }
+        else
+        {
+            ptr_cond++;
+        }
+    }
+}
+
+/*
+ * Builds prefilters with regex of a trigger.
+ *
+ * This is done only if the regex are the only effect of the trigger (no
+ * command, no post action) and if they are all applied on the default
+ * variable: if none of the literal texts required by the regex is found
+ * in the message, no regex can match and the trigger does nothing.
+ */
+
+void
+trigger_prefilter_build_regex (struct t_trigger *trigger, int hook_type)
+{
+    const char *ptr_regex;
+    char *regex_escaped, *literal;
+    int i, count, flags;
+
+    if ((hook_type != TRIGGER_HOOK_MODIFIER) && (hook_type != TRIGGER_HOOK_LINE))
+        return;
+
+    if ((trigger->regex_count == 0)
+        || (trigger->commands_count > 0)
+        || !trigger->options[TRIGGER_OPTION_POST_ACTION]
+        || (weechat_config_enum (trigger->options[TRIGGER_OPTION_POST_ACTION])
+            != TRIGGER_POST_ACTION_NONE))
+    {
+        return;
+    }
+
+    for (i = 0; i < trigger->regex_count; i++)
+    {
+        if ((trigger->regex[i].command != TRIGGER_REGEX_COMMAND_REPLACE)
+            || (trigger->regex[i].variable
+                && (strcmp (trigger->regex[i].variable,
+                            trigger_hook_regex_default_var[hook_type]) != 0)))
+        {
+            return;
+        }
+    }
+
+    count = trigger->prefilters_count;
+    for (i = 0; i < trigger->regex_count; i++)
+    {
+        /* invalid regex is skipped when trigger is executed */
+        if (!trigger->regex[i].regex)
+            continue;
+        literal = NULL;
+        regex_escaped = weechat_string_convert_escaped_chars (
+            trigger->regex[i].str_regex);
+        if (regex_escaped)
+        {
+            ptr_regex = weechat_string_regex_flags (
+                regex_escaped, REG_EXTENDED | REG_ICASE, &flags);
+            if (flags & REG_EXTENDED)
+                literal = trigger_prefilter_regex_literal (ptr_regex);
+            free (regex_escaped);
+        }
+        if (!literal)
+        {
+            /* this regex can match without literal text: no prefilter */
+            while (trigger->prefilters_count > count)
+            {
+                trigger->prefilters_count--;
+                free (trigger->prefilters[trigger->prefilters_count].value);
+            }
+            return;
+        }
+        trigger_prefilter_add (trigger, TRIGGER_PREFILTER_REGEX,
+                               0, (flags & REG_ICASE) ? 0 : 1, 0, literal);
+        free (literal);
+    }
+}
+
+/*
+ * Builds prefilters of a trigger, using its conditions and regex.
+ */
+
+void
+trigger_prefilter_build (struct t_trigger *trigger)
+{
+    int hook_type;
+
+    if (!trigger)
+        return;
+
+    trigger_prefilter_free (trigger);
+    trigger->prefilters_built = 1;
+
+    if (!trigger->options[TRIGGER_OPTION_HOOK]
+        || !trigger->options[TRIGGER_OPTION_CONDITIONS])
+    {
+        return;
+    }
+
+    hook_type = weechat_config_enum (trigger->options[TRIGGER_OPTION_HOOK]);
+    if ((hook_type != TRIGGER_HOOK_PRINT)
+        && (hook_type != TRIGGER_HOOK_LINE)
+        && (hook_type != TRIGGER_HOOK_MODIFIER))
+    {
+        return;
+    }
+
+    trigger_prefilter_build_conditions (trigger, hook_type);
+    trigger_prefilter_build_regex (trigger, hook_type);
+}
+
+/*
+ * Frees prefilters of a trigger (they will be built again on next call
+ * to the trigger).
+ */
+
+void
+trigger_prefilter_free (struct t_trigger *trigger)
+{
+    int i;
+
+    if (!trigger)
+        return;
+
+    for (i = 0; i < trigger->prefilters_count; i++)
+    {
+        free (trigger->prefilters[i].value);
+    }
+    free (trigger->prefilters);
+    trigger->prefilters = NULL;
+    trigger->prefilters_count = 0;
+    trigger->prefilters_built = 0;
+}
+
+/*
+ * Initializes data for prefilters.
+ */
+
+void
+trigger_prefilter_data_init (struct t_trigger_prefilter_data *data)
+{
+    data->buffer = NULL;
+    data->tags = NULL;
+    data->tags_count = 0;
+    data->str_tags = NULL;
+    data->message = NULL;
+    data->displayed = -1;
+    data->highlight = -1;
+}
+
+/*
+ * Checks if tag "no_trigger" is in tags.
+ *
+ * Returns:
+ *   1: tag "no_trigger" found
+ *   0: tag "no_trigger" not found
+ */
+
+int
+trigger_prefilter_has_no_trigger (struct t_trigger_prefilter_data *data)
+{
+    const char *ptr_tag, *pos;
+    int i, length;
+
+    if (data->tags)
+    {
+        for (i = 0; i < data->tags_count; i++)
+        {
+            if (strcmp (data->tags[i], "no_trigger") == 0)
+                return 1;
+        }
+        return 0;
+    }
+
+    ptr_tag = data->str_tags;
+    while (ptr_tag && ptr_tag[0])
+    {
+        while (ptr_tag[0] == ' ')
+        {
+            ptr_tag++;
+        }
+        pos = strchr (ptr_tag, ',');
+        length = (pos) ? pos - ptr_tag : (int)strlen (ptr_tag);
+        while ((length > 0) && (ptr_tag[length - 1] == ' '))
+        {
+            length--;
+        }
+        if ((length == 10) && (strncmp (ptr_tag, "no_trigger", 10) == 0))
+            return 1;
+        ptr_tag = (pos) ? pos + 1 : NULL;
+    }
+
+    return 0;
+}
+
+/*
+ * Builds string with tags and commas around (",tag1,tag2,"), like the
+ * variable with tags used in conditions.
+ *
+ * Returns:
+ *   1: string built
+ *   0: string too long for buffer
+ */
+
+int
+trigger_prefilter_build_tags (struct t_trigger_prefilter_data *data,
+                              char *str_tags, int size)
+{
+    int i, length, length_tag;
+
+    if (data->tags)
+    {
+        str_tags[0] = ',';
+        length = 1;
+        for (i = 0; i < data->tags_count; i++)
+        {
+            length_tag = strlen (data->tags[i]);
+            if (length + length_tag + 2 > size)
+                return 0;
+            if (i > 0)
+                str_tags[length++] = ',';
+            memcpy (str_tags + length, data->tags[i], length_tag);
+            length += length_tag;
+        }
+        str_tags[length++] = ',';
+        str_tags[length] = '\0';
+        return 1;
+    }
+
+    length = snprintf (str_tags, size, ",%s,",
+                       (data->str_tags) ? data->str_tags : "");
+
+    return (length < size) ? 1 : 0;
+}
+
+/*
+ * Compares a string with a prefilter value.
+ *
+ * Returns:
+ *   1: comparison is true
+ *   0: comparison is false
+ */
+
+int
+trigger_prefilter_compare (struct t_trigger_prefilter *prefilter,
+                           const char *string)
+{
+    int rc;
+
+    if (prefilter->match)
+    {
+        rc = weechat_string_match (string, prefilter->value,
+                                   prefilter->case_sensitive);
+    }
+    else
+    {
+        rc = ((prefilter->case_sensitive) ?
+              strstr (string, prefilter->value) :
+              weechat_strcasestr (string, prefilter->value)) ? 1 : 0;
+    }
+
+    return (prefilter->negate) ? rc ^ 1 : rc;
+}
+
+/*
+ * Checks prefilters of a trigger with data received by the hook callback.
+ *
+ * If the check fails, the trigger must not be executed: its conditions can
+ * not be true, or none of its regex can match.
+ *
+ * Returns:
+ *   1: trigger can be executed
+ *   0: trigger must not be executed
+ */
+
+int
+trigger_prefilter_check (struct t_trigger *trigger,
+                         struct t_trigger_prefilter_data *data)
+{
+    char str_tags[4096];
+    const char *ptr_string;
+    int i, tags_built, regex_count, regex_found;
+
+    if (!trigger || !data)
+        return 1;
+
+    if (!trigger->prefilters_built)
+        trigger_prefilter_build (trigger);
+
+    if (trigger_prefilter_has_no_trigger (data))
+        goto fail;
+
+    tags_built = -1;
+    regex_count = 0;
+    regex_found = 0;
+
+    for (i = 0; i < trigger->prefilters_count; i++)
+    {
+        switch (trigger->prefilters[i].type)
+        {
+            case TRIGGER_PREFILTER_DISPLAYED:
+                if (data->displayed == 0)
+                    goto fail;
+                break;
+            case TRIGGER_PREFILTER_HIGHLIGHT:
+                if (data->highlight == 0)
+                    goto fail;
+                break;
+            case TRIGGER_PREFILTER_TAG:
+                if (tags_built < 0)
+                {
+                    tags_built = trigger_prefilter_build_tags (
+                        data, str_tags, sizeof (str_tags));
+                }
+                if (tags_built
+                    && !trigger_prefilter_compare (&(trigger->prefilters[i]),
+                                                   str_tags))
+                {
+                    goto fail;
+                }
+                break;
+            case TRIGGER_PREFILTER_BUFFER:
+                if (data->buffer)
+                {
+                    ptr_string = weechat_buffer_get_string (data->buffer,
+                                                            "full_name");
+                    if (!trigger_prefilter_compare (
+                            &(trigger->prefilters[i]),
+                            (ptr_string) ? ptr_string : ""))
+                    {
+                        goto fail;
+                    }
+                }
+                break;
+            case TRIGGER_PREFILTER_MESSAGE:
+                if (!trigger_prefilter_compare (
+                        &(trigger->prefilters[i]),
+                        (data->message) ? data->message : ""))
+                {
+                    goto fail;
+                }
+                break;
+            case TRIGGER_PREFILTER_REGEX:
+                regex_count++;
+                if (!data->message
+                    || trigger_prefilter_compare (&(trigger->prefilters[i]),
+                                                  data->message))
+                {
+                    regex_found = 1;
+                }
+                break;
+            case TRIGGER_NUM_PREFILTER_TYPES:
+                break;
+        }
+    }
+
+    /* none of the regex can match: the trigger would do nothing */
+    if ((regex_count > 0) && !regex_found)
+        goto fail;
+
+    return 1;
+
+fail:
+    trigger->hook_count_prefilter++;
+    return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_PLUGIN_TRIGGER_PREFILTER_H
+#define WEECHAT_PLUGIN_TRIGGER_PREFILTER_H
+
+#define TRIGGER_PREFILTER_LITERAL_MAX 128
+
+struct t_trigger;
+
+/*
+ * a prefilter is a cheap test extracted from conditions or regex of a
+ * trigger, checked in hook callback before building the hashtables; if a
+ * prefilter fails, the conditions (or all the regex) can not be true, so
+ * the trigger is not executed at all
+ */
+
+enum t_trigger_prefilter_type
+{
+    TRIGGER_PREFILTER_DISPLAYED = 0,   /* "${tg_displayed}"                 */
+    TRIGGER_PREFILTER_HIGHLIGHT,       /* "${tg_highlight}"                 */
+    TRIGGER_PREFILTER_TAG,             /* "${tg_tags} !!- ,tag,"            */
+    TRIGGER_PREFILTER_BUFFER,          /* "${buffer.full_name} =* mask"     */
+    TRIGGER_PREFILTER_MESSAGE,         /* "${tg_message} =- text"           */
+    TRIGGER_PREFILTER_REGEX,           /* text required by a regex          */
+    /* number of prefilter types */
+    TRIGGER_NUM_PREFILTER_TYPES,
+};
+
+struct t_trigger_prefilter
+{
+    enum t_trigger_prefilter_type type; /* type of prefilter                */
+    int match;                         /* 1 = mask (=*), 0 = include (=-)   */
+    int case_sensitive;                /* 1 if comparison is case sensitive */
+    int negate;                        /* 1 if result is negated (!*, !-)   */
+    char *value;                       /* ",tag,", mask or text             */
+};
+
+/* data received by hook callback, available without building hashtables */
+
+struct t_trigger_prefilter_data
+{
+    struct t_gui_buffer *buffer;       /* buffer (NULL if unknown)          */
+    const char **tags;                 /* tags (array)...                   */
+    int tags_count;                    /* ...and number of tags             */
+    const char *str_tags;              /* ...or tags separated by commas    */
+    const char *message;               /* message (or modifier string)      */
+    int displayed;                     /* 1 if displayed, -1 if unknown     */
+    int highlight;                     /* 1 if highlight, -1 if unknown     */
+};
+
+extern char *trigger_prefilter_regex_literal (const char *regex);
+extern void trigger_prefilter_build (struct t_trigger *trigger);
+extern void trigger_prefilter_free (struct t_trigger *trigger);
+extern int trigger_prefilter_check (struct t_trigger *trigger,
+                                    struct t_trigger_prefilter_data *data);
+extern void trigger_prefilter_data_init (struct t_trigger_prefilter_data *data);
+
+#endif /* WEECHAT_PLUGIN_TRIGGER_PREFILTER_H */
@@ -32,6 +32,7 @@
 #include "trigger-command.h"
 #include "trigger-completion.h"
 #include "trigger-config.h"
+#include "trigger-prefilter.h"
 
 
 WEECHAT_PLUGIN_NAME(TRIGGER_PLUGIN_NAME);
@@ -287,6 +288,10 @@ trigger_unhook (struct t_trigger *trigger)
     }
     trigger->hook_count_cb = 0;
     trigger->hook_count_cmd = 0;
+    trigger->hook_count_prefilter = 0;
+    trigger->hook_count_match = 0;
+    trigger->hook_time_usec = 0;
+    trigger_prefilter_free (trigger);
     if (trigger->hook_print_buffers)
     {
         free (trigger->hook_print_buffers);
@@ -597,6 +602,10 @@ trigger_hook (struct t_trigger *trigger)
                         weechat_prefix ("error"), TRIGGER_PLUGIN_NAME,
                         trigger->name);
     }
+    else
+    {
+        trigger_prefilter_build (trigger);
+    }
 
     weechat_string_free_split (argv);
     weechat_string_free_split (argv_eol);
@@ -924,8 +933,14 @@ trigger_alloc (const char *name)
     new_trigger->hooks = NULL;
     new_trigger->hook_count_cb = 0;
     new_trigger->hook_count_cmd = 0;
+    new_trigger->hook_count_prefilter = 0;
+    new_trigger->hook_count_match = 0;
+    new_trigger->hook_time_usec = 0;
     new_trigger->hook_running = 0;
     new_trigger->hook_print_buffers = NULL;
+    new_trigger->prefilters_built = 0;
+    new_trigger->prefilters_count = 0;
+    new_trigger->prefilters = NULL;
     new_trigger->regex_count = 0;
     new_trigger->regex = NULL;
     new_trigger->commands_count = 0;
@@ -1296,8 +1311,24 @@ trigger_print_log ()
         }
         weechat_log_printf ("  hook_count_cb . . . . . : %llu", ptr_trigger->hook_count_cb);
         weechat_log_printf ("  hook_count_cmd. . . . . : %llu", ptr_trigger->hook_count_cmd);
+        weechat_log_printf ("  hook_count_prefilter. . : %llu", ptr_trigger->hook_count_prefilter);
+        weechat_log_printf ("  hook_count_match. . . . : %llu", ptr_trigger->hook_count_match);
+        weechat_log_printf ("  hook_time_usec. . . . . : %llu", ptr_trigger->hook_time_usec);
         weechat_log_printf ("  hook_running. . . . . . : %d", ptr_trigger->hook_running);
         weechat_log_printf ("  hook_print_buffers. . . : '%s'", ptr_trigger->hook_print_buffers);
+        weechat_log_printf ("  prefilters_built. . . . : %d", ptr_trigger->prefilters_built);
+        weechat_log_printf ("  prefilters_count. . . . : %d", ptr_trigger->prefilters_count);
+        for (i = 0; i < ptr_trigger->prefilters_count; i++)
+        {
+            weechat_log_printf ("    prefilters[%03d] . . . : type:%d, match:%d, "
+                                "case_sensitive:%d, negate:%d, value:'%s'",
+                                i,
+                                ptr_trigger->prefilters[i].type,
+                                ptr_trigger->prefilters[i].match,
+                                ptr_trigger->prefilters[i].case_sensitive,
+                                ptr_trigger->prefilters[i].negate,
+                                ptr_trigger->prefilters[i].value);
+        }
         weechat_log_printf ("  regex_count . . . . . . : %d", ptr_trigger->regex_count);
         weechat_log_printf ("  regex . . . . . . . . . : %p", ptr_trigger->regex);
         for (i = 0; i < ptr_trigger->regex_count; i++)
@@ -111,9 +111,21 @@ struct t_trigger
     struct t_hook **hooks;             /* array of hooks (signal, ...)      */
     unsigned long long hook_count_cb;  /* number of calls made to callback  */
     unsigned long long hook_count_cmd; /* number of commands run in callback*/
+    unsigned long long hook_count_prefilter; /* number of calls stopped by  */
+                                       /* prefilters                        */
+    unsigned long long hook_count_match; /* number of calls with conditions */
+                                       /* OK                                */
+    unsigned long long hook_time_usec; /* time spent in callback (in usec), */
+                                       /* measured only when monitor buffer */
+                                       /* is open or debug is enabled       */
     int hook_running;                  /* 1 if one hook callback is running */
     char *hook_print_buffers;          /* buffers (for hook_print only)     */
 
+    /* prefilters (checked before building hashtables in callback) */
+    int prefilters_built;              /* 1 if prefilters are built         */
+    int prefilters_count;              /* number of prefilters              */
+    struct t_trigger_prefilter *prefilters; /* array of prefilters          */
+
     /* regular expressions */
     int regex_count;                   /* number of regex                   */
     struct t_trigger_regex *regex;     /* array of regex                    */
@@ -58,6 +58,7 @@ extern "C"
 
 /* import tests from libs */
 /* core */
+IMPORT_TEST_GROUP(CoreArena);
 IMPORT_TEST_GROUP(CoreArraylist);
 IMPORT_TEST_GROUP(CoreCalc);
 IMPORT_TEST_GROUP(CoreCommand);
@@ -71,6 +72,7 @@ IMPORT_TEST_GROUP(CoreHook);
 IMPORT_TEST_GROUP(CoreInfolist);
 IMPORT_TEST_GROUP(CoreList);
 IMPORT_TEST_GROUP(CoreNetwork);
+IMPORT_TEST_GROUP(CoreProfile);
 IMPORT_TEST_GROUP(CoreSecure);
 IMPORT_TEST_GROUP(CoreSignal);
 IMPORT_TEST_GROUP(CoreString);
@@ -113,6 +115,7 @@ IMPORT_TEST_GROUP(GuiKey);
 IMPORT_TEST_GROUP(GuiLine);
 IMPORT_TEST_GROUP(GuiNick);
 IMPORT_TEST_GROUP(GuiNicklist);
+IMPORT_TEST_GROUP(GuiWindow);
 /* GUI - Curses */
 IMPORT_TEST_GROUP(GuiCursesMouse);
 /* scripts */
@@ -25,13 +25,71 @@
 
 extern "C"
 {
+#ifndef HAVE_CONFIG_H
+#define HAVE_CONFIG_H
+#endif
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
 #include "src/core/weechat.h"
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
+#include "src/core/core-hook.h"
+#include "src/plugins/plugin.h"
+
+extern struct t_hook *hook_fd_search (int fd);
+extern int hook_fd_table_set (int fd, struct t_hook *hook);
+extern void hook_fd_set_error (struct t_hook *hook, int error);
+extern void hook_fd_exec_fd (int fd);
+extern int hook_fd_pollfd_rebuild;
+#ifdef HAVE_EPOLL
+extern int hook_fd_epoll_fd;
+extern int hook_fd_epoll_count;
+extern void hook_fd_exec_epoll (int timeout);
+#endif
 }
 
 TEST_GROUP(HookFd)
 {
 };
 
+int test_hook_fd_calls = 0;
+
+/*
+ * Callback for fd hooks (does nothing).
+ */
+
+int
+test_hook_fd_cb (const void *pointer, void *data, int fd)
+{
+    /* make C++ compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) fd;
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Callback for fd hooks: counts calls and reads data available on fd.
+ */
+
+int
+test_hook_fd_read_cb (const void *pointer, void *data, int fd)
+{
+    char buffer[64];
+
+    /* make C++ compiler happy */
+    (void) pointer;
+    (void) data;
+
+    test_hook_fd_calls++;
+    (void) read (fd, buffer, sizeof (buffer));
+
+    return WEECHAT_RC_OK;
+}
+
 /*
  * Tests functions:
  *   hook_fd_get_description
@@ -45,19 +103,149 @@ TEST(HookFd, GetDescription)
 /*
  * Tests functions:
  *   hook_fd_search
+ *   hook_fd_table_set
  */
 
 TEST(HookFd, Search)
+{
+    struct t_hook *hook;
+    int fd[2];
+
+    POINTERS_EQUAL(NULL, hook_fd_search (-1));
+    POINTERS_EQUAL(NULL, hook_fd_search (100000));
+
+    LONGS_EQUAL(0, pipe (fd));
+
+    POINTERS_EQUAL(NULL, hook_fd_search (fd[0]));
+    hook = hook_fd (NULL, fd[0], 1, 0, 0, &test_hook_fd_cb, NULL, NULL);
+    CHECK(hook);
+    POINTERS_EQUAL(hook, hook_fd_search (fd[0]));
+
+    /* a second hook on same fd is not allowed */
+    POINTERS_EQUAL(NULL,
+                   hook_fd (NULL, fd[0], 1, 0, 0, &test_hook_fd_cb,
+                            NULL, NULL));
+
+    unhook (hook);
+    POINTERS_EQUAL(NULL, hook_fd_search (fd[0]));
+
+    LONGS_EQUAL(0, hook_fd_table_set (-1, NULL));
+
+    close (fd[0]);
+    close (fd[1]);
+}
+
+/*
+ * Tests functions:
+ *   hook_fd_get_poll_events
+ */
+
+TEST(HookFd, GetPollEvents)
 {
     /* TODO: write tests */
 }
 
 /*
  * Tests functions:
- *   hook_fd_realloc_pollfd
+ *   hook_fd_set_error
+ */
+
+TEST(HookFd, SetError)
+{
+    struct t_hook *hook;
+    int fd[2];
+
+    LONGS_EQUAL(0, pipe (fd));
+
+    hook = hook_fd (NULL, fd[0], 1, 0, 0, &test_hook_fd_cb, NULL, NULL);
+    CHECK(hook);
+    LONGS_EQUAL(0, HOOK_FD(hook, error));
+
+    hook_fd_set_error (hook, EBADF);
+    LONGS_EQUAL(EBADF, HOOK_FD(hook, error));
+
+    /* error is set only once */
+    hook_fd_set_error (hook, EINVAL);
+    LONGS_EQUAL(EBADF, HOOK_FD(hook, error));
+
+    unhook (hook);
+
+    close (fd[0]);
+    close (fd[1]);
+}
+
+/*
+ * Tests functions:
+ *   hook_fd_epoll_register
+ *   hook_fd_epoll_unregister
+ */
+
+TEST(HookFd, EpollRegister)
+{
+#ifdef HAVE_EPOLL
+    struct t_hook *hook, *hook_file, *hook_bad;
+    FILE *file;
+    int fd[2], fd_bad, count, id;
+
+    LONGS_EQUAL(0, pipe (fd));
+
+    count = hook_fd_epoll_count;
+
+    /* pipe: registered in epoll */
+    hook = hook_fd (NULL, fd[0], 1, 0, 0, &test_hook_fd_cb, NULL, NULL);
+    CHECK(hook);
+    CHECK(hook_fd_epoll_fd >= 0);
+    id = HOOK_FD(hook, registered);
+    CHECK(id > 0);
+    LONGS_EQUAL(count + 1, hook_fd_epoll_count);
+
+    /* change of flags: registration modified */
+    hook_fd_set_flag (hook, HOOK_FD_FLAG_WRITE, 1);
+    LONGS_EQUAL(id, HOOK_FD(hook, registered));
+    LONGS_EQUAL(count + 1, hook_fd_epoll_count);
+    hook_fd_set_flag (hook, HOOK_FD_FLAG_WRITE, 0);
+    LONGS_EQUAL(id, HOOK_FD(hook, registered));
+
+    /* regular file: refused by epoll, watched with poll() */
+    file = tmpfile ();
+    CHECK(file);
+    hook_fd_pollfd_rebuild = 0;
+    hook_file = hook_fd (NULL, fileno (file), 1, 0, 0, &test_hook_fd_cb,
+                         NULL, NULL);
+    CHECK(hook_file);
+    LONGS_EQUAL(0, HOOK_FD(hook_file, registered));
+    LONGS_EQUAL(0, HOOK_FD(hook_file, error));
+    LONGS_EQUAL(1, hook_fd_pollfd_rebuild);
+    LONGS_EQUAL(count + 1, hook_fd_epoll_count);
+    unhook (hook_file);
+    fclose (file);
+
+    /* invalid fd: error, watched with poll() */
+    fd_bad = dup (fd[1]);
+    CHECK(fd_bad >= 0);
+    close (fd_bad);
+    hook_bad = hook_fd (NULL, fd_bad, 1, 0, 0, &test_hook_fd_cb, NULL, NULL);
+    CHECK(hook_bad);
+    LONGS_EQUAL(0, HOOK_FD(hook_bad, registered));
+    LONGS_EQUAL(EBADF, HOOK_FD(hook_bad, error));
+    LONGS_EQUAL(count + 1, hook_fd_epoll_count);
+    unhook (hook_bad);
+
+    /* removal of hook: fd unregistered */
+    unhook (hook);
+    LONGS_EQUAL(count, hook_fd_epoll_count);
+
+    close (fd[0]);
+    close (fd[1]);
+#endif /* HAVE_EPOLL */
+}
+
+/*
+ * Tests functions:
+ *   hook_fd_build_pollfd
  */
 
-TEST(HookFd, ReallocPollfd)
+TEST(HookFd, BuildPollfd)
 {
     /* TODO: write tests */
 }
@@ -92,6 +280,173 @@ TEST(HookFd, Fd)
     /* TODO: write tests */
 }
 
+/*
+ * Tests functions:
+ *   hook_fd_set_flag
+ */
+
+TEST(HookFd, SetFlag)
+{
+    struct t_hook *hook;
+    int fd[2];
+
+    LONGS_EQUAL(0, pipe (fd));
+
+    hook = hook_fd (NULL, fd[0], 1, 0, 0, &test_hook_fd_cb, NULL, NULL);
+    CHECK(hook);
+    LONGS_EQUAL(HOOK_FD_FLAG_READ, HOOK_FD(hook, flags));
+
+    hook_fd_set_flag (hook, HOOK_FD_FLAG_WRITE, 1);
+    LONGS_EQUAL(HOOK_FD_FLAG_READ | HOOK_FD_FLAG_WRITE, HOOK_FD(hook, flags));
+
+    hook_set (hook, "read", "0");
+    LONGS_EQUAL(HOOK_FD_FLAG_WRITE, HOOK_FD(hook, flags));
+
+    hook_set (hook, "exception", "1");
+    LONGS_EQUAL(HOOK_FD_FLAG_WRITE | HOOK_FD_FLAG_EXCEPTION,
+                HOOK_FD(hook, flags));
+
+    hook_set (hook, "write", "0");
+    LONGS_EQUAL(HOOK_FD_FLAG_EXCEPTION, HOOK_FD(hook, flags));
+
+    unhook (hook);
+
+    close (fd[0]);
+    close (fd[1]);
+}
+
+/*
+ * Tests functions:
+ *   hook_fd_exec_fd
+ *   hook_fd_exec_epoll
+ */
+
+TEST(HookFd, ExecFd)
+{
+    struct t_hook *hook;
+    int fd[2];
+#ifdef HAVE_EPOLL
+    int fd_dup;
+#endif
+
+    LONGS_EQUAL(0, pipe (fd));
+
+    hook = hook_fd (NULL, fd[0], 1, 0, 0, &test_hook_fd_read_cb, NULL, NULL);
+    CHECK(hook);
+
+    /* no hook on fd */
+    test_hook_fd_calls = 0;
+    hook_fd_exec_fd (fd[1]);
+    LONGS_EQUAL(0, test_hook_fd_calls);
+
+    /* callback called for the hook on fd */
+    LONGS_EQUAL(1, write (fd[1], "a", 1));
+    hook_fd_exec_fd (fd[0]);
+    LONGS_EQUAL(1, test_hook_fd_calls);
+
+#ifdef HAVE_EPOLL
+    CHECK(HOOK_FD(hook, registered) > 0);
+
+    /* no data: callback not called */
+    test_hook_fd_calls = 0;
+    hook_fd_exec_epoll (0);
+    LONGS_EQUAL(0, test_hook_fd_calls);
+
+    /* data available: callback called once */
+    LONGS_EQUAL(1, write (fd[1], "b", 1));
+    hook_fd_exec_epoll (0);
+    LONGS_EQUAL(1, test_hook_fd_calls);
+    hook_fd_exec_epoll (0);
+    LONGS_EQUAL(1, test_hook_fd_calls);
+
+    /* fd closed (file still open with a dup): error, fd removed */
+    fd_dup = dup (fd[0]);
+    CHECK(fd_dup >= 0);
+    close (fd[0]);
+    close (fd[1]);
+    LONGS_EQUAL(0, HOOK_FD(hook, error));
+    hook_fd_exec_epoll (0);
+    LONGS_EQUAL(1, test_hook_fd_calls);
+    LONGS_EQUAL(EBADF, HOOK_FD(hook, error));
+    LONGS_EQUAL(0, HOOK_FD(hook, registered));
+    LONGS_EQUAL(1, hook_fd_pollfd_rebuild);
+
+    unhook (hook);
+    close (fd_dup);
+#else
+    unhook (hook);
+    close (fd[0]);
+    close (fd[1]);
+#endif /* HAVE_EPOLL */
+}
+
+/*
+ * Tests functions:
+ *   hook_fd_epoll_rebuild
+ *   hook_fd_exec_epoll
+ */
+
+TEST(HookFd, EpollFdReused)
+{
+#ifdef HAVE_EPOLL
+    struct t_hook *hook_old, *hook_new;
+    struct epoll_event event;
+    int fd_old[2], fd_new[2], fd_dup, count, id;
+
+    LONGS_EQUAL(0, pipe (fd_old));
+    LONGS_EQUAL(0, pipe (fd_new));
+
+    count = hook_fd_epoll_count;
+
+    hook_old = hook_fd (NULL, fd_old[0], 1, 0, 0, &test_hook_fd_read_cb,
+                        NULL, NULL);
+    CHECK(hook_old);
+    CHECK(HOOK_FD(hook_old, registered) > 0);
+
+    /*
+     * fd closed before the hook is removed (file still open with a dup),
+     * then fd number reused by a new file
+     */
+    id = HOOK_FD(hook_old, registered);
+    fd_dup = dup (fd_old[0]);
+    CHECK(fd_dup >= 0);
+    LONGS_EQUAL(fd_old[0], dup2 (fd_new[0], fd_old[0]));
+    unhook (hook_old);
+    LONGS_EQUAL(count, hook_fd_epoll_count);
+
+    /* new hook on the fd number reused */
+    hook_new = hook_fd (NULL, fd_old[0], 1, 0, 0, &test_hook_fd_read_cb,
+                        NULL, NULL);
+    CHECK(hook_new);
+    CHECK(HOOK_FD(hook_new, registered) > 0);
+    CHECK(HOOK_FD(hook_new, registered) != id);
+    LONGS_EQUAL(count + 1, hook_fd_epoll_count);
+
+    /* event on the stale registration: dropped, callback not called */
+    test_hook_fd_calls = 0;
+    LONGS_EQUAL(1, write (fd_old[1], "a", 1));
+    hook_fd_exec_epoll (0);
+    LONGS_EQUAL(0, test_hook_fd_calls);
+    CHECK(HOOK_FD(hook_new, registered) > 0);
+    LONGS_EQUAL(count + 1, hook_fd_epoll_count);
+    LONGS_EQUAL(0, epoll_wait (hook_fd_epoll_fd, &event, 1, 0));
+
+    /* event on the new file: callback called */
+    LONGS_EQUAL(1, write (fd_new[1], "b", 1));
+    hook_fd_exec_epoll (0);
+    LONGS_EQUAL(1, test_hook_fd_calls);
+
+    unhook (hook_new);
+    LONGS_EQUAL(count, hook_fd_epoll_count);
+
+    close (fd_dup);
+    close (fd_old[0]);
+    close (fd_old[1]);
+    close (fd_new[0]);
+    close (fd_new[1]);
+#endif /* HAVE_EPOLL */
+}
+
 /*
  * Tests functions:
  *   hook_fd_exec
@@ -112,6 +467,35 @@ TEST(HookFd, FreeData)
     /* TODO: write tests */
 }
 
+/*
+ * Tests functions:
+ *   hook_fd_end
+ */
+
+TEST(HookFd, End)
+{
+    struct t_hook *hook;
+    int fd[2];
+
+    LONGS_EQUAL(0, pipe (fd));
+
+    hook = hook_fd (NULL, fd[0], 1, 0, 0, &test_hook_fd_cb, NULL, NULL);
+    CHECK(hook);
+
+    hook_fd_end ();
+    LONGS_EQUAL(0, HOOK_FD(hook, registered));
+    LONGS_EQUAL(1, hook_fd_pollfd_rebuild);
+#ifdef HAVE_EPOLL
+    LONGS_EQUAL(-1, hook_fd_epoll_fd);
+    LONGS_EQUAL(0, hook_fd_epoll_count);
+#endif
+
+    unhook (hook);
+
+    close (fd[0]);
+    close (fd[1]);
+}
+
 /*
  * Tests functions:
  *   hook_fd_add_to_infolist
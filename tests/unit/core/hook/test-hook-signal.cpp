@@ -25,13 +25,85 @@
 
 extern "C"
 {
+#include <string.h>
 #include "src/core/weechat.h"
+#include "src/core/core-hook.h"
+#include "src/core/core-string.h"
+#include "src/plugins/plugin.h"
+
+extern enum t_hook_signal_mask_type hook_signal_mask_type (const char *mask,
+                                                           const char **word,
+                                                           int *length);
+extern int hook_signal_match (const char *signal, struct t_hook *hook);
+extern void hook_signal_get_candidates (const char *signal,
+                                        const char *signal_lower,
+                                        struct t_hook_signal_candidates *candidates);
+extern void hook_signal_index_update (struct t_hook *hook, int add);
+extern struct t_hashtable *hook_signal_index_exact;
+extern struct t_hook_signal_trie *hook_signal_index_prefix;
+extern struct t_hook_signal_trie *hook_signal_index_suffix;
+extern struct t_arraylist *hook_signal_index_generic;
 }
 
+#define WEE_CHECK_MASK_TYPE(__type, __word, __mask)                     \
+    type = hook_signal_mask_type (__mask, &word, &length);              \
+    LONGS_EQUAL(__type, type);                                          \
+    LONGS_EQUAL(strlen (__word), length);                               \
+    STRNCMP_EQUAL(__word, word, length);
+
+char test_hook_signal_calls[1024];
+struct t_hook *test_hook_signal_added = NULL;
+
 TEST_GROUP(HookSignal)
 {
 };
 
+/*
+ * Callback for signal hooks: adds the name of hook (in pointer) to the
+ * string test_hook_signal_calls.
+ */
+
+int
+test_hook_signal_cb (const void *pointer, void *data,
+                     const char *signal, const char *type_data,
+                     void *signal_data)
+{
+    /* make C++ compiler happy */
+    (void) data;
+    (void) signal;
+    (void) type_data;
+    (void) signal_data;
+
+    if (test_hook_signal_calls[0])
+        strcat (test_hook_signal_calls, ",");
+    strcat (test_hook_signal_calls, (const char *)pointer);
+
+    return (strstr ((const char *)pointer, "eat")) ?
+        WEECHAT_RC_OK_EAT : WEECHAT_RC_OK;
+}
+
+/*
+ * Callback for signal hooks: hooks a new signal "test_signal_add".
+ */
+
+int
+test_hook_signal_add_cb (const void *pointer, void *data,
+                         const char *signal, const char *type_data,
+                         void *signal_data)
+{
+    /* make C++ compiler happy */
+    (void) data;
+    (void) signal;
+    (void) type_data;
+    (void) signal_data;
+
+    test_hook_signal_cb (pointer, NULL, NULL, NULL, NULL);
+    test_hook_signal_added = hook_signal (NULL, "500|test_signal_add",
+                                          &test_hook_signal_cb, "added", NULL);
+
+    return WEECHAT_RC_OK;
+}
+
 /*
  * Tests functions:
  *   hook_signal_get_description
@@ -42,6 +114,30 @@ TEST(HookSignal, GetDescription)
     /* TODO: write tests */
 }
 
+/*
+ * Tests functions:
+ *   hook_signal_mask_type
+ */
+
+TEST(HookSignal, MaskType)
+{
+    enum t_hook_signal_mask_type type;
+    const char *word;
+    int length;
+
+    WEE_CHECK_MASK_TYPE(HOOK_SIGNAL_MASK_EXACT, "test", "test");
+    WEE_CHECK_MASK_TYPE(HOOK_SIGNAL_MASK_PREFIX, "", "*");
+    WEE_CHECK_MASK_TYPE(HOOK_SIGNAL_MASK_PREFIX, "", "**");
+    WEE_CHECK_MASK_TYPE(HOOK_SIGNAL_MASK_PREFIX, "buffer_", "buffer_*");
+    WEE_CHECK_MASK_TYPE(HOOK_SIGNAL_MASK_PREFIX, "buffer_", "buffer_**");
+    WEE_CHECK_MASK_TYPE(HOOK_SIGNAL_MASK_SUFFIX, "_changed", "*_changed");
+    WEE_CHECK_MASK_TYPE(HOOK_SIGNAL_MASK_SUFFIX, "_changed", "**_changed");
+    WEE_CHECK_MASK_TYPE(HOOK_SIGNAL_MASK_GENERIC, ",irc_in2_",
+                        "*,irc_in2_*");
+    WEE_CHECK_MASK_TYPE(HOOK_SIGNAL_MASK_GENERIC, "irc", "irc*in*");
+    WEE_CHECK_MASK_TYPE(HOOK_SIGNAL_MASK_GENERIC, "a", "a*b");
+}
+
 /*
  * Tests functions:
  *   hook_signal
@@ -62,6 +158,127 @@ TEST(HookSignal, Match)
     /* TODO: write tests */
 }
 
+/*
+ * Tests functions:
+ *   hook_signal_index_update
+ *   hook_signal_index_add_mask
+ *   hook_signal_index_remove_mask
+ *   hook_signal_trie_add
+ *   hook_signal_trie_remove
+ *   hook_signal_get_candidates
+ */
+
+TEST(HookSignal, Index)
+{
+    const char *masks[] = {
+        "test_index", "TEST_INDEX", "test_*", "test_index*", "*_index",
+        "*DEX", "*", "*index*", "t*x", "test_*;*_index;test_index",
+        "other", "other*", "*other", "*o*t*h*e*r*", NULL,
+    };
+    const char *signals[] = {
+        "test_index", "Test_Index", "test_", "test_index_2", "index",
+        "x_index", "other", "test_other", "tx", "t", "", NULL,
+    };
+    struct t_hook *hooks[32];
+    struct t_hook_signal_candidates candidates;
+    char *signal_lower;
+    int i, j, count, num_hooks;
+
+    for (num_hooks = 0; masks[num_hooks]; num_hooks++)
+    {
+        hooks[num_hooks] = hook_signal (NULL, masks[num_hooks],
+                                        &test_hook_signal_cb, "", NULL);
+        CHECK(hooks[num_hooks]);
+    }
+
+    candidates.hooks = NULL;
+    candidates.count = 0;
+    candidates.size = 0;
+
+    /* hooks found with index must be the same as a scan of all hooks */
+    for (i = 0; signals[i]; i++)
+    {
+        signal_lower = string_tolower (signals[i]);
+        hook_signal_get_candidates (signals[i], signal_lower, &candidates);
+        count = 0;
+        for (j = 0; j < num_hooks; j++)
+        {
+            if (hook_signal_match (signals[i], hooks[j]))
+            {
+                CHECK(count < candidates.count);
+                POINTERS_EQUAL(hooks[j], candidates.hooks[count]);
+                count++;
+            }
+        }
+        LONGS_EQUAL(count, candidates.count);
+        free (signal_lower);
+    }
+
+    for (i = 0; i < num_hooks; i++)
+    {
+        unhook (hooks[i]);
+    }
+
+    hook_signal_get_candidates ("test_index", "test_index", &candidates);
+    LONGS_EQUAL(0, candidates.count);
+
+    free (candidates.hooks);
+}
+
+/*
+ * Tests functions:
+ *   hook_signal_index_free
+ *   hook_signal_trie_free
+ */
+
+TEST(HookSignal, IndexFree)
+{
+    const char *masks[] = {
+        "test_free", "test_free_*", "test_free_a*", "*_test_free",
+        "*_test*_free*", NULL,
+    };
+    struct t_hook *hooks[16], *ptr_hook;
+    int i, num_hooks;
+
+    for (num_hooks = 0; masks[num_hooks]; num_hooks++)
+    {
+        hooks[num_hooks] = hook_signal (NULL, masks[num_hooks],
+                                        &test_hook_signal_cb, "h", NULL);
+        CHECK(hooks[num_hooks]);
+    }
+    CHECK(hook_signal_index_exact);
+    CHECK(hook_signal_index_prefix);
+    CHECK(hook_signal_index_suffix);
+    CHECK(hook_signal_index_generic);
+
+    hook_signal_index_free ();
+    POINTERS_EQUAL(NULL, hook_signal_index_exact);
+    POINTERS_EQUAL(NULL, hook_signal_index_prefix);
+    POINTERS_EQUAL(NULL, hook_signal_index_suffix);
+    POINTERS_EQUAL(NULL, hook_signal_index_generic);
+
+    /* free again: nothing to do */
+    hook_signal_index_free ();
+
+    /* rebuild index with all signal hooks */
+    for (ptr_hook = weechat_hooks[HOOK_TYPE_SIGNAL]; ptr_hook;
+         ptr_hook = ptr_hook->next_hook)
+    {
+        if (!ptr_hook->deleted)
+            hook_signal_index_update (ptr_hook, 1);
+    }
+
+    test_hook_signal_calls[0] = '\0';
+    hook_signal_send ("test_free_a_test_free", WEECHAT_HOOK_SIGNAL_STRING,
+                      NULL);
+    STRCMP_EQUAL("h,h,h,h", test_hook_signal_calls);
+
+    for (i = 0; i < num_hooks; i++)
+    {
+        unhook (hooks[i]);
+    }
+}
+
 /*
  * Tests functions:
  *   hook_signal_send
@@ -69,7 +286,59 @@ TEST(HookSignal, Match)
 
 TEST(HookSignal, Send)
 {
-    /* TODO: write tests */
+    struct t_hook *hook1, *hook2, *hook3, *hook4, *hook5;
+
+    hook1 = hook_signal (NULL, "test_signal_*", &test_hook_signal_cb,
+                         "h1", NULL);
+    hook2 = hook_signal (NULL, "2000|*_signal_send", &test_hook_signal_cb,
+                         "h2", NULL);
+    hook3 = hook_signal (NULL, "test_signal_send;*signal*",
+                         &test_hook_signal_cb, "h3", NULL);
+    hook4 = hook_signal (NULL, "500|test_signal_send", &test_hook_signal_cb,
+                         "h4_eat", NULL);
+    hook5 = hook_signal (NULL, "100|test_signal_send", &test_hook_signal_cb,
+                         "h5", NULL);
+
+    /* order: priority, then creation; each hook called once; eat */
+    test_hook_signal_calls[0] = '\0';
+    LONGS_EQUAL(WEECHAT_RC_OK_EAT,
+                hook_signal_send ("test_signal_send",
+                                  WEECHAT_HOOK_SIGNAL_STRING, NULL));
+    STRCMP_EQUAL("h2,h1,h3,h4_eat", test_hook_signal_calls);
+
+    /* case insensitive */
+    test_hook_signal_calls[0] = '\0';
+    hook_signal_send ("TEST_SIGNAL_SEND", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("h2,h1,h3,h4_eat", test_hook_signal_calls);
+
+    test_hook_signal_calls[0] = '\0';
+    LONGS_EQUAL(WEECHAT_RC_OK,
+                hook_signal_send ("test_signal_other",
+                                  WEECHAT_HOOK_SIGNAL_STRING, NULL));
+    STRCMP_EQUAL("h1,h3", test_hook_signal_calls);
+
+    test_hook_signal_calls[0] = '\0';
+    hook_signal_send ("unknown", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("", test_hook_signal_calls);
+
+    unhook (hook4);
+    test_hook_signal_calls[0] = '\0';
+    hook_signal_send ("test_signal_send", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("h2,h1,h3,h5", test_hook_signal_calls);
+
+    unhook (hook1);
+    unhook (hook2);
+    unhook (hook3);
+    unhook (hook5);
+
+    /* hook added by a callback: called if after the current hook */
+    hook1 = hook_signal (NULL, "test_signal_add", &test_hook_signal_add_cb,
+                         "h1", NULL);
+    test_hook_signal_calls[0] = '\0';
+    hook_signal_send ("test_signal_add", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("h1,added", test_hook_signal_calls);
+    unhook (hook1);
+    unhook (test_hook_signal_added);
 }
 
 /*
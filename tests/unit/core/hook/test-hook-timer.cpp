@@ -25,13 +25,146 @@
 
 extern "C"
 {
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
 #include "src/core/weechat.h"
+#include "src/core/core-hook.h"
+#include "src/core/core-util.h"
+#include "src/plugins/plugin.h"
+
+extern void hook_timer_heap_rebuild ();
 }
 
+#define TEST_HOOK_TIMER_MANY_COUNT 1000
+
 TEST_GROUP(HookTimer)
 {
 };
 
+char test_hook_timer_calls[64];
+int test_hook_timer_last_remaining_calls = 0;
+int test_hook_timer_count_calls = 0;
+
+/*
+ * Callback for timer hooks (does nothing).
+ */
+
+int
+test_hook_timer_cb (const void *pointer, void *data, int remaining_calls)
+{
+    /* make C++ compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) remaining_calls;
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Callback for timer hooks: counts calls.
+ */
+
+int
+test_hook_timer_count_cb (const void *pointer, void *data,
+                          int remaining_calls)
+{
+    /* make C++ compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) remaining_calls;
+
+    test_hook_timer_count_calls++;
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Callback for timer hooks: adds the name of timer (in pointer) to the
+ * string with calls.
+ */
+
+int
+test_hook_timer_record_cb (const void *pointer, void *data,
+                           int remaining_calls)
+{
+    /* make C++ compiler happy */
+    (void) data;
+
+    if (strlen (test_hook_timer_calls) + 1 < sizeof (test_hook_timer_calls))
+        strcat (test_hook_timer_calls, (const char *)pointer);
+    test_hook_timer_last_remaining_calls = remaining_calls;
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Sets next execution date of a timer: "seconds" relative to now.
+ */
+
+void
+test_hook_timer_set_next_exec (struct t_hook *hook, int seconds)
+{
+    gettimeofday (&HOOK_TIMER(hook, next_exec), NULL);
+    HOOK_TIMER(hook, next_exec).tv_sec += seconds;
+}
+
+/*
+ * Checks that heap of timers is valid: each timer runs after its parent
+ * and has the right index.
+ *
+ * Returns:
+ *   1: heap is valid
+ *   0: heap is invalid
+ */
+
+int
+test_hook_timer_heap_valid ()
+{
+    int i;
+
+    for (i = 0; i < hook_timer_heap_count; i++)
+    {
+        if (HOOK_TIMER(hook_timer_heap[i], heap_index) != i)
+            return 0;
+        if ((i > 0)
+            && (util_timeval_cmp (
+                    &HOOK_TIMER(hook_timer_heap[(i - 1) / 2], next_exec),
+                    &HOOK_TIMER(hook_timer_heap[i], next_exec)) > 0))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Counts timers of an array which are in heap of timers (NULL entries are
+ * ignored).
+ */
+
+int
+test_hook_timer_count_in_heap (struct t_hook **hooks, int count)
+{
+    int i, index, found;
+
+    found = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (!hooks[i])
+            continue;
+        index = HOOK_TIMER(hooks[i], heap_index);
+        if ((index >= 0) && (index < hook_timer_heap_count)
+            && (hook_timer_heap[index] == hooks[i]))
+        {
+            found++;
+        }
+    }
+
+    return found;
+}
+
 /*
  * Tests functions:
  *   hook_timer_get_description
@@ -42,6 +175,51 @@ TEST(HookTimer, GetDescription)
     /* TODO: write tests */
 }
 
+/*
+ * Tests functions:
+ *   hook_timer_heap_cmp
+ *   hook_timer_heap_swap
+ *   hook_timer_heap_up
+ *   hook_timer_heap_down
+ *   hook_timer_heap_add
+ *   hook_timer_heap_remove
+ *   hook_timer_heap_rebuild
+ */
+
+TEST(HookTimer, Heap)
+{
+    struct t_hook *hooks[64];
+    int i, count;
+
+    count = hook_timer_heap_count;
+
+    for (i = 0; i < 64; i++)
+    {
+        hooks[i] = hook_timer (NULL, 1000000 + (((i * 37) % 64) * 1000),
+                               0, 0, &test_hook_timer_cb, NULL, NULL);
+        CHECK(hooks[i]);
+        CHECK(HOOK_TIMER(hooks[i], heap_index) >= 0);
+    }
+    LONGS_EQUAL(count + 64, hook_timer_heap_count);
+    LONGS_EQUAL(1, test_hook_timer_heap_valid ());
+
+    /* remove some timers in the middle of heap */
+    for (i = 0; i < 64; i += 3)
+    {
+        unhook (hooks[i]);
+        hooks[i] = NULL;
+    }
+    LONGS_EQUAL(1, test_hook_timer_heap_valid ());
+
+    for (i = 0; i < 64; i++)
+    {
+        if (hooks[i])
+            unhook (hooks[i]);
+    }
+    LONGS_EQUAL(count, hook_timer_heap_count);
+    LONGS_EQUAL(1, test_hook_timer_heap_valid ());
+}
+
 /*
  * Tests functions:
  *   hook_timer_init
@@ -89,7 +267,145 @@ TEST(HookTimer, GetTimeToNext)
 
 TEST(HookTimer, Exec)
 {
-    /* TODO: write tests */
+    struct t_hook *hook_a, *hook_b, *hook_c;
+    struct timeval tv_now;
+    int count;
+
+    count = hooks_count[HOOK_TYPE_TIMER];
+
+    hook_a = hook_timer (NULL, 1000000, 0, 0,
+                         &test_hook_timer_record_cb, "A", NULL);
+    CHECK(hook_a);
+    hook_b = hook_timer (NULL, 1000000, 0, 2,
+                         &test_hook_timer_record_cb, "B", NULL);
+    CHECK(hook_b);
+    hook_c = hook_timer (NULL, 1000000, 0, 1,
+                         &test_hook_timer_record_cb, "C", NULL);
+    CHECK(hook_c);
+    LONGS_EQUAL(count + 3, hooks_count[HOOK_TYPE_TIMER]);
+
+    /* no timer to run */
+    test_hook_timer_calls[0] = '\0';
+    hook_timer_exec ();
+    STRCMP_EQUAL("", test_hook_timer_calls);
+
+    /* timers run in order of next execution date */
+    test_hook_timer_set_next_exec (hook_a, -1);
+    test_hook_timer_set_next_exec (hook_b, -3);
+    test_hook_timer_set_next_exec (hook_c, -2);
+    hook_timer_heap_rebuild ();
+    LONGS_EQUAL(1, test_hook_timer_heap_valid ());
+    test_hook_timer_calls[0] = '\0';
+    hook_timer_exec ();
+    STRCMP_EQUAL("BCA", test_hook_timer_calls);
+
+    /* timer C (one call) has been removed */
+    LONGS_EQUAL(count + 2, hooks_count[HOOK_TYPE_TIMER]);
+
+    /* timers A and B are re-armed in heap, with a date in future */
+    gettimeofday (&tv_now, NULL);
+    CHECK(HOOK_TIMER(hook_a, heap_index) >= 0);
+    CHECK(HOOK_TIMER(hook_b, heap_index) >= 0);
+    CHECK(util_timeval_cmp (&HOOK_TIMER(hook_a, next_exec), &tv_now) > 0);
+    CHECK(util_timeval_cmp (&HOOK_TIMER(hook_b, next_exec), &tv_now) > 0);
+    LONGS_EQUAL(1, HOOK_TIMER(hook_b, remaining_calls));
+    LONGS_EQUAL(1, test_hook_timer_heap_valid ());
+
+    /* no timer to run */
+    test_hook_timer_calls[0] = '\0';
+    hook_timer_exec ();
+    STRCMP_EQUAL("", test_hook_timer_calls);
+
+    /* last call of timer B */
+    test_hook_timer_set_next_exec (hook_b, -1);
+    hook_timer_heap_rebuild ();
+    test_hook_timer_calls[0] = '\0';
+    hook_timer_exec ();
+    STRCMP_EQUAL("B", test_hook_timer_calls);
+    LONGS_EQUAL(0, test_hook_timer_last_remaining_calls);
+    LONGS_EQUAL(count + 1, hooks_count[HOOK_TYPE_TIMER]);
+    LONGS_EQUAL(1, test_hook_timer_heap_valid ());
+
+    unhook (hook_a);
+    LONGS_EQUAL(count, hooks_count[HOOK_TYPE_TIMER]);
+}
+
+/*
+ * Tests functions:
+ *   hook_timer
+ *   hook_timer_exec
+ *   hook_timer_remove_cb
+ *
+ * Heap with many timers: only timers to run are executed and the heap is
+ * kept sorted when timers are added, executed and removed.
+ */
+
+TEST(HookTimer, ManyTimers)
+{
+    struct t_hook **hooks;
+    int i;
+
+    hooks = (struct t_hook **)malloc (
+        TEST_HOOK_TIMER_MANY_COUNT * sizeof (*hooks));
+    CHECK(hooks);
+
+    /* add timers with intervals in a shuffled order */
+    for (i = 0; i < TEST_HOOK_TIMER_MANY_COUNT; i++)
+    {
+        hooks[i] = hook_timer (
+            NULL,
+            3600 * 1000 + ((i * 7919) % TEST_HOOK_TIMER_MANY_COUNT),
+            0, 0, &test_hook_timer_count_cb, NULL, NULL);
+        CHECK(hooks[i]);
+    }
+    LONGS_EQUAL(TEST_HOOK_TIMER_MANY_COUNT,
+                test_hook_timer_count_in_heap (hooks,
+                                               TEST_HOOK_TIMER_MANY_COUNT));
+    LONGS_EQUAL(1, test_hook_timer_heap_valid ());
+
+    /* no timer to run */
+    test_hook_timer_count_calls = 0;
+    hook_timer_exec ();
+    LONGS_EQUAL(0, test_hook_timer_count_calls);
+
+    /* one timer out of ten must run */
+    for (i = 0; i < TEST_HOOK_TIMER_MANY_COUNT; i += 10)
+    {
+        test_hook_timer_set_next_exec (hooks[i], -1);
+    }
+    hook_timer_heap_rebuild ();
+    LONGS_EQUAL(1, test_hook_timer_heap_valid ());
+    test_hook_timer_count_calls = 0;
+    hook_timer_exec ();
+    LONGS_EQUAL(TEST_HOOK_TIMER_MANY_COUNT / 10, test_hook_timer_count_calls);
+    LONGS_EQUAL(TEST_HOOK_TIMER_MANY_COUNT,
+                test_hook_timer_count_in_heap (hooks,
+                                               TEST_HOOK_TIMER_MANY_COUNT));
+    LONGS_EQUAL(1, test_hook_timer_heap_valid ());
+
+    /* timers executed are scheduled again: no timer to run */
+    test_hook_timer_count_calls = 0;
+    hook_timer_exec ();
+    LONGS_EQUAL(0, test_hook_timer_count_calls);
+
+    /* remove one timer out of two */
+    for (i = 0; i < TEST_HOOK_TIMER_MANY_COUNT; i += 2)
+    {
+        unhook (hooks[i]);
+        hooks[i] = NULL;
+    }
+    LONGS_EQUAL(TEST_HOOK_TIMER_MANY_COUNT / 2,
+                test_hook_timer_count_in_heap (hooks,
+                                               TEST_HOOK_TIMER_MANY_COUNT));
+    LONGS_EQUAL(1, test_hook_timer_heap_valid ());
+
+    for (i = 1; i < TEST_HOOK_TIMER_MANY_COUNT; i += 2)
+    {
+        unhook (hooks[i]);
+    }
+    LONGS_EQUAL(1, test_hook_timer_heap_valid ());
+
+    free (hooks);
 }
 
 /*
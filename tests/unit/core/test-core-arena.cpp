@@ -0,0 +1,164 @@
+/*
+ * test-core-arena.cpp - test arena functions
+ *
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdint.h>
+#include <string.h>
+#include "src/core/core-arena.h"
+}
+
+TEST_GROUP(CoreArena)
+{
+};
+
+/*
+ * Tests functions:
+ *   arena_new
+ *   arena_free
+ */
+
+TEST(CoreArena, New)
+{
+    struct t_arena *arena;
+
+    POINTERS_EQUAL(NULL, arena_new (0, 16));
+    POINTERS_EQUAL(NULL, arena_new (16, 0));
+    POINTERS_EQUAL(NULL, arena_new (16, -1));
+
+    arena = arena_new (1, 16);
+    CHECK(arena);
+    CHECK(arena->object_size >= sizeof (void *));
+    CHECK(arena->slot_size >= arena->object_size);
+    LONGS_EQUAL(16, arena->objects_per_chunk);
+    LONGS_EQUAL(0, arena->chunks_count);
+    LONGS_EQUAL(0, arena->objects_count);
+    LONGS_EQUAL(0, arena->closed);
+    POINTERS_EQUAL(NULL, arena->chunks);
+    POINTERS_EQUAL(NULL, arena->full_chunks);
+    LONGS_EQUAL(0, arena_size (arena));
+    arena_free (arena);
+
+    arena_free (NULL);
+}
+
+/*
+ * Tests functions:
+ *   arena_alloc
+ *   arena_release
+ *   arena_size
+ */
+
+TEST(CoreArena, AllocRelease)
+{
+    struct t_arena *arena;
+    void *objects[10], *ptr;
+    int i;
+
+    POINTERS_EQUAL(NULL, arena_alloc (NULL));
+    arena_release (NULL);
+    LONGS_EQUAL(0, arena_size (NULL));
+
+    arena = arena_new (24, 4);
+    CHECK(arena);
+
+    for (i = 0; i < 10; i++)
+    {
+        objects[i] = arena_alloc (arena);
+        CHECK(objects[i]);
+        LONGS_EQUAL(0, (uintptr_t)objects[i] % 16);
+        memset (objects[i], i, 24);
+    }
+    LONGS_EQUAL(10, arena->objects_count);
+    LONGS_EQUAL(3, arena->chunks_count);
+    CHECK(arena->chunks);
+    CHECK(arena->full_chunks);
+    CHECK(arena_size (arena) >= 3 * 4 * 24);
+
+    /* objects do not overlap */
+    for (i = 0; i < 10; i++)
+    {
+        LONGS_EQUAL(i, ((char *)objects[i])[0]);
+        LONGS_EQUAL(i, ((char *)objects[i])[23]);
+    }
+
+    /* release an object in a full chunk and allocate it again */
+    arena_release (objects[1]);
+    LONGS_EQUAL(9, arena->objects_count);
+    LONGS_EQUAL(3, arena->chunks_count);
+    ptr = arena_alloc (arena);
+    CHECK(ptr);
+    LONGS_EQUAL(10, arena->objects_count);
+    LONGS_EQUAL(3, arena->chunks_count);
+    objects[1] = ptr;
+
+    /* release all objects of first chunk: the chunk is freed */
+    for (i = 0; i < 4; i++)
+    {
+        arena_release (objects[i]);
+    }
+    LONGS_EQUAL(6, arena->objects_count);
+    LONGS_EQUAL(2, arena->chunks_count);
+
+    /* release all other objects */
+    for (i = 4; i < 10; i++)
+    {
+        arena_release (objects[i]);
+    }
+    LONGS_EQUAL(0, arena->objects_count);
+    LONGS_EQUAL(0, arena->chunks_count);
+    POINTERS_EQUAL(NULL, arena->chunks);
+    POINTERS_EQUAL(NULL, arena->full_chunks);
+    LONGS_EQUAL(0, arena_size (arena));
+
+    arena_free (arena);
+}
+
+/*
+ * Tests functions:
+ *   arena_free (with objects still used)
+ */
+
+TEST(CoreArena, FreeWithObjects)
+{
+    struct t_arena *arena;
+    void *object1, *object2;
+
+    arena = arena_new (32, 8);
+    CHECK(arena);
+
+    object1 = arena_alloc (arena);
+    CHECK(object1);
+    object2 = arena_alloc (arena);
+    CHECK(object2);
+
+    /* arena is closed but not freed: objects can still be released */
+    arena_free (arena);
+    LONGS_EQUAL(1, arena->closed);
+    POINTERS_EQUAL(NULL, arena_alloc (arena));
+    arena_release (object1);
+    LONGS_EQUAL(1, arena->objects_count);
+
+    /* release last object: arena is freed */
+    arena_release (object2);
+}
@@ -68,6 +68,120 @@ TEST(CoreEval, IsTrue)
     LONGS_EQUAL(1, eval_is_true ("abcdef"));
 }
 
+/*
+ * Tests functions:
+ *   eval_compile_condition
+ *   eval_node_free
+ */
+
+TEST(CoreEval, CompileCondition)
+{
+    struct t_eval_context context;
+    struct t_eval_node *node;
+
+    memset (&context, 0, sizeof (context));
+    context.prefix = EVAL_DEFAULT_PREFIX;
+    context.length_prefix = strlen (EVAL_DEFAULT_PREFIX);
+    context.suffix = EVAL_DEFAULT_SUFFIX;
+    context.length_suffix = strlen (EVAL_DEFAULT_SUFFIX);
+
+    POINTERS_EQUAL(NULL, eval_compile_condition (NULL, &context));
+    eval_node_free (NULL);
+
+    node = eval_compile_condition ("   ", &context);
+    CHECK(node);
+    LONGS_EQUAL(EVAL_NODE_VALUE, node->type);
+    STRCMP_EQUAL("", node->text);
+    LONGS_EQUAL(1, node->constant);
+    eval_node_free (node);
+
+    node = eval_compile_condition (" ${a} ", &context);
+    CHECK(node);
+    LONGS_EQUAL(EVAL_NODE_VALUE, node->type);
+    STRCMP_EQUAL("${a}", node->text);
+    LONGS_EQUAL(0, node->constant);
+    eval_node_free (node);
+
+    node = eval_compile_condition ("${a} == 1 && (${b} || abc =~ ^a)",
+                                   &context);
+    CHECK(node);
+    LONGS_EQUAL(EVAL_NODE_LOGICAL, node->type);
+    LONGS_EQUAL(EVAL_LOGICAL_OP_AND, node->op);
+    LONGS_EQUAL(EVAL_NODE_COMPARE, node->left->type);
+    LONGS_EQUAL(EVAL_COMPARE_EQUAL, node->left->op);
+    STRCMP_EQUAL("${a}", node->left->left->text);
+    STRCMP_EQUAL("1", node->left->right->text);
+    LONGS_EQUAL(1, node->left->right->constant);
+    LONGS_EQUAL(EVAL_NODE_PARENTHESES, node->right->type);
+    POINTERS_EQUAL(NULL, node->right->right);
+    LONGS_EQUAL(EVAL_NODE_LOGICAL, node->right->left->type);
+    LONGS_EQUAL(EVAL_LOGICAL_OP_OR, node->right->left->op);
+    STRCMP_EQUAL("${b}", node->right->left->left->text);
+    LONGS_EQUAL(EVAL_NODE_COMPARE, node->right->left->right->type);
+    LONGS_EQUAL(EVAL_COMPARE_REGEX_MATCHING, node->right->left->right->op);
+    STRCMP_EQUAL("abc", node->right->left->right->left->text);
+    STRCMP_EQUAL("^a", node->right->left->right->right->text);
+    eval_node_free (node);
+
+    /* value of sub-expression inserted in expression: not compiled */
+    node = eval_compile_condition ("(1) 2", &context);
+    CHECK(node);
+    LONGS_EQUAL(EVAL_NODE_UNCOMPILED, node->type);
+    STRCMP_EQUAL("(1) 2", node->text);
+    eval_node_free (node);
+}
+
+/*
+ * Tests functions:
+ *   eval_cache_conditions_get
+ *   eval_regex_get
+ */
+
+TEST(CoreEval, Cache)
+{
+    struct t_hashtable *options;
+    regex_t *regex;
+    char *value;
+    int count;
+
+    options = hashtable_new (32,
+                             WEECHAT_HASHTABLE_STRING,
+                             WEECHAT_HASHTABLE_STRING,
+                             NULL, NULL);
+    CHECK(options);
+    hashtable_set (options, "type", "condition");
+
+    /* condition is compiled once */
+    value = eval_expression ("abc =~ ^A && 1 == 1", NULL, NULL, options);
+    STRCMP_EQUAL("1", value);
+    free (value);
+    CHECK(eval_cache_conditions);
+    count = eval_cache_conditions->items_count;
+    CHECK(count > 0);
+    value = eval_expression ("abc =~ ^A && 1 == 1", NULL, NULL, options);
+    STRCMP_EQUAL("1", value);
+    free (value);
+    LONGS_EQUAL(count, eval_cache_conditions->items_count);
+
+    /* same condition with another prefix/suffix is another entry */
+    hashtable_set (options, "prefix", "%(");
+    hashtable_set (options, "suffix", ")");
+    value = eval_expression ("abc =~ ^A && 1 == 1", NULL, NULL, options);
+    STRCMP_EQUAL("1", value);
+    free (value);
+    CHECK(eval_cache_conditions->items_count > count);
+
+    hashtable_free (options);
+
+    /* regex */
+    POINTERS_EQUAL(NULL, eval_regex_get (NULL));
+    POINTERS_EQUAL(NULL, eval_regex_get ("*invalid"));
+    regex = eval_regex_get ("^test$");
+    CHECK(regex);
+    POINTERS_EQUAL(regex, eval_regex_get ("^test$"));
+    LONGS_EQUAL(0, regexec (regex, "TEST", 0, NULL, 0));
+}
+
 /*
  * Tests functions:
  *   eval_expression (condition)
@@ -0,0 +1,298 @@
+/*
+ * test-core-profile.cpp - test profiler functions
+ *
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include "tests/tests.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "src/core/weechat.h"
+#include "src/core/core-hashtable.h"
+#include "src/core/core-hook.h"
+#include "src/core/core-infolist.h"
+#include "src/core/core-profile.h"
+#include "src/core/core-string.h"
+#include "src/plugins/plugin.h"
+}
+
+int test_profile_signal_calls = 0;
+
+TEST_GROUP(CoreProfile)
+{
+};
+
+/*
+ * Callback for signal hook: sends another signal (nested callback).
+ */
+
+int
+test_profile_signal_cb (const void *pointer, void *data,
+                        const char *signal, const char *type_data,
+                        void *signal_data)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) type_data;
+    (void) signal_data;
+
+    test_profile_signal_calls++;
+
+    if (strcmp (signal, "test_profile1") == 0)
+    {
+        (void) hook_signal_send ("test_profile_nested",
+                                 WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Tests functions:
+ *   profile_start
+ *   profile_stop
+ *   profile_reset
+ *   profile_get_duration
+ *   profile_end
+ */
+
+TEST(CoreProfile, StartStop)
+{
+    int id;
+
+    LONGS_EQUAL(0, profile_enabled);
+    LONGS_EQUAL(0, profile_stop ());
+
+    LONGS_EQUAL(1, profile_start (0));
+    LONGS_EQUAL(1, profile_enabled);
+    LONGS_EQUAL(0, profile_memory);
+    LONGS_EQUAL(0, profile_start (1));
+    LONGS_EQUAL(0, profile_memory);
+    CHECK(profile_get_duration () >= 0);
+
+    LONGS_EQUAL(1, profile_stop ());
+    LONGS_EQUAL(0, profile_enabled);
+    LONGS_EQUAL(0, profile_stop ());
+
+    /* call not profiled when profiler is stopped */
+    LONGS_EQUAL(0, profile_frame_start_phase (PROFILE_PHASE_TIMERS));
+    LONGS_EQUAL(0, profile_frame_start_hook (NULL));
+
+    /* restart: data is removed */
+    LONGS_EQUAL(1, profile_start (1));
+    LONGS_EQUAL(1, profile_memory);
+    id = profile_frame_start_phase (PROFILE_PHASE_FD);
+    LONGS_EQUAL(profile_id, id);
+    LONGS_EQUAL(1, profile_stack_depth);
+    LONGS_EQUAL(1, profile_stats->items_count);
+
+    /* call in progress during a reset is ignored */
+    profile_reset ();
+    LONGS_EQUAL(0, profile_stack_depth);
+    POINTERS_EQUAL(NULL, profile_stats);
+    profile_frame_end (id);
+    POINTERS_EQUAL(NULL, profile_stats);
+
+    profile_end ();
+    LONGS_EQUAL(0, profile_enabled);
+    LONGS_EQUAL(0, profile_memory);
+    POINTERS_EQUAL(NULL, profile_stats);
+    POINTERS_EQUAL(NULL, profile_root);
+    LONGS_EQUAL(0, profile_get_duration ());
+}
+
+/*
+ * Tests functions:
+ *   profile_frame_start_hook
+ *   profile_frame_start_phase
+ *   profile_frame_end
+ */
+
+TEST(CoreProfile, Frames)
+{
+    struct t_hook *hook1, *hook2;
+    struct t_profile_stat *ptr_stat;
+    struct t_profile_node *ptr_node;
+    int id;
+
+    hook1 = hook_signal (NULL, "test_profile1;test_profile2",
+                         &test_profile_signal_cb, NULL, NULL);
+    CHECK(hook1);
+    hook2 = hook_signal (NULL, "test_profile_nested",
+                         &test_profile_signal_cb, NULL, NULL);
+    CHECK(hook2);
+
+    test_profile_signal_calls = 0;
+
+    LONGS_EQUAL(1, profile_start (0));
+
+    id = profile_frame_start_phase (PROFILE_PHASE_TIMERS);
+    CHECK(id > 0);
+    (void) hook_signal_send ("test_profile1", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    (void) hook_signal_send ("test_profile2", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    profile_frame_end (id);
+    LONGS_EQUAL(0, profile_stack_depth);
+
+    LONGS_EQUAL(3, test_profile_signal_calls);
+
+    /* statistics by hook */
+    ptr_stat = (struct t_profile_stat *)hashtable_get (
+        profile_stats, "core:main_loop:timers");
+    CHECK(ptr_stat);
+    STRCMP_EQUAL("main_loop", ptr_stat->type);
+    STRCMP_EQUAL("core", ptr_stat->plugin);
+    POINTERS_EQUAL(NULL, ptr_stat->subplugin);
+    STRCMP_EQUAL("timers", ptr_stat->description);
+    LONGS_EQUAL(1, ptr_stat->count);
+    CHECK(ptr_stat->time_total >= ptr_stat->time_max);
+
+    /* ";" in description is replaced by "," in frame name */
+    ptr_stat = (struct t_profile_stat *)hashtable_get (
+        profile_stats, "core:signal:test_profile1,test_profile2");
+    CHECK(ptr_stat);
+    STRCMP_EQUAL("signal", ptr_stat->type);
+    STRCMP_EQUAL("core", ptr_stat->plugin);
+    POINTERS_EQUAL(NULL, ptr_stat->subplugin);
+    STRCMP_EQUAL("test_profile1;test_profile2", ptr_stat->description);
+    LONGS_EQUAL(2, ptr_stat->count);
+
+    ptr_stat = (struct t_profile_stat *)hashtable_get (
+        profile_stats, "core:signal:test_profile_nested");
+    CHECK(ptr_stat);
+    LONGS_EQUAL(1, ptr_stat->count);
+
+    /* tree of calls */
+    ptr_node = (struct t_profile_node *)hashtable_get (
+        profile_root->children, "core:main_loop:timers");
+    CHECK(ptr_node);
+    LONGS_EQUAL(1, ptr_node->count);
+    ptr_node = (struct t_profile_node *)hashtable_get (
+        ptr_node->children, "core:signal:test_profile1,test_profile2");
+    CHECK(ptr_node);
+    LONGS_EQUAL(2, ptr_node->count);
+    ptr_node = (struct t_profile_node *)hashtable_get (
+        ptr_node->children, "core:signal:test_profile_nested");
+    CHECK(ptr_node);
+    LONGS_EQUAL(1, ptr_node->count);
+    POINTERS_EQUAL(NULL, ptr_node->children);
+
+    /* call ended after stop of profiler is still recorded */
+    id = profile_frame_start_phase (PROFILE_PHASE_SIGNALS);
+    CHECK(id > 0);
+    LONGS_EQUAL(1, profile_stop ());
+    profile_frame_end (id);
+    ptr_stat = (struct t_profile_stat *)hashtable_get (
+        profile_stats, "core:main_loop:signals");
+    CHECK(ptr_stat);
+    LONGS_EQUAL(1, ptr_stat->count);
+
+    /* no call recorded when profiler is stopped */
+    (void) hook_signal_send ("test_profile2", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    ptr_stat = (struct t_profile_stat *)hashtable_get (
+        profile_stats, "core:signal:test_profile1,test_profile2");
+    LONGS_EQUAL(2, ptr_stat->count);
+
+    profile_end ();
+
+    unhook (hook1);
+    unhook (hook2);
+}
+
+/*
+ * Tests functions:
+ *   profile_display
+ *   profile_write_folded
+ *   profile_add_to_infolist
+ */
+
+TEST(CoreProfile, Output)
+{
+    struct t_infolist *infolist;
+    char filename[128], line[1024], *path;
+    FILE *file;
+    int id1, id2, lines, found;
+
+    profile_display ();
+
+    LONGS_EQUAL(1, profile_start (0));
+
+    id1 = profile_frame_start_phase (PROFILE_PHASE_FD);
+    id2 = profile_frame_start_phase (PROFILE_PHASE_WAIT);
+    usleep (1000);
+    profile_frame_end (id2);
+    usleep (1000);
+    profile_frame_end (id1);
+
+    /* stop profiler, so that display is not profiled */
+    LONGS_EQUAL(1, profile_stop ());
+
+    profile_display ();
+
+    /* folded stacks */
+    snprintf (filename, sizeof (filename),
+              "/tmp/weechat-test-profile-%d.folded", (int)getpid ());
+    path = profile_write_folded (filename);
+    STRCMP_EQUAL(filename, path);
+    free (path);
+    file = fopen (filename, "r");
+    CHECK(file);
+    lines = 0;
+    found = 0;
+    while (fgets (line, sizeof (line), file))
+    {
+        lines++;
+        if (strncmp (line, "core:main_loop:fd;core:main_loop:wait ", 38) == 0)
+            found = 1;
+        else
+            STRNCMP_EQUAL("core:main_loop:fd ", line, 18);
+    }
+    fclose (file);
+    unlink (filename);
+    LONGS_EQUAL(2, lines);
+    LONGS_EQUAL(1, found);
+
+    POINTERS_EQUAL(NULL, profile_write_folded ("/nonexistent/dir/file"));
+
+    /* infolist: sorted by total time */
+    LONGS_EQUAL(0, profile_add_to_infolist (NULL));
+    infolist = infolist_new (NULL);
+    CHECK(infolist);
+    LONGS_EQUAL(1, profile_add_to_infolist (infolist));
+    CHECK(infolist_next (infolist));
+    STRCMP_EQUAL("main_loop", infolist_string (infolist, "type"));
+    STRCMP_EQUAL("core", infolist_string (infolist, "plugin"));
+    POINTERS_EQUAL(NULL, infolist_string (infolist, "subplugin"));
+    STRCMP_EQUAL("fd", infolist_string (infolist, "description"));
+    STRCMP_EQUAL("1", infolist_string (infolist, "count"));
+    CHECK(atoll (infolist_string (infolist, "time_total")) >= 2000);
+    CHECK(infolist_next (infolist));
+    STRCMP_EQUAL("wait", infolist_string (infolist, "description"));
+    CHECK(atoll (infolist_string (infolist, "time_total")) >= 1000);
+    POINTERS_EQUAL(NULL, infolist_next (infolist));
+    infolist_free (infolist);
+
+    profile_end ();
+}
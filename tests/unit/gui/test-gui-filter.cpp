@@ -188,6 +188,11 @@ TEST(GuiFilter, New)
     STRCMP_EQUAL("tag_abc", filter_abc->tags_array[0][0]);
     POINTERS_EQUAL(NULL, filter_abc->tags_array[0][1]);
     POINTERS_EQUAL(NULL, filter_abc->tags_array[1]);
+    CHECK(filter_abc->tags_cond);
+    LONGS_EQUAL(1, filter_abc->tags_cond->count);
+    LONGS_EQUAL(1, filter_abc->tags_cond->tags_count[0]);
+    LONGS_EQUAL(gui_line_tag_id_search ("tag_abc"),
+                filter_abc->tags_cond->tags[0][0].id);
     STRCMP_EQUAL("!regex_abc", filter_abc->regex);
     POINTERS_EQUAL(NULL, filter_abc->regex_prefix);
     CHECK(filter_abc->regex_message);
@@ -28,7 +28,9 @@ extern "C"
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
+#include "src/core/core-arena.h"
 #include "src/core/core-config.h"
+#include "src/core/core-hashtable.h"
 #include "src/core/core-string.h"
 #include "src/gui/gui-buffer.h"
 #include "src/gui/gui-chat.h"
@@ -36,6 +38,7 @@ extern "C"
 #include "src/gui/gui-filter.h"
 #include "src/gui/gui-hotlist.h"
 #include "src/gui/gui-line.h"
+#include "src/gui/gui-nicklist.h"
 }
 
 #define WEE_BUILD_STR_PREFIX_MSG(__result, __prefix, __message)         \
@@ -46,7 +49,7 @@ extern "C"
     STRCMP_EQUAL(__result, str);                                        \
     free (str);                                                         \
     gui_line_free_data (line);                                          \
-    free (line);
+    gui_line_release (line);
 
 #define WEE_BUILD_STR_MSG_TAGS(__tags, __message, __colors)             \
     line = gui_line_new (gui_buffers, -1, 0, 0, 0, 0, __tags,           \
@@ -58,13 +61,18 @@ extern "C"
     STRCMP_EQUAL(str_result, str);                                      \
     free (str);                                                         \
     gui_line_free_data (line);                                          \
-    free (line);
+    gui_line_release (line);
 
 #define WEE_LINE_MATCH_TAGS(__result, __line_tags, __tags)              \
     gui_line_tags_alloc (&line_data, __line_tags);                      \
     tags_array = string_split_tags (__tags, &tags_count);               \
     LONGS_EQUAL(__result, gui_line_match_tags (&line_data, tags_count,  \
                                                tags_array));            \
+    tags_cond = gui_line_tags_cond_new (tags_count, tags_array);        \
+    CHECK(tags_cond);                                                   \
+    LONGS_EQUAL(__result, gui_line_match_tags_cond (&line_data,         \
+                                                    tags_cond));        \
+    gui_line_tags_cond_free (tags_cond);                                \
     gui_line_tags_free (&line_data);                                    \
     string_free_split_tags (tags_array);
 
@@ -100,6 +108,65 @@ TEST(GuiLine, LinesAlloc)
     gui_line_lines_free (NULL);
 }
 
+/*
+ * Tests functions:
+ *   gui_line_lines_memory
+ */
+
+TEST(GuiLine, LinesMemory)
+{
+    struct t_gui_buffer *buffer;
+    size_t size_structs, size_strings;
+    int i;
+
+    gui_line_lines_memory (NULL, &size_structs, &size_strings);
+    LONGS_EQUAL(0, size_structs);
+    LONGS_EQUAL(0, size_strings);
+
+    buffer = gui_buffer_new_user ("test", GUI_BUFFER_TYPE_FORMATTED);
+    CHECK(buffer);
+    POINTERS_EQUAL(NULL, buffer->lines_arena);
+    POINTERS_EQUAL(NULL, buffer->lines_data_arena);
+
+    gui_line_lines_memory (buffer, &size_structs, &size_strings);
+    LONGS_EQUAL(sizeof (struct t_gui_lines), size_structs);
+    LONGS_EQUAL(0, size_strings);
+
+    /* lines and data of lines are allocated by chunks in arenas of buffer */
+    for (i = 0; i < GUI_LINE_DATA_ARENA_CHUNK + 1; i++)
+    {
+        gui_chat_printf_date_tags (buffer, 0, "tag1,tag2", "test");
+    }
+    CHECK(buffer->lines_arena);
+    LONGS_EQUAL(GUI_LINE_DATA_ARENA_CHUNK + 1,
+                buffer->lines_arena->objects_count);
+    CHECK(buffer->lines_data_arena);
+    LONGS_EQUAL(GUI_LINE_DATA_ARENA_CHUNK + 1,
+                buffer->lines_data_arena->objects_count);
+    LONGS_EQUAL(2, buffer->lines_data_arena->chunks_count);
+
+    gui_line_lines_memory (buffer, &size_structs, &size_strings);
+    CHECK(size_structs >= (GUI_LINE_DATA_ARENA_CHUNK + 1)
+          * (sizeof (struct t_gui_line) + sizeof (struct t_gui_line_data)));
+    CHECK(size_strings >= (GUI_LINE_DATA_ARENA_CHUNK + 1)
+          * (strlen ("test") + 1 + (3 * sizeof (char *))));
+
+    /* chunks are freed when lines are removed */
+    gui_line_free (buffer, buffer->own_lines->last_line);
+    LONGS_EQUAL(GUI_LINE_DATA_ARENA_CHUNK,
+                buffer->lines_arena->objects_count);
+    LONGS_EQUAL(GUI_LINE_DATA_ARENA_CHUNK,
+                buffer->lines_data_arena->objects_count);
+    LONGS_EQUAL(1, buffer->lines_data_arena->chunks_count);
+    gui_buffer_clear (buffer);
+    LONGS_EQUAL(0, buffer->lines_arena->objects_count);
+    LONGS_EQUAL(0, buffer->lines_arena->chunks_count);
+    LONGS_EQUAL(0, buffer->lines_data_arena->objects_count);
+    LONGS_EQUAL(0, buffer->lines_data_arena->chunks_count);
+
+    gui_buffer_close (buffer);
+}
+
 /*
  * Tests functions:
  *   gui_line_tags_alloc
@@ -157,6 +224,82 @@ TEST(GuiLine, TagsAlloc)
     gui_line_tags_free (&line_data);
 
     gui_line_tags_free (NULL);
+
+    /* ids of tags (case insensitive) */
+    line_data.tags_array = NULL;
+    line_data.tags_count = 0;
+    gui_line_tags_alloc (&line_data, "tag_id1,TAG_ID1,tag_id2");
+    CHECK(line_data.tags_array);
+    LONGS_EQUAL(3, line_data.tags_count);
+    STRCMP_EQUAL("TAG_ID1", line_data.tags_array[1]);
+    CHECK(GUI_LINE_TAGS_IDS(&line_data)[0] >= 0);
+    LONGS_EQUAL(GUI_LINE_TAGS_IDS(&line_data)[0],
+                GUI_LINE_TAGS_IDS(&line_data)[1]);
+    CHECK(GUI_LINE_TAGS_IDS(&line_data)[2] >= 0);
+    CHECK(GUI_LINE_TAGS_IDS(&line_data)[0]
+          != GUI_LINE_TAGS_IDS(&line_data)[2]);
+    LONGS_EQUAL(GUI_LINE_TAGS_IDS(&line_data)[0],
+                gui_line_tag_id_search ("Tag_Id1"));
+    LONGS_EQUAL(GUI_LINE_TAGS_IDS(&line_data)[2],
+                gui_line_tag_id_search ("tag_id2"));
+    gui_line_tags_free (&line_data);
+    LONGS_EQUAL(-1, gui_line_tag_id_search ("tag_id1"));
+    LONGS_EQUAL(-1, gui_line_tag_id_search ("tag_id2"));
+}
+
+/*
+ * Tests functions:
+ *   gui_line_tag_id_ref
+ *   gui_line_tag_id_unref
+ *   gui_line_tag_id_search
+ */
+
+TEST(GuiLine, TagId)
+{
+    int id1, id2, id3, count;
+
+    LONGS_EQUAL(-1, gui_line_tag_id_ref (NULL));
+    LONGS_EQUAL(-1, gui_line_tag_id_search (NULL));
+    LONGS_EQUAL(-1, gui_line_tag_id_search ("test_tag_id"));
+    gui_line_tag_id_unref (-1);
+    gui_line_tag_id_unref (123456789);
+
+    count = gui_line_tags_ids_count;
+
+    id1 = gui_line_tag_id_ref ("test_tag_id");
+    CHECK(id1 >= 0);
+    LONGS_EQUAL(count + 1, gui_line_tags_ids_count);
+    LONGS_EQUAL(id1, gui_line_tag_id_search ("test_tag_id"));
+    LONGS_EQUAL(id1, gui_line_tag_id_search ("TEST_TAG_ID"));
+    STRCMP_EQUAL("test_tag_id", gui_line_tags_ids_array[id1].tag);
+    LONGS_EQUAL(1, gui_line_tags_ids_array[id1].refcount);
+
+    /* same tag (case insensitive) */
+    id2 = gui_line_tag_id_ref ("Test_Tag_Id");
+    LONGS_EQUAL(id1, id2);
+    LONGS_EQUAL(count + 1, gui_line_tags_ids_count);
+    LONGS_EQUAL(2, gui_line_tags_ids_array[id1].refcount);
+
+    /* other tag */
+    id3 = gui_line_tag_id_ref ("test_tag_id2");
+    CHECK(id3 >= 0);
+    CHECK(id3 != id1);
+    LONGS_EQUAL(count + 2, gui_line_tags_ids_count);
+
+    gui_line_tag_id_unref (id2);
+    LONGS_EQUAL(id1, gui_line_tag_id_search ("test_tag_id"));
+    gui_line_tag_id_unref (id1);
+    LONGS_EQUAL(-1, gui_line_tag_id_search ("test_tag_id"));
+    LONGS_EQUAL(count + 1, gui_line_tags_ids_count);
+
+    /* unused id is used again for a new tag */
+    id2 = gui_line_tag_id_ref ("test_tag_id3");
+    LONGS_EQUAL(id1, id2);
+    LONGS_EQUAL(count + 2, gui_line_tags_ids_count);
+
+    gui_line_tag_id_unref (id2);
+    gui_line_tag_id_unref (id3);
+    LONGS_EQUAL(count, gui_line_tags_ids_count);
 }
 
 /*
@@ -257,7 +400,7 @@ TEST(GuiLine, BuildStringMessageTags)
                                                        NULL,
                                                        1));
     gui_line_free_data (line);
-    free (line);
+    gui_line_release (line);
 
     snprintf (str_result, sizeof (str_result),
               "message%s [%s%s]",
@@ -389,6 +532,10 @@ TEST(GuiLine, GetNextDisplayed)
 
 TEST(GuiLine, SearchById)
 {
+    struct t_gui_buffer *buffer;
+    struct t_gui_line *ptr_line, *ptr_line2;
+    int i, first_id;
+
     POINTERS_EQUAL(NULL, gui_line_search_by_id (NULL, -1));
     POINTERS_EQUAL(NULL, gui_line_search_by_id (gui_buffers, -1));
 
@@ -396,6 +543,71 @@ TEST(GuiLine, SearchById)
         gui_buffers->own_lines->last_line,
         gui_line_search_by_id (gui_buffers,
                                gui_buffers->own_lines->last_line->data->id));
+
+    /* buffer with formatted content */
+    buffer = gui_buffer_new_user ("test", GUI_BUFFER_TYPE_FORMATTED);
+    CHECK(buffer);
+    POINTERS_EQUAL(NULL, gui_line_search_by_id (buffer, 0));
+    for (i = 0; i < 100; i++)
+    {
+        gui_chat_printf (buffer, "line %d", i);
+    }
+    first_id = buffer->own_lines->first_line->data->id;
+    for (ptr_line = buffer->own_lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        POINTERS_EQUAL(ptr_line,
+                       gui_line_search_by_id (buffer, ptr_line->data->id));
+    }
+    POINTERS_EQUAL(NULL, gui_line_search_by_id (buffer, first_id + 100));
+
+    /* remove first and last lines */
+    gui_line_free (buffer, buffer->own_lines->first_line);
+    gui_line_free (buffer, buffer->own_lines->last_line);
+    POINTERS_EQUAL(NULL, gui_line_search_by_id (buffer, first_id));
+    POINTERS_EQUAL(NULL, gui_line_search_by_id (buffer, first_id + 99));
+    POINTERS_EQUAL(buffer->own_lines->first_line,
+                   gui_line_search_by_id (buffer, first_id + 1));
+    POINTERS_EQUAL(buffer->own_lines->last_line,
+                   gui_line_search_by_id (buffer, first_id + 98));
+
+    /* clear buffer */
+    gui_buffer_clear (buffer);
+    POINTERS_EQUAL(NULL, gui_line_search_by_id (buffer, first_id + 1));
+    gui_chat_printf (buffer, "new line");
+    POINTERS_EQUAL(buffer->own_lines->last_line,
+                   gui_line_search_by_id (buffer, first_id + 100));
+
+    gui_buffer_close (buffer);
+
+    /* buffer with free content */
+    buffer = gui_buffer_new_user ("test", GUI_BUFFER_TYPE_FREE);
+    CHECK(buffer);
+    gui_chat_printf_y (buffer, 5, "line 5");
+    LONGS_EQUAL(6, buffer->own_lines->lines_count);
+    gui_chat_printf_y (buffer, 8, "line 8");
+    LONGS_EQUAL(9, buffer->own_lines->lines_count);
+    gui_chat_printf_y (buffer, 2, "line 2");
+    LONGS_EQUAL(9, buffer->own_lines->lines_count);
+    for (i = 0, ptr_line = buffer->own_lines->first_line; ptr_line;
+         i++, ptr_line = ptr_line->next_line)
+    {
+        LONGS_EQUAL(i, ptr_line->data->y);
+        POINTERS_EQUAL(ptr_line, gui_line_search_by_id (buffer, i));
+    }
+    STRCMP_EQUAL("line 2", gui_line_search_by_id (buffer, 2)->data->message);
+    gui_chat_printf_y (buffer, 2, "line 2 (updated)");
+    LONGS_EQUAL(9, buffer->own_lines->lines_count);
+    STRCMP_EQUAL("line 2 (updated)",
+                 gui_line_search_by_id (buffer, 2)->data->message);
+    POINTERS_EQUAL(buffer->own_lines->last_line,
+                   gui_line_search_by_id (buffer, 8));
+    POINTERS_EQUAL(NULL, gui_line_search_by_id (buffer, 9));
+    ptr_line2 = gui_line_search_by_id (buffer, 5);
+    CHECK(ptr_line2);
+    STRCMP_EQUAL("line 5", ptr_line2->data->message);
+
+    gui_buffer_close (buffer);
 }
 
 /*
@@ -448,14 +660,23 @@ TEST(GuiLine, HasTagNoFilter)
 /*
  * Tests functions:
  *   gui_line_match_tags
+ *   gui_line_tags_cond_new
+ *   gui_line_tags_cond_free
+ *   gui_line_match_tags_cond
  */
 
 TEST(GuiLine, MatchTags)
 {
     struct t_gui_line_data line_data;
+    struct t_gui_line_tags_cond *tags_cond;
     char ***tags_array;
     int tags_count;
 
+    POINTERS_EQUAL(NULL, gui_line_tags_cond_new (-1, NULL));
+    POINTERS_EQUAL(NULL, gui_line_tags_cond_new (1, NULL));
+    gui_line_tags_cond_free (NULL);
+    LONGS_EQUAL(0, gui_line_match_tags_cond (NULL, NULL));
+
     /* line without tags */
     WEE_LINE_MATCH_TAGS(0, NULL, NULL);
     WEE_LINE_MATCH_TAGS(0, NULL, "irc_join");
@@ -1084,6 +1305,113 @@ TEST(GuiLine, HookUpdate)
     /* TODO: write tests */
 }
 
+/*
+ * Tests functions:
+ *   gui_line_batch_start
+ *   gui_line_batch_end
+ */
+
+TEST(GuiLine, Batch)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_line *ptr_line;
+
+    gui_line_batch_start (NULL, 0);
+    gui_line_batch_end (NULL);
+
+    buffer = gui_buffer_new_user ("test", GUI_BUFFER_TYPE_FORMATTED);
+    CHECK(buffer);
+    POINTERS_EQUAL(NULL, buffer->lines_batch);
+
+    /* end of batch without start: ignored */
+    gui_buffer_set (buffer, "print_batch", "0");
+    POINTERS_EQUAL(NULL, buffer->lines_batch);
+
+    /* nested batches */
+    gui_buffer_set (buffer, "print_batch", "1");
+    CHECK(buffer->lines_batch);
+    LONGS_EQUAL(1, buffer->lines_batch->count);
+    LONGS_EQUAL(0, buffer->lines_batch->sorted);
+    gui_buffer_set (buffer, "print_batch", "1");
+    LONGS_EQUAL(2, buffer->lines_batch->count);
+    LONGS_EQUAL(0, buffer->lines_batch->nicklist_changed);
+
+    /* nicklist changed: bar items updated at the end of batch */
+    CHECK(gui_nicklist_add_nick (buffer, NULL, "nick1", NULL, NULL, NULL, 1));
+    LONGS_EQUAL(1, buffer->lines_batch->nicklist_changed);
+    LONGS_EQUAL(0, gui_nicklist_batch_signal);
+
+    gui_chat_printf_date_tags (buffer, 0, "notify_message", "msg1");
+    gui_chat_printf_date_tags (buffer, 0, "notify_message", "msg2");
+    gui_chat_printf_date_tags (buffer, 0, "notify_private", "msg3");
+    gui_chat_printf_date_tags (buffer, 0, "notify_none", "msg4");
+    gui_chat_printf_date_tags (buffer, 0, "notify_message", "msg5");
+    LONGS_EQUAL(5, buffer->own_lines->lines_count);
+    LONGS_EQUAL(5, buffer->lines_batch->lines_added);
+    LONGS_EQUAL(0, buffer->lines_batch->hotlist[GUI_HOTLIST_LOW]);
+    LONGS_EQUAL(3, buffer->lines_batch->hotlist[GUI_HOTLIST_MESSAGE]);
+    LONGS_EQUAL(1, buffer->lines_batch->hotlist[GUI_HOTLIST_PRIVATE]);
+    LONGS_EQUAL(0, buffer->lines_batch->hotlist[GUI_HOTLIST_HIGHLIGHT]);
+    POINTERS_EQUAL(NULL, buffer->hotlist);
+
+    /* end of nested batch: hotlist not yet updated */
+    gui_buffer_set (buffer, "print_batch", "0");
+    CHECK(buffer->lines_batch);
+    LONGS_EQUAL(1, buffer->lines_batch->count);
+    POINTERS_EQUAL(NULL, buffer->hotlist);
+
+    /* end of batch: hotlist updated */
+    buffer->own_lines->prefix_max_length_refresh = 0;
+    gui_buffer_set (buffer, "print_batch", "0");
+    POINTERS_EQUAL(NULL, buffer->lines_batch);
+    LONGS_EQUAL(1, buffer->own_lines->prefix_max_length_refresh);
+    CHECK(buffer->hotlist);
+    LONGS_EQUAL(GUI_HOTLIST_PRIVATE, buffer->hotlist->priority);
+    LONGS_EQUAL(0, buffer->hotlist->count[GUI_HOTLIST_LOW]);
+    LONGS_EQUAL(3, buffer->hotlist->count[GUI_HOTLIST_MESSAGE]);
+    LONGS_EQUAL(1, buffer->hotlist->count[GUI_HOTLIST_PRIVATE]);
+    LONGS_EQUAL(0, buffer->hotlist->count[GUI_HOTLIST_HIGHLIGHT]);
+
+    /* lines are added at the end of buffer, in order */
+    STRCMP_EQUAL("msg1", buffer->own_lines->first_line->data->message);
+    STRCMP_EQUAL("msg5", buffer->own_lines->last_line->data->message);
+
+    gui_buffer_close (buffer);
+
+    /* sorted batch: lines are inserted in order of date */
+    buffer = gui_buffer_new_user ("test", GUI_BUFFER_TYPE_FORMATTED);
+    CHECK(buffer);
+    gui_chat_printf_date_tags (buffer, 5000, NULL, "msg5000");
+    gui_buffer_set (buffer, "print_batch", "sorted");
+    CHECK(buffer->lines_batch);
+    LONGS_EQUAL(1, buffer->lines_batch->sorted);
+    gui_chat_printf_date_tags (buffer, 2000, NULL, "msg2000");
+    gui_chat_printf_date_tags (buffer, 1000, NULL, "msg1000");
+    gui_chat_printf_date_tags (buffer, 3000, NULL, "msg3000");
+    gui_chat_printf_date_tags (buffer, 2000, NULL, "msg2000b");
+    gui_chat_printf_date_tags (buffer, 6000, NULL, "msg6000");
+    gui_buffer_set (buffer, "print_batch", "0");
+    POINTERS_EQUAL(NULL, buffer->lines_batch);
+    LONGS_EQUAL(6, buffer->own_lines->lines_count);
+    ptr_line = buffer->own_lines->first_line;
+    POINTERS_EQUAL(NULL, ptr_line->prev_line);
+    STRCMP_EQUAL("msg1000", ptr_line->data->message);
+    ptr_line = ptr_line->next_line;
+    STRCMP_EQUAL("msg2000", ptr_line->data->message);
+    ptr_line = ptr_line->next_line;
+    STRCMP_EQUAL("msg2000b", ptr_line->data->message);
+    ptr_line = ptr_line->next_line;
+    STRCMP_EQUAL("msg3000", ptr_line->data->message);
+    ptr_line = ptr_line->next_line;
+    STRCMP_EQUAL("msg5000", ptr_line->data->message);
+    ptr_line = ptr_line->next_line;
+    STRCMP_EQUAL("msg6000", ptr_line->data->message);
+    POINTERS_EQUAL(NULL, ptr_line->next_line);
+    POINTERS_EQUAL(ptr_line, buffer->own_lines->last_line);
+    STRCMP_EQUAL("msg3000", ptr_line->prev_line->prev_line->data->message);
+    gui_buffer_close (buffer);
+}
+
 /*
  * Tests functions:
  *   gui_line_add
@@ -1091,7 +1419,54 @@ TEST(GuiLine, HookUpdate)
 
 TEST(GuiLine, Add)
 {
-    /* TODO: write tests */
+    struct t_gui_buffer *buffer;
+    struct t_gui_line *ptr_line;
+
+    config_file_option_set (config_history_max_buffer_lines_number, "3", 1);
+
+    /* lines added at the end: oldest lines are removed */
+    buffer = gui_buffer_new_user ("test", GUI_BUFFER_TYPE_FORMATTED);
+    CHECK(buffer);
+    gui_chat_printf_date_tags (buffer, 1000, NULL, "msg1000");
+    gui_chat_printf_date_tags (buffer, 2000, NULL, "msg2000");
+    gui_chat_printf_date_tags (buffer, 3000, NULL, "msg3000");
+    gui_chat_printf_date_tags (buffer, 4000, NULL, "msg4000");
+    LONGS_EQUAL(3, buffer->own_lines->lines_count);
+    STRCMP_EQUAL("msg2000", buffer->own_lines->first_line->data->message);
+    STRCMP_EQUAL("msg4000", buffer->own_lines->last_line->data->message);
+    gui_buffer_close (buffer);
+
+    /* sorted batch on a full buffer, with lines out of order */
+    buffer = gui_buffer_new_user ("test", GUI_BUFFER_TYPE_FORMATTED);
+    CHECK(buffer);
+    gui_chat_printf_date_tags (buffer, 2000, NULL, "msg2000");
+    gui_chat_printf_date_tags (buffer, 4000, NULL, "msg4000");
+    gui_chat_printf_date_tags (buffer, 6000, NULL, "msg6000");
+    gui_buffer_set (buffer, "print_batch", "sorted");
+    /* older than all lines: not added */
+    gui_chat_printf_date_tags (buffer, 1000, NULL, "msg1000");
+    LONGS_EQUAL(3, buffer->own_lines->lines_count);
+    LONGS_EQUAL(0, buffer->lines_batch->lines_added);
+    STRCMP_EQUAL("msg2000", buffer->own_lines->first_line->data->message);
+    /* inserted in the middle: oldest line is removed */
+    gui_chat_printf_date_tags (buffer, 5000, NULL, "msg5000");
+    LONGS_EQUAL(3, buffer->own_lines->lines_count);
+    LONGS_EQUAL(1, buffer->lines_batch->lines_added);
+    /* inserted before the first line: not added */
+    gui_chat_printf_date_tags (buffer, 3000, NULL, "msg3000");
+    LONGS_EQUAL(3, buffer->own_lines->lines_count);
+    LONGS_EQUAL(1, buffer->lines_batch->lines_added);
+    gui_buffer_set (buffer, "print_batch", "0");
+    ptr_line = buffer->own_lines->first_line;
+    STRCMP_EQUAL("msg4000", ptr_line->data->message);
+    ptr_line = ptr_line->next_line;
+    STRCMP_EQUAL("msg5000", ptr_line->data->message);
+    ptr_line = ptr_line->next_line;
+    STRCMP_EQUAL("msg6000", ptr_line->data->message);
+    POINTERS_EQUAL(NULL, ptr_line->next_line);
+    gui_buffer_close (buffer);
+
+    config_file_option_reset (config_history_max_buffer_lines_number, 1);
 }
 
 /*
@@ -1101,7 +1476,46 @@ TEST(GuiLine, Add)
 
 TEST(GuiLine, AddY)
 {
-    /* TODO: write tests */
+    struct t_gui_buffer *buffer;
+    struct t_gui_line *ptr_line;
+    int y;
+
+    buffer = gui_buffer_new_user ("test", GUI_BUFFER_TYPE_FREE);
+    CHECK(buffer);
+
+    gui_chat_printf_y (buffer, 0, "line 0");
+    gui_chat_printf_y (buffer, 2, "line 2");
+    gui_chat_printf_y (buffer, 1, "line 1");
+    LONGS_EQUAL(3, buffer->own_lines->lines_count);
+
+    /* replace lines */
+    gui_chat_printf_y (buffer, 2, "line 2 (new)");
+    gui_chat_printf_y (buffer, 1, "line 1 (new)");
+    LONGS_EQUAL(3, buffer->own_lines->lines_count);
+
+    /* replace lines not found in index: searched in list */
+    y = 2;
+    hashtable_remove (buffer->own_lines_by_id, &y);
+    gui_chat_printf_y (buffer, 2, "line 2 (newer)");
+    y = 1;
+    hashtable_remove (buffer->own_lines_by_id, &y);
+    gui_chat_printf_y (buffer, 1, "line 1 (newer)");
+    LONGS_EQUAL(3, buffer->own_lines->lines_count);
+    POINTERS_EQUAL(buffer->own_lines->last_line,
+                   gui_line_search_by_id (buffer, 2));
+
+    ptr_line = buffer->own_lines->first_line;
+    LONGS_EQUAL(0, ptr_line->data->y);
+    STRCMP_EQUAL("line 0", ptr_line->data->message);
+    ptr_line = ptr_line->next_line;
+    LONGS_EQUAL(1, ptr_line->data->y);
+    STRCMP_EQUAL("line 1 (newer)", ptr_line->data->message);
+    ptr_line = ptr_line->next_line;
+    LONGS_EQUAL(2, ptr_line->data->y);
+    STRCMP_EQUAL("line 2 (newer)", ptr_line->data->message);
+    POINTERS_EQUAL(NULL, ptr_line->next_line);
+
+    gui_buffer_close (buffer);
 }
 
 /*
@@ -21,17 +21,65 @@
 
 #include "CppUTest/TestHarness.h"
 
+#include "tests/tests.h"
+
 extern "C"
 {
+#include <stdio.h>
 #include <string.h>
+#include "src/core/core-arraylist.h"
+#include "src/core/core-string.h"
 #include "src/gui/gui-buffer.h"
 #include "src/gui/gui-nicklist.h"
+
+extern char *gui_nicklist_nick_index_key (const char *name);
 }
 
 #define TEST_BUFFER_NAME "test"
 
 TEST_GROUP(GuiNicklist)
 {
+    static int nickcmp_cb (const void *pointer, void *data,
+                           struct t_gui_buffer *buffer,
+                           const char *nick1, const char *nick2)
+    {
+        /* make C++ compiler happy */
+        (void) pointer;
+        (void) data;
+        (void) buffer;
+
+        return string_strcasecmp_range (nick1, nick2, 30);
+    }
+
+    /* check that visible item #index is the same as with a full iteration */
+    void check_visible_item (struct t_gui_buffer *buffer, int index)
+    {
+        struct t_gui_nick_group *ptr_group, *ptr_group2;
+        struct t_gui_nick *ptr_nick, *ptr_nick2;
+        int i;
+
+        i = 0;
+        ptr_group = NULL;
+        ptr_nick = NULL;
+        gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
+        while (ptr_group || ptr_nick)
+        {
+            if ((ptr_nick && ptr_nick->visible)
+                || (ptr_group && !ptr_nick
+                    && buffer->nicklist_display_groups
+                    && ptr_group->visible))
+            {
+                if (i == index)
+                    break;
+                i++;
+            }
+            gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
+        }
+
+        gui_nicklist_get_visible_item (buffer, index, &ptr_group2, &ptr_nick2);
+        POINTERS_EQUAL(ptr_group, ptr_group2);
+        POINTERS_EQUAL(ptr_nick, ptr_nick2);
+    }
 };
 
 /*
@@ -266,8 +314,10 @@ TEST(GuiNicklist, AddGroup)
 
 /*
  * Tests functions:
- *   gui_nicklist_find_pos_nick
  *   gui_nicklist_insert_nick_sorted
+ *   gui_nicklist_remove_nick_sorted
+ *   gui_nicklist_nick_index_add
+ *   gui_nicklist_nick_index_remove
  *   gui_nicklist_add_nick_with_id
  *   gui_nicklist_add_nick
  *   gui_nicklist_search_nick_id
@@ -502,6 +552,170 @@ TEST(GuiNicklist, GetNextItem)
     gui_buffer_close (buffer);
 }
 
+/*
+ * Tests functions:
+ *   gui_nicklist_get_visible_item
+ *   gui_nicklist_tree_visible_add
+ */
+
+TEST(GuiNicklist, GetVisibleItem)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_nick_group *group1, *group2, *subgroup, *ptr_group;
+    struct t_gui_nick *nick1, *nick2, *ptr_nick;
+    char str_name[64];
+    int i;
+
+    buffer = gui_buffer_new (NULL, TEST_BUFFER_NAME,
+                             NULL, NULL, NULL,
+                             NULL, NULL, NULL);
+    CHECK(buffer);
+
+    /* invalid: NULL buffer / negative index */
+    gui_nicklist_get_visible_item (NULL, 0, &ptr_group, &ptr_nick);
+    POINTERS_EQUAL(NULL, ptr_group);
+    POINTERS_EQUAL(NULL, ptr_nick);
+    gui_nicklist_get_visible_item (buffer, -1, &ptr_group, &ptr_nick);
+    POINTERS_EQUAL(NULL, ptr_group);
+    POINTERS_EQUAL(NULL, ptr_nick);
+
+    /* empty nicklist (root group is not visible) */
+    gui_nicklist_get_visible_item (buffer, 0, &ptr_group, &ptr_nick);
+    POINTERS_EQUAL(NULL, ptr_group);
+    POINTERS_EQUAL(NULL, ptr_nick);
+
+    group1 = gui_nicklist_add_group (buffer, NULL, "1|group1", "blue", 1);
+    CHECK(group1);
+    group2 = gui_nicklist_add_group (buffer, NULL, "2|group2", "blue", 1);
+    CHECK(group2);
+    subgroup = gui_nicklist_add_group (buffer, group2, "subgroup", "blue", 0);
+    CHECK(subgroup);
+    for (i = 0; i < 20; i++)
+    {
+        snprintf (str_name, sizeof (str_name), "nick%02d", 19 - i);
+        CHECK(gui_nicklist_add_nick (buffer, (i % 2) ? group1 : group2,
+                                     str_name, NULL, NULL, NULL, 1));
+        snprintf (str_name, sizeof (str_name), "sub%02d", i);
+        CHECK(gui_nicklist_add_nick (buffer, subgroup,
+                                     str_name, NULL, NULL, NULL, i % 3));
+        snprintf (str_name, sizeof (str_name), "root%02d", i);
+        CHECK(gui_nicklist_add_nick (buffer, NULL,
+                                     str_name, NULL, NULL, NULL, 1));
+    }
+    LONGS_EQUAL(2, buffer->nicklist_root->tree_groups_visible_count);
+    LONGS_EQUAL(53, buffer->nicklist_root->tree_nicks_visible_count);
+    LONGS_EQUAL(20, buffer->nicklist_root->nicks_visible_count);
+    LONGS_EQUAL(1, group2->tree_groups_visible_count);
+    LONGS_EQUAL(23, group2->tree_nicks_visible_count);
+    LONGS_EQUAL(13, subgroup->nicks_visible_count);
+
+    nick1 = gui_nicklist_search_nick (buffer, NULL, "nick00");
+    CHECK(nick1);
+    nick2 = gui_nicklist_search_nick (buffer, NULL, "sub00");
+    CHECK(nick2);
+
+    for (i = 0; i < 60; i++)
+    {
+        check_visible_item (buffer, i);
+    }
+
+    gui_buffer_set (buffer, "nicklist_display_groups", "0");
+    for (i = 0; i < 60; i++)
+    {
+        check_visible_item (buffer, i);
+    }
+    gui_buffer_set (buffer, "nicklist_display_groups", "1");
+
+    /* change visibility of groups/nicks */
+    gui_nicklist_group_set (buffer, subgroup, "visible", "1");
+    gui_nicklist_group_set (buffer, group1, "visible", "0");
+    gui_nicklist_nick_set (buffer, nick1, "visible", "0");
+    gui_nicklist_nick_set (buffer, nick2, "visible", "1");
+    LONGS_EQUAL(2, buffer->nicklist_root->tree_groups_visible_count);
+    LONGS_EQUAL(53, buffer->nicklist_root->tree_nicks_visible_count);
+    for (i = 0; i < 60; i++)
+    {
+        check_visible_item (buffer, i);
+    }
+
+    /* remove nicks and group */
+    gui_nicklist_remove_nick (buffer, nick1);
+    gui_nicklist_remove_nick (buffer, nick2);
+    LONGS_EQUAL(52, buffer->nicklist_root->tree_nicks_visible_count);
+    gui_nicklist_remove_group (buffer, subgroup);
+    LONGS_EQUAL(1, buffer->nicklist_root->tree_groups_visible_count);
+    LONGS_EQUAL(39, buffer->nicklist_root->tree_nicks_visible_count);
+    for (i = 0; i < 45; i++)
+    {
+        check_visible_item (buffer, i);
+    }
+
+    gui_nicklist_remove_all (buffer);
+    LONGS_EQUAL(0, buffer->nicklist_root->tree_groups_visible_count);
+    LONGS_EQUAL(0, buffer->nicklist_root->tree_nicks_visible_count);
+    LONGS_EQUAL(0, arraylist_size (buffer->nicklist_root->nicks_sorted));
+
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests functions:
+ *   gui_nicklist_nick_index_key
+ *   gui_nicklist_search_nick_name (with nickcmp callback)
+ */
+
+TEST(GuiNicklist, SearchNickIndex)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_nick_group *group1;
+    struct t_gui_nick *nick1, *nick2, *nick3;
+    char *str;
+
+    WEE_TEST_STR("", gui_nicklist_nick_index_key (""));
+    WEE_TEST_STR("nick{a}|~_", gui_nicklist_nick_index_key ("NICK[A]\\^_"));
+    WEE_TEST_STR("nick{a}|~_", gui_nicklist_nick_index_key ("nick{a}|~_"));
+    WEE_TEST_STR("été", gui_nicklist_nick_index_key ("ÉTÉ"));
+
+    buffer = gui_buffer_new (NULL, TEST_BUFFER_NAME,
+                             NULL, NULL, NULL,
+                             NULL, NULL, NULL);
+    CHECK(buffer);
+
+    group1 = gui_nicklist_add_group (buffer, NULL, "group1", "blue", 1);
+    CHECK(group1);
+
+    /* without nickcmp callback: case sensitive */
+    nick1 = gui_nicklist_add_nick (buffer, NULL, "Alice", NULL, NULL, NULL, 1);
+    CHECK(nick1);
+    nick2 = gui_nicklist_add_nick (buffer, group1, "alice", NULL, NULL, NULL, 1);
+    CHECK(nick2);
+    nick3 = gui_nicklist_add_nick (buffer, group1, "bob[a]", NULL, NULL, NULL, 1);
+    CHECK(nick3);
+    POINTERS_EQUAL(nick1, gui_nicklist_search_nick (buffer, NULL, "Alice"));
+    POINTERS_EQUAL(nick2, gui_nicklist_search_nick (buffer, NULL, "alice"));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, "ALICE"));
+    POINTERS_EQUAL(nick3, gui_nicklist_search_nick (buffer, NULL, "bob[a]"));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, "bob{a}"));
+    POINTERS_EQUAL(nick2, gui_nicklist_search_nick (buffer, group1, "alice"));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, group1, "Alice"));
+
+    /* with nickcmp callback: case insensitive (IRC rfc1459) */
+    gui_nicklist_remove_nick (buffer, nick2);
+    gui_buffer_set_pointer (buffer, "nickcmp_callback", (void *)&nickcmp_cb);
+    POINTERS_EQUAL(nick1, gui_nicklist_search_nick (buffer, NULL, "ALICE"));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, group1, "ALICE"));
+    POINTERS_EQUAL(nick3, gui_nicklist_search_nick (buffer, NULL, "BOB{A}"));
+    POINTERS_EQUAL(nick3, gui_nicklist_search_nick (buffer, group1, "Bob[A]"));
+    POINTERS_EQUAL(NULL, gui_nicklist_add_nick (buffer, NULL, "BOB{a}",
+                                                NULL, NULL, NULL, 1));
+
+    gui_nicklist_remove_nick (buffer, nick3);
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, "bob[a]"));
+    POINTERS_EQUAL(nick1, gui_nicklist_search_nick (buffer, NULL, "alice"));
+
+    gui_buffer_close (buffer);
+}
+
 /*
  * Tests functions:
  *   gui_nicklist_get_group_start
@@ -0,0 +1,130 @@
+/*
+ * test-gui-window.cpp - test window functions
+ *
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include "src/core/core-config.h"
+#include "src/core/core-config-file.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-line.h"
+#include "src/gui/gui-window.h"
+}
+
+TEST_GROUP(GuiWindow)
+{
+};
+
+/*
+ * Tests functions:
+ *   gui_window_line_heights_invalidate_all
+ *   gui_window_line_heights_check
+ *   gui_window_line_heights_get
+ *   gui_window_line_heights_set
+ *   gui_window_line_heights_remove_line
+ *   gui_window_line_heights_free
+ *   gui_window_ask_refresh
+ */
+
+TEST(GuiWindow, LineHeights)
+{
+    struct t_gui_line *line1, *line2;
+    int old_width, old_refresh_needed;
+
+    gui_chat_printf (NULL, "test line heights 1");
+    gui_chat_printf (NULL, "test line heights 2");
+    line1 = gui_buffers->own_lines->last_line->prev_line;
+    line2 = gui_buffers->own_lines->last_line;
+
+    gui_window_line_heights_free (gui_windows);
+    POINTERS_EQUAL(NULL, gui_windows->line_heights);
+
+    LONGS_EQUAL(0, gui_window_line_heights_check (NULL, 1));
+    LONGS_EQUAL(0, gui_window_line_heights_check (gui_windows, 0));
+    LONGS_EQUAL(-1, gui_window_line_heights_get (NULL, line1, 0));
+    LONGS_EQUAL(-1, gui_window_line_heights_get (gui_windows, NULL, 0));
+    LONGS_EQUAL(-1, gui_window_line_heights_get (gui_windows, line1, 0));
+    POINTERS_EQUAL(NULL, gui_windows->line_heights);
+
+    /* set heights: cache is created */
+    gui_window_line_heights_set (gui_windows, NULL, 2, 0);
+    POINTERS_EQUAL(NULL, gui_windows->line_heights);
+    gui_window_line_heights_set (gui_windows, line1, -1, 0);
+    POINTERS_EQUAL(NULL, gui_windows->line_heights);
+    gui_window_line_heights_set (gui_windows, line1, 3, 0);
+    CHECK(gui_windows->line_heights);
+    LONGS_EQUAL(1, gui_window_line_heights_check (gui_windows, 0));
+    gui_window_line_heights_set (gui_windows, line2, 1,
+                                 GUI_WINDOW_LINE_HEIGHTS_FLAGS_MASK);
+    LONGS_EQUAL(3, gui_window_line_heights_get (gui_windows, line1, 0));
+    LONGS_EQUAL(1, gui_window_line_heights_get (
+                    gui_windows, line2, GUI_WINDOW_LINE_HEIGHTS_FLAGS_MASK));
+
+    /* flags are different */
+    LONGS_EQUAL(-1, gui_window_line_heights_get (gui_windows, line1, 1));
+    LONGS_EQUAL(-1, gui_window_line_heights_get (gui_windows, line2, 0));
+
+    /* remove a line */
+    gui_window_line_heights_remove_line (NULL);
+    gui_window_line_heights_remove_line (line1);
+    LONGS_EQUAL(-1, gui_window_line_heights_get (gui_windows, line1, 0));
+    LONGS_EQUAL(1, gui_window_line_heights_get (
+                    gui_windows, line2, GUI_WINDOW_LINE_HEIGHTS_FLAGS_MASK));
+
+    /* a new line removes the previous line from cache */
+    gui_window_line_heights_set (gui_windows, line1, 3, 0);
+    gui_chat_printf (NULL, "test line heights 3");
+    LONGS_EQUAL(3, gui_window_line_heights_get (gui_windows, line1, 0));
+    LONGS_EQUAL(-1, gui_window_line_heights_get (
+                    gui_windows, line2, GUI_WINDOW_LINE_HEIGHTS_FLAGS_MASK));
+
+    /* invalidate all heights */
+    gui_window_line_heights_invalidate_all ();
+    LONGS_EQUAL(-1, gui_window_line_heights_get (gui_windows, line1, 0));
+
+    /* change of window width clears the cache */
+    gui_window_line_heights_set (gui_windows, line1, 3, 0);
+    LONGS_EQUAL(3, gui_window_line_heights_get (gui_windows, line1, 0));
+    old_width = gui_windows->win_chat_width;
+    gui_windows->win_chat_width = old_width + 10;
+    LONGS_EQUAL(-1, gui_window_line_heights_get (gui_windows, line1, 0));
+    gui_windows->win_chat_width = old_width;
+
+    /* refresh of windows keeps the cache */
+    gui_window_line_heights_set (gui_windows, line1, 3, 0);
+    old_refresh_needed = gui_window_refresh_needed;
+    gui_window_ask_refresh (1);
+    LONGS_EQUAL(3, gui_window_line_heights_get (gui_windows, line1, 0));
+    gui_window_refresh_needed = old_refresh_needed;
+
+    /* change of an option used to display lines clears the cache */
+    config_file_option_set (config_look_align_end_of_lines, "time", 1);
+    LONGS_EQUAL(-1, gui_window_line_heights_get (gui_windows, line1, 0));
+    config_file_option_reset (config_look_align_end_of_lines, 1);
+    gui_window_refresh_needed = old_refresh_needed;
+
+    gui_window_line_heights_free (gui_windows);
+    POINTERS_EQUAL(NULL, gui_windows->line_heights);
+    gui_window_line_heights_free (gui_windows);
+    gui_window_line_heights_free (NULL);
+}
@@ -23,10 +23,22 @@
 
 extern "C"
 {
+#include <stdlib.h>
+#include "src/core/core-hashtable.h"
 #include "src/plugins/irc/irc-ignore.h"
 #include "src/plugins/irc/irc-server.h"
+
+extern struct t_hashtable *irc_ignore_cache;
+extern int irc_ignore_matcher_ok;
 }
 
+#define WEE_CHECK_PARSE_MASK(__exact, __prefix, __mask)                 \
+    irc_ignore_parse_mask (__mask, &exact, &prefix);                    \
+    STRCMP_EQUAL(__exact, exact);                                       \
+    STRCMP_EQUAL(__prefix, prefix);                                     \
+    free (exact);                                                       \
+    free (prefix);
+
 TEST_GROUP(IrcIgnore)
 {
 };
@@ -61,6 +73,44 @@ TEST(IrcIgnore, New)
     irc_ignore_free (ignore);
 }
 
+/*
+ * Tests functions:
+ *   irc_ignore_parse_mask
+ */
+
+TEST(IrcIgnore, ParseMask)
+{
+    char *exact, *prefix;
+
+    irc_ignore_parse_mask (NULL, NULL, NULL);
+    WEE_CHECK_PARSE_MASK(NULL, NULL, NULL);
+    WEE_CHECK_PARSE_MASK(NULL, NULL, "");
+    WEE_CHECK_PARSE_MASK(NULL, NULL, "nick");
+    WEE_CHECK_PARSE_MASK(NULL, NULL, "(?-i)^nick$");
+    WEE_CHECK_PARSE_MASK(NULL, NULL, "^.*$");
+    WEE_CHECK_PARSE_MASK(NULL, NULL, "^nick1$|^nick2$");
+    WEE_CHECK_PARSE_MASK(NULL, NULL, "^\\w+$");
+    WEE_CHECK_PARSE_MASK(NULL, NULL, "^\xc3\xa9t\xc3\xa9$");
+
+    /* exact text */
+    WEE_CHECK_PARSE_MASK("", NULL, "^$");
+    WEE_CHECK_PARSE_MASK("nick", NULL, "^nick$");
+    WEE_CHECK_PARSE_MASK("nick", NULL, "^NICK$");
+    WEE_CHECK_PARSE_MASK("user@host.com", NULL, "^User@Host\\.com$");
+    WEE_CHECK_PARSE_MASK("[nick]|", NULL, "^\\[nick\\]\\|$");
+
+    /* prefix */
+    WEE_CHECK_PARSE_MASK(NULL, "nick", "^nick");
+    WEE_CHECK_PARSE_MASK(NULL, "nick!", "^Nick!.*@host$");
+    WEE_CHECK_PARSE_MASK(NULL, "nic", "^nick?$");
+    WEE_CHECK_PARSE_MASK(NULL, "nic", "^nick*$");
+    WEE_CHECK_PARSE_MASK(NULL, "nic", "^nick+$");
+    WEE_CHECK_PARSE_MASK(NULL, "nic", "^nick{2}$");
+    WEE_CHECK_PARSE_MASK(NULL, "nick", "^nick[0-9]$");
+    WEE_CHECK_PARSE_MASK(NULL, "nick.", "^nick\\.\\w$");
+    WEE_CHECK_PARSE_MASK(NULL, "t", "^t\xc3\xa9t\xc3\xa9$");
+}
+
 /*
  * Tests functions:
  *   irc_ignore_free
@@ -214,3 +264,84 @@ TEST(IrcIgnore, CheckHost)
     irc_ignore_free_all ();
     irc_server_free (server);
 }
+
+/*
+ * Tests functions:
+ *   irc_ignore_check_exact
+ *   irc_ignore_check_list
+ *   irc_ignore_check
+ *   irc_ignore_matcher_invalidate
+ *   irc_ignore_matcher_build
+ *   irc_ignore_matcher_free
+ */
+
+TEST(IrcIgnore, Check)
+{
+    struct t_irc_server *server;
+    struct t_irc_ignore *ignore;
+
+    server = irc_server_alloc ("test_ignore");
+    CHECK(server);
+
+    LONGS_EQUAL(0, irc_ignore_check (NULL, NULL, NULL, NULL));
+    LONGS_EQUAL(0, irc_ignore_check (server, "#chan", "nick1", "nick1!u@h"));
+    LONGS_EQUAL(0, irc_ignore_matcher_ok);
+
+    CHECK(irc_ignore_new ("^nick1$", NULL, NULL));
+    CHECK(irc_ignore_new ("^User2@Host$", "test_ignore", NULL));
+    CHECK(irc_ignore_new ("^nick3!.*@spam\\.example$", NULL, "#chan"));
+    CHECK(irc_ignore_new ("spam", "other", NULL));
+    CHECK(irc_ignore_new ("^nick5!user5@host$", NULL, NULL));
+
+    /* exact nick */
+    LONGS_EQUAL(1, irc_ignore_check (server, "#chan", "nick1", "nick1!u@h"));
+    LONGS_EQUAL(1, irc_ignore_matcher_ok);
+    LONGS_EQUAL(1, irc_ignore_check (server, "#chan", "NICK1", "NICK1!u@h"));
+    LONGS_EQUAL(1, irc_ignore_check (server, NULL, "nick1", NULL));
+    LONGS_EQUAL(0, irc_ignore_check (server, "#chan", "nick11", "nick11!u@h"));
+
+    /* exact user@host (only if mask has no "!") */
+    LONGS_EQUAL(1, irc_ignore_check (server, "#chan", "nick", "nick!user2@host"));
+    LONGS_EQUAL(1, irc_ignore_check (server, "#chan", "nick", "user2@host"));
+    LONGS_EQUAL(0, irc_ignore_check (server, "#chan", "nick", "nick!user2@host2"));
+    LONGS_EQUAL(1, irc_ignore_check (server, "#chan", "nick5",
+                                     "nick5!user5@host"));
+    LONGS_EQUAL(0, irc_ignore_check (server, "#chan", "nick", "user5@host"));
+
+    /* regex with prefix */
+    LONGS_EQUAL(1, irc_ignore_check (server, "#chan", "nick3",
+                                     "nick3!user@spam.example"));
+    LONGS_EQUAL(1, irc_ignore_check (server, "#chan", "Nick3",
+                                     "Nick3!user@SPAM.example"));
+    LONGS_EQUAL(0, irc_ignore_check (server, "#other", "nick3",
+                                     "nick3!user@spam.example"));
+    LONGS_EQUAL(0, irc_ignore_check (server, "#chan", "nick4",
+                                     "nick4!user@spam.example"));
+
+    /* regex on another server */
+    LONGS_EQUAL(0, irc_ignore_check (server, "#chan", "spammer", "spammer!u@h"));
+
+    /* results are in cache, cleared when an ignore is added or removed */
+    CHECK(irc_ignore_cache);
+    CHECK(hashtable_get_integer (irc_ignore_cache, "items_count") > 0);
+    ignore = irc_ignore_new ("^nick11$", NULL, NULL);
+    CHECK(ignore);
+    LONGS_EQUAL(0, irc_ignore_matcher_ok);
+    LONGS_EQUAL(0, hashtable_get_integer (irc_ignore_cache, "items_count"));
+    LONGS_EQUAL(1, irc_ignore_check (server, "#chan", "nick11", "nick11!u@h"));
+    LONGS_EQUAL(1, irc_ignore_matcher_ok);
+    irc_ignore_free (ignore);
+    LONGS_EQUAL(0, irc_ignore_matcher_ok);
+    LONGS_EQUAL(0, irc_ignore_check (server, "#chan", "nick11", "nick11!u@h"));
+
+    /* matcher built again after free */
+    irc_ignore_matcher_free ();
+    LONGS_EQUAL(1, irc_ignore_check (server, "#chan", "nick1", "nick1!u@h"));
+    LONGS_EQUAL(0, irc_ignore_check (server, "#chan", "nick11", "nick11!u@h"));
+
+    irc_ignore_free_all ();
+    POINTERS_EQUAL(NULL, irc_ignore_cache);
+    LONGS_EQUAL(0, irc_ignore_matcher_ok);
+
+    irc_server_free (server);
+}
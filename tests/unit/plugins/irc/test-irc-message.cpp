@@ -457,6 +457,82 @@ TEST(IrcMessage, ParseParams)
     string_free_split (params);
 }
 
+/*
+ * Tests functions:
+ *   irc_message_parse_spans
+ *   irc_message_span_dup
+ */
+
+TEST(IrcMessage, ParseSpans)
+{
+    struct t_irc_message_spans spans;
+    const char *msg;
+    char *str;
+
+    irc_message_parse_spans (NULL, NULL, &spans);
+    LONGS_EQUAL(-1, spans.tags.pos);
+    LONGS_EQUAL(-1, spans.message_without_tags.pos);
+    LONGS_EQUAL(-1, spans.nick.pos);
+    LONGS_EQUAL(-1, spans.user.pos);
+    LONGS_EQUAL(-1, spans.host.pos);
+    LONGS_EQUAL(-1, spans.command.pos);
+    LONGS_EQUAL(-1, spans.channel.pos);
+    LONGS_EQUAL(-1, spans.arguments.pos);
+    LONGS_EQUAL(-1, spans.text.pos);
+    POINTERS_EQUAL(NULL, irc_message_span_dup (NULL, &spans.tags));
+    POINTERS_EQUAL(NULL, irc_message_span_dup ("test", &spans.tags));
+    POINTERS_EQUAL(NULL, irc_message_span_dup ("test", NULL));
+
+    msg = "@time=2015-06-27T16:40:35.000Z :nick!user@host PRIVMSG "
+        "#weechat :Hello world!";
+    irc_message_parse_spans (NULL, msg, &spans);
+    LONGS_EQUAL(1, spans.tags.pos);
+    LONGS_EQUAL(29, spans.tags.length);
+    LONGS_EQUAL(31, spans.message_without_tags.pos);
+    LONGS_EQUAL(46, spans.message_without_tags.length);
+    LONGS_EQUAL(32, spans.nick.pos);
+    LONGS_EQUAL(4, spans.nick.length);
+    LONGS_EQUAL(37, spans.user.pos);
+    LONGS_EQUAL(4, spans.user.length);
+    LONGS_EQUAL(32, spans.host.pos);
+    LONGS_EQUAL(14, spans.host.length);
+    LONGS_EQUAL(47, spans.command.pos);
+    LONGS_EQUAL(7, spans.command.length);
+    LONGS_EQUAL(55, spans.channel.pos);
+    LONGS_EQUAL(8, spans.channel.length);
+    LONGS_EQUAL(55, spans.arguments.pos);
+    LONGS_EQUAL(22, spans.arguments.length);
+    LONGS_EQUAL(65, spans.text.pos);
+    LONGS_EQUAL(12, spans.text.length);
+
+    str = irc_message_span_dup (msg, &spans.tags);
+    STRCMP_EQUAL("time=2015-06-27T16:40:35.000Z", str);
+    free (str);
+    str = irc_message_span_dup (msg, &spans.host);
+    STRCMP_EQUAL("nick!user@host", str);
+    free (str);
+    str = irc_message_span_dup (msg, &spans.command);
+    STRCMP_EQUAL("PRIVMSG", str);
+    free (str);
+    str = irc_message_span_dup (msg, &spans.text);
+    STRCMP_EQUAL("Hello world!", str);
+    free (str);
+
+    /* message without tags and host */
+    msg = "PING :server";
+    irc_message_parse_spans (NULL, msg, &spans);
+    LONGS_EQUAL(-1, spans.tags.pos);
+    LONGS_EQUAL(0, spans.message_without_tags.pos);
+    LONGS_EQUAL(12, spans.message_without_tags.length);
+    LONGS_EQUAL(-1, spans.nick.pos);
+    LONGS_EQUAL(-1, spans.host.pos);
+    LONGS_EQUAL(0, spans.command.pos);
+    LONGS_EQUAL(4, spans.command.length);
+    LONGS_EQUAL(-1, spans.channel.pos);
+    LONGS_EQUAL(5, spans.arguments.pos);
+    LONGS_EQUAL(7, spans.arguments.length);
+}
+
 /*
  * Tests functions:
  *   irc_message_parse
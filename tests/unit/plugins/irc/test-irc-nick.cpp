@@ -26,7 +26,9 @@
 extern "C"
 {
 #include <string.h>
+#include "src/gui/gui-buffer.h"
 #include "src/gui/gui-color.h"
+#include "src/plugins/irc/irc-channel.h"
 #include "src/plugins/irc/irc-nick.h"
 #include "src/plugins/irc/irc-server.h"
 }
@@ -390,11 +392,115 @@ TEST(IrcNick, FreeAll)
 /*
  * Tests functions:
  *   irc_nick_search
+ *   irc_nick_index_add
+ *   irc_nick_index_remove
+ *   irc_nick_index_rebuild
  */
 
 TEST(IrcNick, Search)
 {
-    /* TODO: write tests */
+    struct t_irc_server *server;
+    struct t_irc_channel *channel;
+    struct t_irc_nick *nick1, *nick2, *nick3, *nick4;
+
+    server = irc_server_alloc ("server1");
+    CHECK(server);
+
+    channel = irc_channel_new (server, IRC_CHANNEL_TYPE_CHANNEL, "#test",
+                               0, 0);
+    CHECK(channel);
+
+    POINTERS_EQUAL(NULL, irc_nick_search (NULL, NULL, NULL));
+    POINTERS_EQUAL(NULL, irc_nick_search (server, NULL, "alice"));
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, NULL));
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "alice"));
+
+    nick1 = irc_nick_new (server, channel, "Alice", "user@host", NULL, 0,
+                          NULL, NULL);
+    CHECK(nick1);
+    nick2 = irc_nick_new (server, channel, "bob[a]", "user@host", NULL, 0,
+                          NULL, NULL);
+    CHECK(nick2);
+    nick3 = irc_nick_new (server, channel, "carol^", "user@host", NULL, 0,
+                          NULL, NULL);
+    CHECK(nick3);
+    LONGS_EQUAL(3, channel->nicks_count);
+    POINTERS_EQUAL(nick1, irc_nick_new (server, channel, "ALICE", NULL,
+                                        NULL, 0, NULL, NULL));
+    LONGS_EQUAL(3, channel->nicks_count);
+
+    /* casemapping: rfc1459 */
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "xxx"));
+    POINTERS_EQUAL(nick1, irc_nick_search (server, channel, "alice"));
+    POINTERS_EQUAL(nick1, irc_nick_search (server, channel, "ALICE"));
+    POINTERS_EQUAL(nick2, irc_nick_search (server, channel, "bob[a]"));
+    POINTERS_EQUAL(nick2, irc_nick_search (server, channel, "BOB{A}"));
+    POINTERS_EQUAL(nick3, irc_nick_search (server, channel, "carol^"));
+    POINTERS_EQUAL(nick3, irc_nick_search (server, channel, "CAROL~"));
+
+    /* casemapping: strict-rfc1459 */
+    irc_server_set_casemapping (server,
+                                IRC_SERVER_CASEMAPPING_STRICT_RFC1459);
+    POINTERS_EQUAL(nick1, irc_nick_search (server, channel, "ALICE"));
+    POINTERS_EQUAL(nick2, irc_nick_search (server, channel, "BOB{A}"));
+    POINTERS_EQUAL(nick3, irc_nick_search (server, channel, "CAROL^"));
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "CAROL~"));
+
+    /* casemapping: ascii */
+    irc_server_set_casemapping (server, IRC_SERVER_CASEMAPPING_ASCII);
+    POINTERS_EQUAL(nick1, irc_nick_search (server, channel, "ALICE"));
+    POINTERS_EQUAL(nick2, irc_nick_search (server, channel, "BOB[A]"));
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "BOB{A}"));
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "CAROL~"));
+
+    irc_server_set_casemapping (server, IRC_SERVER_CASEMAPPING_RFC1459);
+
+    /* change nick */
+    irc_nick_change (server, channel, nick1, "Alice2");
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "alice"));
+    POINTERS_EQUAL(nick1, irc_nick_search (server, channel, "ALICE2"));
+
+    /* change case of nick */
+    irc_nick_change (server, channel, nick1, "alice2");
+    POINTERS_EQUAL(nick1, irc_nick_search (server, channel, "Alice2"));
+    STRCMP_EQUAL("alice2", nick1->name);
+
+    /* free nick */
+    irc_nick_free (server, channel, nick2);
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "bob[a]"));
+    POINTERS_EQUAL(nick1, irc_nick_search (server, channel, "alice2"));
+    POINTERS_EQUAL(nick3, irc_nick_search (server, channel, "carol^"));
+
+    /* nicks colliding after a change of casemapping */
+    irc_server_set_casemapping (server, IRC_SERVER_CASEMAPPING_ASCII);
+    nick2 = irc_nick_new (server, channel, "dave[x]", "user@host", NULL, 0,
+                          NULL, NULL);
+    CHECK(nick2);
+    nick4 = irc_nick_new (server, channel, "dave{x}", "user@host", NULL, 0,
+                          NULL, NULL);
+    CHECK(nick4);
+    CHECK(nick2 != nick4);
+    LONGS_EQUAL(0, channel->nicks_index_collisions);
+    POINTERS_EQUAL(nick2, irc_nick_search (server, channel, "dave[x]"));
+    POINTERS_EQUAL(nick4, irc_nick_search (server, channel, "dave{x}"));
+    irc_server_set_casemapping (server, IRC_SERVER_CASEMAPPING_RFC1459);
+    LONGS_EQUAL(1, channel->nicks_index_collisions);
+    POINTERS_EQUAL(nick2, irc_nick_search (server, channel, "dave{x}"));
+    /* the other nick is indexed when the indexed one is removed */
+    irc_nick_free (server, channel, nick2);
+    LONGS_EQUAL(0, channel->nicks_index_collisions);
+    POINTERS_EQUAL(nick4, irc_nick_search (server, channel, "dave[x]"));
+    POINTERS_EQUAL(nick4, irc_nick_search (server, channel, "DAVE{X}"));
+    irc_nick_free (server, channel, nick4);
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "dave[x]"));
+
+    /* free all nicks */
+    irc_nick_free_all (server, channel);
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "alice2"));
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "carol^"));
+
+    gui_buffer_close (channel->buffer);
+    irc_server_free (server);
 }
 
 /*
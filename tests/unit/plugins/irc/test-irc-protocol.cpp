@@ -65,6 +65,8 @@ extern char *irc_protocol_cap_to_enable (const char *capabilities,
 }
 
 #define IRC_FAKE_SERVER "fake"
+#define IRC_REPLAY_NICKS 250
+#define IRC_REPLAY_ROUNDS 4
 #define IRC_MSG_005 "PREFIX=(ohv)@%+ MAXLIST=bqeI:100 MODES=4 "         \
     "NETWORK=StaticBox STATUSMSG=@+ CALLERID=g "                        \
     "CASEMAPPING=strict-rfc1459 LINELEN=4096 NICKLEN=30 MAXNICKLEN=31 " \
@@ -1245,6 +1247,143 @@ TEST(IrcProtocolWithServer, recv_command_invalid_message)
     CHECK_NO_MSG;
 }
 
+/*
+ * Tests functions:
+ *   irc_protocol_search_message
+ */
+
+TEST(IrcProtocol, SearchMessage)
+{
+    struct t_irc_protocol_msg *ptr_msg;
+    char *name;
+    int i, j;
+
+    POINTERS_EQUAL(NULL, irc_protocol_search_message (NULL));
+    POINTERS_EQUAL(NULL, irc_protocol_search_message (""));
+    POINTERS_EQUAL(NULL, irc_protocol_search_message ("xyz"));
+    POINTERS_EQUAL(NULL, irc_protocol_search_message ("privmsg2"));
+    POINTERS_EQUAL(NULL, irc_protocol_search_message ("099"));
+    POINTERS_EQUAL(NULL, irc_protocol_search_message ("0001"));
+    POINTERS_EQUAL(NULL, irc_protocol_search_message ("01"));
+    POINTERS_EQUAL(NULL, irc_protocol_search_message ("1"));
+
+    ptr_msg = irc_protocol_search_message ("privmsg");
+    CHECK(ptr_msg);
+    STRCMP_EQUAL("privmsg", ptr_msg->name);
+    POINTERS_EQUAL(ptr_msg, irc_protocol_search_message ("PRIVMSG"));
+    POINTERS_EQUAL(ptr_msg, irc_protocol_search_message ("PrivMsg"));
+
+    ptr_msg = irc_protocol_search_message ("001");
+    CHECK(ptr_msg);
+    STRCMP_EQUAL("001", ptr_msg->name);
+
+    ptr_msg = irc_protocol_search_message ("975");
+    CHECK(ptr_msg);
+    STRCMP_EQUAL("975", ptr_msg->name);
+
+    /* index must return the same entry as a linear search in the table */
+    for (i = 0; irc_protocol_messages[i].name; i++)
+    {
+        for (j = 0; irc_protocol_messages[j].name; j++)
+        {
+            if (strcasecmp (irc_protocol_messages[j].name,
+                            irc_protocol_messages[i].name) == 0)
+                break;
+        }
+        POINTERS_EQUAL(&irc_protocol_messages[j],
+                       irc_protocol_search_message (
+                           irc_protocol_messages[i].name));
+        name = string_toupper (irc_protocol_messages[i].name);
+        POINTERS_EQUAL(&irc_protocol_messages[j],
+                       irc_protocol_search_message (name));
+        free (name);
+    }
+}
+
+/*
+ * Tests functions:
+ *   irc_protocol_search_message
+ *   irc_server_msgq_add_buffer
+ *   irc_server_msgq_flush
+ *
+ * Replay of a stream of messages received during a netsplit
+ * (JOIN/PRIVMSG/MODE/QUIT, numerics) and lookup of the commands.
+ */
+
+TEST(IrcProtocolWithServer, ReplayNetsplit)
+{
+    const char *commands[] = { "PRIVMSG", "JOIN", "QUIT", "PART", "NOTICE",
+                               "MODE", "NICK", "353", "366", "PING",
+                               "xyz", "999", NULL };
+    struct t_irc_protocol_msg *ptr_msg_linear;
+    char **stream, *stream_copy, str_msg[1024];
+    int i, j, found_linear, found_index;
+
+    SRV_INIT_JOIN;
+
+    stream = string_dyn_alloc (256 * 1024);
+    CHECK(stream);
+    for (i = 0; i < IRC_REPLAY_NICKS; i++)
+    {
+        snprintf (str_msg, sizeof (str_msg),
+                  ":nick%d!user%d@host%d.example.com JOIN #test\r\n"
+                  ":nick%d!user%d@host%d.example.com PRIVMSG #test "
+                  ":hello from nick%d\r\n"
+                  ":server MODE #test +v nick%d\r\n"
+                  ":nick%d!user%d@host%d.example.com QUIT "
+                  ":irc.example.com irc2.example.com\r\n",
+                  i, i, i, i, i, i, i, i, i, i, i);
+        string_dyn_concat (stream, str_msg, -1);
+    }
+
+    record_start ();
+    for (i = 0; i < IRC_REPLAY_ROUNDS; i++)
+    {
+        /* the buffer can be modified when it is split: use a copy */
+        stream_copy = strdup (*stream);
+        CHECK(stream_copy);
+        irc_server_msgq_add_buffer (ptr_server, stream_copy);
+        irc_server_msgq_flush ();
+        free (stream_copy);
+    }
+    record_stop ();
+
+    string_dyn_free (stream, 1);
+
+    /* messages of all rounds have been processed (at least the PRIVMSG) */
+    CHECK(arraylist_size (recorded_messages)
+          >= IRC_REPLAY_NICKS * IRC_REPLAY_ROUNDS);
+
+    /* all nicks have quit: only self nick is left in channel */
+    CHECK(ptr_server->channels);
+    LONGS_EQUAL(1, ptr_server->channels->nicks_count);
+
+    /* lookup of commands: index returns the same entry as a linear search */
+    found_linear = 0;
+    found_index = 0;
+    for (i = 0; commands[i]; i++)
+    {
+        ptr_msg_linear = NULL;
+        for (j = 0; irc_protocol_messages[j].name; j++)
+        {
+            if (string_strcasecmp (irc_protocol_messages[j].name,
+                                   commands[i]) == 0)
+            {
+                ptr_msg_linear = &irc_protocol_messages[j];
+                break;
+            }
+        }
+        POINTERS_EQUAL(ptr_msg_linear,
+                       irc_protocol_search_message (commands[i]));
+        if (ptr_msg_linear)
+            found_linear++;
+        if (irc_protocol_search_message (commands[i]))
+            found_index++;
+    }
+    LONGS_EQUAL(10, found_linear);
+    LONGS_EQUAL(found_linear, found_index);
+}
+
 /*
  * Tests functions:
  *   irc_protocol_cb_account (without account-notify capability)
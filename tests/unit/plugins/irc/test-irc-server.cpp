@@ -27,7 +27,10 @@ extern "C"
 {
 #include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 #include "src/core/core-config-file.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-line.h"
 #include "src/plugins/plugin.h"
 #include "src/plugins/irc/irc-channel.h"
 #include "src/plugins/irc/irc-server.h"
@@ -35,6 +38,18 @@ extern "C"
 extern int irc_server_fingerprint_search_algo_with_size (int size);
 extern char *irc_server_eval_fingerprint (struct t_irc_server *server);
 extern char *irc_server_build_autojoin (struct t_irc_server *server);
+extern char *irc_server_outqueue_merge_mode (struct t_irc_server *server,
+                                             const char *message1,
+                                             const char *message2);
+extern char *irc_server_outqueue_merge_kick (struct t_irc_server *server,
+                                             const char *message1,
+                                             const char *message2);
+extern void irc_server_outqueue_add (struct t_irc_server *server, int priority,
+                                     const char *command, const char *msg1,
+                                     const char *msg2, int modified,
+                                     const char *tags,
+                                     struct t_irc_redirect *redirect);
+extern void irc_server_anti_flood_refill (struct t_irc_server *server);
 }
 
 #define IRC_FAKE_SERVER "fake"
@@ -213,6 +228,35 @@ TEST(IrcServer, Strcasecmp)
     irc_server_free (server);
 }
 
+/*
+ * Tests functions:
+ *   irc_server_string_casemap
+ */
+
+TEST(IrcServer, StringCasemap)
+{
+    struct t_irc_server *server;
+    char *str;
+
+    server = irc_server_alloc ("server1");
+    CHECK(server);
+
+    POINTERS_EQUAL(NULL, irc_server_string_casemap (NULL, NULL));
+    POINTERS_EQUAL(NULL, irc_server_string_casemap (server, NULL));
+
+    WEE_TEST_STR("", irc_server_string_casemap (NULL, ""));
+    WEE_TEST_STR("nick{a}|~_ô", irc_server_string_casemap (NULL, "NICK[A]\\^_ô"));
+    WEE_TEST_STR("nick{a}|~_Ô", irc_server_string_casemap (server, "NICK[A]\\^_Ô"));
+
+    server->casemapping = IRC_SERVER_CASEMAPPING_STRICT_RFC1459;
+    WEE_TEST_STR("nick{a}|^_Ô", irc_server_string_casemap (server, "NICK[A]\\^_Ô"));
+
+    server->casemapping = IRC_SERVER_CASEMAPPING_ASCII;
+    WEE_TEST_STR("nick[a]\\^_Ô", irc_server_string_casemap (server, "NICK[A]\\^_Ô"));
+
+    irc_server_free (server);
+}
+
 /*
  * Tests functions:
  *   irc_server_eval_expression
@@ -787,6 +831,35 @@ TEST(IrcServer, GetMaxModes)
     /* TODO: write tests */
 }
 
+/*
+ * Tests functions:
+ *   irc_server_get_targmax
+ */
+
+TEST(IrcServer, GetTargmax)
+{
+    struct t_irc_server *server;
+
+    server = irc_server_alloc ("test_targmax");
+    CHECK(server);
+
+    LONGS_EQUAL(-1, irc_server_get_targmax (NULL, NULL));
+    LONGS_EQUAL(-1, irc_server_get_targmax (server, NULL));
+    LONGS_EQUAL(-1, irc_server_get_targmax (server, ""));
+    LONGS_EQUAL(-1, irc_server_get_targmax (server, "KICK"));
+
+    server->isupport = strdup ("MODES=4 TARGMAX=KICK:4,NAMES:,PRIVMSG:x");
+
+    LONGS_EQUAL(4, irc_server_get_targmax (server, "KICK"));
+    LONGS_EQUAL(4, irc_server_get_targmax (server, "kick"));
+    LONGS_EQUAL(0, irc_server_get_targmax (server, "NAMES"));
+    LONGS_EQUAL(-1, irc_server_get_targmax (server, "PRIVMSG"));
+    LONGS_EQUAL(-1, irc_server_get_targmax (server, "KIC"));
+    LONGS_EQUAL(-1, irc_server_get_targmax (server, "WHOIS"));
+
+    irc_server_free (server);
+}
+
 /*
  * Tests functions:
  *   irc_server_get_default_msg
@@ -995,7 +1068,209 @@ TEST(IrcServer, ApplyCommandLineOptions)
 
 TEST(IrcServer, OutqueueAdd)
 {
-    /* TODO: write tests */
+    struct t_irc_server *server;
+
+    server = irc_server_alloc ("test_outqueue");
+    CHECK(server);
+
+    server->isupport = strdup ("MODES=3 TARGMAX=KICK:3");
+
+    /* not merged: immediate priority */
+    irc_server_outqueue_add (server, 0, "mode", NULL,
+                             "MODE #test +o alice\r\n", 0, NULL, NULL);
+    irc_server_outqueue_add (server, 0, "mode", NULL,
+                             "MODE #test +o bob\r\n", 0, NULL, NULL);
+    LONGS_EQUAL(2, server->outqueue_size[0]);
+    LONGS_EQUAL(0, server->outqueue_merged);
+
+    /* merged: MODE in high priority queue */
+    irc_server_outqueue_add (server, 1, "mode", NULL,
+                             "MODE #test +o alice\r\n", 0, NULL, NULL);
+    irc_server_outqueue_add (server, 1, "mode", NULL,
+                             "MODE #test +o bob\r\n", 0, NULL, NULL);
+    irc_server_outqueue_add (server, 1, "mode", NULL,
+                             "MODE #test +v carol\r\n", 0, NULL, NULL);
+    LONGS_EQUAL(1, server->outqueue_size[1]);
+    LONGS_EQUAL(2, server->outqueue_merged);
+    STRCMP_EQUAL("MODE #test +oov alice bob carol\r\n",
+                 server->outqueue[1]->message_after_mod);
+
+    /* not merged: too many modes */
+    irc_server_outqueue_add (server, 1, "mode", NULL,
+                             "MODE #test +o dave\r\n", 0, NULL, NULL);
+    LONGS_EQUAL(2, server->outqueue_size[1]);
+
+    /* not merged: different tags */
+    irc_server_outqueue_add (server, 1, "mode", NULL,
+                             "MODE #test +o eve\r\n", 0, "tag=1", NULL);
+    LONGS_EQUAL(3, server->outqueue_size[1]);
+
+    /* not merged: message modified */
+    irc_server_outqueue_add (server, 2, "kick", "KICK #test alice :bye",
+                             "KICK #test alice :bye!\r\n", 1, NULL, NULL);
+    irc_server_outqueue_add (server, 2, "kick", NULL,
+                             "KICK #test bob :bye!\r\n", 0, NULL, NULL);
+    LONGS_EQUAL(2, server->outqueue_size[2]);
+
+    /* merged: KICK in low priority queue */
+    irc_server_outqueue_add (server, 2, "kick", NULL,
+                             "KICK #test carol :bye!\r\n", 0, NULL, NULL);
+    LONGS_EQUAL(2, server->outqueue_size[2]);
+    LONGS_EQUAL(3, server->outqueue_merged);
+    STRCMP_EQUAL("KICK #test bob,carol :bye!\r\n",
+                 server->last_outqueue[2]->message_after_mod);
+
+    irc_server_outqueue_free_all (server, 1);
+    LONGS_EQUAL(0, server->outqueue_size[1]);
+
+    irc_server_free (server);
+}
+
+/*
+ * Tests functions:
+ *   irc_server_outqueue_merge_mode
+ */
+
+TEST(IrcServer, OutqueueMergeMode)
+{
+    struct t_irc_server *server;
+    char *str;
+
+    server = irc_server_alloc ("test_merge_mode");
+    CHECK(server);
+
+    WEE_TEST_STR("MODE #test +oo alice bob",
+                 irc_server_outqueue_merge_mode (server,
+                                                 "MODE #test +o alice",
+                                                 "MODE #test +o bob"));
+    WEE_TEST_STR("MODE #test -vov alice bob carol",
+                 irc_server_outqueue_merge_mode (server,
+                                                 "MODE #test -vo alice bob",
+                                                 "MODE #test -v carol"));
+    WEE_TEST_STR("MODE #test -vovv alice bob carol dave",
+                 irc_server_outqueue_merge_mode (server,
+                                                 "MODE #test -vo alice bob",
+                                                 "MODE #test -vv carol dave"));
+    /* too many modes (default is 4) */
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_mode (server,
+                                                 "MODE #test -vo alice bob",
+                                                 "MODE #test -vvv carol dave eve"));
+    WEE_TEST_STR("MODE #TEST +ov alice bob",
+                 irc_server_outqueue_merge_mode (server,
+                                                 "MODE #TEST +o alice",
+                                                 "MODE #test +v bob"));
+
+    /* different channels */
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_mode (server,
+                                                 "MODE #test +o alice",
+                                                 "MODE #test2 +o bob"));
+    /* not a channel */
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_mode (server,
+                                                 "MODE alice +i x",
+                                                 "MODE alice +i y"));
+    /* different actions */
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_mode (server,
+                                                 "MODE #test +o alice",
+                                                 "MODE #test -o bob"));
+    /* modes not in prefix modes */
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_mode (server,
+                                                 "MODE #test +b alice!*@*",
+                                                 "MODE #test +b bob!*@*"));
+    /* missing arguments */
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_mode (server,
+                                                 "MODE #test +oo alice",
+                                                 "MODE #test +o bob"));
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_mode (server,
+                                                 "MODE #test",
+                                                 "MODE #test +o bob"));
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_mode (server,
+                                                 "MODE #test +o alice",
+                                                 "MODE #test +o bob carol"));
+
+    server->isupport = strdup ("MODES=2");
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_mode (server,
+                                                 "MODE #test +oo alice bob",
+                                                 "MODE #test +o carol"));
+
+    irc_server_free (server);
+}
+
+/*
+ * Tests functions:
+ *   irc_server_outqueue_merge_kick
+ */
+
+TEST(IrcServer, OutqueueMergeKick)
+{
+    struct t_irc_server *server;
+    char *str;
+
+    server = irc_server_alloc ("test_merge_kick");
+    CHECK(server);
+
+    /* no TARGMAX in isupport */
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_kick (server,
+                                                 "KICK #test alice",
+                                                 "KICK #test bob"));
+
+    server->isupport = strdup ("TARGMAX=KICK:");
+
+    WEE_TEST_STR("KICK #test alice,bob",
+                 irc_server_outqueue_merge_kick (server,
+                                                 "KICK #test alice",
+                                                 "KICK #test bob"));
+    WEE_TEST_STR("KICK #test alice,bob,carol :bye",
+                 irc_server_outqueue_merge_kick (server,
+                                                 "KICK #test alice,bob :bye",
+                                                 "KICK #TEST carol :bye"));
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_kick (server,
+                                                 "KICK #test alice :bye",
+                                                 "KICK #test bob :see you"));
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_kick (server,
+                                                 "KICK #test alice :bye",
+                                                 "KICK #test2 bob :bye"));
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_kick (server,
+                                                 "KICK #test",
+                                                 "KICK #test bob"));
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_kick (server,
+                                                 "KICK #test :bye",
+                                                 "KICK #test bob :bye"));
+
+    free (server->isupport);
+    server->isupport = strdup ("TARGMAX=KICK:3");
+
+    WEE_TEST_STR("KICK #test alice,bob,carol :bye",
+                 irc_server_outqueue_merge_kick (server,
+                                                 "KICK #test alice,bob :bye",
+                                                 "KICK #test carol :bye"));
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_kick (server,
+                                                 "KICK #test alice,bob :bye",
+                                                 "KICK #test carol,dave :bye"));
+
+    free (server->isupport);
+    server->isupport = strdup ("TARGMAX=KICK:1");
+
+    WEE_TEST_STR(NULL,
+                 irc_server_outqueue_merge_kick (server,
+                                                 "KICK #test alice",
+                                                 "KICK #test bob"));
+
+    irc_server_free (server);
 }
 
 /*
@@ -1128,6 +1403,41 @@ TEST(IrcServer, OutqueueAllEmpty)
     /* TODO: write tests */
 }
 
+/*
+ * Tests functions:
+ *   irc_server_anti_flood_refill
+ */
+
+TEST(IrcServer, AntiFloodRefill)
+{
+    struct t_irc_server *server;
+    struct timeval now;
+
+    server = irc_server_alloc ("test_anti_flood");
+    CHECK(server);
+
+    /* default: anti_flood = 2000 ms, anti_flood_burst = 5 */
+
+    /* first refill: credit is full */
+    irc_server_anti_flood_refill (server);
+    LONGS_EQUAL(10000000, server->anti_flood_credit);
+
+    /* credit can not exceed the max */
+    irc_server_anti_flood_refill (server);
+    LONGS_EQUAL(10000000, server->anti_flood_credit);
+
+    /* empty credit, 3 seconds elapsed: refilled by ~3 seconds */
+    server->anti_flood_credit = 0;
+    gettimeofday (&now, NULL);
+    server->anti_flood_last_refill.tv_sec = now.tv_sec - 3;
+    server->anti_flood_last_refill.tv_usec = now.tv_usec;
+    irc_server_anti_flood_refill (server);
+    CHECK((server->anti_flood_credit >= 3000000)
+          && (server->anti_flood_credit < 4000000));
+
+    irc_server_free (server);
+}
+
 /*
  * Tests functions:
  *   irc_server_outqueue_timer_cb
@@ -1200,22 +1510,100 @@ TEST(IrcServer, Sendf)
 
 /*
  * Tests functions:
- *   irc_server_msgq_add_msg
+ *   irc_server_recv_buffer_free
+ *   irc_server_recv_buffer_reserve
+ *   irc_server_recv_buffer_add
+ *   irc_server_recv_buffer_pending
  */
 
-TEST(IrcServer, MsgqAddMsg)
+TEST(IrcServer, RecvBuffer)
 {
-    /* TODO: write tests */
-}
+    struct t_irc_server *server;
+    char *ptr_buffer, *ptr_old_buffer, *str;
 
-/*
- * Tests functions:
- *   irc_server_msgq_add_unterminated
- */
+    POINTERS_EQUAL(NULL, irc_server_recv_buffer_reserve (NULL, 10));
+    POINTERS_EQUAL(NULL, irc_server_recv_buffer_pending (NULL));
+    irc_server_recv_buffer_add (NULL, 10);
+    irc_server_recv_buffer_free (NULL);
 
-TEST(IrcServer, MsgqAddUnterminated)
-{
-    /* TODO: write tests */
+    server = irc_server_alloc ("server1");
+    CHECK(server);
+
+    POINTERS_EQUAL(NULL, server->recv_buffer);
+    POINTERS_EQUAL(NULL, irc_server_recv_buffer_pending (server));
+    POINTERS_EQUAL(NULL, irc_server_recv_buffer_reserve (server, -1));
+
+    /* first reserve: buffer is allocated */
+    ptr_buffer = irc_server_recv_buffer_reserve (server, 10);
+    CHECK(ptr_buffer);
+    POINTERS_EQUAL(server->recv_buffer, ptr_buffer);
+    LONGS_EQUAL(IRC_SERVER_RECV_BUFFER_SIZE, server->recv_buffer_size);
+
+    /* complete messages are split in place, "\r" are removed */
+    memcpy (ptr_buffer, "msg1\r\nm\rsg2\n\r\nmsg3", 18);
+    irc_server_recv_buffer_add (server, 18);
+    LONGS_EQUAL(0, server->recv_buffer_start);
+    LONGS_EQUAL(14, server->recv_buffer_parsed);
+    LONGS_EQUAL(18, server->recv_buffer_length);
+    STRCMP_EQUAL("msg1", server->recv_buffer);
+    STRCMP_EQUAL("msg2", server->recv_buffer + 6);
+    STRCMP_EQUAL("", server->recv_buffer + 12);
+    STRCMP_EQUAL("msg3", server->recv_buffer + 14);
+    str = irc_server_recv_buffer_pending (server);
+    STRCMP_EQUAL("msg1\nmsg2\nmsg3", str);
+    free (str);
+
+    /* message truncated on first '\0' received */
+    ptr_buffer = irc_server_recv_buffer_reserve (server, 8);
+    POINTERS_EQUAL(server->recv_buffer + 18, ptr_buffer);
+    memcpy (ptr_buffer, "a\0b\r\nmsg", 8);
+    irc_server_recv_buffer_add (server, 8);
+    LONGS_EQUAL(23, server->recv_buffer_parsed);
+    LONGS_EQUAL(26, server->recv_buffer_length);
+    STRCMP_EQUAL("msg3a", server->recv_buffer + 14);
+    STRCMP_EQUAL("", server->recv_buffer + 20);
+    str = irc_server_recv_buffer_pending (server);
+    STRCMP_EQUAL("msg1\nmsg2\nmsg3a\nmsg", str);
+    free (str);
+
+    /* messages processed are removed when buffer is full */
+    server->recv_buffer_start = 23;
+    ptr_old_buffer = server->recv_buffer;
+    ptr_buffer = irc_server_recv_buffer_reserve (
+        server, IRC_SERVER_RECV_BUFFER_SIZE - 10);
+    POINTERS_EQUAL(ptr_old_buffer, server->recv_buffer);
+    POINTERS_EQUAL(server->recv_buffer + 3, ptr_buffer);
+    LONGS_EQUAL(0, server->recv_buffer_start);
+    LONGS_EQUAL(0, server->recv_buffer_parsed);
+    LONGS_EQUAL(3, server->recv_buffer_length);
+    STRNCMP_EQUAL("msg", server->recv_buffer, 3);
+
+    /* buffer is enlarged if needed */
+    ptr_buffer = irc_server_recv_buffer_reserve (
+        server, IRC_SERVER_RECV_BUFFER_SIZE);
+    CHECK(ptr_buffer);
+    LONGS_EQUAL(IRC_SERVER_RECV_BUFFER_SIZE * 2, server->recv_buffer_size);
+    LONGS_EQUAL(3, server->recv_buffer_length);
+    STRNCMP_EQUAL("msg", server->recv_buffer, 3);
+
+    /* buffer used by message being processed is never moved in place */
+    server->recv_buffer_flush = server->recv_buffer;
+    ptr_old_buffer = server->recv_buffer;
+    server->recv_buffer_start = 1;
+    ptr_buffer = irc_server_recv_buffer_reserve (
+        server, IRC_SERVER_RECV_BUFFER_SIZE * 2 - 2);
+    CHECK(ptr_buffer);
+    CHECK(ptr_old_buffer != server->recv_buffer);
+    STRNCMP_EQUAL("msg", ptr_old_buffer, 3);
+    STRNCMP_EQUAL("sg", server->recv_buffer, 2);
+    irc_server_recv_buffer_free (server);
+    POINTERS_EQUAL(NULL, server->recv_buffer);
+    LONGS_EQUAL(0, server->recv_buffer_size);
+    LONGS_EQUAL(0, server->recv_buffer_length);
+    free (ptr_old_buffer);
+    server->recv_buffer_flush = NULL;
+
+    irc_server_free (server);
 }
 
 /*
@@ -1225,17 +1613,80 @@ TEST(IrcServer, MsgqAddUnterminated)
 
 TEST(IrcServer, MsgqAddBuffer)
 {
-    /* TODO: write tests */
+    struct t_irc_server *server;
+    char *str;
+
+    irc_server_msgq_add_buffer (NULL, NULL);
+
+    server = irc_server_alloc ("server1");
+    CHECK(server);
+
+    irc_server_msgq_add_buffer (server, NULL);
+    irc_server_msgq_add_buffer (server, "");
+    POINTERS_EQUAL(NULL, server->recv_buffer);
+
+    irc_server_msgq_add_buffer (server, "PING :a\r\nPIN");
+    irc_server_msgq_add_buffer (server, "G :b\n\r\nPING :c\r");
+    str = irc_server_recv_buffer_pending (server);
+    STRCMP_EQUAL("PING :a\nPING :b\nPING :c\r", str);
+    free (str);
+
+    irc_server_free (server);
 }
 
 /*
  * Tests functions:
+ *   irc_server_msgq_flush_server
+ *   irc_server_msgq_timer_add
  *   irc_server_msgq_flush
  */
 
 TEST(IrcServer, MsgqFlush)
 {
-    /* TODO: write tests */
+    struct t_irc_server *server;
+    char *str;
+
+    LONGS_EQUAL(0, irc_server_msgq_flush_server (NULL, 0));
+    irc_server_msgq_timer_add (NULL);
+
+    server = irc_server_alloc ("server1");
+    CHECK(server);
+
+    LONGS_EQUAL(0, irc_server_msgq_flush_server (server, 0));
+
+    /* messages are ignored if server is not connected */
+    irc_server_msgq_add_buffer (server, "XYZ a\r\nXYZ b\r\n");
+    LONGS_EQUAL(0, irc_server_msgq_flush_server (server, 1));
+    LONGS_EQUAL(0, server->recv_buffer_start);
+    LONGS_EQUAL(0, server->recv_buffer_length);
+
+    /* max number of messages processed */
+    server->fake_server = 1;
+    irc_server_msgq_add_buffer (server, "XYZ a\r\n\r\nXYZ b\r\nXYZ c\r\nXYZ");
+    LONGS_EQUAL(1, irc_server_msgq_flush_server (server, 2));
+    str = irc_server_recv_buffer_pending (server);
+    STRCMP_EQUAL("XYZ c\nXYZ", str);
+    free (str);
+
+    /* no message processed while a message is being processed */
+    server->recv_buffer_flush = server->recv_buffer;
+    LONGS_EQUAL(0, irc_server_msgq_flush_server (server, 0));
+    str = irc_server_recv_buffer_pending (server);
+    STRCMP_EQUAL("XYZ c\nXYZ", str);
+    free (str);
+    server->recv_buffer_flush = NULL;
+
+    irc_server_msgq_timer_add (server);
+    CHECK(server->hook_timer_msgq);
+
+    /* unterminated message is kept */
+    irc_server_msgq_flush ();
+    LONGS_EQUAL(23, server->recv_buffer_start);
+    LONGS_EQUAL(23, server->recv_buffer_parsed);
+    LONGS_EQUAL(26, server->recv_buffer_length);
+    STRCMP_EQUAL("XYZ", server->recv_buffer + 23);
+
+    irc_server_free (server);
 }
 
 /*
@@ -1729,3 +2180,52 @@ TEST(IrcServerConnected, BuildAutojoin)
     WEE_TEST_STR("#test1,#test2,#test3",
                  irc_server_build_autojoin (ptr_server));
 }
+
+/*
+ * Tests functions:
+ *   irc_server_print_batch_start
+ *   irc_server_print_batch_end
+ */
+
+TEST(IrcServerConnected, PrintBatch)
+{
+    struct t_irc_channel *ptr_channel1, *ptr_channel2;
+
+    LONGS_EQUAL(0, irc_server_print_batch_start (NULL));
+    irc_server_print_batch_end (NULL);
+
+    server_recv (":server 001 alice");
+    server_recv (":alice!user@host JOIN #test1");
+    ptr_channel1 = irc_channel_search (ptr_server, "#test1");
+    CHECK(ptr_channel1);
+
+    /* end of batch without start: ignored */
+    irc_server_print_batch_end (ptr_server);
+    POINTERS_EQUAL(NULL, ptr_server->buffer->lines_batch);
+    POINTERS_EQUAL(NULL, ptr_channel1->buffer->lines_batch);
+
+    LONGS_EQUAL(1, irc_server_print_batch_start (ptr_server));
+    LONGS_EQUAL(1, ptr_server->print_batch);
+    LONGS_EQUAL(1, ptr_channel1->print_batch);
+    CHECK(ptr_server->buffer->lines_batch);
+    CHECK(ptr_channel1->buffer->lines_batch);
+    LONGS_EQUAL(0, irc_server_print_batch_start (ptr_server));
+    LONGS_EQUAL(1, ptr_channel1->buffer->lines_batch->count);
+
+    /* channel created during the batch is not in batch */
+    server_recv (":alice!user@host JOIN #test2");
+    ptr_channel2 = irc_channel_search (ptr_server, "#test2");
+    CHECK(ptr_channel2);
+    LONGS_EQUAL(0, ptr_channel2->print_batch);
+    POINTERS_EQUAL(NULL, ptr_channel2->buffer->lines_batch);
+
+    server_recv (":bob!user@host JOIN #test1");
+    LONGS_EQUAL(1, ptr_channel1->buffer->lines_batch->nicklist_changed);
+
+    irc_server_print_batch_end (ptr_server);
+    LONGS_EQUAL(0, ptr_server->print_batch);
+    LONGS_EQUAL(0, ptr_channel1->print_batch);
+    POINTERS_EQUAL(NULL, ptr_server->buffer->lines_batch);
+    POINTERS_EQUAL(NULL, ptr_channel1->buffer->lines_batch);
+    POINTERS_EQUAL(NULL, ptr_channel2->buffer->lines_batch);
+}
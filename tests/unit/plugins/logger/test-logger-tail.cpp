@@ -34,6 +34,10 @@ extern "C"
 
 extern const char *logger_tail_last_eol (const char *string_start,
                                          const char *string_ptr);
+extern struct t_arraylist *logger_tail_file_read (const char *filename,
+                                                  int lines);
+extern struct t_arraylist *logger_tail_data (const char *data, size_t size,
+                                             int lines);
 }
 
 TEST_GROUP(LoggerTail)
@@ -68,6 +72,91 @@ TEST(LoggerTail, LastEol)
     POINTERS_EQUAL(str + 7, logger_tail_last_eol (str, str + 8));
     POINTERS_EQUAL(str + 7, logger_tail_last_eol (str, str + 9));
     POINTERS_EQUAL(str + 7, logger_tail_last_eol (str, str + 10));
+
+    /* long strings (search by words of 8 bytes) */
+    str = "0123456789abcdef\n0123456789abcdefghijklmnopqrstuvwxyz";
+    POINTERS_EQUAL(NULL, logger_tail_last_eol (str, str + 15));
+    POINTERS_EQUAL(str + 16, logger_tail_last_eol (str, str + 16));
+    POINTERS_EQUAL(str + 16, logger_tail_last_eol (str, str + 17));
+    POINTERS_EQUAL(str + 16, logger_tail_last_eol (str, str + 24));
+    POINTERS_EQUAL(str + 16, logger_tail_last_eol (str, str + 52));
+    str = "\r0123456789abcdefghijklmnopqrstuvwxyz";
+    POINTERS_EQUAL(str, logger_tail_last_eol (str, str + 36));
+    POINTERS_EQUAL(NULL, logger_tail_last_eol (str + 1, str + 36));
+}
+
+/*
+ * Tests functions:
+ *   logger_tail_data
+ */
+
+TEST(LoggerTail, Data)
+{
+    const char *data;
+    struct t_arraylist *lines;
+
+    POINTERS_EQUAL(NULL, logger_tail_data (NULL, 0, 1));
+    POINTERS_EQUAL(NULL, logger_tail_data ("abc", 3, 0));
+
+    lines = logger_tail_data ("", 0, 1);
+    CHECK(lines);
+    LONGS_EQUAL(0, arraylist_size (lines));
+    arraylist_free (lines);
+
+    lines = logger_tail_data ("\n", 1, 1);
+    CHECK(lines);
+    LONGS_EQUAL(0, arraylist_size (lines));
+    arraylist_free (lines);
+
+    /* no new line at the end */
+    data = "line 1\nline 2";
+    lines = logger_tail_data (data, strlen (data), 1);
+    CHECK(lines);
+    LONGS_EQUAL(1, arraylist_size (lines));
+    STRCMP_EQUAL("line 2", (const char *)arraylist_get (lines, 0));
+    arraylist_free (lines);
+    lines = logger_tail_data (data, strlen (data), 10);
+    CHECK(lines);
+    LONGS_EQUAL(2, arraylist_size (lines));
+    STRCMP_EQUAL("line 1", (const char *)arraylist_get (lines, 0));
+    STRCMP_EQUAL("line 2", (const char *)arraylist_get (lines, 1));
+    arraylist_free (lines);
+
+    /* "\r" is an end of line, empty first line */
+    data = "\nline 1\rline 2 is a long line\n";
+    lines = logger_tail_data (data, strlen (data), 2);
+    CHECK(lines);
+    LONGS_EQUAL(2, arraylist_size (lines));
+    STRCMP_EQUAL("line 1", (const char *)arraylist_get (lines, 0));
+    STRCMP_EQUAL("line 2 is a long line",
+                 (const char *)arraylist_get (lines, 1));
+    arraylist_free (lines);
+    /* empty line before the first new line is ignored */
+    lines = logger_tail_data (data, strlen (data), 3);
+    CHECK(lines);
+    LONGS_EQUAL(2, arraylist_size (lines));
+    STRCMP_EQUAL("line 1", (const char *)arraylist_get (lines, 0));
+    STRCMP_EQUAL("line 2 is a long line",
+                 (const char *)arraylist_get (lines, 1));
+    arraylist_free (lines);
+
+    /* only one empty line before the first new line is ignored */
+    data = "\n\nline 1\n";
+    lines = logger_tail_data (data, strlen (data), 3);
+    CHECK(lines);
+    LONGS_EQUAL(2, arraylist_size (lines));
+    STRCMP_EQUAL("", (const char *)arraylist_get (lines, 0));
+    STRCMP_EQUAL("line 1", (const char *)arraylist_get (lines, 1));
+    arraylist_free (lines);
+
+    /* data is not NUL-terminated: only "size" bytes are read */
+    data = "line 1\nline 2\nline 3";
+    lines = logger_tail_data (data, 13, 5);
+    CHECK(lines);
+    LONGS_EQUAL(2, arraylist_size (lines));
+    STRCMP_EQUAL("line 1", (const char *)arraylist_get (lines, 0));
+    STRCMP_EQUAL("line 2", (const char *)arraylist_get (lines, 1));
+    arraylist_free (lines);
 }
 
 /*
@@ -75,6 +164,7 @@ TEST(LoggerTail, LastEol)
  *   logger_tail_lines_cmp_cb
  *   logger_tail_lines_free_cb
  *   logger_tail_file
+ *   logger_tail_file_read
  */
 
 TEST(LoggerTail, File)
@@ -343,6 +433,40 @@ TEST(LoggerTail, File)
     STRCMP_EQUAL("", (const char *)arraylist_get (lines, 1999));
     arraylist_free (lines);
 
+    /* read by blocks (without mapping file in memory): same lines */
+    lines = logger_tail_file_read (filename, 3);
+    CHECK(lines);
+    LONGS_EQUAL(3, arraylist_size (lines));
+    STRCMP_EQUAL("", (const char *)arraylist_get (lines, 0));
+    STRCMP_EQUAL("this is a test, line 1000", (const char *)arraylist_get (lines, 1));
+    STRCMP_EQUAL("", (const char *)arraylist_get (lines, 2));
+    arraylist_free (lines);
+
+    unlink (filename);
+    free (filename);
+
+    /* write a small test file, starting with empty lines */
+    filename = string_eval_path_home ("${weechat_data_dir}/test_file.txt",
+                                      NULL, NULL, NULL);
+    file = fopen (filename, "w");
+    fwrite ("\n\nline 1\n", 1, 9, file);
+    fflush (file);
+    fclose (file);
+
+    /* mapped in memory or read by blocks: same lines */
+    lines = logger_tail_file (filename, 10);
+    CHECK(lines);
+    LONGS_EQUAL(2, arraylist_size (lines));
+    STRCMP_EQUAL("", (const char *)arraylist_get (lines, 0));
+    STRCMP_EQUAL("line 1", (const char *)arraylist_get (lines, 1));
+    arraylist_free (lines);
+    lines = logger_tail_file_read (filename, 10);
+    CHECK(lines);
+    LONGS_EQUAL(2, arraylist_size (lines));
+    STRCMP_EQUAL("", (const char *)arraylist_get (lines, 0));
+    STRCMP_EQUAL("line 1", (const char *)arraylist_get (lines, 1));
+    arraylist_free (lines);
+
     unlink (filename);
     free (filename);
 }
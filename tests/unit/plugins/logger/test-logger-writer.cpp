@@ -0,0 +1,122 @@
+/*
+ * test-logger-writer.cpp - test logger writer thread functions
+ *
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include "tests/tests.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "src/plugins/logger/logger-buffer.h"
+#include "src/plugins/logger/logger-config.h"
+#include "src/plugins/logger/logger-writer.h"
+}
+
+TEST_GROUP(LoggerWriter)
+{
+};
+
+/*
+ * Tests functions:
+ *   logger_writer_start
+ *   logger_writer_add
+ *   logger_writer_wake_up
+ *   logger_writer_sync
+ *   logger_writer_rotate_needed
+ *   logger_writer_stop
+ */
+
+TEST(LoggerWriter, Write)
+{
+    struct t_logger_buffer logger_buffer;
+    unsigned long long old_rotation_size_max;
+    char content[256], *line;
+    size_t size;
+    int i;
+
+    memset (&logger_buffer, 0, sizeof (logger_buffer));
+    logger_buffer.log_file = tmpfile ();
+    CHECK(logger_buffer.log_file);
+
+    /* writer thread not running */
+    LONGS_EQUAL(0, logger_writer_running);
+    line = strdup ("test");
+    LONGS_EQUAL(0, logger_writer_add (&logger_buffer, line, 1));
+    free (line);
+    logger_writer_wake_up ();
+    logger_writer_sync ();
+    LONGS_EQUAL(0, logger_writer_rotate_needed ());
+    logger_writer_stop ();
+
+    LONGS_EQUAL(1, logger_writer_start ());
+    LONGS_EQUAL(1, logger_writer_running);
+    LONGS_EQUAL(1, logger_writer_start ());
+
+    LONGS_EQUAL(0, logger_writer_add (NULL, NULL, 1));
+    LONGS_EQUAL(0, logger_writer_add (&logger_buffer, NULL, 1));
+
+    /* lines written after sync */
+    old_rotation_size_max = logger_config_rotation_size_max;
+    logger_config_rotation_size_max = 0;
+    LONGS_EQUAL(1, logger_writer_add (&logger_buffer, strdup ("line 1"), 0));
+    LONGS_EQUAL(1, logger_writer_add (&logger_buffer, strdup ("line 2"), 0));
+    logger_writer_wake_up ();
+    LONGS_EQUAL(1, logger_writer_add (&logger_buffer, strdup ("line 3"), 1));
+    logger_writer_sync ();
+    LONGS_EQUAL(0, logger_writer_rotate_needed ());
+    LONGS_EQUAL(0, logger_buffer.rotate_needed);
+    LONGS_EQUAL(0, logger_buffer.writer_flush_needed);
+
+    rewind (logger_buffer.log_file);
+    size = fread (content, 1, sizeof (content) - 1, logger_buffer.log_file);
+    content[size] = '\0';
+    STRCMP_EQUAL("line 1\nline 2\nline 3\n", content);
+
+    /* rotation asked when file is bigger than max size */
+    logger_config_rotation_size_max = 30;
+    for (i = 0; i < 3; i++)
+    {
+        LONGS_EQUAL(1, logger_writer_add (&logger_buffer,
+                                          strdup ("0123456789"), 0));
+    }
+    logger_writer_sync ();
+    LONGS_EQUAL(1, logger_buffer.rotate_needed);
+    LONGS_EQUAL(1, logger_writer_rotate_needed ());
+    LONGS_EQUAL(0, logger_writer_rotate_needed ());
+    logger_config_rotation_size_max = old_rotation_size_max;
+
+    /* pending lines are written when thread is stopped */
+    LONGS_EQUAL(1, logger_writer_add (&logger_buffer, strdup ("end"), 0));
+    logger_writer_stop ();
+    LONGS_EQUAL(0, logger_writer_running);
+
+    rewind (logger_buffer.log_file);
+    size = fread (content, 1, sizeof (content) - 1, logger_buffer.log_file);
+    content[size] = '\0';
+    STRCMP_EQUAL("line 1\nline 2\nline 3\n"
+                 "0123456789\n0123456789\n0123456789\nend\n",
+                 content);
+
+    fclose (logger_buffer.log_file);
+}
@@ -0,0 +1,361 @@
+/*
+ * test-relay-client.cpp - test client functions
+ *
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include "tests/tests.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include "src/core/core-config-file.h"
+#include "src/plugins/relay/relay.h"
+#include "src/plugins/relay/relay-client.h"
+#include "src/plugins/relay/relay-config.h"
+#include "src/plugins/relay/relay-server.h"
+
+extern void relay_client_outqueue_free_all (struct t_relay_client *client);
+extern void relay_client_send_outqueue (struct t_relay_client *client);
+}
+
+#define RELAY_CLIENT_TEST_DATA_SIZE (1024 * 1024)
+
+TEST_GROUP(RelayClient)
+{
+};
+
+TEST_GROUP(RelayClientWithSocket)
+{
+    struct t_relay_server *ptr_relay_server = NULL;
+    struct t_relay_client *ptr_client[2] = { NULL, NULL };
+    int sock_peer[2] = { -1, -1 };
+    char *data = NULL;
+    char *data_recv = NULL;
+    int size_recv = 0;
+
+    /*
+     * Creates a client with a non-blocking socket connected to a peer
+     * (the socket buffer is small, so that a big message is partially sent).
+     *
+     * Note: messages are sent with a short message for raw buffer, to not
+     * display the big data in raw buffer.
+     */
+
+    struct t_relay_client *client_new (int index)
+    {
+        struct t_relay_client *client;
+        int sv[2], size;
+
+        if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+            return NULL;
+        size = 4096;
+        setsockopt (sv[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof (size));
+        fcntl (sv[0], F_SETFL, fcntl (sv[0], F_GETFL) | O_NONBLOCK);
+        fcntl (sv[1], F_SETFL, fcntl (sv[1], F_GETFL) | O_NONBLOCK);
+
+        /* create client without socket (no fd hook), then set socket */
+        client = relay_client_new (-1, "test", ptr_relay_server);
+        if (!client)
+        {
+            close (sv[0]);
+            close (sv[1]);
+            return NULL;
+        }
+        client->sock = sv[0];
+        sock_peer[index] = sv[1];
+
+        return client;
+    }
+
+    /*
+     * Reads all data available on the peer socket of a client.
+     *
+     * Returns number of bytes read.
+     */
+
+    int peer_read (int index)
+    {
+        int num_read, total;
+
+        total = 0;
+        while (size_recv < RELAY_CLIENT_TEST_DATA_SIZE * 2)
+        {
+            num_read = read (sock_peer[index], data_recv + size_recv,
+                             (RELAY_CLIENT_TEST_DATA_SIZE * 2) - size_recv);
+            if (num_read <= 0)
+                break;
+            size_recv += num_read;
+            total += num_read;
+        }
+        return total;
+    }
+
+    void setup ()
+    {
+        int i;
+
+        /* disable auto-open of relay buffer */
+        config_file_option_set (relay_config_look_auto_open_buffer, "off", 1);
+
+        ptr_relay_server = relay_server_new (
+            "weechat",
+            RELAY_PROTOCOL_WEECHAT,
+            NULL,
+            9002,
+            NULL,  /* path */
+            1,  /* ipv4 */
+            0,  /* ipv6 */
+            0,  /* tls */
+            0);  /* unix_socket */
+
+        data = (char *)malloc (RELAY_CLIENT_TEST_DATA_SIZE);
+        for (i = 0; i < RELAY_CLIENT_TEST_DATA_SIZE; i++)
+        {
+            data[i] = 'a' + (i % 26);
+        }
+        data_recv = (char *)malloc (RELAY_CLIENT_TEST_DATA_SIZE * 2);
+        size_recv = 0;
+    }
+
+    void teardown ()
+    {
+        int i;
+
+        for (i = 0; i < 2; i++)
+        {
+            if (ptr_client[i])
+            {
+                close (ptr_client[i]->sock);
+                ptr_client[i]->sock = -1;
+                relay_client_free (ptr_client[i]);
+                ptr_client[i] = NULL;
+            }
+            if (sock_peer[i] >= 0)
+            {
+                close (sock_peer[i]);
+                sock_peer[i] = -1;
+            }
+        }
+
+        relay_server_free (ptr_relay_server);
+        ptr_relay_server = NULL;
+
+        free (data);
+        data = NULL;
+        free (data_recv);
+        data_recv = NULL;
+
+        /* restore auto-open of relay buffer */
+        config_file_option_reset (relay_config_look_auto_open_buffer, 1);
+    }
+};
+
+/*
+ * Tests functions:
+ *   relay_client_outqueue_data_new
+ *   relay_client_outqueue_data_unref
+ */
+
+TEST(RelayClient, OutqueueDataNewUnref)
+{
+    struct t_relay_client_outqueue_data *outqueue_data;
+
+    POINTERS_EQUAL(NULL, relay_client_outqueue_data_new (NULL, 0));
+    POINTERS_EQUAL(NULL, relay_client_outqueue_data_new ("abc", 0));
+    POINTERS_EQUAL(NULL, relay_client_outqueue_data_new ("abc", -1));
+
+    relay_client_outqueue_data_unref (NULL);
+
+    outqueue_data = relay_client_outqueue_data_new ("abc", 3);
+    CHECK(outqueue_data);
+    MEMCMP_EQUAL("abc", outqueue_data->data, 3);
+    LONGS_EQUAL(3, outqueue_data->data_size);
+    LONGS_EQUAL(1, outqueue_data->refcount);
+
+    outqueue_data->refcount++;
+    relay_client_outqueue_data_unref (outqueue_data);
+    LONGS_EQUAL(1, outqueue_data->refcount);
+    relay_client_outqueue_data_unref (outqueue_data);
+}
+
+/*
+ * Tests functions:
+ *   relay_client_send
+ *   relay_client_send_outqueue
+ */
+
+TEST(RelayClientWithSocket, SendShortWrite)
+{
+    int num_sent;
+
+    ptr_client[0] = client_new (0);
+    CHECK(ptr_client[0]);
+
+    /* short write: remaining data (not shared) is copied in out queue */
+    num_sent = relay_client_send (ptr_client[0], RELAY_MSG_STANDARD,
+                                  data, RELAY_CLIENT_TEST_DATA_SIZE, "data");
+    CHECK(num_sent > 0);
+    CHECK(num_sent < RELAY_CLIENT_TEST_DATA_SIZE);
+    CHECK(ptr_client[0]->outqueue);
+    POINTERS_EQUAL(ptr_client[0]->outqueue, ptr_client[0]->last_outqueue);
+    LONGS_EQUAL(0, ptr_client[0]->outqueue->offset);
+    LONGS_EQUAL(RELAY_CLIENT_TEST_DATA_SIZE - num_sent,
+                ptr_client[0]->outqueue->data->data_size);
+    LONGS_EQUAL(1, ptr_client[0]->outqueue->data->refcount);
+    LONGS_EQUAL(num_sent, ptr_client[0]->bytes_sent);
+
+    /* a second message is queued after the first one */
+    LONGS_EQUAL(-1, relay_client_send (ptr_client[0], RELAY_MSG_STANDARD,
+                                       "end", 3, "end"));
+    CHECK(ptr_client[0]->outqueue->next_outqueue);
+    POINTERS_EQUAL(ptr_client[0]->outqueue->next_outqueue,
+                   ptr_client[0]->last_outqueue);
+
+    /* read data on peer and send out queue until it is empty */
+    while (ptr_client[0]->outqueue)
+    {
+        CHECK(peer_read (0) > 0);
+        relay_client_send_outqueue (ptr_client[0]);
+    }
+    peer_read (0);
+
+    LONGS_EQUAL(RELAY_CLIENT_TEST_DATA_SIZE + 3, size_recv);
+    MEMCMP_EQUAL(data, data_recv, RELAY_CLIENT_TEST_DATA_SIZE);
+    MEMCMP_EQUAL("end", data_recv + RELAY_CLIENT_TEST_DATA_SIZE, 3);
+    LONGS_EQUAL(RELAY_CLIENT_TEST_DATA_SIZE + 3, ptr_client[0]->bytes_sent);
+    POINTERS_EQUAL(NULL, ptr_client[0]->last_outqueue);
+    POINTERS_EQUAL(NULL, ptr_client[0]->hook_timer_send);
+}
+
+/*
+ * Tests functions:
+ *   relay_client_send_shared
+ *   relay_client_send_outqueue
+ */
+
+TEST(RelayClientWithSocket, SendSharedResumeOffset)
+{
+    struct t_relay_client_outqueue_data *shared_data;
+    int num_sent, offset;
+
+    ptr_client[0] = client_new (0);
+    CHECK(ptr_client[0]);
+
+    /* short write: data is shared, the offset is the number of bytes sent */
+    shared_data = NULL;
+    num_sent = relay_client_send_shared (ptr_client[0], RELAY_MSG_STANDARD,
+                                         data, RELAY_CLIENT_TEST_DATA_SIZE,
+                                         "data", &shared_data);
+    CHECK(num_sent > 0);
+    CHECK(num_sent < RELAY_CLIENT_TEST_DATA_SIZE);
+    CHECK(shared_data);
+    LONGS_EQUAL(2, shared_data->refcount);
+    LONGS_EQUAL(RELAY_CLIENT_TEST_DATA_SIZE, shared_data->data_size);
+    CHECK(ptr_client[0]->outqueue);
+    POINTERS_EQUAL(shared_data, ptr_client[0]->outqueue->data);
+    LONGS_EQUAL(num_sent, ptr_client[0]->outqueue->offset);
+
+    /* nothing read on peer: nothing sent, offset is unchanged */
+    relay_client_send_outqueue (ptr_client[0]);
+    LONGS_EQUAL(num_sent, ptr_client[0]->outqueue->offset);
+
+    /* each send resumes from the offset */
+    offset = ptr_client[0]->outqueue->offset;
+    CHECK(peer_read (0) > 0);
+    relay_client_send_outqueue (ptr_client[0]);
+    CHECK(ptr_client[0]->outqueue);
+    CHECK(ptr_client[0]->outqueue->offset > offset);
+    LONGS_EQUAL(ptr_client[0]->outqueue->offset,
+                ptr_client[0]->bytes_sent);
+
+    while (ptr_client[0]->outqueue)
+    {
+        CHECK(peer_read (0) > 0);
+        relay_client_send_outqueue (ptr_client[0]);
+    }
+    peer_read (0);
+
+    LONGS_EQUAL(RELAY_CLIENT_TEST_DATA_SIZE, size_recv);
+    MEMCMP_EQUAL(data, data_recv, RELAY_CLIENT_TEST_DATA_SIZE);
+
+    /* reference of out queue has been removed */
+    LONGS_EQUAL(1, shared_data->refcount);
+    relay_client_outqueue_data_unref (shared_data);
+}
+
+/*
+ * Tests functions:
+ *   relay_client_send_shared
+ *   relay_client_outqueue_free_all
+ *   relay_client_outqueue_data_unref
+ */
+
+TEST(RelayClientWithSocket, SendSharedFree)
+{
+    struct t_relay_client_outqueue_data *shared_data;
+    int num_sent[2], i;
+
+    ptr_client[0] = client_new (0);
+    CHECK(ptr_client[0]);
+    ptr_client[1] = client_new (1);
+    CHECK(ptr_client[1]);
+
+    /* same data queued for two clients, without copy */
+    shared_data = NULL;
+    for (i = 0; i < 2; i++)
+    {
+        num_sent[i] = relay_client_send_shared (ptr_client[i],
+                                                RELAY_MSG_STANDARD,
+                                                data,
+                                                RELAY_CLIENT_TEST_DATA_SIZE,
+                                                "data", &shared_data);
+        CHECK(num_sent[i] > 0);
+        CHECK(num_sent[i] < RELAY_CLIENT_TEST_DATA_SIZE);
+        POINTERS_EQUAL(shared_data, ptr_client[i]->outqueue->data);
+        LONGS_EQUAL(num_sent[i], ptr_client[i]->outqueue->offset);
+    }
+    LONGS_EQUAL(3, shared_data->refcount);
+
+    /* owner removes its reference: data is still queued for clients */
+    relay_client_outqueue_data_unref (shared_data);
+    LONGS_EQUAL(2, shared_data->refcount);
+
+    /* out queue of first client is freed: data is kept for second client */
+    relay_client_outqueue_free_all (ptr_client[0]);
+    POINTERS_EQUAL(NULL, ptr_client[0]->outqueue);
+    POINTERS_EQUAL(NULL, ptr_client[0]->last_outqueue);
+    LONGS_EQUAL(1, shared_data->refcount);
+
+    /* second client still sends the whole data (freed when sent) */
+    while (ptr_client[1]->outqueue)
+    {
+        CHECK(peer_read (1) > 0);
+        relay_client_send_outqueue (ptr_client[1]);
+    }
+    peer_read (1);
+
+    LONGS_EQUAL(RELAY_CLIENT_TEST_DATA_SIZE, size_recv);
+    MEMCMP_EQUAL(data, data_recv, RELAY_CLIENT_TEST_DATA_SIZE);
+}
@@ -0,0 +1,237 @@
+/*
+ * test-relay-weechat-msg.cpp - test relay WeeChat protocol (messages)
+ *
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-line.h"
+#include "src/plugins/relay/relay.h"
+#include "src/plugins/relay/relay-client.h"
+#include "src/plugins/relay/weechat/relay-weechat.h"
+#include "src/plugins/relay/weechat/relay-weechat-msg.h"
+
+extern int relay_weechat_msg_compress_zlib (struct t_relay_weechat_msg *msg);
+extern int relay_weechat_msg_compress_zstd (struct t_relay_weechat_msg *msg);
+}
+
+#define RELAY_WEECHAT_MSG_LINES 2000
+
+TEST_GROUP(RelayWeechatMsg)
+{
+};
+
+/*
+ * Builds a message "_buffer_line_added" with the last line of core buffer.
+ */
+
+struct t_relay_weechat_msg *
+test_relay_weechat_msg_line_added ()
+{
+    struct t_relay_weechat_msg *msg;
+    char cmd_hdata[64];
+
+    msg = relay_weechat_msg_new ("_buffer_line_added");
+    if (!msg)
+        return NULL;
+    snprintf (cmd_hdata, sizeof (cmd_hdata),
+              "line_data:0x%lx",
+              (unsigned long)gui_buffers->own_lines->last_line->data);
+    relay_weechat_msg_add_hdata (
+        msg, cmd_hdata,
+        "buffer,id,date,date_usec,date_printed,date_usec_printed,"
+        "displayed,notify_level,highlight,tags_array,prefix,message");
+    return msg;
+}
+
+/*
+ * Tests functions:
+ *   relay_weechat_msg_compress_zstd_stream
+ */
+
+TEST(RelayWeechatMsg, CompressZstdStream)
+{
+#ifdef HAVE_ZSTD
+    struct t_relay_weechat_msg *msg;
+    ZSTD_CCtx *cctx;
+    ZSTD_DCtx *dctx;
+    ZSTD_inBuffer input;
+    ZSTD_outBuffer output;
+    char *data, raw_message[1024], buffer[4096];
+    int i, size;
+
+    cctx = ZSTD_createCCtx ();
+    CHECK(cctx);
+    dctx = ZSTD_createDCtx ();
+    CHECK(dctx);
+
+    POINTERS_EQUAL(NULL,
+                   relay_weechat_msg_compress_zstd_stream (NULL, cctx, &size,
+                                                           NULL, 0));
+
+    for (i = 0; i < 4; i++)
+    {
+        if (i == 2)
+        {
+            /* stream reset (message sent with another flag): new frame */
+            ZSTD_CCtx_reset (cctx, ZSTD_reset_session_only);
+            ZSTD_DCtx_reset (dctx, ZSTD_reset_session_only);
+        }
+        gui_chat_printf (NULL, "test zstd stream, message %d", i);
+        msg = test_relay_weechat_msg_line_added ();
+        CHECK(msg);
+        data = relay_weechat_msg_compress_zstd_stream (msg, cctx, &size,
+                                                       raw_message,
+                                                       sizeof (raw_message));
+        CHECK(data);
+        CHECK(size > 5);
+        LONGS_EQUAL(RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM, data[4]);
+        STRNCMP_EQUAL("obj: ", raw_message, 5);
+
+        /* each message can be decompressed when received (stream flushed) */
+        input.src = data + 5;
+        input.size = size - 5;
+        input.pos = 0;
+        output.dst = buffer;
+        output.size = sizeof (buffer);
+        output.pos = 0;
+        CHECK(!ZSTD_isError (ZSTD_decompressStream (dctx, &output, &input)));
+        LONGS_EQUAL(size - 5, input.pos);
+        LONGS_EQUAL(msg->data_size - 5, output.pos);
+        MEMCMP_EQUAL(msg->data + 5, buffer, output.pos);
+
+        free (data);
+        relay_weechat_msg_free (msg);
+    }
+
+    ZSTD_freeDCtx (dctx);
+    ZSTD_freeCCtx (cctx);
+#endif /* HAVE_ZSTD */
+}
+
+/*
+ * Tests functions:
+ *   relay_weechat_msg_compress_zlib
+ *   relay_weechat_msg_compress_zstd
+ *   relay_weechat_msg_compress_zstd_stream
+ *
+ * Compares the size of a stream of lines, with each compression, and checks
+ * that the stream gives back the original messages (with a change of
+ * compression level in the middle of the stream).
+ */
+
+TEST(RelayWeechatMsg, CompressStreamOfLines)
+{
+    struct t_relay_weechat_msg *msgs[RELAY_WEECHAT_MSG_LINES];
+    long long bytes_raw, bytes_zlib, bytes_zstd, bytes_stream;
+    char *data;
+    int i, size;
+#ifdef HAVE_ZSTD
+    ZSTD_CCtx *cctx;
+    ZSTD_DCtx *dctx;
+    ZSTD_inBuffer input;
+    ZSTD_outBuffer output;
+    char buffer[4096];
+#endif
+
+    bytes_raw = 0;
+    for (i = 0; i < RELAY_WEECHAT_MSG_LINES; i++)
+    {
+        gui_chat_printf_date_tags (
+            NULL, 0, "irc_privmsg,notify_message,prefix_nick_cyan,"
+            "nick_alice,host_~alice@example.com,log1",
+            "alice\tmessage %d: hello, this is a typical line displayed "
+            "in a channel, with some text", i);
+        msgs[i] = test_relay_weechat_msg_line_added ();
+        CHECK(msgs[i]);
+        bytes_raw += msgs[i]->data_size;
+    }
+
+    bytes_zlib = 0;
+    for (i = 0; i < RELAY_WEECHAT_MSG_LINES; i++)
+    {
+        relay_weechat_msg_compress_zlib (msgs[i]);
+        bytes_zlib += (msgs[i]->compressed_size[RELAY_WEECHAT_COMPRESSION_ZLIB] > 0) ?
+            msgs[i]->compressed_size[RELAY_WEECHAT_COMPRESSION_ZLIB] :
+            msgs[i]->data_size;
+    }
+    CHECK(bytes_zlib <= bytes_raw);
+
+#ifdef HAVE_ZSTD
+    bytes_zstd = 0;
+    for (i = 0; i < RELAY_WEECHAT_MSG_LINES; i++)
+    {
+        relay_weechat_msg_compress_zstd (msgs[i]);
+        bytes_zstd += (msgs[i]->compressed_size[RELAY_WEECHAT_COMPRESSION_ZSTD] > 0) ?
+            msgs[i]->compressed_size[RELAY_WEECHAT_COMPRESSION_ZSTD] :
+            msgs[i]->data_size;
+    }
+    CHECK(bytes_zstd <= bytes_raw);
+
+    bytes_stream = 0;
+    cctx = ZSTD_createCCtx ();
+    CHECK(cctx);
+    dctx = ZSTD_createDCtx ();
+    CHECK(dctx);
+    ZSTD_CCtx_setParameter (cctx, ZSTD_c_compressionLevel, 4);
+    for (i = 0; i < RELAY_WEECHAT_MSG_LINES; i++)
+    {
+        if (i == RELAY_WEECHAT_MSG_LINES / 2)
+            ZSTD_CCtx_setParameter (cctx, ZSTD_c_compressionLevel, 10);
+        data = relay_weechat_msg_compress_zstd_stream (msgs[i], cctx, &size,
+                                                       NULL, 0);
+        CHECK(data);
+        bytes_stream += size;
+        input.src = data + 5;
+        input.size = size - 5;
+        input.pos = 0;
+        output.dst = buffer;
+        output.size = sizeof (buffer);
+        output.pos = 0;
+        CHECK(!ZSTD_isError (ZSTD_decompressStream (dctx, &output, &input)));
+        LONGS_EQUAL(size - 5, input.pos);
+        LONGS_EQUAL(msgs[i]->data_size - 5, output.pos);
+        MEMCMP_EQUAL(msgs[i]->data + 5, buffer, output.pos);
+        free (data);
+    }
+    ZSTD_freeDCtx (dctx);
+    ZSTD_freeCCtx (cctx);
+
+    /* the stream must compress better than independent messages */
+    CHECK(bytes_stream < bytes_zlib);
+    CHECK(bytes_stream < bytes_zstd);
+#else
+    (void) bytes_zstd;
+    (void) bytes_stream;
+    (void) data;
+    (void) size;
+#endif /* HAVE_ZSTD */
+
+    for (i = 0; i < RELAY_WEECHAT_MSG_LINES; i++)
+    {
+        relay_weechat_msg_free (msgs[i]);
+    }
+}
@@ -0,0 +1,318 @@
+/*
+ * test-relay-weechat.cpp - test weechat protocol (general functions)
+ *
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include "tests/tests.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <string.h>
+#include "src/core/core-config-file.h"
+#include "src/core/core-hashtable.h"
+#include "src/gui/gui-buffer.h"
+#include "src/plugins/relay/relay.h"
+#include "src/plugins/relay/relay-client.h"
+#include "src/plugins/relay/relay-config.h"
+#include "src/plugins/relay/relay-server.h"
+#include "src/plugins/relay/weechat/relay-weechat.h"
+#include "src/plugins/relay/weechat/relay-weechat-protocol.h"
+}
+
+#define RELAY_WEECHAT_TEST_CLIENTS 3
+
+struct t_relay_client *relay_weechat_test_clients[RELAY_WEECHAT_TEST_CLIENTS];
+char *relay_weechat_test_data_sent[RELAY_WEECHAT_TEST_CLIENTS];
+int relay_weechat_test_size_sent[RELAY_WEECHAT_TEST_CLIENTS];
+int relay_weechat_test_count_sent[RELAY_WEECHAT_TEST_CLIENTS];
+
+/*
+ * clients disconnected when the first client (in list of clients) receives
+ * a message
+ */
+struct t_relay_client *relay_weechat_test_client_disconnect[2];
+
+TEST_GROUP(RelayWeechat)
+{
+    struct t_relay_server *ptr_relay_server = NULL;
+    struct t_gui_buffer *buffer = NULL;
+
+    /*
+     * Searches index of a test client.
+     *
+     * Returns index of client, -1 if not found.
+     */
+
+    static int client_index (void *client)
+    {
+        int i;
+
+        for (i = 0; i < RELAY_WEECHAT_TEST_CLIENTS; i++)
+        {
+            if (relay_weechat_test_clients[i] == client)
+                return i;
+        }
+        return -1;
+    }
+
+    static void fake_send_func (void *client, const char *data, int data_size)
+    {
+        int i, index;
+
+        index = client_index (client);
+        if (index < 0)
+            return;
+
+        free (relay_weechat_test_data_sent[index]);
+        relay_weechat_test_data_sent[index] = (char *)malloc (data_size);
+        memcpy (relay_weechat_test_data_sent[index], data, data_size);
+        relay_weechat_test_size_sent[index] = data_size;
+        relay_weechat_test_count_sent[index]++;
+
+        /* disconnect clients while the message is sent to all clients */
+        if (client == relay_clients)
+        {
+            for (i = 0; i < 2; i++)
+            {
+                if (relay_weechat_test_client_disconnect[i])
+                {
+                    relay_client_set_status (
+                        relay_weechat_test_client_disconnect[i],
+                        RELAY_STATUS_DISCONNECTED);
+                    relay_weechat_test_client_disconnect[i] = NULL;
+                }
+            }
+        }
+    }
+
+    void clear_data_sent ()
+    {
+        int i;
+
+        for (i = 0; i < RELAY_WEECHAT_TEST_CLIENTS; i++)
+        {
+            free (relay_weechat_test_data_sent[i]);
+            relay_weechat_test_data_sent[i] = NULL;
+            relay_weechat_test_size_sent[i] = 0;
+            relay_weechat_test_count_sent[i] = 0;
+        }
+    }
+
+    void sync_buffer (int index, const char *full_name)
+    {
+        int flags;
+
+        flags = RELAY_WEECHAT_PROTOCOL_SYNC_ALL;
+        hashtable_set (
+            RELAY_WEECHAT_DATA(relay_weechat_test_clients[index], buffers_sync),
+            full_name, &flags);
+    }
+
+    void setup ()
+    {
+        struct t_relay_client *ptr_client, *clients[RELAY_WEECHAT_TEST_CLIENTS];
+        int i;
+
+        /* disable auto-open of relay buffer */
+        config_file_option_set (relay_config_look_auto_open_buffer, "off", 1);
+
+        /* buffer synchronized by clients (messages are sent for its title) */
+        buffer = gui_buffer_new_user ("test", GUI_BUFFER_TYPE_FORMATTED);
+
+        ptr_relay_server = relay_server_new (
+            "weechat",
+            RELAY_PROTOCOL_WEECHAT,
+            NULL,
+            9003,
+            NULL,  /* path */
+            1,  /* ipv4 */
+            0,  /* ipv6 */
+            0,  /* tls */
+            0);  /* unix_socket */
+
+        for (i = 0; i < RELAY_WEECHAT_TEST_CLIENTS; i++)
+        {
+            relay_weechat_test_clients[i] = relay_client_new (
+                -1, "test", ptr_relay_server);
+            relay_weechat_test_clients[i]->fake_send_func = &fake_send_func;
+            RELAY_WEECHAT_DATA(relay_weechat_test_clients[i], compression) =
+                RELAY_WEECHAT_COMPRESSION_OFF;
+            relay_weechat_test_data_sent[i] = NULL;
+        }
+
+        /* sort clients like in list (first client receives messages first) */
+        i = 0;
+        for (ptr_client = relay_clients; ptr_client;
+             ptr_client = ptr_client->next_client)
+        {
+            if (client_index (ptr_client) >= 0)
+                clients[i++] = ptr_client;
+        }
+        memcpy (relay_weechat_test_clients, clients, sizeof (clients));
+        relay_weechat_test_client_disconnect[0] = NULL;
+        relay_weechat_test_client_disconnect[1] = NULL;
+        clear_data_sent ();
+    }
+
+    void teardown ()
+    {
+        int i;
+
+        for (i = 0; i < RELAY_WEECHAT_TEST_CLIENTS; i++)
+        {
+            relay_client_free (relay_weechat_test_clients[i]);
+            relay_weechat_test_clients[i] = NULL;
+        }
+
+        relay_server_free (ptr_relay_server);
+        ptr_relay_server = NULL;
+
+        clear_data_sent ();
+
+        gui_buffer_close (buffer);
+        buffer = NULL;
+
+        /* restore auto-open of relay buffer */
+        config_file_option_reset (relay_config_look_auto_open_buffer, 1);
+    }
+};
+
+/*
+ * Tests functions:
+ *   relay_weechat_hook_signals
+ *   relay_weechat_unhook_signals
+ */
+
+TEST(RelayWeechat, HookUnhookSignals)
+{
+    int i;
+
+    /* signals are hooked for new clients, with one hook for all clients */
+    CHECK(relay_weechat_hook_signal_buffer);
+    LONGS_EQUAL(RELAY_WEECHAT_TEST_CLIENTS,
+                relay_weechat_hook_signal_buffer_clients);
+    for (i = 0; i < RELAY_WEECHAT_TEST_CLIENTS; i++)
+    {
+        LONGS_EQUAL(1, RELAY_WEECHAT_DATA(relay_weechat_test_clients[i],
+                                          signal_buffer_hooked));
+    }
+
+    /* hook signals again for a client */
+    relay_weechat_hook_signals (relay_weechat_test_clients[0]);
+    LONGS_EQUAL(RELAY_WEECHAT_TEST_CLIENTS,
+                relay_weechat_hook_signal_buffer_clients);
+
+    /* unhook signals twice for a client */
+    relay_weechat_unhook_signals (relay_weechat_test_clients[1]);
+    LONGS_EQUAL(2, relay_weechat_hook_signal_buffer_clients);
+    relay_weechat_unhook_signals (relay_weechat_test_clients[1]);
+    LONGS_EQUAL(2, relay_weechat_hook_signal_buffer_clients);
+    CHECK(relay_weechat_hook_signal_buffer);
+
+    /* hook is removed with the last client */
+    relay_weechat_unhook_signals (relay_weechat_test_clients[0]);
+    CHECK(relay_weechat_hook_signal_buffer);
+    relay_weechat_unhook_signals (relay_weechat_test_clients[2]);
+    POINTERS_EQUAL(NULL, relay_weechat_hook_signal_buffer);
+    LONGS_EQUAL(0, relay_weechat_hook_signal_buffer_clients);
+}
+
+/*
+ * Tests functions:
+ *   relay_weechat_protocol_signal_buffer_cb
+ */
+
+TEST(RelayWeechat, SignalBufferDispatch)
+{
+    int i;
+
+    /* no client synchronized with the buffer: nothing is sent */
+    gui_buffer_set (buffer, "title", "title 1");
+    for (i = 0; i < RELAY_WEECHAT_TEST_CLIENTS; i++)
+    {
+        LONGS_EQUAL(0, relay_weechat_test_count_sent[i]);
+    }
+
+    /* same message is sent once to clients synchronized with the buffer */
+    sync_buffer (0, "core.test");
+    sync_buffer (2, "core.test");
+    gui_buffer_set (buffer, "title", "title 2");
+    LONGS_EQUAL(1, relay_weechat_test_count_sent[0]);
+    LONGS_EQUAL(0, relay_weechat_test_count_sent[1]);
+    LONGS_EQUAL(1, relay_weechat_test_count_sent[2]);
+    CHECK(relay_weechat_test_size_sent[0] > 0);
+    LONGS_EQUAL(relay_weechat_test_size_sent[0],
+                relay_weechat_test_size_sent[2]);
+    MEMCMP_EQUAL(relay_weechat_test_data_sent[0],
+                 relay_weechat_test_data_sent[2],
+                 relay_weechat_test_size_sent[0]);
+
+    /* client without signals hooked does not receive the message */
+    relay_weechat_unhook_signals (relay_weechat_test_clients[2]);
+    gui_buffer_set (buffer, "title", "title 3");
+    LONGS_EQUAL(2, relay_weechat_test_count_sent[0]);
+    LONGS_EQUAL(0, relay_weechat_test_count_sent[1]);
+    LONGS_EQUAL(1, relay_weechat_test_count_sent[2]);
+}
+
+/*
+ * Tests functions:
+ *   relay_weechat_protocol_signal_buffer_cb
+ */
+
+TEST(RelayWeechat, SignalBufferDispatchDisconnect)
+{
+    int i;
+
+    for (i = 0; i < RELAY_WEECHAT_TEST_CLIENTS; i++)
+    {
+        sync_buffer (i, "core.test");
+    }
+
+    /* second client is disconnected while message is sent to first client */
+    relay_weechat_test_client_disconnect[0] = relay_weechat_test_clients[1];
+    gui_buffer_set (buffer, "title", "title 1");
+    LONGS_EQUAL(1, relay_weechat_test_count_sent[0]);
+    LONGS_EQUAL(0, relay_weechat_test_count_sent[1]);
+    LONGS_EQUAL(1, relay_weechat_test_count_sent[2]);
+    LONGS_EQUAL(2, relay_weechat_hook_signal_buffer_clients);
+    CHECK(relay_weechat_hook_signal_buffer);
+
+    /*
+     * all clients are disconnected while message is sent to first client:
+     * the shared hook is removed during its own callback
+     */
+    relay_weechat_test_client_disconnect[0] = relay_weechat_test_clients[0];
+    relay_weechat_test_client_disconnect[1] = relay_weechat_test_clients[2];
+    gui_buffer_set (buffer, "title", "title 2");
+    LONGS_EQUAL(2, relay_weechat_test_count_sent[0]);
+    LONGS_EQUAL(0, relay_weechat_test_count_sent[1]);
+    LONGS_EQUAL(1, relay_weechat_test_count_sent[2]);
+    LONGS_EQUAL(0, relay_weechat_hook_signal_buffer_clients);
+    POINTERS_EQUAL(NULL, relay_weechat_hook_signal_buffer);
+
+    /* no more message sent */
+    gui_buffer_set (buffer, "title", "title 3");
+    LONGS_EQUAL(2, relay_weechat_test_count_sent[0]);
+    LONGS_EQUAL(0, relay_weechat_test_count_sent[1]);
+    LONGS_EQUAL(1, relay_weechat_test_count_sent[2]);
+}
@@ -0,0 +1,345 @@
+/*
+ * test-trigger-prefilter.cpp - test trigger prefilter functions
+ *
+ * Copyright (C) 2024 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include "tests/tests.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include "src/core/core-config-file.h"
+#include "src/gui/gui-buffer.h"
+#include "src/plugins/plugin.h"
+#include "src/plugins/trigger/trigger.h"
+#include "src/plugins/trigger/trigger-prefilter.h"
+}
+
+#define WEE_CHECK_REGEX_LITERAL(__result, __regex)                      \
+    literal = trigger_prefilter_regex_literal (__regex);                \
+    if (__result == NULL)                                               \
+    {                                                                   \
+        POINTERS_EQUAL(NULL, literal);                                  \
+    }                                                                   \
+    else                                                                \
+    {                                                                   \
+        STRCMP_EQUAL(__result, literal);                                \
+    }                                                                   \
+    free (literal);
+
+TEST_GROUP(TriggerPrefilter)
+{
+};
+
+/*
+ * Tests functions:
+ *   trigger_prefilter_regex_literal
+ */
+
+TEST(TriggerPrefilter, RegexLiteral)
+{
+    char *literal;
+
+    WEE_CHECK_REGEX_LITERAL(NULL, NULL);
+    WEE_CHECK_REGEX_LITERAL(NULL, "");
+    WEE_CHECK_REGEX_LITERAL(NULL, ".*");
+    WEE_CHECK_REGEX_LITERAL(NULL, "a|b");
+    WEE_CHECK_REGEX_LITERAL(NULL, "([a-z]+)");
+    WEE_CHECK_REGEX_LITERAL(NULL, "a?");
+    WEE_CHECK_REGEX_LITERAL(NULL, "(abc");
+    WEE_CHECK_REGEX_LITERAL(NULL, "abc)");
+    WEE_CHECK_REGEX_LITERAL(NULL, "[abc");
+
+    WEE_CHECK_REGEX_LITERAL("abc", "abc");
+    WEE_CHECK_REGEX_LITERAL("abc", "^abc$");
+    WEE_CHECK_REGEX_LITERAL("hello", "hello.*world");
+    WEE_CHECK_REGEX_LITERAL("world", "hel?lo.*world");
+    WEE_CHECK_REGEX_LITERAL("ab", "ab+cd");
+    WEE_CHECK_REGEX_LITERAL("ab", "abc{0,2}");
+    WEE_CHECK_REGEX_LITERAL("abc", "abc{2}");
+    WEE_CHECK_REGEX_LITERAL("def", "(abc)?def");
+    WEE_CHECK_REGEX_LITERAL("yz", "x[abc]yz");
+    WEE_CHECK_REGEX_LITERAL("yz", "x[]a]yz");
+    WEE_CHECK_REGEX_LITERAL("yz", "x[[:alpha:]]yz");
+    WEE_CHECK_REGEX_LITERAL(".txt", "\\.txt$");
+    WEE_CHECK_REGEX_LITERAL("ab", "ab\\wcd");
+    WEE_CHECK_REGEX_LITERAL("foo", "\\<foo\\>");
+    WEE_CHECK_REGEX_LITERAL("foobar", "foo\\>bar");
+    WEE_CHECK_REGEX_LITERAL("abc", "\\`abc\\'");
+    WEE_CHECK_REGEX_LITERAL("hello ", "\\<hello\\> .*\\<x\\>");
+    WEE_CHECK_REGEX_LITERAL("ab", "(abc|abd)x");
+    WEE_CHECK_REGEX_LITERAL("ab", "(abc|abd)");
+    WEE_CHECK_REGEX_LITERAL("é", "é+x");
+    WEE_CHECK_REGEX_LITERAL("nickserv", "^(/(msg|m) +nickserv)");
+    WEE_CHECK_REGEX_LITERAL(
+        "/",
+        "^((/(msg|m|quote) +nickserv +id +)|/oper +[^ ]+ +|/quote +pass +)"
+        "([^\n]*)");
+}
+
+/*
+ * Tests functions:
+ *   trigger_prefilter_build
+ *   trigger_prefilter_free
+ */
+
+TEST(TriggerPrefilter, Build)
+{
+    struct t_trigger *trigger;
+
+    /* conditions joined with "&&" */
+    trigger = trigger_new (
+        "test", "on", "print", "",
+        "${tg_displayed} && ${tg_tags} !!- ,notify_none, "
+        "&& (${tg_highlight} || ${tg_msg_pv}) && ${buffer.notify} > 0",
+        "", "/print test", "ok", "none");
+    CHECK(trigger);
+    LONGS_EQUAL(1, trigger->prefilters_built);
+    LONGS_EQUAL(2, trigger->prefilters_count);
+    LONGS_EQUAL(TRIGGER_PREFILTER_DISPLAYED, trigger->prefilters[0].type);
+    LONGS_EQUAL(TRIGGER_PREFILTER_TAG, trigger->prefilters[1].type);
+    LONGS_EQUAL(0, trigger->prefilters[1].match);
+    LONGS_EQUAL(1, trigger->prefilters[1].case_sensitive);
+    LONGS_EQUAL(1, trigger->prefilters[1].negate);
+    STRCMP_EQUAL(",notify_none,", trigger->prefilters[1].value);
+    trigger_prefilter_free (trigger);
+    LONGS_EQUAL(0, trigger->prefilters_built);
+    LONGS_EQUAL(0, trigger->prefilters_count);
+    POINTERS_EQUAL(NULL, trigger->prefilters);
+    trigger_free (trigger);
+
+    /* conditions joined with "||": no prefilter */
+    trigger = trigger_new (
+        "test", "on", "print", "",
+        "${tg_displayed} || ${tg_tags} !!- ,notify_none,",
+        "", "/print test", "ok", "none");
+    CHECK(trigger);
+    LONGS_EQUAL(0, trigger->prefilters_count);
+    trigger_free (trigger);
+
+    /* comparisons not supported, or value to evaluate: no prefilter */
+    trigger = trigger_new (
+        "test", "on", "print", "",
+        "${tg_message} =~ abc && ${tg_message} =- ${tg_prefix} "
+        "&& \"${tg_message}\" =- abc && ${tg_tags} =- notify_none "
+        "&& ${tg_unknown} =- abc",
+        "", "/print test", "ok", "none");
+    CHECK(trigger);
+    LONGS_EQUAL(0, trigger->prefilters_count);
+    trigger_free (trigger);
+
+    /* buffer mask and message */
+    trigger = trigger_new (
+        "test", "on", "line", "",
+        "${buffer.full_name} =* irc.* && ${message} !- secret",
+        "", "/print test", "ok", "none");
+    CHECK(trigger);
+    LONGS_EQUAL(2, trigger->prefilters_count);
+    LONGS_EQUAL(TRIGGER_PREFILTER_BUFFER, trigger->prefilters[0].type);
+    LONGS_EQUAL(1, trigger->prefilters[0].match);
+    LONGS_EQUAL(0, trigger->prefilters[0].case_sensitive);
+    LONGS_EQUAL(0, trigger->prefilters[0].negate);
+    STRCMP_EQUAL("irc.*", trigger->prefilters[0].value);
+    LONGS_EQUAL(TRIGGER_PREFILTER_MESSAGE, trigger->prefilters[1].type);
+    LONGS_EQUAL(0, trigger->prefilters[1].match);
+    LONGS_EQUAL(0, trigger->prefilters[1].case_sensitive);
+    LONGS_EQUAL(1, trigger->prefilters[1].negate);
+    STRCMP_EQUAL("secret", trigger->prefilters[1].value);
+    trigger_free (trigger);
+
+    /* regex only: prefilter with literal text of regex */
+    trigger = trigger_new (
+        "test", "on", "modifier", "input_text_display",
+        "", "/pass(word)? +[^ ]+/xxx/ /secret/***/tg_string", "",
+        "ok", "none");
+    CHECK(trigger);
+    LONGS_EQUAL(2, trigger->prefilters_count);
+    LONGS_EQUAL(TRIGGER_PREFILTER_REGEX, trigger->prefilters[0].type);
+    LONGS_EQUAL(0, trigger->prefilters[0].case_sensitive);
+    STRCMP_EQUAL("pass", trigger->prefilters[0].value);
+    LONGS_EQUAL(TRIGGER_PREFILTER_REGEX, trigger->prefilters[1].type);
+    STRCMP_EQUAL("secret", trigger->prefilters[1].value);
+    trigger_free (trigger);
+
+    /* regex with a command or on another variable: no prefilter */
+    trigger = trigger_new (
+        "test", "on", "modifier", "input_text_display",
+        "", "/secret/***/", "/print test", "ok", "none");
+    CHECK(trigger);
+    LONGS_EQUAL(0, trigger->prefilters_count);
+    trigger_free (trigger);
+    trigger = trigger_new (
+        "test", "on", "modifier", "input_text_display",
+        "", "/secret/***/tg_modifier_data", "", "ok", "none");
+    CHECK(trigger);
+    LONGS_EQUAL(0, trigger->prefilters_count);
+    trigger_free (trigger);
+
+    /* one regex without literal: no prefilter */
+    trigger = trigger_new (
+        "test", "on", "modifier", "input_text_display",
+        "", "/secret/***/ /[0-9]+/N/", "", "ok", "none");
+    CHECK(trigger);
+    LONGS_EQUAL(0, trigger->prefilters_count);
+    trigger_free (trigger);
+
+    /* signal: no prefilter */
+    trigger = trigger_new (
+        "test", "on", "signal", "test",
+        "${tg_signal_data} =- abc", "", "/print test", "ok", "none");
+    CHECK(trigger);
+    LONGS_EQUAL(0, trigger->prefilters_count);
+    trigger_free (trigger);
+}
+
+/*
+ * Tests functions:
+ *   trigger_prefilter_data_init
+ *   trigger_prefilter_check
+ */
+
+TEST(TriggerPrefilter, Check)
+{
+    struct t_trigger *trigger;
+    struct t_trigger_prefilter_data data;
+    const char *tags_notify_none[] = { "irc_join", "notify_none", NULL };
+    const char *tags_message[] = { "irc_privmsg", "notify_message", NULL };
+    const char *tags_no_trigger[] = { "no_trigger", NULL };
+
+    LONGS_EQUAL(1, trigger_prefilter_check (NULL, NULL));
+
+    /* print: displayed, tags, message */
+    trigger = trigger_new (
+        "test", "on", "print", "",
+        "${tg_displayed} && ${tg_tags} !!- ,notify_none, "
+        "&& ${tg_message} =- hello",
+        "", "/print test", "ok", "none");
+    CHECK(trigger);
+    LONGS_EQUAL(3, trigger->prefilters_count);
+
+    trigger_prefilter_data_init (&data);
+    POINTERS_EQUAL(NULL, data.buffer);
+    POINTERS_EQUAL(NULL, data.tags);
+    LONGS_EQUAL(0, data.tags_count);
+    POINTERS_EQUAL(NULL, data.str_tags);
+    POINTERS_EQUAL(NULL, data.message);
+    LONGS_EQUAL(-1, data.displayed);
+    LONGS_EQUAL(-1, data.highlight);
+
+    data.buffer = gui_buffers;
+    data.tags = tags_message;
+    data.tags_count = 2;
+    data.message = "Hello world";
+    data.displayed = 1;
+    data.highlight = 0;
+    LONGS_EQUAL(1, trigger_prefilter_check (trigger, &data));
+    LONGS_EQUAL(0, trigger->hook_count_prefilter);
+
+    data.message = "bye";
+    LONGS_EQUAL(0, trigger_prefilter_check (trigger, &data));
+    LONGS_EQUAL(1, trigger->hook_count_prefilter);
+    data.message = "Hello world";
+
+    data.displayed = 0;
+    LONGS_EQUAL(0, trigger_prefilter_check (trigger, &data));
+    LONGS_EQUAL(2, trigger->hook_count_prefilter);
+    data.displayed = 1;
+
+    data.tags = tags_notify_none;
+    LONGS_EQUAL(0, trigger_prefilter_check (trigger, &data));
+    LONGS_EQUAL(3, trigger->hook_count_prefilter);
+
+    data.tags = tags_no_trigger;
+    data.tags_count = 1;
+    LONGS_EQUAL(0, trigger_prefilter_check (trigger, &data));
+    LONGS_EQUAL(4, trigger->hook_count_prefilter);
+
+    /* no tags at all */
+    data.tags = NULL;
+    data.tags_count = 0;
+    LONGS_EQUAL(1, trigger_prefilter_check (trigger, &data));
+
+    /* prefilters are built again after a change in conditions */
+    config_file_option_set (trigger->options[TRIGGER_OPTION_CONDITIONS],
+                            "${tg_highlight}", 1);
+    LONGS_EQUAL(0, trigger->prefilters_built);
+    LONGS_EQUAL(0, trigger_prefilter_check (trigger, &data));
+    LONGS_EQUAL(1, trigger->prefilters_built);
+    LONGS_EQUAL(1, trigger->prefilters_count);
+    data.highlight = 1;
+    LONGS_EQUAL(1, trigger_prefilter_check (trigger, &data));
+
+    trigger_free (trigger);
+
+    /* line: buffer and tags (string) */
+    trigger = trigger_new (
+        "test", "on", "line", "",
+        "${buffer.full_name} ==* core.* && ${tags} =- ,NOTIFY_MESSAGE,",
+        "", "/print test", "ok", "none");
+    CHECK(trigger);
+    LONGS_EQUAL(2, trigger->prefilters_count);
+
+    trigger_prefilter_data_init (&data);
+    data.buffer = gui_buffers;
+    data.str_tags = "irc_privmsg,notify_message";
+    LONGS_EQUAL(1, trigger_prefilter_check (trigger, &data));
+    data.str_tags = "irc_privmsg,notify_message_other";
+    LONGS_EQUAL(0, trigger_prefilter_check (trigger, &data));
+    data.str_tags = "irc_privmsg,notify_message,no_trigger";
+    LONGS_EQUAL(0, trigger_prefilter_check (trigger, &data));
+    data.str_tags = "notify_message";
+    LONGS_EQUAL(1, trigger_prefilter_check (trigger, &data));
+
+    /* unknown buffer: prefilter on buffer is ignored */
+    data.buffer = NULL;
+    LONGS_EQUAL(1, trigger_prefilter_check (trigger, &data));
+
+    trigger_free (trigger);
+
+    trigger = trigger_new (
+        "test", "on", "line", "",
+        "${buffer.full_name} ==* irc.*",
+        "", "/print test", "ok", "none");
+    CHECK(trigger);
+    trigger_prefilter_data_init (&data);
+    data.buffer = gui_buffers;
+    LONGS_EQUAL(0, trigger_prefilter_check (trigger, &data));
+    trigger_free (trigger);
+
+    /* modifier: regex */
+    trigger = trigger_new (
+        "test", "on", "modifier", "input_text_display",
+        "", "/pass(word)? +[^ ]+/xxx/ /secret/***/", "", "ok", "none");
+    CHECK(trigger);
+    LONGS_EQUAL(2, trigger->prefilters_count);
+
+    trigger_prefilter_data_init (&data);
+    data.message = "hello";
+    LONGS_EQUAL(0, trigger_prefilter_check (trigger, &data));
+    data.message = "my PASS is";
+    LONGS_EQUAL(1, trigger_prefilter_check (trigger, &data));
+    data.message = "top secret";
+    LONGS_EQUAL(1, trigger_prefilter_check (trigger, &data));
+    data.message = NULL;
+    LONGS_EQUAL(1, trigger_prefilter_check (trigger, &data));
+
+    trigger_free (trigger);
+}